@@ -0,0 +1,83 @@
+/* Karatsuba畳み込みの素朴な畳み込みに切り替えるサイズ毎の処理時間計測 */
+#include "ri_karatsuba.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* 1条件あたりの計測時間[clock] */
+#define MEASURE_CLOCKS (CLOCKS_PER_SEC / 4)
+
+/* 1ブロックあたりの処理時間[us]を計測 */
+static double MeasureBlockTime(const struct RIConvolveInterface *conv_if, void *conv,
+        const float *input, float *output, uint32_t num_samples)
+{
+    uint32_t num_trials = 0;
+    clock_t start, elapsed;
+
+    start = clock();
+    do {
+        conv_if->Convolve(conv, input, output, num_samples);
+        num_trials++;
+    } while ((elapsed = clock() - start) < MEASURE_CLOCKS);
+
+    return (1.0e6 * (double)elapsed / CLOCKS_PER_SEC) / num_trials;
+}
+
+int main(void)
+{
+    const struct RIConvolveInterface *conv_if = RIKaratsuba_GetInterface();
+    const uint32_t num_coefficients[] = { 256, 1024, 4096 };
+    const uint32_t num_block_samples[] = { 64, 256, 1024 };
+    uint32_t i, j, k;
+
+    for (i = 0; i < sizeof(num_coefficients) / sizeof(num_coefficients[0]); i++) {
+        for (j = 0; j < sizeof(num_block_samples) / sizeof(num_block_samples[0]); j++) {
+            struct RIConvolveConfig config;
+            float *coef, *input, *output;
+            void *conv, *work;
+            int64_t work_size;
+            uint32_t base_case_size;
+
+            config.max_num_coefficients = num_coefficients[i];
+            config.max_num_input_samples = num_block_samples[j];
+            config.fft_partition_size = 0;
+            config.num_head_coefficients = 0;
+            config.num_delay_samples = 0;
+            config.use_worker_thread = 0;
+            work_size = conv_if->CalculateWorkSize(&config);
+            work = malloc((size_t)work_size);
+            conv = conv_if->Create(&config, work, work_size);
+
+            coef = (float *)malloc(sizeof(float) * num_coefficients[i]);
+            input = (float *)malloc(sizeof(float) * num_block_samples[j]);
+            output = (float *)malloc(sizeof(float) * num_block_samples[j]);
+            for (k = 0; k < num_coefficients[i]; k++) {
+                coef[k] = 2.0f * ((float)rand() / RAND_MAX - 0.5f);
+            }
+            for (k = 0; k < num_block_samples[j]; k++) {
+                input[k] = 2.0f * ((float)rand() / RAND_MAX - 0.5f);
+            }
+            conv_if->SetCoefficients(conv, coef, num_coefficients[i]);
+
+            printf("coefficients:%5u block:%5u |", num_coefficients[i], num_block_samples[j]);
+            for (base_case_size = 8; base_case_size <= 256; base_case_size <<= 1) {
+                RIKaratsuba_SetBaseCaseSize(conv, base_case_size);
+                if (RIKaratsuba_GetBaseCaseSize(conv) != base_case_size) {
+                    break;
+                }
+                printf(" %3u:%9.2fus", base_case_size,
+                        MeasureBlockTime(conv_if, conv, input, output, num_block_samples[j]));
+            }
+            printf(" | calibrated:%3u\n", RIKaratsuba_CalibrateBaseCaseSize(conv));
+
+            conv_if->Destroy(conv);
+            free(work);
+            free(coef);
+            free(input);
+            free(output);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,76 @@
+/* Toom-Cook / Karatsuba / FFT畳み込みの処理時間比較 */
+#include "ri_toom_cook.h"
+#include "ri_karatsuba.h"
+#include "ri_fft_convolve.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* 1条件あたりの計測時間[clock] */
+#define MEASURE_CLOCKS (CLOCKS_PER_SEC / 4)
+
+/* 1ブロックあたりの処理時間[us]を計測 */
+static double MeasureBlockTime(const struct RIConvolveInterface *conv_if,
+        const float *coef, uint32_t num_coefficients, const float *input, float *output, uint32_t num_samples)
+{
+    struct RIConvolveConfig config;
+    uint32_t num_trials = 0;
+    clock_t start, elapsed;
+    int64_t work_size;
+    void *conv, *work;
+
+    config.max_num_coefficients = num_coefficients;
+    config.max_num_input_samples = num_samples;
+    config.fft_partition_size = 0;
+    config.num_head_coefficients = 0;
+    config.num_delay_samples = 0;
+    config.use_worker_thread = 0;
+    work_size = conv_if->CalculateWorkSize(&config);
+    work = malloc((size_t)work_size);
+    conv = conv_if->Create(&config, work, work_size);
+    conv_if->SetCoefficients(conv, coef, num_coefficients);
+
+    start = clock();
+    do {
+        conv_if->Convolve(conv, input, output, num_samples);
+        num_trials++;
+    } while ((elapsed = clock() - start) < MEASURE_CLOCKS);
+
+    conv_if->Destroy(conv);
+    free(work);
+
+    return (1.0e6 * (double)elapsed / CLOCKS_PER_SEC) / num_trials;
+}
+
+int main(void)
+{
+    /* 2k-8kの係数長を中心に、2の冪乗とそれ以外を含める */
+    const uint32_t num_coefficients[] = { 1024, 2048, 2049, 3000, 4096, 6000, 8192 };
+    const uint32_t num_block_samples[] = { 256, 1024 };
+    uint32_t i, j, k;
+
+    printf("%12s %6s %13s %13s %13s\n", "coefficients", "block", "ToomCook[us]", "Karatsuba[us]", "FFT[us]");
+    for (i = 0; i < sizeof(num_coefficients) / sizeof(num_coefficients[0]); i++) {
+        float *coef = (float *)malloc(sizeof(float) * num_coefficients[i]);
+        for (k = 0; k < num_coefficients[i]; k++) {
+            coef[k] = 2.0f * ((float)rand() / RAND_MAX - 0.5f);
+        }
+        for (j = 0; j < sizeof(num_block_samples) / sizeof(num_block_samples[0]); j++) {
+            float *input = (float *)malloc(sizeof(float) * num_block_samples[j]);
+            float *output = (float *)malloc(sizeof(float) * num_block_samples[j]);
+            for (k = 0; k < num_block_samples[j]; k++) {
+                input[k] = 2.0f * ((float)rand() / RAND_MAX - 0.5f);
+            }
+            printf("%12u %6u %13.2f %13.2f %13.2f\n", num_coefficients[i], num_block_samples[j],
+                    MeasureBlockTime(RIToomCook_GetInterface(), coef, num_coefficients[i], input, output, num_block_samples[j]),
+                    MeasureBlockTime(RIKaratsuba_GetInterface(), coef, num_coefficients[i], input, output, num_block_samples[j]),
+                    MeasureBlockTime(RIFFTConvolve_GetInterface(), coef, num_coefficients[i], input, output, num_block_samples[j]));
+            free(input);
+            free(output);
+        }
+        free(coef);
+    }
+
+    return 0;
+}
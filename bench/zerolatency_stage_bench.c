@@ -0,0 +1,68 @@
+/* ゼロレイテンシー畳み込みの係数長に対する1サンプルあたり処理時間 */
+#include "ri_zerolatency_fft_convolve.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* 1条件あたりの計測時間[clock] */
+#define MEASURE_CLOCKS (CLOCKS_PER_SEC / 4)
+
+int main(void)
+{
+    const uint32_t num_coefficients[] = { 1024, 4096, 16384, 65536, 262144 };
+    const uint32_t num_block_samples[] = { 32, 256, 1024 };
+    const struct RIConvolveInterface *conv_if = RIZeroLatencyFFTConvolve_GetInterface();
+    uint32_t i, j, k;
+
+    printf("%12s %6s %9s %6s %13s\n", "coefficients", "block", "partition", "stages", "[ns/sample]");
+    for (i = 0; i < sizeof(num_coefficients) / sizeof(num_coefficients[0]); i++) {
+        float *coef = (float *)malloc(sizeof(float) * num_coefficients[i]);
+        for (k = 0; k < num_coefficients[i]; k++) {
+            coef[k] = 2.0f * ((float)rand() / RAND_MAX - 0.5f);
+        }
+        for (j = 0; j < sizeof(num_block_samples) / sizeof(num_block_samples[0]); j++) {
+            struct RIConvolveConfig config;
+            uint32_t num_trials = 0;
+            clock_t start, elapsed;
+            int64_t work_size;
+            void *conv, *work;
+            float *input = (float *)malloc(sizeof(float) * num_block_samples[j]);
+            float *output = (float *)malloc(sizeof(float) * num_block_samples[j]);
+
+            for (k = 0; k < num_block_samples[j]; k++) {
+                input[k] = 2.0f * ((float)rand() / RAND_MAX - 0.5f);
+            }
+
+            config.max_num_coefficients = num_coefficients[i];
+            config.max_num_input_samples = num_block_samples[j];
+            config.fft_partition_size = 0;
+            config.num_head_coefficients = 0;
+            config.num_delay_samples = 0;
+            config.use_worker_thread = 0;
+            work_size = conv_if->CalculateWorkSize(&config);
+            work = malloc((size_t)work_size);
+            conv = conv_if->Create(&config, work, work_size);
+            /* 分割サイズは計測して決める */
+            RIZeroLatencyFFTConvolve_CalibratePartitionSize(conv, coef, num_coefficients[i]);
+
+            start = clock();
+            do {
+                conv_if->Convolve(conv, input, output, num_block_samples[j]);
+                num_trials++;
+            } while ((elapsed = clock() - start) < MEASURE_CLOCKS);
+
+            printf("%12u %6u %9u %6u %13.2f\n", num_coefficients[i], num_block_samples[j],
+                    RIZeroLatencyFFTConvolve_GetPartitionSize(conv), RIZeroLatencyFFTConvolve_GetNumStages(conv),
+                    (1.0e9 * (double)elapsed / CLOCKS_PER_SEC) / ((double)num_trials * num_block_samples[j]));
+
+            conv_if->Destroy(conv);
+            free(work);
+            free(input);
+            free(output);
+        }
+        free(coef);
+    }
+
+    return 0;
+}
@@ -0,0 +1,78 @@
+/* ゼロレイテンシー畳み込みのワーカースレッド有無での呼び出し元スレッドの処理時間 */
+#include "ri_zerolatency_fft_convolve.h"
+#include "ri_convolve_statistics.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* 1条件あたりの呼び出し回数 */
+#define NUM_CALLS 20000
+/* 計測前に捨てる呼び出し回数 */
+#define NUM_WARMUP_CALLS 1000
+
+int main(void)
+{
+    const uint32_t num_coefficients[] = { 16384, 65536, 262144 };
+    const uint32_t num_block_samples[] = { 32, 256 };
+    const struct RIConvolveInterface *conv_if = RIZeroLatencyFFTConvolve_GetInterface();
+    uint32_t i, j, k, worker;
+
+    printf("%12s %6s %6s %15s %15s\n", "coefficients", "block", "worker", "mean[ticks/call]", "max[ticks/call]");
+    for (i = 0; i < sizeof(num_coefficients) / sizeof(num_coefficients[0]); i++) {
+        float *coef = (float *)malloc(sizeof(float) * num_coefficients[i]);
+        for (k = 0; k < num_coefficients[i]; k++) {
+            coef[k] = 2.0f * ((float)rand() / RAND_MAX - 0.5f);
+        }
+        for (j = 0; j < sizeof(num_block_samples) / sizeof(num_block_samples[0]); j++) {
+            for (worker = 0; worker <= 1; worker++) {
+                struct RIConvolveConfig config;
+                uint64_t total_ticks = 0, max_ticks = 0;
+                int64_t work_size;
+                void *conv, *work;
+                float *input = (float *)malloc(sizeof(float) * num_block_samples[j]);
+                float *output = (float *)malloc(sizeof(float) * num_block_samples[j]);
+
+                for (k = 0; k < num_block_samples[j]; k++) {
+                    input[k] = 2.0f * ((float)rand() / RAND_MAX - 0.5f);
+                }
+
+                /* 分割サイズは揃えて比較する */
+                config.max_num_coefficients = num_coefficients[i];
+                config.max_num_input_samples = num_block_samples[j];
+                config.fft_partition_size = 256;
+                config.num_head_coefficients = 0;
+                config.num_delay_samples = 0;
+                config.use_worker_thread = (uint8_t)worker;
+                work_size = conv_if->CalculateWorkSize(&config);
+                work = malloc((size_t)work_size);
+                conv = conv_if->Create(&config, work, work_size);
+                conv_if->SetCoefficients(conv, coef, num_coefficients[i]);
+
+                /* 呼び出し毎の経過時間を計測 */
+                for (k = 0; k < NUM_WARMUP_CALLS + NUM_CALLS; k++) {
+                    const uint64_t start = RIConvolveStatistics_GetTicks();
+                    uint64_t ticks;
+                    conv_if->Convolve(conv, input, output, num_block_samples[j]);
+                    ticks = RIConvolveStatistics_GetTicks() - start;
+                    if (k >= NUM_WARMUP_CALLS) {
+                        total_ticks += ticks;
+                        if (ticks > max_ticks) {
+                            max_ticks = ticks;
+                        }
+                    }
+                }
+
+                printf("%12u %6u %6u %15.0f %15.0f\n", num_coefficients[i], num_block_samples[j], worker,
+                        (double)total_ticks / NUM_CALLS, (double)max_ticks);
+
+                conv_if->Destroy(conv);
+                free(work);
+                free(input);
+                free(output);
+            }
+        }
+        free(coef);
+    }
+
+    return 0;
+}
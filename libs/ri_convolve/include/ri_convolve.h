@@ -3,28 +3,73 @@
 
 #include <stdint.h>
 
+/* ワークサイズの上限: int64_tとアドレス空間の小さい方 */
+#define RICONVOLVE_MAX_WORK_SIZE ((int64_t)(((uint64_t)SIZE_MAX < (uint64_t)INT64_MAX) ? (uint64_t)SIZE_MAX : (uint64_t)INT64_MAX))
+/* ワークサイズの加算 どちらかが負(エラー)または上限を超える場合は-1 */
+#define RICONVOLVE_ADD_WORK_SIZE(a, b) \
+    ((((int64_t)(a) < 0) || ((int64_t)(b) < 0) || ((int64_t)(a) > RICONVOLVE_MAX_WORK_SIZE - (int64_t)(b))) \
+     ? (int64_t)-1 : ((int64_t)(a) + (int64_t)(b)))
+/* ワークサイズと個数の乗算 ワークサイズが負(エラー)または上限を超える場合は-1 */
+#define RICONVOLVE_MUL_WORK_SIZE(size, num) \
+    ((((int64_t)(size) < 0) || (((uint64_t)(num) != 0) && ((uint64_t)(size) > (uint64_t)RICONVOLVE_MAX_WORK_SIZE / (uint64_t)(num)))) \
+     ? (int64_t)-1 : ((int64_t)(size) * (int64_t)(num)))
+/* 要素数num_elemsの配列をアラインして確保するためのワークサイズ 上限を超える場合は-1 */
+#define RICONVOLVE_ARRAY_WORK_SIZE(elem_size, num_elems, alignment) \
+    RICONVOLVE_ADD_WORK_SIZE(RICONVOLVE_MUL_WORK_SIZE(elem_size, num_elems), alignment)
+
 /* 初期化コンフィグ */
 struct RIConvolveConfig {
     uint32_t max_num_coefficients; /* 最大係数数 */
     uint32_t max_num_input_samples; /* 最大入力サンプル数 */
+    uint32_t fft_partition_size; /* FFT畳み込みの係数分割サイズ(2の冪乗に切り上げ). 0で既定値 */
+    uint32_t num_head_coefficients; /* ゼロレイテンシー畳み込みで時間領域処理する先頭係数長. 0で分割サイズから決める */
+    uint32_t num_delay_samples; /* FFT畳み込みで出力を追加で遅らせるサンプル数. 通常は0 */
+    uint8_t use_worker_thread; /* ゼロレイテンシー畳み込みでFFT畳み込みをワーカースレッドで処理するか. 0で呼び出し元スレッドで処理 */
+};
+
+/* 処理時間ヒストグラムのビン数 */
+#define RICONVOLVE_STATISTICS_NUM_HISTOGRAM_BINS 48
+
+/* 統計情報
+* RICONVOLVE_ENABLE_STATISTICSを定義してビルドした場合のみ計測する（既定では無効）
+* 時間の単位はティック（x86ではタイムスタンプカウンタのサイクル数, それ以外はナノ秒）
+* 平均処理時間はtotal_ticks / num_calls, パーセンタイルはRIConvolveStatistics_GetPercentileTicksで求める */
+struct RIConvolveStatistics {
+    uint64_t num_calls; /* 畳み込み呼び出し回数（サンプル数0の呼び出しは除く） */
+    uint64_t num_samples; /* 処理したサンプル数 */
+    uint64_t num_ffts; /* 実行したFFT回数 */
+    uint64_t num_iffts; /* 実行したIFFT回数 */
+    uint64_t num_partition_macs; /* 実行した分割毎の複素乗算/加算回数 */
+    uint64_t num_skipped_partition_macs; /* 係数長が最大係数長より短いため省略した分割毎の複素乗算/加算回数 */
+    uint64_t num_deadline_misses; /* ワーカースレッドの処理が間に合わず、FFT畳み込み段の出力を無音で代用した呼び出し回数 */
+    uint64_t min_ticks; /* 1呼び出しの最小処理時間 */
+    uint64_t max_ticks; /* 1呼び出しの最大処理時間 */
+    uint64_t total_ticks; /* 処理時間の合計 */
+    uint64_t histogram[RICONVOLVE_STATISTICS_NUM_HISTOGRAM_BINS]; /* 1呼び出しの処理時間の度数: i番目は[2^i, 2^(i+1))ティック（先頭は[0, 2)） */
 };
 
 /* 畳み込みインターフェース */
 struct RIConvolveInterface {
   /* ワークサイズ計算 */
-  int32_t (*CalculateWorkSize)(const struct RIConvolveConfig *config);
+  int64_t (*CalculateWorkSize)(const struct RIConvolveConfig *config);
   /* インスタンス作成 */
-  void* (*Create)(const struct RIConvolveConfig *config, void *work, int32_t work_size);
+  void* (*Create)(const struct RIConvolveConfig *config, void *work, int64_t work_size);
   /* インスタンス破棄 */
   void (*Destroy)(void *obj);
   /* 内部状態リセット */
   void (*Reset)(void *obj);
   /* 畳み込み係数セット */
   void (*SetCoefficients)(void *obj, const float *coefficients, uint32_t num_coefficients);
-  /* 畳み込み演算実行 */
+  /* 畳み込み演算実行 inputとoutputは同一領域でもよい（部分的な重なりは不可） */
   void (*Convolve)(void *obj, const float *input, float *output, uint32_t num_samples);
+  /* 要素間隔を指定した畳み込み演算実行 input_stride/output_strideはfloat要素単位(1以上). インターリーブされたデータを直接読み書きできる
+   * inputとoutputは同じ間隔なら同一領域でもよい */
+  void (*ConvolveStrided)(void *obj, const float *input, uint32_t input_stride, float *output, uint32_t output_stride, uint32_t num_samples);
   /* レイテンシーの取得 */
   int32_t (*GetLatencyNumSamples)(void *obj);
+  /* 統計情報の取得 取得できたら1, 統計情報を無効にしてビルドした場合は0を返す
+   * 畳み込み処理中に別スレッドから呼んでもよい（ロックせずに一貫したスナップショットを取る）. 作成・破棄・係数セットとは並行して呼ばないこと */
+  uint8_t (*GetStatistics)(void *obj, struct RIConvolveStatistics *statistics);
 };
 
 #endif /* RICONVOLVE_H_INCLUDED */
@@ -0,0 +1,61 @@
+#ifndef RICONVOLVEPLANNER_H_INCLUDED
+#define RICONVOLVEPLANNER_H_INCLUDED
+
+#include <stdint.h>
+#include "ri_convolve.h"
+
+/* 計画の候補となる畳み込みモジュール */
+typedef enum RIConvolvePlannerEngine {
+    RICONVOLVEPLANNER_ENGINE_KARATSUBA = 0, /* RIKaratsuba */
+    RICONVOLVEPLANNER_ENGINE_FFT, /* RIFFTConvolve */
+    RICONVOLVEPLANNER_ENGINE_ZEROLATENCY_FFT, /* RIZeroLatencyFFTConvolve */
+    RICONVOLVEPLANNER_ENGINE_DIRECT_FIR, /* RIDirectFIR */
+    RICONVOLVEPLANNER_ENGINE_TOOM_COOK, /* RIToomCook */
+    RICONVOLVEPLANNER_ENGINE_NUM
+} RIConvolvePlannerEngine;
+
+/* 計画結果 */
+struct RIConvolvePlan {
+    RIConvolvePlannerEngine engine; /* 選んだモジュール */
+    const struct RIConvolveInterface *convolve_if; /* 選んだモジュールのインターフェース */
+    struct RIConvolveConfig config; /* convolve_ifに渡すコンフィグ（分割サイズ等は決定済み） */
+};
+
+/* API結果型 */
+typedef enum RIConvolvePlannerApiResult {
+    RICONVOLVEPLANNER_APIRESULT_OK = 0,
+    RICONVOLVEPLANNER_APIRESULT_INVALID_ARGUMENT,
+    RICONVOLVEPLANNER_APIRESULT_INSUFFICIENT_BUFFER,
+    RICONVOLVEPLANNER_APIRESULT_NOT_FOUND,
+    RICONVOLVEPLANNER_APIRESULT_NG
+} RIConvolvePlannerApiResult;
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* 計画に必要なワークサイズ計算 */
+int64_t RIConvolvePlanner_CalculateWorkSize(const struct RIConvolveConfig *config);
+
+/* 候補のモジュールと分割サイズで実際に処理時間（経過時間）を計測し、最速の組み合わせを選ぶ
+* configの最大係数長・最大入力サンプル数・先頭係数長・遅延サンプル数・ワーカースレッド使用有無は候補にそのまま渡す
+* 分割サイズは計画で決めるため、configのfft_partition_sizeは使わない
+* max_latency_num_samples レイテンシーの許容値. これを超える候補は選ばない（0ならゼロレイテンシーのみ） */
+RIConvolvePlannerApiResult RIConvolvePlanner_Plan(const struct RIConvolveConfig *config,
+        uint32_t max_latency_num_samples, struct RIConvolvePlan *plan, void *work, int64_t work_size);
+
+/* wisdomファイルから同じ条件の計画を探す
+* ファイルがない・同じ条件の計画がない場合はRICONVOLVEPLANNER_APIRESULT_NOT_FOUND
+* 計測結果はマシン依存のため、CPU名・命令セットが異なるマシンで保存した計画は使わない */
+RIConvolvePlannerApiResult RIConvolvePlanner_LoadWisdom(const char *path,
+        const struct RIConvolveConfig *config, uint32_t max_latency_num_samples, struct RIConvolvePlan *plan);
+
+/* 計画をwisdomファイルに追記 同じ条件の計画が既にあれば後から追記したものが優先される */
+RIConvolvePlannerApiResult RIConvolvePlanner_SaveWisdom(const char *path,
+        const struct RIConvolveConfig *config, uint32_t max_latency_num_samples, const struct RIConvolvePlan *plan);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* RICONVOLVEPLANNER_H_INCLUDED */
@@ -0,0 +1,43 @@
+#ifndef RICONVOLVESTATISTICS_H_INCLUDED
+#define RICONVOLVESTATISTICS_H_INCLUDED
+
+#include <stdint.h>
+#include "ri_convolve.h"
+
+/* 統計情報の計測器
+* 書き込み側（畳み込み処理スレッド）はlocalを更新し、RIConvolveStatistics_Publishでpublishedに反映する
+* 読み出し側はRIConvolveStatistics_Snapshotでpublishedを読む. sequenceが奇数の間は反映中 */
+struct RIConvolveStatisticsCounter {
+    struct RIConvolveStatistics local; /* 書き込み側のみが触る集計値 */
+    uint64_t sequence; /* 反映毎に2ずつ進むシーケンス番号 */
+    struct RIConvolveStatistics published; /* 読み出し側に公開した集計値 */
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* 現在のティック取得 */
+uint64_t RIConvolveStatistics_GetTicks(void);
+
+/* 計測器の初期化 */
+void RIConvolveStatistics_Initialize(struct RIConvolveStatisticsCounter *counter);
+
+/* 1呼び出し分の処理サンプル数と処理時間を集計 num_samplesが0の場合は集計しない */
+void RIConvolveStatistics_RecordCall(struct RIConvolveStatisticsCounter *counter, uint32_t num_samples, uint64_t ticks);
+
+/* 集計値を読み出し側に公開 書き込み側のスレッドのみが呼ぶこと */
+void RIConvolveStatistics_Publish(struct RIConvolveStatisticsCounter *counter);
+
+/* 公開済みの集計値を取得 書き込み側と並行して呼んでよい */
+void RIConvolveStatistics_Snapshot(const struct RIConvolveStatisticsCounter *counter, struct RIConvolveStatistics *statistics);
+
+/* 処理時間のパーセンタイル取得 percentは0から100
+* 該当するヒストグラムのビンの上端を返すため、実際の値より最大2倍大きくなる. 呼び出しがなければ0 */
+uint64_t RIConvolveStatistics_GetPercentileTicks(const struct RIConvolveStatistics *statistics, uint32_t percent);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* RICONVOLVESTATISTICS_H_INCLUDED */
@@ -0,0 +1,19 @@
+#ifndef RIDIRECTFIR_H_INCLUDED
+#define RIDIRECTFIR_H_INCLUDED
+
+#include "ri_convolve.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* インターフェース取得
+* 短い係数向けの直接型FIRフィルタ. レイテンシは0
+* AVX2/AVX-512が有効なビルドではFMA命令で複数出力をまとめて計算する */
+const struct RIConvolveInterface* RIDirectFIR_GetInterface(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RIDIRECTFIR_H_INCLUDED */
@@ -9,6 +9,52 @@ extern "C" {
 
 const struct RIConvolveInterface *RIFFTConvolve_GetInterface(void);
 
+/* 分割スペクトルのサイズ(float要素数)計算 */
+uint32_t RIFFTConvolve_CalculateSpectrumSize(uint32_t partition_size, uint32_t num_coefficients);
+
+/* 係数を分割してフーリエ変換したスペクトルを作成
+* partition_size 分割サイズ(2の冪乗)
+* spectrum 出力スペクトル(RIFFTConvolve_CalculateSpectrumSizeの要素数が必要)
+* work 作業用配列(2 * partition_sizeの要素数が必要)
+*/
+void RIFFTConvolve_MakeSpectrum(uint32_t partition_size,
+        const float *coefficients, uint32_t num_coefficients, float *spectrum, float *work);
+
+/* RIFFT_RealFFTの出力形式のスペクトルsrcとcoefを複素乗算し、dstに足し込む
+* num_complex 複素数の個数(FFT点数/2) 先頭の1複素数は直流成分と最高周波数成分の実部
+*/
+void RIFFTConvolve_MulAddSpectrum(float *dst, const float *src, const float *coef, uint32_t num_complex);
+
+/* 変換済みの分割スペクトルをセット
+* スペクトルはコピーせずに参照するため、インスタンスが使用している間は領域を保持すること
+* スペクトルの分割サイズはRIFFTConvolve_GetPartitionSizeの値と一致していること
+*/
+void RIFFTConvolve_BindSpectrum(void *obj, const float *spectrum, uint32_t num_coefficients);
+
+/* 分割サイズの取得 */
+uint32_t RIFFTConvolve_GetPartitionSize(const void *obj);
+
+/* 畳み込み結果をoutputに足し込む
+* インターフェースのConvolveと同じ処理で、結果を上書きせずに加算する
+*/
+void RIFFTConvolve_ConvolveAdd(void *obj, const float *input, float *output, uint32_t num_samples);
+
+/* 要素間隔を指定して畳み込み結果をoutputに足し込む
+* input_stride/output_strideはfloat要素単位(1以上)
+*/
+void RIFFTConvolve_ConvolveAddStrided(void *obj,
+        const float *input, uint32_t input_stride, float *output, uint32_t output_stride, uint32_t num_samples);
+
+/* 変換済みの入力スペクトルから1分割分の畳み込み計算
+* input_spectrum 入力スペクトル. 前回と今回の分割(計2 * partition_size点)を並べた信号をRIFFT_RealFFTで変換したもの
+*                RIFFT_RealFFTの形式(x[0]に直流成分, x[1]に最高周波数成分)で、正規化は不要
+* output 今回の分割の出力(partition_sizeの要素数が必要). 時間領域の信号
+* 入力側の変換のみ省ける. 周波数領域の積は巡回畳み込みで前半が折り返しているため、出力は逆変換して時間領域で返す
+* input_spectrumとoutputは同一領域でもよい
+* 時間領域のConvolveとは内部状態を共有するため、切り替える際はResetすること
+*/
+void RIFFTConvolve_ConvolveSpectrum(void *obj, const float *input_spectrum, float *output);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,59 @@
+#ifndef RIIRCOMPOSER_H_INCLUDED
+#define RIIRCOMPOSER_H_INCLUDED
+
+#include <stdint.h>
+
+/* インパルス応答グラフのノード種別 */
+typedef enum RIIRNodeType {
+    RIIRNODE_TYPE_IMPULSE = 0, /* インパルス応答（葉） */
+    RIIRNODE_TYPE_SERIES, /* 子ノードの直列接続（畳み込み） */
+    RIIRNODE_TYPE_PARALLEL /* 子ノードの並列接続（和） */
+} RIIRNodeType;
+
+/* インパルス応答グラフのノード
+* 同じノードを複数の親から参照してよいが、循環参照は不可 */
+struct RIIRNode {
+    RIIRNodeType type; /* ノード種別 */
+    float gain; /* ノードの出力に掛けるゲイン */
+    const float *coefficients; /* 係数（RIIRNODE_TYPE_IMPULSEのみ） */
+    uint32_t num_coefficients; /* 係数長（RIIRNODE_TYPE_IMPULSEのみ） */
+    const struct RIIRNode *const *children; /* 子ノード（RIIRNODE_TYPE_SERIES, RIIRNODE_TYPE_PARALLELのみ） */
+    uint32_t num_children; /* 子ノード数（RIIRNODE_TYPE_SERIES, RIIRNODE_TYPE_PARALLELのみ） */
+};
+
+/* API結果型 */
+typedef enum RIIRComposerApiResult {
+    RIIRCOMPOSER_APIRESULT_OK = 0,
+    RIIRCOMPOSER_APIRESULT_INVALID_ARGUMENT,
+    RIIRCOMPOSER_APIRESULT_INSUFFICIENT_BUFFER,
+    RIIRCOMPOSER_APIRESULT_NG
+} RIIRComposerApiResult;
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* 合成後の係数長を取得 不正なグラフの場合は0を返す */
+uint32_t RIIRComposer_GetNumCoefficients(const struct RIIRNode *root);
+
+/* 合成に必要なワークサイズ計算
+* partition_size RIIRComposer_ComposeSpectrumで使用する分割サイズ(RIIRComposer_Composeのみ使用する場合は0) */
+int64_t RIIRComposer_CalculateWorkSize(const struct RIIRNode *root, uint32_t partition_size);
+
+/* グラフを1つのインパルス応答に合成
+* 合成後の係数長のFFT点数で全ての葉を一度ずつ変換し、直列は積・並列は和を周波数領域でとる
+* coefficients 合成結果(num_coefficients要素. RIIRComposer_GetNumCoefficients以上必要. 余った要素は0埋め) */
+RIIRComposerApiResult RIIRComposer_Compose(const struct RIIRNode *root,
+        float *coefficients, uint32_t num_coefficients, void *work, int64_t work_size);
+
+/* グラフを合成して分割スペクトルを作成
+* spectrum 出力スペクトル(RIFFTConvolve_CalculateSpectrumSize(partition_size, RIIRComposer_GetNumCoefficients(root))の要素数が必要)
+* 結果はRIFFTConvolve_BindSpectrumでFFT畳み込みにセットできる */
+RIIRComposerApiResult RIIRComposer_ComposeSpectrum(const struct RIIRNode *root,
+        uint32_t partition_size, float *spectrum, void *work, int64_t work_size);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* RIIRCOMPOSER_H_INCLUDED */
@@ -10,6 +10,17 @@ extern "C" {
 /* インターフェース取得 */
 const struct RIConvolveInterface* RIKaratsuba_GetInterface(void);
 
+/* 素朴な畳み込みに切り替えるサイズの設定
+* 8以上、最大処理サンプル単位以下に制限する。内部状態はリセットされる */
+void RIKaratsuba_SetBaseCaseSize(void *obj, uint32_t base_case_size);
+
+/* 素朴な畳み込みに切り替えるサイズの取得 */
+uint32_t RIKaratsuba_GetBaseCaseSize(const void *obj);
+
+/* 最大入力サンプル数での処理時間を計測し、最速となる素朴な畳み込みに切り替えるサイズを設定
+* 係数セット後に呼ぶこと。設定したサイズを返す。内部状態はリセットされる */
+uint32_t RIKaratsuba_CalibrateBaseCaseSize(void *obj);
+
 #ifdef __cplusplus
 }
 #endif
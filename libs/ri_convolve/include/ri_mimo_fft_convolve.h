@@ -0,0 +1,51 @@
+#ifndef RIMIMOFFTCONVOLVE_H_INCLUDED
+#define RIMIMOFFTCONVOLVE_H_INCLUDED
+
+#include <stdint.h>
+
+/* 多入力多出力FFT畳み込み生成コンフィグ */
+struct RIMIMOFFTConvolveConfig {
+    uint32_t num_input_channels; /* 入力チャンネル数 */
+    uint32_t num_output_channels; /* 出力チャンネル数 */
+    uint32_t max_num_coefficients; /* 最大係数数 */
+    uint32_t fft_partition_size; /* 係数分割サイズ(2の冪乗に切り上げ). 0で既定値 */
+};
+
+struct RIMIMOFFTConvolve;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ワークサイズ計算 */
+int64_t RIMIMOFFTConvolve_CalculateWorkSize(const struct RIMIMOFFTConvolveConfig *config);
+
+/* インスタンス作成 */
+struct RIMIMOFFTConvolve *RIMIMOFFTConvolve_Create(const struct RIMIMOFFTConvolveConfig *config, void *work, int64_t work_size);
+
+/* インスタンス破棄 */
+void RIMIMOFFTConvolve_Destroy(struct RIMIMOFFTConvolve *conv);
+
+/* 内部状態リセット */
+void RIMIMOFFTConvolve_Reset(struct RIMIMOFFTConvolve *conv);
+
+/* 入力チャンネルinputから出力チャンネルoutputへの畳み込み係数セット
+* 係数をセットしていない組み合わせは無音とみなす */
+void RIMIMOFFTConvolve_SetCoefficients(struct RIMIMOFFTConvolve *conv,
+        uint32_t input_channel, uint32_t output_channel, const float *coefficients, uint32_t num_coefficients);
+
+/* 畳み込み演算実行
+* input 入力チャンネル数分の入力信号
+* output 出力チャンネル数分の出力信号
+* 各入力は1回だけFFTし、出力毎に周波数領域で全入力の積和をとってから1回だけIFFTする */
+void RIMIMOFFTConvolve_Convolve(struct RIMIMOFFTConvolve *conv,
+        const float *const *input, float *const *output, uint32_t num_samples);
+
+/* レイテンシーの取得 */
+int32_t RIMIMOFFTConvolve_GetLatencyNumSamples(const struct RIMIMOFFTConvolve *conv);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RIMIMOFFTCONVOLVE_H_INCLUDED */
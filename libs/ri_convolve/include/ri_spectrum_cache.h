@@ -0,0 +1,66 @@
+#ifndef RISPECTRUMCACHE_H_INCLUDED
+#define RISPECTRUMCACHE_H_INCLUDED
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* スペクトルキャッシュ生成コンフィグ */
+struct RISpectrumCacheConfig {
+    uint32_t max_num_entries; /* 最大エントリ数 */
+    uint32_t max_partition_size; /* 最大分割サイズ */
+    size_t max_memory_size; /* スペクトルと照合用の係数の格納に使用するメモリサイズ[byte] */
+};
+
+/* API結果型 */
+typedef enum RISpectrumCacheApiResult {
+    RISPECTRUMCACHE_APIRESULT_OK = 0,
+    RISPECTRUMCACHE_APIRESULT_INVALID_ARGUMENT,
+    RISPECTRUMCACHE_APIRESULT_EXCEED_MAX_ENTRIES,
+    RISPECTRUMCACHE_APIRESULT_EXCEED_MAX_MEMORY,
+    RISPECTRUMCACHE_APIRESULT_NG
+} RISpectrumCacheApiResult;
+
+struct RISpectrumCache;
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* スペクトルキャッシュ作成に必要なワークサイズ計算 */
+int64_t RISpectrumCache_CalculateWorkSize(const struct RISpectrumCacheConfig *config);
+
+/* スペクトルキャッシュ作成 */
+struct RISpectrumCache *RISpectrumCache_Create(const struct RISpectrumCacheConfig *config, void *work, int64_t work_size);
+
+/* スペクトルキャッシュ破棄 */
+void RISpectrumCache_Destroy(struct RISpectrumCache *cache);
+
+/* 参照されていないエントリを全て破棄 */
+void RISpectrumCache_Clear(struct RISpectrumCache *cache);
+
+/* 係数に対応する分割スペクトルを取得
+* 係数長・分割サイズ・係数の内容が一致するエントリがあればそれを返し、無ければ変換して登録する
+* 内容はハッシュ値で絞り込んだ上で、エントリに保持した係数と比較する
+* メモリが不足する場合は参照されていないエントリを最も古く使われたものから破棄する
+* 取得したスペクトルはRISpectrumCache_Releaseを呼ぶまで破棄されない
+* 取得したスペクトルはRIFFTConvolve_BindSpectrumでFFT畳み込みにセットできる
+* 注意）スレッドセーフではない */
+RISpectrumCacheApiResult RISpectrumCache_Acquire(
+        struct RISpectrumCache *cache, const float *coefficients, uint32_t num_coefficients,
+        uint32_t partition_size, const float **pspectrum);
+
+/* 取得したスペクトルの参照を解放 */
+RISpectrumCacheApiResult RISpectrumCache_Release(
+        struct RISpectrumCache *cache, const float *spectrum);
+
+/* 登録済みのエントリ数取得 */
+uint32_t RISpectrumCache_GetNumEntries(const struct RISpectrumCache *cache);
+
+/* スペクトルと照合用の係数の格納に使用中のメモリサイズ取得 */
+size_t RISpectrumCache_GetUsedMemorySize(const struct RISpectrumCache *cache);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* RISPECTRUMCACHE_H_INCLUDED */
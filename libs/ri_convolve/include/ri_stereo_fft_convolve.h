@@ -0,0 +1,51 @@
+#ifndef RISTEREOFFTCONVOLVE_H_INCLUDED
+#define RISTEREOFFTCONVOLVE_H_INCLUDED
+
+#include <stdint.h>
+
+/* チャンネル数 */
+#define RISTEREOFFTCONVOLVE_NUM_CHANNELS 2
+
+/* ステレオFFT畳み込み生成コンフィグ */
+struct RIStereoFFTConvolveConfig {
+    uint32_t max_num_coefficients; /* 最大係数数 */
+    uint32_t fft_partition_size; /* 係数分割サイズ(2の冪乗に切り上げ). 0で既定値 */
+};
+
+struct RIStereoFFTConvolve;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ワークサイズ計算 */
+int64_t RIStereoFFTConvolve_CalculateWorkSize(const struct RIStereoFFTConvolveConfig *config);
+
+/* インスタンス作成 */
+struct RIStereoFFTConvolve *RIStereoFFTConvolve_Create(const struct RIStereoFFTConvolveConfig *config, void *work, int64_t work_size);
+
+/* インスタンス破棄 */
+void RIStereoFFTConvolve_Destroy(struct RIStereoFFTConvolve *conv);
+
+/* 内部状態リセット */
+void RIStereoFFTConvolve_Reset(struct RIStereoFFTConvolve *conv);
+
+/* チャンネルchannelの畳み込み係数セット */
+void RIStereoFFTConvolve_SetCoefficients(struct RIStereoFFTConvolve *conv,
+        uint32_t channel, const float *coefficients, uint32_t num_coefficients);
+
+/* 畳み込み演算実行
+* input 2チャンネル分の入力信号
+* output 2チャンネル分の出力信号
+* 2チャンネルを1つの複素信号の実部・虚部にまとめて1回の複素FFT/IFFTで処理する */
+void RIStereoFFTConvolve_Convolve(struct RIStereoFFTConvolve *conv,
+        const float *const *input, float *const *output, uint32_t num_samples);
+
+/* レイテンシーの取得 */
+int32_t RIStereoFFTConvolve_GetLatencyNumSamples(const struct RIStereoFFTConvolve *conv);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RISTEREOFFTCONVOLVE_H_INCLUDED */
@@ -0,0 +1,18 @@
+#ifndef RITOOMCOOK_H_INCLUDED
+#define RITOOMCOOK_H_INCLUDED
+
+#include "ri_convolve.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* インターフェース取得
+* Toom-Cook 3分割法による時間領域畳み込み. 係数長・入力長は2の冪乗でなくてもよい */
+const struct RIConvolveInterface* RIToomCook_GetInterface(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RITOOMCOOK_H_INCLUDED */
@@ -9,6 +9,27 @@ extern "C" {
 
 const struct RIConvolveInterface* RIZeroLatencyFFTConvolve_GetInterface(void);
 
+/* FFT分割サイズの取得
+* コンフィグで分割サイズを指定しなかった場合は既定値(1024)を係数長と先頭係数長に収まるよう制限した値になる */
+uint32_t RIZeroLatencyFFTConvolve_GetPartitionSize(const void *obj);
+
+/* 最大入力サンプル数での処理時間を計測し、最速となるFFT分割サイズで係数をセット
+* コンフィグで分割サイズを指定しなかった場合のみ64から2048の2の冪乗を計測する. 指定した場合は係数をセットするのみ
+* SetCoefficientsの代わりに呼ぶこと. 設定した分割サイズを返す. 内部状態はリセットされる */
+uint32_t RIZeroLatencyFFTConvolve_CalibratePartitionSize(void *obj, const float *coefficients, uint32_t num_coefficients);
+
+/* 時間領域で畳み込む先頭係数長の取得
+* コンフィグで指定しなかった場合は分割サイズ(=FFT畳み込みのレイテンシ)に一致する
+* ワーカースレッド使用時はFFT畳み込み段を2ブロック先読みして処理するため、さらに最大入力サンプル数の2倍だけ長くなる
+* 畳み込み処理はワーカースレッドの処理完了を待たない. 2ブロック分遅れて間に合わなかった出力は無音で代用し、
+* 統計情報のnum_deadline_missesに数える */
+uint32_t RIZeroLatencyFFTConvolve_GetNumHeadCoefficients(const void *obj);
+
+/* 使用中のFFT畳み込み段数の取得
+* 先頭係数の後ろを、分割サイズを4倍ずつ(最大8192)大きくしたFFT畳み込みの段で順に受け持つ
+* 各段は前段の末尾から次段の分割サイズ以上の位置までを受け持つため、レイテンシ0のまま後段ほど大きいFFTを使える */
+uint32_t RIZeroLatencyFFTConvolve_GetNumStages(const void *obj);
+
 #ifdef __cplusplus
 }
 #endif
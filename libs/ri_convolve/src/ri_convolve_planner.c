@@ -0,0 +1,543 @@
+#ifdef _MSC_VER
+/* fopenの警告を抑制 */
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include "ri_convolve_planner.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <ctype.h>
+
+#include "ri_karatsuba.h"
+#include "ri_fft_convolve.h"
+#include "ri_zerolatency_fft_convolve.h"
+#include "ri_direct_fir.h"
+#include "ri_toom_cook.h"
+#include "ri_convolve_statistics.h"
+
+/* CPU名の取得方法の選択 */
+#if defined(__x86_64__) || defined(__i386__)
+#define RICONVOLVEPLANNER_USE_CPUID
+#include <cpuid.h>
+#elif defined(_M_X64) || defined(_M_IX86)
+#define RICONVOLVEPLANNER_USE_CPUID
+#include <intrin.h>
+#endif
+
+/* アーキテクチャ名 */
+#if defined(__x86_64__) || defined(_M_X64)
+#define RICONVOLVEPLANNER_ARCH_NAME "x86_64"
+#elif defined(__i386__) || defined(_M_IX86)
+#define RICONVOLVEPLANNER_ARCH_NAME "x86"
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define RICONVOLVEPLANNER_ARCH_NAME "arm64"
+#elif defined(__arm__) || defined(_M_ARM)
+#define RICONVOLVEPLANNER_ARCH_NAME "arm"
+#else
+#define RICONVOLVEPLANNER_ARCH_NAME "unknown"
+#endif
+
+/* ビルド時に有効な命令セット名 */
+#if defined(__AVX512F__)
+#define RICONVOLVEPLANNER_ISA_NAME "avx512"
+#elif defined(__AVX2__)
+#define RICONVOLVEPLANNER_ISA_NAME "avx2"
+#elif defined(__AVX__)
+#define RICONVOLVEPLANNER_ISA_NAME "avx"
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define RICONVOLVEPLANNER_ISA_NAME "sse2"
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define RICONVOLVEPLANNER_ISA_NAME "neon"
+#else
+#define RICONVOLVEPLANNER_ISA_NAME "generic"
+#endif
+
+/* メモリアラインメント */
+#define RICONVOLVEPLANNER_ALIGNMENT 16
+/* 分割サイズの最小値 */
+#define RICONVOLVEPLANNER_MIN_PARTITION_SIZE 64
+/* FFT畳み込みの分割サイズの最大値 */
+#define RICONVOLVEPLANNER_MAX_FFT_PARTITION_SIZE 8192
+/* ゼロレイテンシー畳み込みの分割サイズの最大値 */
+#define RICONVOLVEPLANNER_MAX_ZEROLATENCY_PARTITION_SIZE 2048
+/* wisdomファイルの行の先頭 */
+#define RICONVOLVEPLANNER_WISDOM_TAG "RIConvolvePlan"
+/* wisdomファイルの1行の最大文字数 */
+#define RICONVOLVEPLANNER_WISDOM_MAX_LINE_LENGTH 256
+/* CPU名の最大文字数(cpuidのブランド文字列長) */
+#define RICONVOLVEPLANNER_CPU_NAME_LENGTH 48
+/* マシンキーの最大文字数: アーキテクチャ名-命令セット名-CPU名 */
+#define RICONVOLVEPLANNER_MACHINE_KEY_LENGTH 80
+/* 1候補あたりの計測回数 */
+#define RICONVOLVEPLANNER_NUM_MEASURE_TRIALS 3
+/* マクロ値の文字列化 */
+#define RICONVOLVEPLANNER_STRINGIFY(x) #x
+#define RICONVOLVEPLANNER_TO_STRING(x) RICONVOLVEPLANNER_STRINGIFY(x)
+/* 最小値を取得 */
+#define MIN(a, b) (((a) < (b)) ? (a) : (b))
+/* 最大値を取得 */
+#define MAX(a, b) (((a) > (b)) ? (a) : (b))
+/* nの倍数切り上げ */
+#define ROUNDUP(val, n) ((((val) + ((n) - 1)) / (n)) * (n))
+
+/* 計測用の作業領域 */
+struct RIConvolvePlannerWork {
+    float *coefficients; /* 計測用の係数 */
+    float *input; /* 計測用の入力 */
+    float *output; /* 計測用の出力 */
+    void *conv_work; /* 候補のインスタンス領域 */
+    int64_t conv_work_size; /* 候補のインスタンス領域サイズ */
+};
+
+/* モジュールのインターフェース取得 */
+static const struct RIConvolveInterface *RIConvolvePlanner_GetInterface(RIConvolvePlannerEngine engine);
+/* モジュール毎の分割サイズの候補範囲を取得 */
+static void RIConvolvePlanner_GetPartitionSizeRange(RIConvolvePlannerEngine engine,
+        const struct RIConvolveConfig *config, uint32_t *min_partition_size, uint32_t *max_partition_size);
+/* 候補の計画を作成 */
+static void RIConvolvePlanner_SetupCandidate(RIConvolvePlannerEngine engine, uint32_t partition_size,
+        const struct RIConvolveConfig *config, struct RIConvolvePlan *candidate);
+/* 全候補のうち最大のインスタンスのワークサイズを計算 */
+static int64_t RIConvolvePlanner_CalculateMaxConvolveWorkSize(const struct RIConvolveConfig *config);
+/* 作業領域の割り当て */
+static RIConvolvePlannerApiResult RIConvolvePlanner_SetupWork(const struct RIConvolveConfig *config,
+        void *work, int64_t work_size, struct RIConvolvePlannerWork *planner_work);
+/* 候補の処理時間を計測 数回計測した最小値を返す time_limitを超えた回はその時点で打ち切る(0で打ち切らない) */
+static uint64_t RIConvolvePlanner_Measure(const struct RIConvolveInterface *conv_if, void *conv,
+        const struct RIConvolveConfig *config, const struct RIConvolvePlannerWork *planner_work, uint64_t time_limit);
+/* 計測したマシンを識別するキー(空白を含まない文字列)を取得 keyはRICONVOLVEPLANNER_MACHINE_KEY_LENGTH + 1以上 */
+static void RIConvolvePlanner_GetMachineKey(char *key);
+/* 2の冪乗に切り上げ */
+static uint32_t RIConvolvePlanner_Roundup2PoweredValue(uint32_t val);
+
+/* 計画に必要なワークサイズ計算 */
+int64_t RIConvolvePlanner_CalculateWorkSize(const struct RIConvolveConfig *config)
+{
+    int64_t work_size, conv_work_size;
+
+    /* 引数チェック */
+    if (config == NULL) {
+        return -1;
+    }
+
+    if ((conv_work_size = RIConvolvePlanner_CalculateMaxConvolveWorkSize(config)) < 0) {
+        return -1;
+    }
+
+    /* 計測用の係数・入出力分 */
+    work_size = RICONVOLVE_ARRAY_WORK_SIZE(sizeof(float), config->max_num_coefficients, RICONVOLVEPLANNER_ALIGNMENT);
+    work_size = RICONVOLVE_ADD_WORK_SIZE(work_size,
+            RICONVOLVE_MUL_WORK_SIZE(RICONVOLVE_ARRAY_WORK_SIZE(sizeof(float), config->max_num_input_samples, RICONVOLVEPLANNER_ALIGNMENT), 2));
+    /* 候補のインスタンス分 */
+    work_size = RICONVOLVE_ADD_WORK_SIZE(work_size, conv_work_size);
+
+    return work_size;
+}
+
+/* 候補を計測して最速の組み合わせを選ぶ */
+RIConvolvePlannerApiResult RIConvolvePlanner_Plan(const struct RIConvolveConfig *config,
+        uint32_t max_latency_num_samples, struct RIConvolvePlan *plan, void *work, int64_t work_size)
+{
+    RIConvolvePlannerApiResult ret;
+    struct RIConvolvePlannerWork planner_work;
+    uint32_t engine, partition_size, min_partition_size, max_partition_size, smpl;
+    uint64_t best_time = 0;
+    uint8_t found = 0;
+
+    /* 引数チェック */
+    if ((config == NULL) || (plan == NULL) || (work == NULL)) {
+        return RICONVOLVEPLANNER_APIRESULT_INVALID_ARGUMENT;
+    }
+
+    /* 入力がなければ計測できない */
+    if ((config->max_num_input_samples == 0) || (config->max_num_coefficients == 0)) {
+        return RICONVOLVEPLANNER_APIRESULT_INVALID_ARGUMENT;
+    }
+
+    /* 作業領域の割り当て */
+    if ((ret = RIConvolvePlanner_SetupWork(config, work, work_size, &planner_work)) != RICONVOLVEPLANNER_APIRESULT_OK) {
+        return ret;
+    }
+
+    /* 計測用の係数 値は処理時間に影響しないが全係数を有効にしておく */
+    for (smpl = 0; smpl < config->max_num_coefficients; smpl++) {
+        planner_work.coefficients[smpl] = 1.0f / (float)config->max_num_coefficients;
+    }
+    memset(planner_work.input, 0, sizeof(float) * config->max_num_input_samples);
+
+    for (engine = 0; engine < RICONVOLVEPLANNER_ENGINE_NUM; engine++) {
+        RIConvolvePlanner_GetPartitionSizeRange((RIConvolvePlannerEngine)engine,
+                config, &min_partition_size, &max_partition_size);
+        for (partition_size = min_partition_size; partition_size <= max_partition_size; partition_size <<= 1) {
+            struct RIConvolvePlan candidate;
+            int64_t candidate_work_size;
+            void *conv;
+            uint64_t elapsed;
+
+            RIConvolvePlanner_SetupCandidate((RIConvolvePlannerEngine)engine, partition_size, config, &candidate);
+
+            /* 作成できない組み合わせは候補から外す */
+            if (((candidate_work_size = candidate.convolve_if->CalculateWorkSize(&candidate.config)) < 0)
+                    || (candidate_work_size > planner_work.conv_work_size)) {
+                continue;
+            }
+            if ((conv = candidate.convolve_if->Create(&candidate.config,
+                            planner_work.conv_work, candidate_work_size)) == NULL) {
+                continue;
+            }
+
+            /* レイテンシーが許容値を超える候補は外す */
+            candidate.convolve_if->SetCoefficients(conv, planner_work.coefficients, config->max_num_coefficients);
+            if ((uint32_t)candidate.convolve_if->GetLatencyNumSamples(conv) > max_latency_num_samples) {
+                candidate.convolve_if->Destroy(conv);
+                continue;
+            }
+
+            elapsed = RIConvolvePlanner_Measure(candidate.convolve_if, conv, config, &planner_work, found ? best_time : 0);
+            candidate.convolve_if->Destroy(conv);
+
+            /* 同着なら先に試した（単純な）候補を優先 */
+            if (!found || (elapsed < best_time)) {
+                best_time = elapsed;
+                (*plan) = candidate;
+                found = 1;
+            }
+        }
+    }
+
+    return found ? RICONVOLVEPLANNER_APIRESULT_OK : RICONVOLVEPLANNER_APIRESULT_NOT_FOUND;
+}
+
+/* wisdomファイルから同じ条件の計画を探す */
+RIConvolvePlannerApiResult RIConvolvePlanner_LoadWisdom(const char *path,
+        const struct RIConvolveConfig *config, uint32_t max_latency_num_samples, struct RIConvolvePlan *plan)
+{
+    FILE *fp;
+    char line[RICONVOLVEPLANNER_WISDOM_MAX_LINE_LENGTH];
+    char machine_key[RICONVOLVEPLANNER_MACHINE_KEY_LENGTH + 1];
+    char line_machine_key[RICONVOLVEPLANNER_MACHINE_KEY_LENGTH + 1];
+    uint8_t found = 0;
+
+    /* 引数チェック */
+    if ((path == NULL) || (config == NULL) || (plan == NULL)) {
+        return RICONVOLVEPLANNER_APIRESULT_INVALID_ARGUMENT;
+    }
+
+    if ((fp = fopen(path, "r")) == NULL) {
+        return RICONVOLVEPLANNER_APIRESULT_NOT_FOUND;
+    }
+
+    RIConvolvePlanner_GetMachineKey(machine_key);
+
+    /* 後から追記した計画を優先するため最後まで読む 解釈できない行は読み飛ばす */
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        unsigned long max_num_coefficients, max_num_input_samples, num_head_coefficients;
+        unsigned long num_delay_samples, use_worker_thread, max_latency;
+        unsigned long engine, fft_partition_size, plan_num_head_coefficients;
+
+        if (sscanf(line, RICONVOLVEPLANNER_WISDOM_TAG
+                    " %" RICONVOLVEPLANNER_TO_STRING(RICONVOLVEPLANNER_MACHINE_KEY_LENGTH) "s"
+                    " %lu %lu %lu %lu %lu %lu %lu %lu %lu", line_machine_key,
+                    &max_num_coefficients, &max_num_input_samples, &num_head_coefficients,
+                    &num_delay_samples, &use_worker_thread, &max_latency,
+                    &engine, &fft_partition_size, &plan_num_head_coefficients) != 10) {
+            continue;
+        }
+
+        /* 別のマシンで計測した計画は使わない */
+        if (strcmp(line_machine_key, machine_key) != 0) {
+            continue;
+        }
+
+        if ((max_num_coefficients != config->max_num_coefficients)
+                || (max_num_input_samples != config->max_num_input_samples)
+                || (num_head_coefficients != config->num_head_coefficients)
+                || (num_delay_samples != config->num_delay_samples)
+                || (use_worker_thread != config->use_worker_thread)
+                || (max_latency != max_latency_num_samples)
+                || (engine >= RICONVOLVEPLANNER_ENGINE_NUM)) {
+            continue;
+        }
+
+        plan->engine = (RIConvolvePlannerEngine)engine;
+        plan->convolve_if = RIConvolvePlanner_GetInterface(plan->engine);
+        plan->config = (*config);
+        plan->config.fft_partition_size = (uint32_t)fft_partition_size;
+        plan->config.num_head_coefficients = (uint32_t)plan_num_head_coefficients;
+        found = 1;
+    }
+
+    fclose(fp);
+
+    return found ? RICONVOLVEPLANNER_APIRESULT_OK : RICONVOLVEPLANNER_APIRESULT_NOT_FOUND;
+}
+
+/* 計画をwisdomファイルに追記 */
+RIConvolvePlannerApiResult RIConvolvePlanner_SaveWisdom(const char *path,
+        const struct RIConvolveConfig *config, uint32_t max_latency_num_samples, const struct RIConvolvePlan *plan)
+{
+    FILE *fp;
+    int ret;
+    char machine_key[RICONVOLVEPLANNER_MACHINE_KEY_LENGTH + 1];
+
+    /* 引数チェック */
+    if ((path == NULL) || (config == NULL) || (plan == NULL)
+            || (plan->engine >= RICONVOLVEPLANNER_ENGINE_NUM)) {
+        return RICONVOLVEPLANNER_APIRESULT_INVALID_ARGUMENT;
+    }
+
+    if ((fp = fopen(path, "a")) == NULL) {
+        return RICONVOLVEPLANNER_APIRESULT_NG;
+    }
+
+    /* 計測したマシンのキーを先頭に記録 */
+    RIConvolvePlanner_GetMachineKey(machine_key);
+    ret = fprintf(fp, RICONVOLVEPLANNER_WISDOM_TAG " %s %lu %lu %lu %lu %lu %lu %lu %lu %lu\n",
+            machine_key, (unsigned long)config->max_num_coefficients, (unsigned long)config->max_num_input_samples,
+            (unsigned long)config->num_head_coefficients, (unsigned long)config->num_delay_samples,
+            (unsigned long)config->use_worker_thread, (unsigned long)max_latency_num_samples,
+            (unsigned long)plan->engine, (unsigned long)plan->config.fft_partition_size,
+            (unsigned long)plan->config.num_head_coefficients);
+
+    if ((fclose(fp) != 0) || (ret < 0)) {
+        return RICONVOLVEPLANNER_APIRESULT_NG;
+    }
+
+    return RICONVOLVEPLANNER_APIRESULT_OK;
+}
+
+/* モジュールのインターフェース取得 */
+static const struct RIConvolveInterface *RIConvolvePlanner_GetInterface(RIConvolvePlannerEngine engine)
+{
+    switch (engine) {
+    case RICONVOLVEPLANNER_ENGINE_KARATSUBA:
+        return RIKaratsuba_GetInterface();
+    case RICONVOLVEPLANNER_ENGINE_FFT:
+        return RIFFTConvolve_GetInterface();
+    case RICONVOLVEPLANNER_ENGINE_ZEROLATENCY_FFT:
+        return RIZeroLatencyFFTConvolve_GetInterface();
+    case RICONVOLVEPLANNER_ENGINE_DIRECT_FIR:
+        return RIDirectFIR_GetInterface();
+    case RICONVOLVEPLANNER_ENGINE_TOOM_COOK:
+        return RIToomCook_GetInterface();
+    default:
+        assert(0);
+    }
+
+    return NULL;
+}
+
+/* モジュール毎の分割サイズの候補範囲を取得 */
+static void RIConvolvePlanner_GetPartitionSizeRange(RIConvolvePlannerEngine engine,
+        const struct RIConvolveConfig *config, uint32_t *min_partition_size, uint32_t *max_partition_size)
+{
+    uint32_t num_coefficients_size;
+
+    assert((config != NULL) && (min_partition_size != NULL) && (max_partition_size != NULL));
+
+    /* 係数長を超える分割サイズは意味がない */
+    num_coefficients_size = MAX(RICONVOLVEPLANNER_MIN_PARTITION_SIZE,
+            RIConvolvePlanner_Roundup2PoweredValue(config->max_num_coefficients));
+
+    switch (engine) {
+    case RICONVOLVEPLANNER_ENGINE_FFT:
+        (*min_partition_size) = RICONVOLVEPLANNER_MIN_PARTITION_SIZE;
+        (*max_partition_size) = MIN(RICONVOLVEPLANNER_MAX_FFT_PARTITION_SIZE, num_coefficients_size);
+        break;
+    case RICONVOLVEPLANNER_ENGINE_ZEROLATENCY_FFT:
+        (*min_partition_size) = RICONVOLVEPLANNER_MIN_PARTITION_SIZE;
+        (*max_partition_size) = MIN(RICONVOLVEPLANNER_MAX_ZEROLATENCY_PARTITION_SIZE, num_coefficients_size);
+        break;
+    default:
+        /* 分割しないモジュールは1候補のみ */
+        (*min_partition_size) = (*max_partition_size) = 1;
+        break;
+    }
+}
+
+/* 候補の計画を作成 */
+static void RIConvolvePlanner_SetupCandidate(RIConvolvePlannerEngine engine, uint32_t partition_size,
+        const struct RIConvolveConfig *config, struct RIConvolvePlan *candidate)
+{
+    assert((config != NULL) && (candidate != NULL));
+
+    candidate->engine = engine;
+    candidate->convolve_if = RIConvolvePlanner_GetInterface(engine);
+    candidate->config = (*config);
+    switch (engine) {
+    case RICONVOLVEPLANNER_ENGINE_FFT:
+        candidate->config.fft_partition_size = partition_size;
+        candidate->config.num_head_coefficients = 0;
+        break;
+    case RICONVOLVEPLANNER_ENGINE_ZEROLATENCY_FFT:
+        candidate->config.fft_partition_size = partition_size;
+        break;
+    default:
+        candidate->config.fft_partition_size = 0;
+        candidate->config.num_head_coefficients = 0;
+        break;
+    }
+}
+
+/* 全候補のうち最大のインスタンスのワークサイズを計算 */
+static int64_t RIConvolvePlanner_CalculateMaxConvolveWorkSize(const struct RIConvolveConfig *config)
+{
+    uint32_t engine, partition_size, min_partition_size, max_partition_size;
+    int64_t max_work_size = -1;
+
+    assert(config != NULL);
+
+    for (engine = 0; engine < RICONVOLVEPLANNER_ENGINE_NUM; engine++) {
+        RIConvolvePlanner_GetPartitionSizeRange((RIConvolvePlannerEngine)engine,
+                config, &min_partition_size, &max_partition_size);
+        for (partition_size = min_partition_size; partition_size <= max_partition_size; partition_size <<= 1) {
+            struct RIConvolvePlan candidate;
+            RIConvolvePlanner_SetupCandidate((RIConvolvePlannerEngine)engine, partition_size, config, &candidate);
+            /* 作成できない組み合わせは無視 */
+            max_work_size = MAX(max_work_size, candidate.convolve_if->CalculateWorkSize(&candidate.config));
+        }
+    }
+
+    return max_work_size;
+}
+
+/* 作業領域の割り当て */
+static RIConvolvePlannerApiResult RIConvolvePlanner_SetupWork(const struct RIConvolveConfig *config,
+        void *work, int64_t work_size, struct RIConvolvePlannerWork *planner_work)
+{
+    uint8_t *work_ptr = (uint8_t *)work;
+    int64_t required_size;
+
+    assert((config != NULL) && (work != NULL) && (planner_work != NULL));
+
+    if ((required_size = RIConvolvePlanner_CalculateWorkSize(config)) < 0) {
+        return RICONVOLVEPLANNER_APIRESULT_NOT_FOUND;
+    }
+    if (work_size < required_size) {
+        return RICONVOLVEPLANNER_APIRESULT_INSUFFICIENT_BUFFER;
+    }
+
+    /* 計測用の係数・入出力 */
+    work_ptr = (uint8_t *)ROUNDUP((uintptr_t)work_ptr, RICONVOLVEPLANNER_ALIGNMENT);
+    planner_work->coefficients = (float *)work_ptr;
+    work_ptr += sizeof(float) * config->max_num_coefficients;
+    work_ptr = (uint8_t *)ROUNDUP((uintptr_t)work_ptr, RICONVOLVEPLANNER_ALIGNMENT);
+    planner_work->input = (float *)work_ptr;
+    work_ptr += sizeof(float) * config->max_num_input_samples;
+    work_ptr = (uint8_t *)ROUNDUP((uintptr_t)work_ptr, RICONVOLVEPLANNER_ALIGNMENT);
+    planner_work->output = (float *)work_ptr;
+    work_ptr += sizeof(float) * config->max_num_input_samples;
+
+    /* 候補のインスタンス領域 各モジュールが内部でアラインする */
+    planner_work->conv_work = work_ptr;
+    planner_work->conv_work_size = RIConvolvePlanner_CalculateMaxConvolveWorkSize(config);
+
+    return RICONVOLVEPLANNER_APIRESULT_OK;
+}
+
+/* 候補の処理時間を計測 */
+static uint64_t RIConvolvePlanner_Measure(const struct RIConvolveInterface *conv_if, void *conv,
+        const struct RIConvolveConfig *config, const struct RIConvolvePlannerWork *planner_work, uint64_t time_limit)
+{
+    uint32_t smpl, num_samples, trial;
+    uint64_t min_elapsed = 0;
+
+    assert((conv_if != NULL) && (conv != NULL) && (config != NULL) && (planner_work != NULL));
+
+    /* 最大のFFT分割サイズの2周期分を最大入力サンプル数単位で処理する時間を比較 */
+    num_samples = ROUNDUP(2 * MIN(RICONVOLVEPLANNER_MAX_FFT_PARTITION_SIZE,
+                RIConvolvePlanner_Roundup2PoweredValue(config->max_num_coefficients)), config->max_num_input_samples);
+
+    /* 初回のキャッシュミス等を除くため1ブロック空回し */
+    conv_if->Convolve(conv, planner_work->input, planner_work->output, config->max_num_input_samples);
+
+    /* CPU時間ではなく経過時間で比べ、割り込み等の影響を除くため数回の最小値を取る */
+    for (trial = 0; trial < RICONVOLVEPLANNER_NUM_MEASURE_TRIALS; trial++) {
+        const uint64_t start = RIConvolveStatistics_GetTicks();
+        uint64_t elapsed = 0;
+        for (smpl = 0; smpl < num_samples; smpl += config->max_num_input_samples) {
+            conv_if->Convolve(conv, planner_work->input, planner_work->output, config->max_num_input_samples);
+            /* 最速の候補より遅くなった時点で打ち切り */
+            elapsed = RIConvolveStatistics_GetTicks() - start;
+            if ((time_limit > 0) && (elapsed > time_limit)) {
+                break;
+            }
+        }
+        if ((trial == 0) || (elapsed < min_elapsed)) {
+            min_elapsed = elapsed;
+        }
+    }
+
+    return min_elapsed;
+}
+
+/* 計測したマシンを識別するキーを取得 */
+static void RIConvolvePlanner_GetMachineKey(char *key)
+{
+    char cpu_name[RICONVOLVEPLANNER_CPU_NAME_LENGTH + 1] = "unknown";
+    char *pos;
+
+    assert(key != NULL);
+
+#if defined(RICONVOLVEPLANNER_USE_CPUID)
+    /* 拡張機能0x80000002-0x80000004のブランド文字列 */
+    {
+        uint32_t leaf, regs[4];
+        uint8_t brand[RICONVOLVEPLANNER_CPU_NAME_LENGTH];
+#if defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, (int)0x80000000);
+        regs[0] = (uint32_t)info[0];
+#else
+        unsigned int eax, ebx, ecx, edx;
+        regs[0] = (__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) != 0) ? eax : 0;
+#endif
+        if (regs[0] >= 0x80000004) {
+            for (leaf = 0; leaf < 3; leaf++) {
+#if defined(_MSC_VER)
+                __cpuid(info, (int)(0x80000002 + leaf));
+                regs[0] = (uint32_t)info[0]; regs[1] = (uint32_t)info[1];
+                regs[2] = (uint32_t)info[2]; regs[3] = (uint32_t)info[3];
+#else
+                __get_cpuid(0x80000002 + leaf, &eax, &ebx, &ecx, &edx);
+                regs[0] = eax; regs[1] = ebx; regs[2] = ecx; regs[3] = edx;
+#endif
+                memcpy(&brand[16 * leaf], regs, sizeof(regs));
+            }
+            memcpy(cpu_name, brand, RICONVOLVEPLANNER_CPU_NAME_LENGTH);
+            cpu_name[RICONVOLVEPLANNER_CPU_NAME_LENGTH] = '\0';
+        }
+    }
+#endif
+
+    /* wisdomファイルの1語になるよう前後の空白を除き、途中の空白・制御文字は'_'に置き換える */
+    pos = cpu_name;
+    while ((*pos != '\0') && isspace((unsigned char)*pos)) {
+        pos++;
+    }
+    sprintf(key, "%s-%s-%s", RICONVOLVEPLANNER_ARCH_NAME, RICONVOLVEPLANNER_ISA_NAME, pos);
+    for (pos = &key[strlen(key)]; (pos > key) && isspace((unsigned char)pos[-1]); pos--) {
+        pos[-1] = '\0';
+    }
+    for (pos = key; *pos != '\0'; pos++) {
+        if (!isgraph((unsigned char)*pos)) {
+            *pos = '_';
+        }
+    }
+}
+
+/* 2の冪乗に切り上げ */
+static uint32_t RIConvolvePlanner_Roundup2PoweredValue(uint32_t val)
+{
+    val--;
+    val |= val >> 1;
+    val |= val >> 2;
+    val |= val >> 4;
+    val |= val >> 8;
+    val |= val >> 16;
+    val++;
+
+    return val;
+}
@@ -0,0 +1,269 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+/* clock_gettimeを使うため */
+#define _POSIX_C_SOURCE 199309L
+#endif
+
+#include "ri_convolve_statistics.h"
+
+#include <string.h>
+#include <assert.h>
+
+/* ティックの取得方法の選択 */
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define RICONVOLVESTATISTICS_USE_RDTSC
+#include <intrin.h>
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define RICONVOLVESTATISTICS_USE_RDTSC
+#include <x86intrin.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+/* 最小値を取得 */
+#define MIN(a, b) (((a) < (b)) ? (a) : (b))
+
+/* 64bit値の読み出し(relaxed) */
+static uint64_t RIConvolveStatistics_LoadRelaxed(const uint64_t *ptr);
+/* 64bit値の読み出し(acquire) */
+static uint64_t RIConvolveStatistics_LoadAcquire(const uint64_t *ptr);
+/* 64bit値の書き込み(relaxed) */
+static void RIConvolveStatistics_StoreRelaxed(uint64_t *ptr, uint64_t value);
+/* 64bit値の書き込み(release) */
+static void RIConvolveStatistics_StoreRelease(uint64_t *ptr, uint64_t value);
+/* 以前の読み出しを以降の読み書きより前に完了させる */
+static void RIConvolveStatistics_FenceAcquire(void);
+/* 以前の読み書きを以降の書き込みより前に完了させる */
+static void RIConvolveStatistics_FenceRelease(void);
+/* 集計値を1値ずつアトミックにコピー */
+static void RIConvolveStatistics_AtomicCopy(struct RIConvolveStatistics *dst, const struct RIConvolveStatistics *src);
+/* 処理時間に対応するヒストグラムのビン番号を取得 */
+static uint32_t RIConvolveStatistics_GetHistogramBin(uint64_t ticks);
+
+/* 現在のティック取得 */
+uint64_t RIConvolveStatistics_GetTicks(void)
+{
+#if defined(RICONVOLVESTATISTICS_USE_RDTSC)
+    return (uint64_t)__rdtsc();
+#elif defined(_WIN32)
+    LARGE_INTEGER count, frequency;
+    QueryPerformanceCounter(&count);
+    QueryPerformanceFrequency(&frequency);
+    /* ナノ秒に換算 乗算のオーバーフローを避けるため秒と端数に分ける */
+    return (uint64_t)(count.QuadPart / frequency.QuadPart) * (uint64_t)1000000000
+        + (uint64_t)((count.QuadPart % frequency.QuadPart) * (int64_t)1000000000 / frequency.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000UL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+/* 計測器の初期化 */
+void RIConvolveStatistics_Initialize(struct RIConvolveStatisticsCounter *counter)
+{
+    assert(counter != NULL);
+
+    memset(&counter->local, 0, sizeof(struct RIConvolveStatistics));
+    memset(&counter->published, 0, sizeof(struct RIConvolveStatistics));
+    counter->sequence = 0;
+}
+
+/* 1呼び出し分の処理サンプル数と処理時間を集計 */
+void RIConvolveStatistics_RecordCall(struct RIConvolveStatisticsCounter *counter, uint32_t num_samples, uint64_t ticks)
+{
+    struct RIConvolveStatistics *local;
+
+    assert(counter != NULL);
+
+    if (num_samples == 0) {
+        return;
+    }
+
+    local = &counter->local;
+    if ((local->num_calls == 0) || (ticks < local->min_ticks)) {
+        local->min_ticks = ticks;
+    }
+    if (ticks > local->max_ticks) {
+        local->max_ticks = ticks;
+    }
+    local->num_calls++;
+    local->num_samples += num_samples;
+    local->total_ticks += ticks;
+    local->histogram[RIConvolveStatistics_GetHistogramBin(ticks)]++;
+}
+
+/* 集計値を読み出し側に公開 */
+void RIConvolveStatistics_Publish(struct RIConvolveStatisticsCounter *counter)
+{
+    uint64_t sequence;
+
+    assert(counter != NULL);
+
+    /* シーケンス番号を書き換えるのは書き込み側のみ */
+    sequence = counter->sequence;
+
+    /* シーケンス番号を奇数にして反映中であることを示す */
+    RIConvolveStatistics_StoreRelaxed(&counter->sequence, sequence + 1);
+    RIConvolveStatistics_FenceRelease();
+
+    RIConvolveStatistics_AtomicCopy(&counter->published, &counter->local);
+
+    /* 偶数に戻して反映完了 */
+    RIConvolveStatistics_StoreRelease(&counter->sequence, sequence + 2);
+}
+
+/* 公開済みの集計値を取得 */
+void RIConvolveStatistics_Snapshot(const struct RIConvolveStatisticsCounter *counter, struct RIConvolveStatistics *statistics)
+{
+    uint64_t begin_sequence, end_sequence;
+
+    assert((counter != NULL) && (statistics != NULL));
+
+    /* 読んでいる間に反映が起きたら読み直す */
+    do {
+        begin_sequence = RIConvolveStatistics_LoadAcquire(&counter->sequence);
+        if (begin_sequence & 1) {
+            continue;
+        }
+        RIConvolveStatistics_AtomicCopy(statistics, &counter->published);
+        RIConvolveStatistics_FenceAcquire();
+        end_sequence = RIConvolveStatistics_LoadRelaxed(&counter->sequence);
+        if (begin_sequence == end_sequence) {
+            break;
+        }
+    } while (1);
+}
+
+/* 処理時間のパーセンタイル取得 */
+uint64_t RIConvolveStatistics_GetPercentileTicks(const struct RIConvolveStatistics *statistics, uint32_t percent)
+{
+    uint32_t bin;
+    uint64_t target, count = 0;
+
+    assert(statistics != NULL);
+    assert(percent <= 100);
+
+    if (statistics->num_calls == 0) {
+        return 0;
+    }
+
+    /* 少なくとも1回分は数える */
+    target = (statistics->num_calls * percent + 99) / 100;
+    if (target == 0) {
+        target = 1;
+    }
+
+    for (bin = 0; bin < RICONVOLVE_STATISTICS_NUM_HISTOGRAM_BINS - 1; bin++) {
+        count += statistics->histogram[bin];
+        if (count >= target) {
+            break;
+        }
+    }
+
+    /* ビンの上端 最大値を超えることはない */
+    if (bin == RICONVOLVE_STATISTICS_NUM_HISTOGRAM_BINS - 1) {
+        return statistics->max_ticks;
+    }
+    return MIN(((uint64_t)2 << bin) - 1, statistics->max_ticks);
+}
+
+/* 集計値を1値ずつアトミックにコピー */
+static void RIConvolveStatistics_AtomicCopy(struct RIConvolveStatistics *dst, const struct RIConvolveStatistics *src)
+{
+    uint32_t i;
+
+#define RICONVOLVESTATISTICS_COPY(member) RIConvolveStatistics_StoreRelaxed(&dst->member, RIConvolveStatistics_LoadRelaxed(&src->member))
+    RICONVOLVESTATISTICS_COPY(num_calls);
+    RICONVOLVESTATISTICS_COPY(num_samples);
+    RICONVOLVESTATISTICS_COPY(num_ffts);
+    RICONVOLVESTATISTICS_COPY(num_iffts);
+    RICONVOLVESTATISTICS_COPY(num_partition_macs);
+    RICONVOLVESTATISTICS_COPY(num_skipped_partition_macs);
+    RICONVOLVESTATISTICS_COPY(num_deadline_misses);
+    RICONVOLVESTATISTICS_COPY(min_ticks);
+    RICONVOLVESTATISTICS_COPY(max_ticks);
+    RICONVOLVESTATISTICS_COPY(total_ticks);
+    for (i = 0; i < RICONVOLVE_STATISTICS_NUM_HISTOGRAM_BINS; i++) {
+        RICONVOLVESTATISTICS_COPY(histogram[i]);
+    }
+#undef RICONVOLVESTATISTICS_COPY
+}
+
+/* 処理時間に対応するヒストグラムのビン番号を取得 */
+static uint32_t RIConvolveStatistics_GetHistogramBin(uint64_t ticks)
+{
+    uint32_t bin = 0;
+
+    /* floor(log2(ticks)) 最後のビンは上限なし */
+    while ((ticks > 1) && (bin < RICONVOLVE_STATISTICS_NUM_HISTOGRAM_BINS - 1)) {
+        ticks >>= 1;
+        bin++;
+    }
+
+    return bin;
+}
+
+/* 64bit値の読み出し(relaxed) */
+static uint64_t RIConvolveStatistics_LoadRelaxed(const uint64_t *ptr)
+{
+#if defined(_MSC_VER)
+    return (uint64_t)_InterlockedCompareExchange64((volatile __int64 *)ptr, 0, 0);
+#else
+    return __atomic_load_n(ptr, __ATOMIC_RELAXED);
+#endif
+}
+
+/* 64bit値の読み出し(acquire) */
+static uint64_t RIConvolveStatistics_LoadAcquire(const uint64_t *ptr)
+{
+#if defined(_MSC_VER)
+    return (uint64_t)_InterlockedCompareExchange64((volatile __int64 *)ptr, 0, 0);
+#else
+    return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+#endif
+}
+
+/* 64bit値の書き込み(relaxed) */
+static void RIConvolveStatistics_StoreRelaxed(uint64_t *ptr, uint64_t value)
+{
+#if defined(_MSC_VER)
+    _InterlockedExchange64((volatile __int64 *)ptr, (__int64)value);
+#else
+    __atomic_store_n(ptr, value, __ATOMIC_RELAXED);
+#endif
+}
+
+/* 64bit値の書き込み(release) */
+static void RIConvolveStatistics_StoreRelease(uint64_t *ptr, uint64_t value)
+{
+#if defined(_MSC_VER)
+    _InterlockedExchange64((volatile __int64 *)ptr, (__int64)value);
+#else
+    __atomic_store_n(ptr, value, __ATOMIC_RELEASE);
+#endif
+}
+
+/* 以前の読み出しを以降の読み書きより前に完了させる */
+static void RIConvolveStatistics_FenceAcquire(void)
+{
+#if defined(_MSC_VER)
+    /* Interlocked関数が完全なメモリバリアになる */
+#else
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+#endif
+}
+
+/* 以前の読み書きを以降の書き込みより前に完了させる */
+static void RIConvolveStatistics_FenceRelease(void)
+{
+#if defined(_MSC_VER)
+    /* Interlocked関数が完全なメモリバリアになる */
+#else
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+#endif
+}
@@ -0,0 +1,398 @@
+#include "ri_direct_fir.h"
+
+#include <assert.h>
+#include <string.h>
+#include "ri_convolve_statistics.h"
+
+/* SIMD命令の選択 */
+#if defined(__AVX512F__)
+#define RIDIRECTFIR_USE_AVX512
+#include <immintrin.h>
+#elif defined(__AVX2__) && (defined(__FMA__) || defined(_MSC_VER))
+#define RIDIRECTFIR_USE_AVX2
+#include <immintrin.h>
+#endif
+
+/* メモリアラインメント */
+#define RIDIRECTFIR_ALIGNMENT 64
+/* 出力間隔を指定した場合に一度に計算するサンプル数 */
+#define RIDIRECTFIR_STRIDED_BLOCK_SIZE 64
+/* nの倍数切り上げ */
+#define ROUNDUP(val, n) ((((val) + ((n) - 1)) / (n)) * (n))
+/* 最小値を取得 */
+#define MIN(a, b) (((a) < (b)) ? (a) : (b))
+
+/* 直接型FIRフィルタ構造体 */
+struct RIDirectFIR {
+    float *coefficients; /* 時間反転した畳み込み係数 */
+    uint32_t num_coefficients; /* 畳み込み係数サイズ */
+    uint32_t max_num_coefficients; /* 最大の畳み込み係数サイズ */
+    uint32_t max_num_input_samples; /* 最大入力サンプル数 */
+    float *history; /* 入力履歴バッファ: 前半(max_num_coefficients - 1)に過去の入力, 後半に今回の入力 */
+#if defined(RICONVOLVE_ENABLE_STATISTICS)
+    struct RIConvolveStatisticsCounter statistics; /* 統計情報 */
+#endif
+};
+
+/* ワークサイズ計算 */
+static int64_t RIDirectFIR_CalculateWorkSize(const struct RIConvolveConfig *config);
+/* インスタンス生成 */
+static void* RIDirectFIR_Create(const struct RIConvolveConfig *config, void *work, int64_t work_size);
+/* インスタンス破棄 */
+static void RIDirectFIR_Destroy(void *obj);
+/* 内部状態リセット */
+static void RIDirectFIR_Reset(void *obj);
+/* 係数セット */
+static void RIDirectFIR_SetCoefficients(void *obj, const float *coefficients, uint32_t num_coefficients);
+/* 畳み込み計算 */
+static void RIDirectFIR_Convolve(void *obj, const float *input, float *output, uint32_t num_samples);
+/* 要素間隔を指定した畳み込み計算 */
+static void RIDirectFIR_ConvolveStrided(void *obj,
+        const float *input, uint32_t input_stride, float *output, uint32_t output_stride, uint32_t num_samples);
+/* レイテンシーの取得 */
+static int32_t RIDirectFIR_GetLatencyNumSamples(void *obj);
+/* 統計情報の取得 */
+static uint8_t RIDirectFIR_GetStatistics(void *obj, struct RIConvolveStatistics *statistics);
+/* ブロック単位のFIRフィルタ処理 */
+/* output[n] = sum_{j} rcoef[j] * input[n + j] */
+static void RIDirectFIR_FilterBlock(
+        const float *input, const float *rcoef, uint32_t num_coefficients, float *output, uint32_t num_samples);
+
+/* 要素間隔strideのsrcを連続領域dstにコピー */
+static void RIDirectFIR_CopyFromStrided(float *dst, const float *src, uint32_t stride, uint32_t num_samples);
+/* 連続領域srcを要素間隔strideのdstにコピー */
+static void RIDirectFIR_CopyToStrided(float *dst, uint32_t stride, const float *src, uint32_t num_samples);
+/* インターフェース */
+static const struct RIConvolveInterface st_direct_fir_if = {
+    RIDirectFIR_CalculateWorkSize,
+    RIDirectFIR_Create,
+    RIDirectFIR_Destroy,
+    RIDirectFIR_Reset,
+    RIDirectFIR_SetCoefficients,
+    RIDirectFIR_Convolve,
+    RIDirectFIR_ConvolveStrided,
+    RIDirectFIR_GetLatencyNumSamples,
+    RIDirectFIR_GetStatistics,
+};
+
+/* インターフェース取得 */
+const struct RIConvolveInterface* RIDirectFIR_GetInterface(void)
+{
+    return &st_direct_fir_if;
+}
+
+/* ワークサイズ計算 */
+static int64_t RIDirectFIR_CalculateWorkSize(const struct RIConvolveConfig *config)
+{
+    int64_t work_size;
+
+    if (config == NULL) {
+        return -1;
+    }
+
+    if (config->max_num_coefficients == 0) {
+        return -1;
+    }
+
+    work_size = (int64_t)(sizeof(struct RIDirectFIR) + RIDIRECTFIR_ALIGNMENT);
+
+    /* 係数 */
+    work_size = RICONVOLVE_ADD_WORK_SIZE(work_size,
+            RICONVOLVE_ARRAY_WORK_SIZE(sizeof(float), config->max_num_coefficients, RIDIRECTFIR_ALIGNMENT));
+
+    /* 入力履歴 */
+    work_size = RICONVOLVE_ADD_WORK_SIZE(work_size,
+            RICONVOLVE_ARRAY_WORK_SIZE(sizeof(float), (int64_t)config->max_num_coefficients - 1 + config->max_num_input_samples, RIDIRECTFIR_ALIGNMENT));
+
+    return work_size;
+}
+
+/* インスタンス生成 */
+static void* RIDirectFIR_Create(const struct RIConvolveConfig *config, void *work, int64_t work_size)
+{
+    uint8_t *work_ptr = (uint8_t *)work;
+    struct RIDirectFIR *conv;
+    int64_t required_size;
+
+    /* 引数チェック */
+    if ((work == NULL) || (config == NULL)) {
+        return NULL;
+    }
+
+    if (((required_size = RIDirectFIR_CalculateWorkSize(config)) < 0)
+            || (work_size < required_size)) {
+        return NULL;
+    }
+
+    /* 構造体を配置 */
+    work_ptr = (uint8_t *)ROUNDUP((uintptr_t)work_ptr, RIDIRECTFIR_ALIGNMENT);
+    conv = (struct RIDirectFIR *)work_ptr;
+    conv->max_num_coefficients = config->max_num_coefficients;
+    conv->max_num_input_samples = config->max_num_input_samples;
+    work_ptr += sizeof(struct RIDirectFIR);
+
+    /* 係数領域の割り当て */
+    work_ptr = (uint8_t *)ROUNDUP((uintptr_t)work_ptr, RIDIRECTFIR_ALIGNMENT);
+    conv->coefficients = (float *)work_ptr;
+    work_ptr += sizeof(float) * config->max_num_coefficients;
+
+    /* 入力履歴の割り当て */
+    work_ptr = (uint8_t *)ROUNDUP((uintptr_t)work_ptr, RIDIRECTFIR_ALIGNMENT);
+    conv->history = (float *)work_ptr;
+    work_ptr += sizeof(float) * (config->max_num_coefficients - 1 + config->max_num_input_samples);
+
+    /* 係数未設定時は無音を出力 */
+    conv->coefficients[0] = 0.0f;
+    conv->num_coefficients = 1;
+
+    /* バッファをリセット */
+    RIDirectFIR_Reset(conv);
+
+#if defined(RICONVOLVE_ENABLE_STATISTICS)
+    RIConvolveStatistics_Initialize(&conv->statistics);
+#endif
+
+    return conv;
+}
+
+/* インスタンス破棄 */
+static void RIDirectFIR_Destroy(void *obj)
+{
+    /* 特に何もしない */
+    if (obj != NULL) {
+        return;
+    }
+}
+
+/* 内部状態リセット */
+static void RIDirectFIR_Reset(void *obj)
+{
+    struct RIDirectFIR *conv = (struct RIDirectFIR *)obj;
+
+    assert(obj != NULL);
+
+    /* 入力履歴のクリア */
+    memset(conv->history, 0, sizeof(float) * (conv->max_num_coefficients - 1 + conv->max_num_input_samples));
+}
+
+/* 係数セット */
+static void RIDirectFIR_SetCoefficients(void *obj, const float *coefficients, uint32_t num_coefficients)
+{
+    uint32_t i;
+    struct RIDirectFIR *conv = (struct RIDirectFIR *)obj;
+
+    /* 引数チェック */
+    assert((obj != NULL) && (coefficients != NULL));
+
+    /* 係数サイズチェック */
+    assert(num_coefficients <= conv->max_num_coefficients);
+
+    if (num_coefficients == 0) {
+        conv->coefficients[0] = 0.0f;
+        conv->num_coefficients = 1;
+    } else {
+        /* 入力と同じ向きに積和できるよう時間反転して保持 */
+        for (i = 0; i < num_coefficients; i++) {
+            conv->coefficients[i] = coefficients[num_coefficients - i - 1];
+        }
+        conv->num_coefficients = num_coefficients;
+    }
+
+    /* 内部バッファリセット */
+    RIDirectFIR_Reset(obj);
+}
+
+/* 畳み込み計算 */
+static void RIDirectFIR_Convolve(void *obj, const float *input, float *output, uint32_t num_samples)
+{
+    RIDirectFIR_ConvolveStrided(obj, input, 1, output, 1, num_samples);
+}
+
+/* 要素間隔を指定した畳み込み計算 */
+static void RIDirectFIR_ConvolveStrided(void *obj,
+        const float *input, uint32_t input_stride, float *output, uint32_t output_stride, uint32_t num_samples)
+{
+    struct RIDirectFIR *conv = (struct RIDirectFIR *)obj;
+    const uint32_t num_history = conv->max_num_coefficients - 1;
+#if defined(RICONVOLVE_ENABLE_STATISTICS)
+    const uint64_t start_ticks = RIConvolveStatistics_GetTicks();
+#endif
+
+    /* 引数チェック */
+    assert((obj != NULL) && (input != NULL) && (output != NULL));
+    assert((input_stride > 0) && (output_stride > 0));
+    assert(num_samples <= conv->max_num_input_samples);
+
+    /* 今回の入力を履歴の後ろに追加 */
+    RIDirectFIR_CopyFromStrided(&conv->history[num_history], input, input_stride, num_samples);
+
+    /* 係数長-1だけ過去の入力から積和 */
+    if (output_stride == 1) {
+        RIDirectFIR_FilterBlock(&conv->history[num_history - (conv->num_coefficients - 1)],
+                conv->coefficients, conv->num_coefficients, output, num_samples);
+    } else {
+        /* 出力間隔が空いている場合は小ブロック単位で計算して書き出す */
+        uint32_t smpl;
+        float block[RIDIRECTFIR_STRIDED_BLOCK_SIZE];
+        for (smpl = 0; smpl < num_samples; smpl += RIDIRECTFIR_STRIDED_BLOCK_SIZE) {
+            const uint32_t num_block_samples = MIN(RIDIRECTFIR_STRIDED_BLOCK_SIZE, num_samples - smpl);
+            RIDirectFIR_FilterBlock(&conv->history[num_history - (conv->num_coefficients - 1) + smpl],
+                    conv->coefficients, conv->num_coefficients, block, num_block_samples);
+            RIDirectFIR_CopyToStrided(&output[(size_t)smpl * output_stride], output_stride, block, num_block_samples);
+        }
+    }
+
+    /* 履歴を更新 */
+    memmove(conv->history, &conv->history[num_samples], sizeof(float) * num_history);
+
+#if defined(RICONVOLVE_ENABLE_STATISTICS)
+    /* 統計情報の更新 */
+    RIConvolveStatistics_RecordCall(&conv->statistics, num_samples, RIConvolveStatistics_GetTicks() - start_ticks);
+    RIConvolveStatistics_Publish(&conv->statistics);
+#endif
+}
+
+/* ブロック単位のFIRフィルタ処理 */
+static void RIDirectFIR_FilterBlock(
+        const float *input, const float *rcoef, uint32_t num_coefficients, float *output, uint32_t num_samples)
+{
+    uint32_t smpl = 0, j;
+
+#if defined(RIDIRECTFIR_USE_AVX512)
+    /* 64出力をまとめて計算: 係数1つのブロードキャストを4つのFMAで使い回す */
+    for (; smpl + 64 <= num_samples; smpl += 64) {
+        const float *in = &input[smpl];
+        __m512 acc0 = _mm512_setzero_ps(), acc1 = _mm512_setzero_ps();
+        __m512 acc2 = _mm512_setzero_ps(), acc3 = _mm512_setzero_ps();
+        for (j = 0; j < num_coefficients; j++) {
+            const __m512 c = _mm512_set1_ps(rcoef[j]);
+            acc0 = _mm512_fmadd_ps(c, _mm512_loadu_ps(&in[j +  0]), acc0);
+            acc1 = _mm512_fmadd_ps(c, _mm512_loadu_ps(&in[j + 16]), acc1);
+            acc2 = _mm512_fmadd_ps(c, _mm512_loadu_ps(&in[j + 32]), acc2);
+            acc3 = _mm512_fmadd_ps(c, _mm512_loadu_ps(&in[j + 48]), acc3);
+        }
+        _mm512_storeu_ps(&output[smpl +  0], acc0);
+        _mm512_storeu_ps(&output[smpl + 16], acc1);
+        _mm512_storeu_ps(&output[smpl + 32], acc2);
+        _mm512_storeu_ps(&output[smpl + 48], acc3);
+    }
+    for (; smpl + 16 <= num_samples; smpl += 16) {
+        const float *in = &input[smpl];
+        __m512 acc = _mm512_setzero_ps();
+        for (j = 0; j < num_coefficients; j++) {
+            acc = _mm512_fmadd_ps(_mm512_set1_ps(rcoef[j]), _mm512_loadu_ps(&in[j]), acc);
+        }
+        _mm512_storeu_ps(&output[smpl], acc);
+    }
+#elif defined(RIDIRECTFIR_USE_AVX2)
+    /* 32出力をまとめて計算: 係数1つのブロードキャストを4つのFMAで使い回す */
+    for (; smpl + 32 <= num_samples; smpl += 32) {
+        const float *in = &input[smpl];
+        __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+        __m256 acc2 = _mm256_setzero_ps(), acc3 = _mm256_setzero_ps();
+        for (j = 0; j < num_coefficients; j++) {
+            const __m256 c = _mm256_set1_ps(rcoef[j]);
+            acc0 = _mm256_fmadd_ps(c, _mm256_loadu_ps(&in[j +  0]), acc0);
+            acc1 = _mm256_fmadd_ps(c, _mm256_loadu_ps(&in[j +  8]), acc1);
+            acc2 = _mm256_fmadd_ps(c, _mm256_loadu_ps(&in[j + 16]), acc2);
+            acc3 = _mm256_fmadd_ps(c, _mm256_loadu_ps(&in[j + 24]), acc3);
+        }
+        _mm256_storeu_ps(&output[smpl +  0], acc0);
+        _mm256_storeu_ps(&output[smpl +  8], acc1);
+        _mm256_storeu_ps(&output[smpl + 16], acc2);
+        _mm256_storeu_ps(&output[smpl + 24], acc3);
+    }
+    for (; smpl + 8 <= num_samples; smpl += 8) {
+        const float *in = &input[smpl];
+        __m256 acc = _mm256_setzero_ps();
+        for (j = 0; j < num_coefficients; j++) {
+            acc = _mm256_fmadd_ps(_mm256_set1_ps(rcoef[j]), _mm256_loadu_ps(&in[j]), acc);
+        }
+        _mm256_storeu_ps(&output[smpl], acc);
+    }
+#else
+    /* 4出力をまとめて計算: 係数と入力の読み込みを使い回す */
+    for (; smpl + 4 <= num_samples; smpl += 4) {
+        const float *in = &input[smpl];
+        float acc0 = 0.0f, acc1 = 0.0f, acc2 = 0.0f, acc3 = 0.0f;
+        for (j = 0; j < num_coefficients; j++) {
+            const float c = rcoef[j];
+            acc0 += c * in[j + 0];
+            acc1 += c * in[j + 1];
+            acc2 += c * in[j + 2];
+            acc3 += c * in[j + 3];
+        }
+        output[smpl + 0] = acc0;
+        output[smpl + 1] = acc1;
+        output[smpl + 2] = acc2;
+        output[smpl + 3] = acc3;
+    }
+#endif
+
+    /* 端数 */
+    for (; smpl < num_samples; smpl++) {
+        const float *in = &input[smpl];
+        float acc = 0.0f;
+        for (j = 0; j < num_coefficients; j++) {
+            acc += rcoef[j] * in[j];
+        }
+        output[smpl] = acc;
+    }
+}
+
+/* レイテンシーの取得 */
+static int32_t RIDirectFIR_GetLatencyNumSamples(void *obj)
+{
+    /* レイテンシー0 */
+    (void)obj;
+    return 0;
+}
+
+/* 統計情報の取得 */
+static uint8_t RIDirectFIR_GetStatistics(void *obj, struct RIConvolveStatistics *statistics)
+{
+#if defined(RICONVOLVE_ENABLE_STATISTICS)
+    const struct RIDirectFIR *conv = (const struct RIDirectFIR *)obj;
+
+    /* 引数チェック */
+    assert((obj != NULL) && (statistics != NULL));
+
+    RIConvolveStatistics_Snapshot(&conv->statistics, statistics);
+
+    return 1;
+#else
+    (void)obj;
+    (void)statistics;
+    return 0;
+#endif
+}
+
+/* 要素間隔strideのsrcを連続領域dstにコピー */
+static void RIDirectFIR_CopyFromStrided(float *dst, const float *src, uint32_t stride, uint32_t num_samples)
+{
+    uint32_t smpl;
+
+    if (stride == 1) {
+        memcpy(dst, src, sizeof(float) * num_samples);
+        return;
+    }
+
+    for (smpl = 0; smpl < num_samples; smpl++) {
+        dst[smpl] = src[(size_t)smpl * stride];
+    }
+}
+
+/* 連続領域srcを要素間隔strideのdstにコピー */
+static void RIDirectFIR_CopyToStrided(float *dst, uint32_t stride, const float *src, uint32_t num_samples)
+{
+    uint32_t smpl;
+
+    if (stride == 1) {
+        memcpy(dst, src, sizeof(float) * num_samples);
+        return;
+    }
+
+    for (smpl = 0; smpl < num_samples; smpl++) {
+        dst[(size_t)smpl * stride] = src[smpl];
+    }
+}
@@ -7,9 +7,10 @@
 #include "ri_convolve.h"
 #include "ri_fft.h"
 #include "ri_ring_buffer.h"
+#include "ri_convolve_statistics.h"
 
-/* FFT点数 */
-#define RIFFTCONVOLVE_FFT_SIZE 2048
+/* 既定の係数分割サイズ(FFT点数はこの2倍) */
+#define RIFFTCONVOLVE_DEFAULT_PARTITION_SIZE 1024
 /* メモリアラインメント */
 #define RIFFTCONVOLVE_ALIGNMENT 16
 /* ある整数が2の冪乗か判定. 0:2の冪乗ではない, それ以外:2の冪乗 */
@@ -31,36 +32,56 @@ struct RIFFTConvolve {
     uint32_t buffer_count; /* 入力バッファサンプル数カウント */
     uint32_t current_part; /* 現在処理中の分割 */
     uint32_t max_num_input_samples;	/* 最大入力サンプル数 */
-    float *ir_freq; /* フーリエ変換済みのインパルス応答 */
+    uint32_t num_delay_samples; /* 出力の追加遅延サンプル数 */
+    const float *ir_freq; /* 畳み込みに使用するフーリエ変換済みのインパルス応答 */
+    float *ir_freq_buffer; /* フーリエ変換済みのインパルス応答の格納領域 */
     struct RIRingBuffer *input_buffer; /* 入力データリングバッファ */
     struct RIRingBuffer *output_buffer; /* 出力データリングバッファ */
     struct RIRingBuffer *freq_buffer; /* 周波数領域に変換したデータバッファ */
     void *freq_buffer_work; /* データバッファのワーク領域先頭ポインタ */
     float *work_buffer[2]; /* 複素数演算バッファ */
     float *comp_muladd_buffer; /* 複素数乗算/加算計算結果バッファ */
+#if defined(RICONVOLVE_ENABLE_STATISTICS)
+    struct RIConvolveStatisticsCounter statistics; /* 統計情報 */
+#endif
 };
 
 /* ワークサイズ計算 */
-static int32_t RIFFTConvolve_CalculateWorkSize(const struct RIConvolveConfig *config);
+static int64_t RIFFTConvolve_CalculateWorkSize(const struct RIConvolveConfig *config);
 /* インスタンス生成 */
-static void* RIFFTConvolve_Create(const struct RIConvolveConfig *config, void *work, int32_t work_size);
+static void* RIFFTConvolve_Create(const struct RIConvolveConfig *config, void *work, int64_t work_size);
 /* インスタンス破棄 */
 static void RIFFTConvolve_Destroy(void *obj);
 /* 内部状態リセット */
 static void RIFFTConvolve_Reset(void *obj);
 /* 係数セット */
 static void RIFFTConvolve_SetCoefficients(void *obj, const float *coefficients, uint32_t num_coefficients);
-/* ワークサイズ計算 */
+/* 畳み込み */
 static void RIFFTConvolve_Convolve(void *obj, const float *input, float *output, uint32_t num_samples);
+/* 要素間隔を指定した畳み込み計算 */
+static void RIFFTConvolve_ConvolveStrided(void *obj,
+        const float *input, uint32_t input_stride, float *output, uint32_t output_stride, uint32_t num_samples);
 /* レイテンシーの取得 */
 static int32_t RIFFTConvolve_GetLatencyNumSamples(void *obj);
+/* 統計情報の取得 */
+static uint8_t RIFFTConvolve_GetStatistics(void *obj, struct RIConvolveStatistics *statistics);
 
 /* 引数を2の冪乗に切り上げる */
 static uint32_t RIFFTConvolve_Roundup2PoweredValue(uint32_t val);
-/* srcとcoefを複素乗算し、dstに足し込む */
-static void RIFFTConvolve_MulAddSpectrum(
-        float *dst, const float *src, const float *coef, uint32_t num_complex);
-
+/* コンフィグからFFT点数を取得 */
+static uint32_t RIFFTConvolve_GetFFTSize(const struct RIConvolveConfig *config);
+/* 入力を畳み込み、出力バッファからnum_samplesだけ結果を取り出す */
+static const float *RIFFTConvolve_Process(struct RIFFTConvolve *conv,
+        const float *input, uint32_t input_stride, uint32_t num_samples);
+#if defined(RICONVOLVE_ENABLE_STATISTICS)
+/* 1ブロック分の分割毎の複素乗算/加算回数を集計 */
+static void RIFFTConvolve_CountPartitionMacs(struct RIFFTConvolve *conv);
+#endif
+
+/* 要素間隔strideのsrcを連続領域dstにコピー */
+static void RIFFTConvolve_CopyFromStrided(float *dst, const float *src, uint32_t stride, uint32_t num_samples);
+/* 連続領域srcを要素間隔strideのdstにコピー */
+static void RIFFTConvolve_CopyToStrided(float *dst, uint32_t stride, const float *src, uint32_t num_samples);
 /* インターフェース */
 static const struct RIConvolveInterface st_fft_convolve_if = {
     RIFFTConvolve_CalculateWorkSize,
@@ -69,11 +90,13 @@ static const struct RIConvolveInterface st_fft_convolve_if = {
     RIFFTConvolve_Reset,
     RIFFTConvolve_SetCoefficients,
     RIFFTConvolve_Convolve,
+    RIFFTConvolve_ConvolveStrided,
     RIFFTConvolve_GetLatencyNumSamples,
+    RIFFTConvolve_GetStatistics,
 };
 
-/* FFTのサイズチェック */
-extern char fft_size_check[IS_POWER_OF_2(RIFFTCONVOLVE_FFT_SIZE) ? 1 : -1];
+/* 既定の分割サイズチェック */
+extern char fft_size_check[IS_POWER_OF_2(RIFFTCONVOLVE_DEFAULT_PARTITION_SIZE) ? 1 : -1];
 
 /* インターフェース取得 */
 const struct RIConvolveInterface *RIFFTConvolve_GetInterface(void)
@@ -82,19 +105,24 @@ const struct RIConvolveInterface *RIFFTConvolve_GetInterface(void)
 }
 
 /* ワークサイズ計算 */
-static int32_t RIFFTConvolve_CalculateWorkSize(const struct RIConvolveConfig *config)
+static int64_t RIFFTConvolve_CalculateWorkSize(const struct RIConvolveConfig *config)
 {
-    int32_t work_size;
+    int64_t work_size, freq_size;
     uint32_t fft_size, max_fft_size, max_num_partitions;
-    int32_t time_buffer_work_size, freq_buffer_work_size;
+    int64_t time_buffer_work_size, output_buffer_work_size, freq_buffer_work_size;
     struct RIRingBufferConfig buffer_config;
 
     if (config == NULL) {
         return -1;
     }
 
+    /* FFT点数(係数長の2倍の2の冪乗)がuint32_tに収まらない */
+    if (config->max_num_coefficients > (UINT32_MAX >> 2)) {
+        return -1;
+    }
+
     /* FFTサイズ */
-    fft_size = RIFFTCONVOLVE_FFT_SIZE;
+    fft_size = RIFFTConvolve_GetFFTSize(config);
 
     /* 最大のFFTサイズを取得 */
     /* 補足）2倍するのは巡回畳み込み対策。FFT畳み込み結果の半分は折り返している。 */
@@ -103,18 +131,33 @@ static int32_t RIFFTConvolve_CalculateWorkSize(const struct RIConvolveConfig *co
     /* 最大分割数の計算 */
     max_num_partitions = max_fft_size / fft_size;
 
+    /* 周波数領域データのサイズ */
+    if ((freq_size = RICONVOLVE_MUL_WORK_SIZE(sizeof(float) * (uint64_t)fft_size, max_num_partitions)) < 0) {
+        return -1;
+    }
+
     /* 入出力リングバッファの領域計算 */
     buffer_config.max_size = sizeof(float) * (fft_size + config->max_num_input_samples);
     /* FFT点数分、もしくは最大サンプル数分拾ってくる場合がある */
     buffer_config.max_required_size = sizeof(float) * MAX(fft_size, config->max_num_input_samples);
+    buffer_config.enable_spsc = 0;
+    buffer_config.use_mirrored_memory = 0;
     time_buffer_work_size = RIRingBuffer_CalculateWorkSize(&buffer_config);
     if (time_buffer_work_size < 0) {
         return -1;
     }
+    /* 出力リングバッファは遅延サンプル分大きく取る */
+    if (RICONVOLVE_ADD_WORK_SIZE(buffer_config.max_size, sizeof(float) * (uint64_t)config->num_delay_samples) < 0) {
+        return -1;
+    }
+    buffer_config.max_size += sizeof(float) * (size_t)config->num_delay_samples;
+    if ((output_buffer_work_size = RIRingBuffer_CalculateWorkSize(&buffer_config)) < 0) {
+        return -1;
+    }
 
     /* 周波数領域に変換したデータのバッファの領域計算 */
     /* 係数設定時に係数長に合わせたサイズのリングバッファを再構築する */
-    buffer_config.max_size = sizeof(float) * max_num_partitions * fft_size;
+    buffer_config.max_size = (size_t)freq_size;
     buffer_config.max_required_size = sizeof(float) * fft_size; 
     freq_buffer_work_size = RIRingBuffer_CalculateWorkSize(&buffer_config);
     if (freq_buffer_work_size < 0) {
@@ -122,38 +165,45 @@ static int32_t RIFFTConvolve_CalculateWorkSize(const struct RIConvolveConfig *co
     }
 
     /* ハンドル領域分 */
-    work_size = sizeof(struct RIFFTConvolve) + RIFFTCONVOLVE_ALIGNMENT;
+    work_size = (int64_t)(sizeof(struct RIFFTConvolve) + RIFFTCONVOLVE_ALIGNMENT);
     /* フーリエ変換済みの係数領域分 */
-    work_size += sizeof(float) * max_num_partitions * fft_size + RIFFTCONVOLVE_ALIGNMENT;
+    work_size = RICONVOLVE_ADD_WORK_SIZE(work_size, RICONVOLVE_ADD_WORK_SIZE(freq_size, RIFFTCONVOLVE_ALIGNMENT));
     /* 複素作業領域分 FFT点数分確保 */
-    work_size += 2 * (sizeof(float) * fft_size + RIFFTCONVOLVE_ALIGNMENT);
+    work_size = RICONVOLVE_ADD_WORK_SIZE(work_size,
+            RICONVOLVE_MUL_WORK_SIZE(RICONVOLVE_ARRAY_WORK_SIZE(sizeof(float), fft_size, RIFFTCONVOLVE_ALIGNMENT), 2));
     /* 複素乗算/加算作業領域分 FFT点数分確保 */
-    work_size += (sizeof(float) * fft_size + RIFFTCONVOLVE_ALIGNMENT);
+    work_size = RICONVOLVE_ADD_WORK_SIZE(work_size,
+            RICONVOLVE_ARRAY_WORK_SIZE(sizeof(float), fft_size, RIFFTCONVOLVE_ALIGNMENT));
     /* 入出力データバッファ分 */
-    work_size += 2 * time_buffer_work_size;
+    work_size = RICONVOLVE_ADD_WORK_SIZE(work_size, time_buffer_work_size);
+    work_size = RICONVOLVE_ADD_WORK_SIZE(work_size, output_buffer_work_size);
     /* 周波数領域に変換したデータのバッファ分 */
-    work_size += freq_buffer_work_size;
+    work_size = RICONVOLVE_ADD_WORK_SIZE(work_size, freq_buffer_work_size);
 
     return work_size;
 }
 
 /* インスタンス生成 */
-static void* RIFFTConvolve_Create(const struct RIConvolveConfig *config, void *work, int32_t work_size)
+static void* RIFFTConvolve_Create(const struct RIConvolveConfig *config, void *work, int64_t work_size)
 {
     uint8_t *work_ptr = (uint8_t *)work;
     struct RIFFTConvolve* conv;
     uint32_t fft_size, max_fft_size, max_num_partitions;
-    int32_t buffer_work_size;
+    int64_t buffer_work_size, required_size;
     struct RIRingBufferConfig buffer_config;
 
     /* 引数チェック */
-    if ((config == NULL) || (work == NULL)
-            || (work_size < RIFFTConvolve_CalculateWorkSize(config))) {
+    if ((config == NULL) || (work == NULL)) {
+        return NULL;
+    }
+
+    if (((required_size = RIFFTConvolve_CalculateWorkSize(config)) < 0)
+            || (work_size < required_size)) {
         return NULL;
     }
 
     /* FFTサイズ */
-    fft_size = RIFFTCONVOLVE_FFT_SIZE;
+    fft_size = RIFFTConvolve_GetFFTSize(config);
 
     /* 最大のFFTサイズを取得 */
     /* 補足）2倍するのは巡回畳み込み対策。FFT畳み込み結果の半分は折り返している。 */
@@ -167,16 +217,18 @@ static void* RIFFTConvolve_Create(const struct RIConvolveConfig *config, void *w
     conv = (struct RIFFTConvolve *)work_ptr;
     conv->fft_size = fft_size;
     conv->partition_size = fft_size / 2;
-    conv->max_num_coefficients = RIFFTConvolve_Roundup2PoweredValue(config->max_num_coefficients);
+    conv->max_num_coefficients = config->max_num_coefficients;
     conv->max_num_input_samples = config->max_num_input_samples;
+    conv->num_delay_samples = config->num_delay_samples;
     conv->num_coefficients = fft_size / 2;
     conv->num_partitions = 1;
     work_ptr += sizeof(struct RIFFTConvolve);
 
     /* 変換済み係数の割り当て */
     work_ptr = (uint8_t *)ROUNDUP((uintptr_t)work_ptr, RIFFTCONVOLVE_ALIGNMENT);
-    conv->ir_freq = (float *)work_ptr;
-    work_ptr += sizeof(float) * max_num_partitions * fft_size;
+    conv->ir_freq_buffer = (float *)work_ptr;
+    conv->ir_freq = conv->ir_freq_buffer;
+    work_ptr += sizeof(float) * (size_t)max_num_partitions * fft_size;
 
     /* 作業領域の割り当て */
     work_ptr = (uint8_t *)ROUNDUP((uintptr_t)work_ptr, RIFFTCONVOLVE_ALIGNMENT);
@@ -193,18 +245,26 @@ static void* RIFFTConvolve_Create(const struct RIConvolveConfig *config, void *w
     buffer_config.max_size = sizeof(float) * (fft_size + config->max_num_input_samples);
     /* FFT点数分、もしくは最大サンプル数分取得する場合がある */
     buffer_config.max_required_size = sizeof(float) * MAX(fft_size, config->max_num_input_samples);
+    buffer_config.enable_spsc = 0;
+    buffer_config.use_mirrored_memory = 0;
     buffer_work_size = RIRingBuffer_CalculateWorkSize(&buffer_config);
     if (buffer_work_size < 0) {
         return NULL;
     }
     conv->input_buffer = RIRingBuffer_Create(&buffer_config, work_ptr, buffer_work_size);
     work_ptr += buffer_work_size;
+    /* 出力バッファは遅延サンプル分大きく取る */
+    buffer_config.max_size += sizeof(float) * (size_t)config->num_delay_samples;
+    buffer_work_size = RIRingBuffer_CalculateWorkSize(&buffer_config);
+    if (buffer_work_size < 0) {
+        return NULL;
+    }
     conv->output_buffer = RIRingBuffer_Create(&buffer_config, work_ptr, buffer_work_size);
     work_ptr += buffer_work_size;
 
     /* 周波数領域に変換したデータバッファ */
     /* 係数設定時に係数長に合わせたサイズのリングバッファを再構築する */
-    buffer_config.max_size = sizeof(float) * max_num_partitions * fft_size;
+    buffer_config.max_size = sizeof(float) * (size_t)max_num_partitions * fft_size;
     buffer_config.max_required_size = sizeof(float) * fft_size; 
     buffer_work_size = RIRingBuffer_CalculateWorkSize(&buffer_config);
     if (buffer_work_size < 0) {
@@ -217,6 +277,10 @@ static void* RIFFTConvolve_Create(const struct RIConvolveConfig *config, void *w
     /* バッファをリセット */
     RIFFTConvolve_Reset(conv);
 
+#if defined(RICONVOLVE_ENABLE_STATISTICS)
+    RIConvolveStatistics_Initialize(&conv->statistics);
+#endif
+
     return conv;
 }
 
@@ -236,11 +300,7 @@ static void RIFFTConvolve_Destroy(void *obj)
 /* 係数セット */
 static void RIFFTConvolve_SetCoefficients(void *obj, const float *coefficients, uint32_t num_coefficients)
 {
-    uint32_t smpl, i;
     struct RIFFTConvolve *conv = (struct RIFFTConvolve *)obj;
-    float norm_factor_inverse;
-    struct RIRingBufferConfig buffer_config;
-    int32_t buffer_work_size;
 
     /* 引数チェック */
     assert((obj != NULL) && (coefficients != NULL));
@@ -248,33 +308,77 @@ static void RIFFTConvolve_SetCoefficients(void *obj, const float *coefficients,
     /* 係数サイズチェック */
     assert(num_coefficients <= conv->max_num_coefficients);
 
-    /* 係数サイズは分割処理単位に切り上げる */
-    conv->num_coefficients = ROUNDUP(num_coefficients, conv->partition_size);
-    /* 分割数の再計算 */
-    conv->num_partitions = conv->num_coefficients / conv->partition_size;
+    /* 自前の領域に係数をフーリエ変換 */
+    RIFFTConvolve_MakeSpectrum(conv->partition_size,
+            coefficients, num_coefficients, conv->ir_freq_buffer, conv->work_buffer[1]);
+
+    /* 変換結果をセット */
+    RIFFTConvolve_BindSpectrum(conv, conv->ir_freq_buffer, num_coefficients);
+}
+
+/* 分割スペクトルのサイズ(float要素数)計算 */
+uint32_t RIFFTConvolve_CalculateSpectrumSize(uint32_t partition_size, uint32_t num_coefficients)
+{
+    /* 分割数 x FFT点数 */
+    return (ROUNDUP(num_coefficients, partition_size) / partition_size) * (2 * partition_size);
+}
+
+/* 係数を分割してフーリエ変換したスペクトルを作成 */
+void RIFFTConvolve_MakeSpectrum(uint32_t partition_size,
+        const float *coefficients, uint32_t num_coefficients, float *spectrum, float *work)
+{
+    uint32_t smpl, i;
+    const uint32_t fft_size = 2 * partition_size;
+    const float norm_factor_inverse = 2.0f / (float)fft_size;
+
+    /* 引数チェック */
+    assert((coefficients != NULL) && (spectrum != NULL) && (work != NULL));
+    assert(IS_POWER_OF_2(partition_size));
 
     /* 後半0埋めを行いつつFFT */
-    norm_factor_inverse = 2.0f / conv->fft_size;
-    for (smpl = 0; smpl < conv->num_coefficients; smpl += conv->partition_size) {
-        const uint32_t copy_samples = MIN(conv->partition_size, num_coefficients - smpl);
-        /* 一旦0埋め（後半部分の0埋めを兼ねる） */
-        memset(conv->work_buffer[0], 0, sizeof(float) * conv->fft_size);
+    for (smpl = 0; smpl < num_coefficients; smpl += partition_size) {
+        const uint32_t copy_samples = MIN(partition_size, num_coefficients - smpl);
+        float *part = &spectrum[2 * smpl];
         /* 係数コピー */
-        memcpy(conv->work_buffer[0], &coefficients[smpl], sizeof(float) * copy_samples);
+        memcpy(part, &coefficients[smpl], sizeof(float) * copy_samples);
+        /* 後半部分の0埋め */
+        memset(&part[copy_samples], 0, sizeof(float) * (fft_size - copy_samples));
         /* 変換前に正規化 */
         for (i = 0; i < copy_samples; i++) {
-            conv->work_buffer[0][i] *= norm_factor_inverse;
+            part[i] *= norm_factor_inverse;
         }
         /* 係数をFFT */
-        RIFFT_RealFFT((int)conv->fft_size, -1, conv->work_buffer[0], conv->work_buffer[1]);
-        /* 結果をコピー */
-        memcpy(&conv->ir_freq[2 * smpl], conv->work_buffer[0], sizeof(float) * conv->fft_size);
+        RIFFT_RealFFT((int)fft_size, -1, part, work);
     }
+}
+
+/* 変換済みの分割スペクトルをセット */
+void RIFFTConvolve_BindSpectrum(void *obj, const float *spectrum, uint32_t num_coefficients)
+{
+    struct RIFFTConvolve *conv = (struct RIFFTConvolve *)obj;
+    struct RIRingBufferConfig buffer_config;
+    int64_t buffer_work_size;
+
+    /* 引数チェック */
+    assert((obj != NULL) && (spectrum != NULL));
+
+    /* 係数サイズチェック */
+    assert(num_coefficients <= conv->max_num_coefficients);
+
+    /* 係数サイズは分割処理単位に切り上げる */
+    conv->num_coefficients = ROUNDUP(num_coefficients, conv->partition_size);
+    /* 分割数の再計算 */
+    conv->num_partitions = conv->num_coefficients / conv->partition_size;
+
+    /* スペクトルはコピーせずに参照 */
+    conv->ir_freq = spectrum;
 
     /* 周波数領域に変換したデータバッファを再構築 */
     RIRingBuffer_Destroy(conv->freq_buffer);
-    buffer_config.max_size = sizeof(float) * conv->num_partitions * conv->fft_size;
-    buffer_config.max_required_size = sizeof(float) * conv->fft_size; 
+    buffer_config.max_size = sizeof(float) * (size_t)conv->num_partitions * conv->fft_size;
+    buffer_config.max_required_size = sizeof(float) * conv->fft_size;
+    buffer_config.enable_spsc = 0;
+    buffer_config.use_mirrored_memory = 0;
     buffer_work_size = RIRingBuffer_CalculateWorkSize(&buffer_config);
     assert(buffer_work_size > 0);
     conv->freq_buffer = RIRingBuffer_Create(&buffer_config, conv->freq_buffer_work, buffer_work_size);
@@ -284,19 +388,137 @@ static void RIFFTConvolve_SetCoefficients(void *obj, const float *coefficients,
     RIFFTConvolve_Reset(conv);
 }
 
+/* 分割サイズの取得 */
+uint32_t RIFFTConvolve_GetPartitionSize(const void *obj)
+{
+    const struct RIFFTConvolve *conv = (const struct RIFFTConvolve *)obj;
+
+    assert(obj != NULL);
+
+    return conv->partition_size;
+}
+
+/* 変換済みの入力スペクトルから1分割分の畳み込み計算 */
+void RIFFTConvolve_ConvolveSpectrum(void *obj, const float *input_spectrum, float *output)
+{
+    struct RIFFTConvolve *conv = (struct RIFFTConvolve *)obj;
+    const size_t freqbuffer_unit_size = sizeof(float) * conv->fft_size; /* 周波数データバッファの処理単位 */
+    uint32_t part;
+    void *buffer_ptr;
+
+    /* 引数チェック */
+    assert((obj != NULL) && (input_spectrum != NULL) && (output != NULL));
+
+    /* 入出力が同一領域の場合があるため、積和は内部のバッファで行う */
+
+    /* 過去の入力と係数の2番目以降の分割を複素乗算/加算 */
+    for (part = 1; part < conv->num_partitions; part++) {
+        /* バッファ先頭からは最も古い結果が取れるので、係数末尾から畳み込みを行う */
+        const size_t part_offset = (size_t)(conv->num_partitions - part) * conv->fft_size;
+        RIRingBuffer_Get(conv->freq_buffer, &buffer_ptr, freqbuffer_unit_size);
+        RIFFTConvolve_MulAddSpectrum(conv->comp_muladd_buffer,
+                (const float *)buffer_ptr, &conv->ir_freq[part_offset], conv->partition_size);
+        RIRingBuffer_Put(conv->freq_buffer, buffer_ptr, freqbuffer_unit_size);
+    }
+
+    /* 入力スペクトルを周波数バッファに入力（一番古いデータは消去） */
+    RIRingBuffer_Get(conv->freq_buffer, &buffer_ptr, freqbuffer_unit_size);
+    RIRingBuffer_Put(conv->freq_buffer, input_spectrum, freqbuffer_unit_size);
+
+    /* 係数先頭分を複素乗算/加算 */
+    RIFFTConvolve_MulAddSpectrum(conv->comp_muladd_buffer, input_spectrum, &conv->ir_freq[0], conv->partition_size);
+
+    /* IFFT */
+    RIFFT_RealFFT((int)conv->fft_size, 1, conv->comp_muladd_buffer, conv->work_buffer[1]);
+
+    /* 有効な結果後半を出力し、複素数乗算/加算結果バッファをクリア */
+    memcpy(output, &conv->comp_muladd_buffer[conv->fft_size / 2], freqbuffer_unit_size / 2);
+    memset(conv->comp_muladd_buffer, 0, freqbuffer_unit_size);
+
+#if defined(RICONVOLVE_ENABLE_STATISTICS)
+    /* 入力の変換は呼び出し元が行うためFFT回数は数えない */
+    conv->statistics.local.num_iffts++;
+    RIFFTConvolve_CountPartitionMacs(conv);
+    RIConvolveStatistics_Publish(&conv->statistics);
+#endif
+}
+
 /* 畳み込み計算 */
 static void RIFFTConvolve_Convolve(void *obj, const float *input, float *output, uint32_t num_samples)
+{
+    RIFFTConvolve_ConvolveStrided(obj, input, 1, output, 1, num_samples);
+}
+
+/* 要素間隔を指定した畳み込み計算 */
+static void RIFFTConvolve_ConvolveStrided(void *obj,
+        const float *input, uint32_t input_stride, float *output, uint32_t output_stride, uint32_t num_samples)
 {
     struct RIFFTConvolve *conv = (struct RIFFTConvolve *)obj;
-    const uint32_t input_size = sizeof(float) * num_samples;
-    const uint32_t freqbuffer_unit_size = sizeof(float) * conv->fft_size; /* 周波数データバッファの処理単位 */
-    void *buffer_ptr;
+    const float *result;
+#if defined(RICONVOLVE_ENABLE_STATISTICS)
+    const uint64_t start_ticks = RIConvolveStatistics_GetTicks();
+#endif
+
+    /* 引数チェック */
+    assert((obj != NULL) && (input != NULL) && (output != NULL));
+    assert((input_stride > 0) && (output_stride > 0));
+
+    result = RIFFTConvolve_Process(conv, input, input_stride, num_samples);
+    RIFFTConvolve_CopyToStrided(output, output_stride, result, num_samples);
+
+#if defined(RICONVOLVE_ENABLE_STATISTICS)
+    /* 統計情報の更新 */
+    RIConvolveStatistics_RecordCall(&conv->statistics, num_samples, RIConvolveStatistics_GetTicks() - start_ticks);
+    RIConvolveStatistics_Publish(&conv->statistics);
+#endif
+}
+
+/* 畳み込み結果を出力に足し込む */
+void RIFFTConvolve_ConvolveAdd(void *obj, const float *input, float *output, uint32_t num_samples)
+{
+    RIFFTConvolve_ConvolveAddStrided(obj, input, 1, output, 1, num_samples);
+}
+
+/* 要素間隔を指定して畳み込み結果を出力に足し込む */
+void RIFFTConvolve_ConvolveAddStrided(void *obj,
+        const float *input, uint32_t input_stride, float *output, uint32_t output_stride, uint32_t num_samples)
+{
+    struct RIFFTConvolve *conv = (struct RIFFTConvolve *)obj;
+    const float *result;
+    uint32_t smpl;
+#if defined(RICONVOLVE_ENABLE_STATISTICS)
+    const uint64_t start_ticks = RIConvolveStatistics_GetTicks();
+#endif
 
     /* 引数チェック */
     assert((obj != NULL) && (input != NULL) && (output != NULL));
+    assert((input_stride > 0) && (output_stride > 0));
 
-    /* 入力のバッファリング */
-    RIRingBuffer_Put(conv->input_buffer, input, input_size);
+    result = RIFFTConvolve_Process(conv, input, input_stride, num_samples);
+    for (smpl = 0; smpl < num_samples; smpl++) {
+        output[(size_t)smpl * output_stride] += result[smpl];
+    }
+
+#if defined(RICONVOLVE_ENABLE_STATISTICS)
+    /* 統計情報の更新 */
+    RIConvolveStatistics_RecordCall(&conv->statistics, num_samples, RIConvolveStatistics_GetTicks() - start_ticks);
+    RIConvolveStatistics_Publish(&conv->statistics);
+#endif
+}
+
+/* 入力を畳み込み、出力バッファからnum_samplesだけ結果を取り出す */
+static const float *RIFFTConvolve_Process(struct RIFFTConvolve *conv,
+        const float *input, uint32_t input_stride, uint32_t num_samples)
+{
+    const size_t input_size = sizeof(float) * num_samples;
+    const size_t freqbuffer_unit_size = sizeof(float) * conv->fft_size; /* 周波数データバッファの処理単位 */
+    void *buffer_ptr, *spectrum_ptr;
+    float *spectrum;
+
+    /* 入力のバッファリング 要素間隔があればバッファ上に直接詰める */
+    RIRingBuffer_Reserve(conv->input_buffer, &buffer_ptr, input_size);
+    RIFFTConvolve_CopyFromStrided((float *)buffer_ptr, input, input_stride, num_samples);
+    RIRingBuffer_Commit(conv->input_buffer, input_size);
 
     /* バッファサンプル数を増加 */
     conv->buffer_count += num_samples;
@@ -313,7 +535,7 @@ static void RIFFTConvolve_Convolve(void *obj, const float *input, float *output,
         /* 周波数領域で複素乗算/加算 */
         for (; conv->current_part < goal_part; conv->current_part++) {
             /* バッファ先頭からは最も古い結果が取れるので、係数末尾から畳み込みを行う */
-            const uint32_t part_offset = (conv->num_partitions - conv->current_part) * conv->fft_size;
+            const size_t part_offset = (size_t)(conv->num_partitions - conv->current_part) * conv->fft_size;
             /* 周波数バッファを取り出す */
             RIRingBuffer_Get(conv->freq_buffer, &buffer_ptr, freqbuffer_unit_size);
             RIFFTConvolve_MulAddSpectrum(conv->comp_muladd_buffer,
@@ -328,31 +550,39 @@ static void RIFFTConvolve_Convolve(void *obj, const float *input, float *output,
     while (conv->buffer_count >= conv->fft_size) {
         /* 残った分の複素乗算/加算を実行 */
         for (; conv->current_part < conv->num_partitions; conv->current_part++) {
-            const uint32_t part_offset = (conv->num_partitions - conv->current_part) * conv->fft_size;
+            const size_t part_offset = (size_t)(conv->num_partitions - conv->current_part) * conv->fft_size;
             RIRingBuffer_Get(conv->freq_buffer, &buffer_ptr, freqbuffer_unit_size);
             RIFFTConvolve_MulAddSpectrum(conv->comp_muladd_buffer,
                     (const float *)buffer_ptr, &conv->ir_freq[part_offset], conv->partition_size);
             RIRingBuffer_Put(conv->freq_buffer, buffer_ptr, freqbuffer_unit_size);
         }
 
+        /* 周波数バッファの一番古いデータを消去し、空いた領域を変換先として確保 */
+        RIRingBuffer_Get(conv->freq_buffer, &buffer_ptr, freqbuffer_unit_size);
+        RIRingBuffer_Reserve(conv->freq_buffer, &spectrum_ptr, freqbuffer_unit_size);
+        spectrum = (float *)spectrum_ptr;
+
         /* 入力バッファからFFTサイズ分データを取り出し */
         /* FFT点数/2だけバッファを進めるため、取り出しサイズは freqbuffer_unit_size / 2 */
         RIRingBuffer_Get(conv->input_buffer, &buffer_ptr, freqbuffer_unit_size / 2);
-        memcpy(conv->work_buffer[0], buffer_ptr, freqbuffer_unit_size); /* 注: 取得するのはfreqbuffer_unit_size */
+        memcpy(spectrum, buffer_ptr, freqbuffer_unit_size); /* 注: 取得するのはfreqbuffer_unit_size */
 
-        /* FFT */
-        RIFFT_RealFFT((int)conv->fft_size, -1, conv->work_buffer[0], conv->work_buffer[1]);
+        /* 周波数バッファ上でFFTし、結果を確定 */
+        RIFFT_RealFFT((int)conv->fft_size, -1, spectrum, conv->work_buffer[1]);
+        RIRingBuffer_Commit(conv->freq_buffer, freqbuffer_unit_size);
 
-        /* 結果を周波数バッファに入力（一番古いデータは消去） */
-        RIRingBuffer_Get(conv->freq_buffer, &buffer_ptr, freqbuffer_unit_size);
-        RIRingBuffer_Put(conv->freq_buffer, conv->work_buffer[0], freqbuffer_unit_size);
-        
         /* 係数先頭分を複素乗算/加算 */
-        RIFFTConvolve_MulAddSpectrum(conv->comp_muladd_buffer, conv->work_buffer[0], &conv->ir_freq[0], conv->partition_size);
+        RIFFTConvolve_MulAddSpectrum(conv->comp_muladd_buffer, spectrum, &conv->ir_freq[0], conv->partition_size);
 
         /* IFFT */
         RIFFT_RealFFT((int)conv->fft_size, 1, conv->comp_muladd_buffer, conv->work_buffer[1]);
 
+#if defined(RICONVOLVE_ENABLE_STATISTICS)
+        conv->statistics.local.num_ffts++;
+        conv->statistics.local.num_iffts++;
+        RIFFTConvolve_CountPartitionMacs(conv);
+#endif
+
         /* 結果を出力バッファに書き出す */
         /* FFT畳み込みで有効なのは結果後半のみ（直線畳み込み）。後半のみ出力バッファに書き出す */
         RIRingBuffer_Put(conv->output_buffer, &conv->comp_muladd_buffer[conv->fft_size / 2], freqbuffer_unit_size / 2);
@@ -369,12 +599,11 @@ static void RIFFTConvolve_Convolve(void *obj, const float *input, float *output,
 
     /* 出力バッファから取り出し */
     RIRingBuffer_Get(conv->output_buffer, &buffer_ptr, input_size);
-    memcpy(output, buffer_ptr, input_size);
+    return (const float *)buffer_ptr;
 }
 
 /* srcとcoefを複素乗算し、dstに足し込む */
-static void RIFFTConvolve_MulAddSpectrum(
-        float *dst, const float *src, const float *coef, uint32_t num_complex)
+void RIFFTConvolve_MulAddSpectrum(float *dst, const float *src, const float *coef, uint32_t num_complex)
 {
     uint32_t cmplx;
     float src_re, src_im, coef_re, coef_im;
@@ -400,9 +629,9 @@ static void RIFFTConvolve_MulAddSpectrum(
 /* 内部状態リセット */
 static void RIFFTConvolve_Reset(void *obj)
 {
-    uint32_t part;
+    uint32_t part, smpl;
     struct RIFFTConvolve *conv = (struct RIFFTConvolve *)obj;
-    const uint32_t fft_buffer_size = sizeof(float) * conv->fft_size;
+    const size_t fft_buffer_size = sizeof(float) * conv->fft_size;
 
     /* 作業領域をクリア */
     memset(conv->work_buffer[0], 0, fft_buffer_size);
@@ -418,6 +647,11 @@ static void RIFFTConvolve_Reset(void *obj)
     /* 補足）最初のFFT点数/2の分はFFTを行うまで出力できないため、無音を入れておく */
     RIRingBuffer_Put(conv->input_buffer,  conv->work_buffer[0], fft_buffer_size / 2);
     RIRingBuffer_Put(conv->output_buffer, conv->work_buffer[0], fft_buffer_size / 2);
+    /* 出力の追加遅延分の無音 */
+    for (smpl = 0; smpl < conv->num_delay_samples; smpl += conv->fft_size) {
+        const uint32_t num_samples = MIN(conv->fft_size, conv->num_delay_samples - smpl);
+        RIRingBuffer_Put(conv->output_buffer, conv->work_buffer[0], sizeof(float) * num_samples);
+    }
 
     /* 周波数領域に変換したデータに0を詰める */
     /* 補足）初回の分割での入力がバッファ末尾に入る様に、分割数-1までを全て0で埋める */
@@ -437,8 +671,27 @@ static int32_t RIFFTConvolve_GetLatencyNumSamples(void *obj)
 {
     struct RIFFTConvolve *conv = (struct RIFFTConvolve *)obj;
 
-    /* 分割サイズ(=FFT点数/2)分遅れる */
-    return (int32_t)conv->partition_size;
+    /* 分割サイズ(=FFT点数/2)と追加遅延分遅れる */
+    return (int32_t)(conv->partition_size + conv->num_delay_samples);
+}
+
+/* 統計情報の取得 */
+static uint8_t RIFFTConvolve_GetStatistics(void *obj, struct RIConvolveStatistics *statistics)
+{
+#if defined(RICONVOLVE_ENABLE_STATISTICS)
+    const struct RIFFTConvolve *conv = (const struct RIFFTConvolve *)obj;
+
+    /* 引数チェック */
+    assert((obj != NULL) && (statistics != NULL));
+
+    RIConvolveStatistics_Snapshot(&conv->statistics, statistics);
+
+    return 1;
+#else
+    (void)obj;
+    (void)statistics;
+    return 0;
+#endif
 }
 
 /* 2の冪乗に切り上げ */
@@ -454,3 +707,58 @@ static uint32_t RIFFTConvolve_Roundup2PoweredValue(uint32_t val)
 
     return val;
 }
+
+/* コンフィグからFFT点数を取得 */
+static uint32_t RIFFTConvolve_GetFFTSize(const struct RIConvolveConfig *config)
+{
+    /* 分割サイズの指定がなければ既定値 */
+    if (config->fft_partition_size == 0) {
+        return 2 * RIFFTCONVOLVE_DEFAULT_PARTITION_SIZE;
+    }
+
+    return 2 * RIFFTConvolve_Roundup2PoweredValue(config->fft_partition_size);
+}
+
+#if defined(RICONVOLVE_ENABLE_STATISTICS)
+/* 1ブロック分の分割毎の複素乗算/加算回数を集計 */
+static void RIFFTConvolve_CountPartitionMacs(struct RIFFTConvolve *conv)
+{
+    /* 設定した最大係数長に対して省略できた分割も数える（2の冪乗への切り上げ分は含めない） */
+    const uint32_t max_num_partitions = ROUNDUP(conv->max_num_coefficients, conv->partition_size) / conv->partition_size;
+
+    assert(conv->num_partitions <= max_num_partitions);
+
+    conv->statistics.local.num_partition_macs += conv->num_partitions;
+    conv->statistics.local.num_skipped_partition_macs += max_num_partitions - conv->num_partitions;
+}
+#endif
+
+/* 要素間隔strideのsrcを連続領域dstにコピー */
+static void RIFFTConvolve_CopyFromStrided(float *dst, const float *src, uint32_t stride, uint32_t num_samples)
+{
+    uint32_t smpl;
+
+    if (stride == 1) {
+        memcpy(dst, src, sizeof(float) * num_samples);
+        return;
+    }
+
+    for (smpl = 0; smpl < num_samples; smpl++) {
+        dst[smpl] = src[(size_t)smpl * stride];
+    }
+}
+
+/* 連続領域srcを要素間隔strideのdstにコピー */
+static void RIFFTConvolve_CopyToStrided(float *dst, uint32_t stride, const float *src, uint32_t num_samples)
+{
+    uint32_t smpl;
+
+    if (stride == 1) {
+        memcpy(dst, src, sizeof(float) * num_samples);
+        return;
+    }
+
+    for (smpl = 0; smpl < num_samples; smpl++) {
+        dst[(size_t)smpl * stride] = src[smpl];
+    }
+}
@@ -0,0 +1,321 @@
+#include "ri_ir_composer.h"
+
+#include <string.h>
+#include <assert.h>
+
+#include "ri_fft.h"
+#include "ri_fft_convolve.h"
+
+/* メモリアラインメント */
+#define RIIRCOMPOSER_ALIGNMENT 16
+/* 最小のFFT点数 */
+#define RIIRCOMPOSER_MIN_FFT_SIZE 4
+/* ある整数が2の冪乗か判定. 0:2の冪乗ではない, それ以外:2の冪乗 */
+#define IS_POWER_OF_2(x) (!((x) & ((x) - 1)))
+/* 最大値を取得 */
+#define MAX(a,b) (((a) > (b)) ? (a) : (b))
+/* nの倍数切り上げ */
+#define ROUNDUP(val, n) ((((val) + ((n) - 1)) / (n)) * (n))
+
+/* 合成作業領域 */
+struct RIIRComposerWork {
+    uint32_t fft_size; /* FFT点数 */
+    float *fft_work; /* FFT作業領域 */
+    float *spectrum_stack; /* 階層毎のスペクトル領域(fft_size * (最大深さ + 1)) */
+};
+
+/* グラフの深さを取得 不正なグラフの場合は0を返す */
+static uint32_t RIIRComposer_GetDepth(const struct RIIRNode *node);
+/* 作業領域の割り当て */
+static RIIRComposerApiResult RIIRComposer_SetupWork(const struct RIIRNode *root,
+        uint32_t partition_size, void *work, int64_t work_size, struct RIIRComposerWork *composer_work);
+/* ノードのスペクトルを計算 結果はspectrum_stackの先頭, それ以降は作業領域として使用 */
+static void RIIRComposer_EvaluateNode(
+        const struct RIIRNode *node, struct RIIRComposerWork *composer_work, float *spectrum_stack);
+/* 2の冪乗に切り上げ */
+static uint32_t RIIRComposer_Roundup2PoweredValue(uint32_t val);
+
+/* 合成後の係数長を取得 */
+uint32_t RIIRComposer_GetNumCoefficients(const struct RIIRNode *root)
+{
+    uint32_t i, num_coefficients;
+
+    /* 引数チェック */
+    if (root == NULL) {
+        return 0;
+    }
+
+    switch (root->type) {
+    case RIIRNODE_TYPE_IMPULSE:
+        if (root->coefficients == NULL) {
+            return 0;
+        }
+        return root->num_coefficients;
+    case RIIRNODE_TYPE_SERIES:
+        if ((root->children == NULL) || (root->num_children == 0)) {
+            return 0;
+        }
+        /* 直列: 長さの和 - (直列数 - 1) */
+        num_coefficients = 1;
+        for (i = 0; i < root->num_children; i++) {
+            const uint32_t child_num_coefficients = RIIRComposer_GetNumCoefficients(root->children[i]);
+            if (child_num_coefficients == 0) {
+                return 0;
+            }
+            /* 係数長が表現できない */
+            if (num_coefficients > (INT32_MAX / 2) - child_num_coefficients) {
+                return 0;
+            }
+            num_coefficients += child_num_coefficients - 1;
+        }
+        return num_coefficients;
+    case RIIRNODE_TYPE_PARALLEL:
+        if ((root->children == NULL) || (root->num_children == 0)) {
+            return 0;
+        }
+        /* 並列: 長さの最大値 */
+        num_coefficients = 0;
+        for (i = 0; i < root->num_children; i++) {
+            const uint32_t child_num_coefficients = RIIRComposer_GetNumCoefficients(root->children[i]);
+            if (child_num_coefficients == 0) {
+                return 0;
+            }
+            num_coefficients = MAX(num_coefficients, child_num_coefficients);
+        }
+        return num_coefficients;
+    default:
+        break;
+    }
+
+    return 0;
+}
+
+/* グラフの深さを取得 */
+static uint32_t RIIRComposer_GetDepth(const struct RIIRNode *node)
+{
+    uint32_t i, depth;
+
+    assert(node != NULL);
+
+    if (node->type == RIIRNODE_TYPE_IMPULSE) {
+        return 1;
+    }
+
+    depth = 0;
+    for (i = 0; i < node->num_children; i++) {
+        depth = MAX(depth, RIIRComposer_GetDepth(node->children[i]));
+    }
+
+    return depth + 1;
+}
+
+/* 合成に必要なワークサイズ計算 */
+int64_t RIIRComposer_CalculateWorkSize(const struct RIIRNode *root, uint32_t partition_size)
+{
+    int64_t work_size;
+    uint32_t num_coefficients, fft_size, depth;
+
+    /* 引数チェック */
+    if (root == NULL) {
+        return -1;
+    }
+    if ((partition_size > 0) && !IS_POWER_OF_2(partition_size)) {
+        return -1;
+    }
+
+    /* 不正なグラフ */
+    if ((num_coefficients = RIIRComposer_GetNumCoefficients(root)) == 0) {
+        return -1;
+    }
+
+    fft_size = MAX(RIIRCOMPOSER_MIN_FFT_SIZE, RIIRComposer_Roundup2PoweredValue(num_coefficients));
+    depth = RIIRComposer_GetDepth(root);
+
+    /* FFT作業領域 分割スペクトル作成にも流用する */
+    work_size = RICONVOLVE_ARRAY_WORK_SIZE(sizeof(float),
+            MAX((uint64_t)fft_size, 2 * (uint64_t)partition_size), RIIRCOMPOSER_ALIGNMENT);
+    /* 階層毎のスペクトル領域: 各階層で結果1つ分, さらに子ノードの結果1つ分 */
+    work_size = RICONVOLVE_ADD_WORK_SIZE(work_size,
+            RICONVOLVE_ARRAY_WORK_SIZE(sizeof(float), (uint64_t)fft_size * ((uint64_t)depth + 1), RIIRCOMPOSER_ALIGNMENT));
+
+    return work_size;
+}
+
+/* 作業領域の割り当て */
+static RIIRComposerApiResult RIIRComposer_SetupWork(const struct RIIRNode *root,
+        uint32_t partition_size, void *work, int64_t work_size, struct RIIRComposerWork *composer_work)
+{
+    int64_t required_size;
+    uint32_t fft_size;
+    uint8_t *work_ptr = (uint8_t *)work;
+
+    assert(composer_work != NULL);
+
+    if ((root == NULL) || (work == NULL)) {
+        return RIIRCOMPOSER_APIRESULT_INVALID_ARGUMENT;
+    }
+    if ((required_size = RIIRComposer_CalculateWorkSize(root, partition_size)) < 0) {
+        return RIIRCOMPOSER_APIRESULT_INVALID_ARGUMENT;
+    }
+    if (work_size < required_size) {
+        return RIIRCOMPOSER_APIRESULT_INSUFFICIENT_BUFFER;
+    }
+
+    fft_size = MAX(RIIRCOMPOSER_MIN_FFT_SIZE, RIIRComposer_Roundup2PoweredValue(RIIRComposer_GetNumCoefficients(root)));
+    composer_work->fft_size = fft_size;
+
+    work_ptr = (uint8_t *)ROUNDUP((uintptr_t)work_ptr, RIIRCOMPOSER_ALIGNMENT);
+    composer_work->fft_work = (float *)work_ptr;
+    work_ptr += sizeof(float) * MAX((size_t)fft_size, 2 * (size_t)partition_size);
+
+    work_ptr = (uint8_t *)ROUNDUP((uintptr_t)work_ptr, RIIRCOMPOSER_ALIGNMENT);
+    composer_work->spectrum_stack = (float *)work_ptr;
+
+    return RIIRCOMPOSER_APIRESULT_OK;
+}
+
+/* ノードのスペクトルを計算 */
+static void RIIRComposer_EvaluateNode(
+        const struct RIIRNode *node, struct RIIRComposerWork *composer_work, float *spectrum_stack)
+{
+    uint32_t i, k;
+    const uint32_t fft_size = composer_work->fft_size;
+    float *spectrum = spectrum_stack;
+    float *child_spectrum = &spectrum_stack[fft_size];
+
+    assert(node != NULL);
+
+    switch (node->type) {
+    case RIIRNODE_TYPE_IMPULSE:
+        /* 0埋めしてFFT */
+        memcpy(spectrum, node->coefficients, sizeof(float) * node->num_coefficients);
+        memset(&spectrum[node->num_coefficients], 0, sizeof(float) * (fft_size - node->num_coefficients));
+        RIFFT_RealFFT((int)fft_size, -1, spectrum, composer_work->fft_work);
+        break;
+    case RIIRNODE_TYPE_SERIES:
+        /* 直列: スペクトルの積 */
+        RIIRComposer_EvaluateNode(node->children[0], composer_work, spectrum);
+        for (i = 1; i < node->num_children; i++) {
+            RIIRComposer_EvaluateNode(node->children[i], composer_work, child_spectrum);
+            /* 先頭の1複素数(float配列2要素)は直流成分と最高周波数成分の実部 */
+            spectrum[0] *= child_spectrum[0];
+            spectrum[1] *= child_spectrum[1];
+            for (k = 1; k < fft_size / 2; k++) {
+                const float re = RIFFTCOMPLEX_REAL(spectrum, k), im = RIFFTCOMPLEX_IMAG(spectrum, k);
+                const float child_re = RIFFTCOMPLEX_REAL(child_spectrum, k), child_im = RIFFTCOMPLEX_IMAG(child_spectrum, k);
+                RIFFTCOMPLEX_REAL(spectrum, k) = re * child_re - im * child_im;
+                RIFFTCOMPLEX_IMAG(spectrum, k) = im * child_re + re * child_im;
+            }
+        }
+        break;
+    case RIIRNODE_TYPE_PARALLEL:
+        /* 並列: スペクトルの和 */
+        RIIRComposer_EvaluateNode(node->children[0], composer_work, spectrum);
+        for (i = 1; i < node->num_children; i++) {
+            RIIRComposer_EvaluateNode(node->children[i], composer_work, child_spectrum);
+            for (k = 0; k < fft_size; k++) {
+                spectrum[k] += child_spectrum[k];
+            }
+        }
+        break;
+    default:
+        assert(0);
+    }
+
+    /* ゲインを適用 */
+    for (k = 0; k < fft_size; k++) {
+        spectrum[k] *= node->gain;
+    }
+}
+
+/* グラフを1つのインパルス応答に合成 */
+RIIRComposerApiResult RIIRComposer_Compose(const struct RIIRNode *root,
+        float *coefficients, uint32_t num_coefficients, void *work, int64_t work_size)
+{
+    uint32_t smpl, num_composed;
+    float norm_factor;
+    struct RIIRComposerWork composer_work;
+    RIIRComposerApiResult ret;
+
+    /* 引数チェック */
+    if (coefficients == NULL) {
+        return RIIRCOMPOSER_APIRESULT_INVALID_ARGUMENT;
+    }
+
+    /* 作業領域の割り当て */
+    if ((ret = RIIRComposer_SetupWork(root, 0, work, work_size, &composer_work)) != RIIRCOMPOSER_APIRESULT_OK) {
+        return ret;
+    }
+
+    /* 出力バッファサイズチェック */
+    num_composed = RIIRComposer_GetNumCoefficients(root);
+    if (num_coefficients < num_composed) {
+        return RIIRCOMPOSER_APIRESULT_INSUFFICIENT_BUFFER;
+    }
+
+    /* 周波数領域で合成 */
+    RIIRComposer_EvaluateNode(root, &composer_work, composer_work.spectrum_stack);
+
+    /* 時間領域に戻す */
+    RIFFT_RealFFT((int)composer_work.fft_size, 1, composer_work.spectrum_stack, composer_work.fft_work);
+
+    /* 正規化しつつ出力 */
+    norm_factor = 2.0f / (float)composer_work.fft_size;
+    for (smpl = 0; smpl < num_composed; smpl++) {
+        coefficients[smpl] = norm_factor * composer_work.spectrum_stack[smpl];
+    }
+    memset(&coefficients[num_composed], 0, sizeof(float) * (num_coefficients - num_composed));
+
+    return RIIRCOMPOSER_APIRESULT_OK;
+}
+
+/* グラフを合成して分割スペクトルを作成 */
+RIIRComposerApiResult RIIRComposer_ComposeSpectrum(const struct RIIRNode *root,
+        uint32_t partition_size, float *spectrum, void *work, int64_t work_size)
+{
+    uint32_t smpl, num_composed;
+    float norm_factor;
+    struct RIIRComposerWork composer_work;
+    RIIRComposerApiResult ret;
+
+    /* 引数チェック */
+    if ((spectrum == NULL) || (partition_size == 0)) {
+        return RIIRCOMPOSER_APIRESULT_INVALID_ARGUMENT;
+    }
+
+    /* 作業領域の割り当て */
+    if ((ret = RIIRComposer_SetupWork(root, partition_size, work, work_size, &composer_work)) != RIIRCOMPOSER_APIRESULT_OK) {
+        return ret;
+    }
+
+    /* 周波数領域で合成し時間領域に戻す */
+    RIIRComposer_EvaluateNode(root, &composer_work, composer_work.spectrum_stack);
+    RIFFT_RealFFT((int)composer_work.fft_size, 1, composer_work.spectrum_stack, composer_work.fft_work);
+
+    /* 正規化 */
+    num_composed = RIIRComposer_GetNumCoefficients(root);
+    norm_factor = 2.0f / (float)composer_work.fft_size;
+    for (smpl = 0; smpl < num_composed; smpl++) {
+        composer_work.spectrum_stack[smpl] *= norm_factor;
+    }
+
+    /* 分割サイズ毎に変換 */
+    RIFFTConvolve_MakeSpectrum(partition_size,
+            composer_work.spectrum_stack, num_composed, spectrum, composer_work.fft_work);
+
+    return RIIRCOMPOSER_APIRESULT_OK;
+}
+
+/* 2の冪乗に切り上げ */
+static uint32_t RIIRComposer_Roundup2PoweredValue(uint32_t val)
+{
+    val--;
+    val |= val >> 1;
+    val |= val >> 2;
+    val |= val >> 4;
+    val |= val >> 8;
+    val |= val >> 16;
+    val++;
+
+    return val;
+}
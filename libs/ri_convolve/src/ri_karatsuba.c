@@ -1,28 +1,56 @@
 #include "ri_karatsuba.h"
 #include <assert.h>
 #include <string.h>
+#include "ri_convolve_statistics.h"
+
+/* SIMD命令の選択 */
+#if defined(__AVX512F__)
+#define RIKARATSUBA_USE_AVX512
+#include <immintrin.h>
+#elif defined(__AVX2__) && (defined(__FMA__) || defined(_MSC_VER))
+#define RIKARATSUBA_USE_AVX2
+#include <immintrin.h>
+#endif
 
 #define RIKARATSUBA_ALIGNMENT 16
+/* 素朴な畳み込みに切り替えるサイズの最小値 */
+#define RIKARATSUBA_MIN_BASE_CASE_SIZE 8
+/* 素朴な畳み込みに切り替えるサイズの既定値 */
+#define RIKARATSUBA_DEFAULT_BASE_CASE_SIZE 32
+/* 較正で試す素朴な畳み込みに切り替えるサイズの最大値 */
+#define RIKARATSUBA_MAX_CALIBRATION_BASE_CASE_SIZE 256
+/* 係数側の和の木を保持する上位の階層数（これより下位の階層では和を都度計算） */
+#define RIKARATSUBA_NUM_SUM_TREE_LEVELS 2
+/* 較正で1つのサイズあたりに計測する回数 */
+#define RIKARATSUBA_NUM_CALIBRATION_TRIALS 5
 
 /* 2値のうちの最大を取る */
 #define MAX(x,y) (((x) > (y)) ? (x) : (y))
+/* 2値のうちの最小を取る */
+#define MIN(x,y) (((x) < (y)) ? (x) : (y))
 /* nの倍数切り上げ */
 #define ROUNDUP(val, n) ((((val) + ((n) - 1)) / (n)) * (n))
 
 struct RIKaratsuba {
     float *coefficients; /* 畳み込み係数 */
+    float *coefficients_tree; /* 係数側の和(w = b1 + b0)を上位の階層分事前計算した木 */
     uint32_t num_coefficients; /* 畳み込み係数サイズ */
-    float *input_buffer; /* 入力バッファ */
-    float *output_buffer; /* 出力バッファ */
-    float *work_buffer; /* 計算用ワークバッファ */
-    int32_t output_buffer_pos; /* 出力バッファ参照位置 */
+    uint32_t tree_size; /* 和の木を作成した係数サイズ */
+    uint32_t base_case_size; /* 素朴な畳み込みに切り替えるサイズ */
+    uint32_t max_num_input_samples; /* 最大入力サンプル数 */
+    float *input_buffer; /* 入力バッファ（分割の端数の0埋めのため最大処理サンプル単位の2倍） */
+    float *output_buffer; /* 出力バッファ（重畳加算用 最大処理サンプル単位の2倍） */
+    float *work_buffer; /* 計算用ワークバッファ（結果は出力バッファに直接足し込むため約2.5倍） */
     uint32_t max_num_coefficients; /* 最大の畳み込み係数サイズ */
+#if defined(RICONVOLVE_ENABLE_STATISTICS)
+    struct RIConvolveStatisticsCounter statistics; /* 統計情報 */
+#endif
 };
 
 /* ワークサイズ計算 */
-static int32_t RIKaratsuba_CalculateWorkSize(const struct RIConvolveConfig *config);
+static int64_t RIKaratsuba_CalculateWorkSize(const struct RIConvolveConfig *config);
 /* インスタンス生成 */
-static void* RIKaratsuba_Create(const struct RIConvolveConfig *config, void *work, int32_t work_size);
+static void* RIKaratsuba_Create(const struct RIConvolveConfig *config, void *work, int64_t work_size);
 /* インスタンス破棄 */
 static void RIKaratsuba_Destroy(void *obj);
 /* 内部状態リセット */
@@ -31,17 +59,56 @@ static void RIKaratsuba_Reset(void *obj);
 static void RIKaratsuba_SetCoefficients(void *obj, const float *coefficients, uint32_t num_coefficients);
 /* ワークサイズ計算 */
 static void RIKaratsuba_Convolve(void *obj, const float *input, float *output, uint32_t num_samples);
+/* 要素間隔を指定した畳み込み計算 */
+static void RIKaratsuba_ConvolveStrided(void *obj,
+        const float *input, uint32_t input_stride, float *output, uint32_t output_stride, uint32_t num_samples);
 /* レイテンシーの取得 */
 static int32_t RIKaratsuba_GetLatencyNumSamples(void *obj);
+/* 統計情報の取得 */
+static uint8_t RIKaratsuba_GetStatistics(void *obj, struct RIConvolveStatistics *statistics);
 /* ナイーブな畳込み */
 /* z = a * b zはサイズ2n */
 static void RIKaratsuba_ConvolveNaive(const float *a, const float *b, float *z, uint32_t n);
+/* 係数側の和の木のサイズ(float要素数)計算 */
+/* num_levelsは木を保持する階層数 */
+static uint32_t RIKaratsuba_CalculateSumTreeSize(uint32_t n, uint32_t base_case_size, uint32_t num_levels);
+/* 係数側の和の木を作成 */
+/* 木はサイズnの係数bに対して [w (= b1 + b0)][b0の木][b1の木][wの木] の順に並ぶ */
+/* b0はサイズfloor(n/2), b1はサイズceil(n/2)で、wはb0を0埋めしてb1と足したもの */
+static void RIKaratsuba_MakeSumTree(const float *b, float *tree, uint32_t n, uint32_t base_case_size, uint32_t num_levels);
+/* 係数側の和 w = b1 + b0 を計算 */
+static void RIKaratsuba_FoldCoefficients(const float *b, float *w, uint32_t n);
+/* カラツバ法の計算用ワークサイズ(float要素数)計算 */
+static uint32_t RIKaratsuba_CalculateKaratsubaWorkSize(uint32_t n, uint32_t base_case_size);
 /* カラツバ法による畳込み */
-/* zはサイズ6n 先頭2nに結果が入る */
-static void RIKaratsuba_ConvolveKaratsuba(const float *a, const float *b, float *z, uint32_t n);
-/* 2の冪乗に切り上げ */
-static uint32_t RIKaratsuba_Roundup2PoweredValue(uint32_t val);
-
+/* btreeはbの和の木(num_levelsが0の階層では和をワーク上で計算), zはサイズ2n */
+/* workはRIKaratsuba_CalculateKaratsubaWorkSize(n)の要素数が必要 */
+static void RIKaratsuba_ConvolveKaratsuba(
+        const float *a, const float *b, const float *btree, uint32_t num_levels,
+        float *z, float *work, uint32_t n, uint32_t base_case_size);
+/* カラツバ法による畳込み結果を足し込む際の計算用ワークサイズ(float要素数)計算 */
+/* has_treeは係数側の和の木を保持しているか否か */
+static uint32_t RIKaratsuba_CalculateKaratsubaAddWorkSize(uint32_t n, uint32_t base_case_size, uint8_t has_tree);
+/* カラツバ法による畳込み結果をzの先頭num_outに足し込む */
+/* workはRIKaratsuba_CalculateKaratsubaAddWorkSize(n)の要素数が必要 */
+static void RIKaratsuba_ConvolveKaratsubaAdd(
+        const float *a, const float *b, const float *btree, uint32_t num_levels,
+        float *z, uint32_t num_out, float *work, uint32_t n, uint32_t base_case_size);
+/* 最大処理サンプル単位以下の全てのサイズ・素朴な畳み込みに切り替えるサイズで必要な計算用ワークサイズ(float要素数)計算 */
+static uint32_t RIKaratsuba_CalculateMaxKaratsubaWorkSize(uint32_t max_num_block_samples);
+/* 入力より長いサイズnの係数bを和の木に沿って分割し、分割毎に畳み込んで出力バッファのoffsetから重畳加算 */
+static void RIKaratsuba_ConvolveSegments(struct RIKaratsuba *conv, const float *b, const float *btree,
+        uint32_t num_levels, uint32_t n, uint32_t offset, uint32_t num_samples, uint32_t tail_end);
+/* 入力バッファ先頭num_samplesの畳み込み結果を出力バッファに重畳加算 */
+/* 出力バッファの有効な末尾位置を返す */
+static uint32_t RIKaratsuba_ConvolveInputBuffer(struct RIKaratsuba *conv, uint32_t num_samples);
+/* 係数側の和の木を再作成 */
+static void RIKaratsuba_UpdateSumTree(struct RIKaratsuba *conv);
+
+/* 要素間隔strideのsrcを連続領域dstにコピー */
+static void RIKaratsuba_CopyFromStrided(float *dst, const float *src, uint32_t stride, uint32_t num_samples);
+/* 連続領域srcを要素間隔strideのdstにコピー */
+static void RIKaratsuba_CopyToStrided(float *dst, uint32_t stride, const float *src, uint32_t num_samples);
 /* インターフェース */
 static const struct RIConvolveInterface st_karatsuba_convolve_if = {
     RIKaratsuba_CalculateWorkSize,
@@ -50,7 +117,9 @@ static const struct RIConvolveInterface st_karatsuba_convolve_if = {
     RIKaratsuba_Reset,
     RIKaratsuba_SetCoefficients,
     RIKaratsuba_Convolve,
+    RIKaratsuba_ConvolveStrided,
     RIKaratsuba_GetLatencyNumSamples,
+    RIKaratsuba_GetStatistics,
 };
 
 /* インターフェース取得 */
@@ -60,73 +129,100 @@ const struct RIConvolveInterface* RIKaratsuba_GetInterface(void)
 }
 
 /* ワークサイズ計算 */
-static int32_t RIKaratsuba_CalculateWorkSize(const struct RIConvolveConfig* config)
+static int64_t RIKaratsuba_CalculateWorkSize(const struct RIConvolveConfig* config)
 {
-    int32_t work_size;
+    int64_t work_size;
     uint32_t max_num_block_samples;
 
     if (config == NULL) {
         return -1;
     }
 
-    /* 最大処理サンプル単位 */
-    max_num_block_samples = RIKaratsuba_Roundup2PoweredValue(MAX(config->max_num_coefficients, config->max_num_input_samples));
+    /* 最大処理サンプル単位 2の冪乗への切り上げは行わない */
+    max_num_block_samples = MAX(config->max_num_coefficients, config->max_num_input_samples);
+    max_num_block_samples = MAX(max_num_block_samples, RIKARATSUBA_MIN_BASE_CASE_SIZE);
 
-    work_size = sizeof(struct RIKaratsuba) + RIKARATSUBA_ALIGNMENT;
+    work_size = (int64_t)(sizeof(struct RIKaratsuba) + RIKARATSUBA_ALIGNMENT);
 
-    /* 係数1 + 入力バッファ1 + 出力バッファ1 + 計算バッファ6 */
-    work_size += 9 * (sizeof(float) * max_num_block_samples + RIKARATSUBA_ALIGNMENT);
+    /* 係数1 + 入力バッファ2 + 出力バッファ2 */
+    work_size = RICONVOLVE_ADD_WORK_SIZE(work_size,
+            RICONVOLVE_MUL_WORK_SIZE(RICONVOLVE_ARRAY_WORK_SIZE(sizeof(float), max_num_block_samples, RIKARATSUBA_ALIGNMENT), 5));
+
+    /* 係数側の和の木・計算用ワーク */
+    work_size = RICONVOLVE_ADD_WORK_SIZE(work_size,
+            RICONVOLVE_ARRAY_WORK_SIZE(sizeof(float), RIKaratsuba_CalculateSumTreeSize(max_num_block_samples, RIKARATSUBA_MIN_BASE_CASE_SIZE, RIKARATSUBA_NUM_SUM_TREE_LEVELS), RIKARATSUBA_ALIGNMENT));
+    work_size = RICONVOLVE_ADD_WORK_SIZE(work_size,
+            RICONVOLVE_ARRAY_WORK_SIZE(sizeof(float), RIKaratsuba_CalculateMaxKaratsubaWorkSize(max_num_block_samples), RIKARATSUBA_ALIGNMENT));
 
     return work_size;
 }
 
 /* インスタンス生成 */
-static void* RIKaratsuba_Create(const struct RIConvolveConfig *config, void *work, int32_t work_size)
+static void* RIKaratsuba_Create(const struct RIConvolveConfig *config, void *work, int64_t work_size)
 {
     uint8_t *work_ptr = (uint8_t *)work;
     struct RIKaratsuba *conv;
     uint32_t max_num_block_samples;
+    int64_t required_size;
 
     /* 引数チェック */
-    if ((work == NULL) || (config == NULL)
-            || (work_size < RIKaratsuba_CalculateWorkSize(config))) {
+    if ((work == NULL) || (config == NULL)) {
+        return NULL;
+    }
+
+    if (((required_size = RIKaratsuba_CalculateWorkSize(config)) < 0)
+            || (work_size < required_size)) {
         return NULL;
     }
 
     /* 最大処理サンプル単位 */
-    max_num_block_samples = RIKaratsuba_Roundup2PoweredValue(MAX(config->max_num_coefficients, config->max_num_input_samples));
+    max_num_block_samples = MAX(config->max_num_coefficients, config->max_num_input_samples);
+    max_num_block_samples = MAX(max_num_block_samples, RIKARATSUBA_MIN_BASE_CASE_SIZE);
 
     /* 構造体を配置 */
     work_ptr = (uint8_t *)ROUNDUP((uintptr_t)work_ptr, RIKARATSUBA_ALIGNMENT);
     conv = (struct RIKaratsuba *)work_ptr;
     conv->num_coefficients = 0;
-    conv->output_buffer_pos = 0;
+    conv->base_case_size = MIN(RIKARATSUBA_DEFAULT_BASE_CASE_SIZE, max_num_block_samples);
+    conv->tree_size = conv->base_case_size;
+    conv->max_num_input_samples = config->max_num_input_samples;
     conv->max_num_coefficients = max_num_block_samples;
     work_ptr += sizeof(struct RIKaratsuba);
 
     /* 係数領域の割り当て */
     work_ptr = (uint8_t *)ROUNDUP((uintptr_t)work_ptr, RIKARATSUBA_ALIGNMENT);
     conv->coefficients = (float *)work_ptr;
+    memset(conv->coefficients, 0, sizeof(float) * max_num_block_samples);
     work_ptr += sizeof(float) * max_num_block_samples;
 
+    /* 係数側の和の木の割り当て */
+    work_ptr = (uint8_t *)ROUNDUP((uintptr_t)work_ptr, RIKARATSUBA_ALIGNMENT);
+    conv->coefficients_tree = (float *)work_ptr;
+    work_ptr += sizeof(float) * RIKaratsuba_CalculateSumTreeSize(max_num_block_samples, RIKARATSUBA_MIN_BASE_CASE_SIZE, RIKARATSUBA_NUM_SUM_TREE_LEVELS);
+
     /* 入力バッファの割り当て */
     work_ptr = (uint8_t *)ROUNDUP((uintptr_t)work_ptr, RIKARATSUBA_ALIGNMENT);
     conv->input_buffer = (float *)work_ptr;
-    work_ptr += sizeof(float) * max_num_block_samples;
+    work_ptr += 2 * sizeof(float) * max_num_block_samples;
 
     /* 出力バッファの割り当て */
     work_ptr = (uint8_t *)ROUNDUP((uintptr_t)work_ptr, RIKARATSUBA_ALIGNMENT);
     conv->output_buffer = (float *)work_ptr;
-    work_ptr += sizeof(float) * max_num_block_samples;
+    work_ptr += 2 * sizeof(float) * max_num_block_samples;
 
     /* 計算用ワークバッファの割り当て */
     work_ptr = (uint8_t *)ROUNDUP((uintptr_t)work_ptr, RIKARATSUBA_ALIGNMENT);
     conv->work_buffer = (float *)work_ptr;
-    work_ptr += 6 * sizeof(float) * max_num_block_samples;
+    work_ptr += sizeof(float) * RIKaratsuba_CalculateMaxKaratsubaWorkSize(max_num_block_samples);
 
-    /* バッファをリセット */
+    /* 和の木を作成してバッファをリセット */
+    RIKaratsuba_UpdateSumTree(conv);
     RIKaratsuba_Reset(conv);
 
+#if defined(RICONVOLVE_ENABLE_STATISTICS)
+    RIConvolveStatistics_Initialize(&conv->statistics);
+#endif
+
     return conv;
 }
 
@@ -154,14 +250,17 @@ static void RIKaratsuba_SetCoefficients(void *obj, const float *coefficients, ui
     /* 係数を単純コピー */
     memcpy(conv->coefficients, coefficients, sizeof(float) * num_coefficients);
 
-    /* 係数サイズは2の冪乗に切り上げておく */
-    conv->num_coefficients = RIKaratsuba_Roundup2PoweredValue(num_coefficients);
+    /* 係数サイズは切り上げずにそのまま使う */
+    conv->num_coefficients = num_coefficients;
 
     /* 係数末尾は0埋め */
     for (i = num_coefficients; i < conv->max_num_coefficients; i++) {
         conv->coefficients[i] = 0.0f;
     }
 
+    /* 係数側の和を事前計算 */
+    RIKaratsuba_UpdateSumTree(conv);
+
     /* 内部バッファリセット */
     RIKaratsuba_Reset(obj);
 }
@@ -169,41 +268,103 @@ static void RIKaratsuba_SetCoefficients(void *obj, const float *coefficients, ui
 /* 畳み込み計算 */
 static void RIKaratsuba_Convolve(void *obj, const float *input, float *output, uint32_t num_samples)
 {
-    uint32_t smpl, i, conv_size;
+    RIKaratsuba_ConvolveStrided(obj, input, 1, output, 1, num_samples);
+}
+
+/* 要素間隔を指定した畳み込み計算 */
+static void RIKaratsuba_ConvolveStrided(void *obj,
+        const float *input, uint32_t input_stride, float *output, uint32_t output_stride, uint32_t num_samples)
+{
+    uint32_t i, tail_end;
     struct RIKaratsuba* conv = (struct RIKaratsuba *)obj;
+#if defined(RICONVOLVE_ENABLE_STATISTICS)
+    const uint64_t start_ticks = RIConvolveStatistics_GetTicks();
+#endif
 
     /* 引数チェック */
     assert((obj != NULL) && (input != NULL) && (output != NULL));
+    assert((input_stride > 0) && (output_stride > 0));
+    assert(num_samples <= conv->max_num_coefficients);
 
-    /* 畳み込みサイズの確定: 必ず2の冪乗, かつ係数分畳み込むように十分なサイズを選ぶ */
-    conv_size = RIKaratsuba_Roundup2PoweredValue(MAX(num_samples, conv->num_coefficients));
+    if (num_samples == 0) {
+        return;
+    }
 
     /* 入力バッファにデータを入力 */
-    memcpy(conv->input_buffer, input, sizeof(float) * num_samples);
-    /* 入力サンプル以降は0埋め */
-    for (smpl = num_samples; smpl < conv_size; smpl++) {
-        conv->input_buffer[smpl] = 0.0f;
-    }
+    RIKaratsuba_CopyFromStrided(conv->input_buffer, input, input_stride, num_samples);
 
     /* 畳み込み計算 */
-    RIKaratsuba_ConvolveKaratsuba(conv->input_buffer,
-            conv->coefficients, conv->work_buffer, conv_size);
+    tail_end = RIKaratsuba_ConvolveInputBuffer(conv, num_samples);
 
-    /* 先頭のnum_samplesは前回の余りを加算してそのまま出力 */
-    for (smpl = 0; smpl < num_samples; smpl++) {
-        output[smpl] = conv->output_buffer[smpl] + conv->work_buffer[smpl];
+    /* 先頭のnum_samplesを出力 */
+    RIKaratsuba_CopyToStrided(output, output_stride, conv->output_buffer, num_samples);
+
+    /* 次回処理のために余り（FIRフィルタの遅延）分出力バッファを前に詰める */
+    memmove(conv->output_buffer, &conv->output_buffer[num_samples], sizeof(float) * (tail_end - num_samples));
+    /* 係数長以降に有効な余りは無いため0埋め */
+    for (i = conv->tree_size; i < tail_end; i++) {
+        conv->output_buffer[i] = 0.0f;
     }
 
-    /* 次回処理のために余り（FIRフィルタの遅延）分出力バッファを更新 */
-    /* 加算 */
-    i = 0;
-    for (; smpl < conv_size; smpl++) {
-        conv->output_buffer[i++] = conv->output_buffer[smpl] + conv->work_buffer[smpl];
+#if defined(RICONVOLVE_ENABLE_STATISTICS)
+    /* 統計情報の更新 */
+    RIConvolveStatistics_RecordCall(&conv->statistics, num_samples, RIConvolveStatistics_GetTicks() - start_ticks);
+    RIConvolveStatistics_Publish(&conv->statistics);
+#endif
+}
+
+/* 入力バッファ先頭num_samplesの畳み込み結果を出力バッファに重畳加算 */
+static uint32_t RIKaratsuba_ConvolveInputBuffer(struct RIKaratsuba *conv, uint32_t num_samples)
+{
+    uint32_t smpl, offset;
+    const uint32_t tree_size = conv->tree_size;
+    const uint32_t tail_end = tree_size + num_samples;
+
+    if (num_samples < tree_size) {
+        /* 係数の方が長い: 入力を0埋めし、係数を和の木に沿って分割して畳み込み */
+        for (smpl = num_samples; smpl < tree_size; smpl++) {
+            conv->input_buffer[smpl] = 0.0f;
+        }
+        RIKaratsuba_ConvolveSegments(conv, conv->coefficients, conv->coefficients_tree,
+                RIKARATSUBA_NUM_SUM_TREE_LEVELS, tree_size, 0, num_samples, tail_end);
+        return tail_end;
     }
-    /* 上書き */
-    for (; smpl < conv_size + num_samples; smpl++) {
-        conv->output_buffer[i++] = conv->work_buffer[smpl];
+
+    /* 入力の方が長い: 入力を係数長毎に区切り、区切り毎に係数全体と畳み込み */
+    for (smpl = num_samples; smpl < ROUNDUP(num_samples, tree_size); smpl++) {
+        conv->input_buffer[smpl] = 0.0f;
+    }
+    for (offset = 0; offset < num_samples; offset += tree_size) {
+        RIKaratsuba_ConvolveKaratsubaAdd(&conv->input_buffer[offset], conv->coefficients,
+                conv->coefficients_tree, RIKARATSUBA_NUM_SUM_TREE_LEVELS, &conv->output_buffer[offset], tail_end - offset, conv->work_buffer, tree_size, conv->base_case_size);
     }
+
+    return tail_end;
+}
+
+/* 入力より長いサイズnの係数bを和の木に沿って分割し、分割毎に畳み込んで出力バッファのoffsetから重畳加算 */
+static void RIKaratsuba_ConvolveSegments(struct RIKaratsuba *conv, const float *b, const float *btree,
+        uint32_t num_levels, uint32_t n, uint32_t offset, uint32_t num_samples, uint32_t tail_end)
+{
+    const uint32_t n0 = n >> 1;
+    const uint32_t n1 = n - n0;
+    const float *b0tree = NULL, *b1tree = NULL;
+
+    /* これ以上分割すると入力より短くなる場合はこのサイズで畳み込み */
+    if ((n <= conv->base_case_size) || (n0 < num_samples)) {
+        RIKaratsuba_ConvolveKaratsubaAdd(conv->input_buffer, b, btree, num_levels,
+                &conv->output_buffer[offset], tail_end - offset, conv->work_buffer, n, conv->base_case_size);
+        return;
+    }
+
+    /* 木の構造 [w][b0の木][b1の木][wの木] に従って下位・上位の分割を処理 */
+    if (num_levels > 0) {
+        b0tree = &btree[n1];
+        b1tree = &b0tree[RIKaratsuba_CalculateSumTreeSize(n0, conv->base_case_size, num_levels - 1)];
+        num_levels--;
+    }
+    RIKaratsuba_ConvolveSegments(conv, &b[0], b0tree, num_levels, n0, offset, num_samples, tail_end);
+    RIKaratsuba_ConvolveSegments(conv, &b[n0], b1tree, num_levels, n1, offset + n0, num_samples, tail_end);
 }
 
 /* 内部状態リセット */
@@ -213,22 +374,14 @@ static void RIKaratsuba_Reset(void *obj)
     struct RIKaratsuba *conv = (struct RIKaratsuba *)obj;
 
     /* 入力バッファのクリア */
-    for (i = 0; i < conv->max_num_coefficients; i++) {
+    for (i = 0; i < 2 * conv->max_num_coefficients; i++) {
         conv->input_buffer[i] = 0.0f;
     }
 
     /* 出力バッファのクリア */
-    for (i = 0; i < conv->max_num_coefficients; i++) {
+    for (i = 0; i < 2 * conv->max_num_coefficients; i++) {
         conv->output_buffer[i] = 0.0f;
     }
-
-    /* 計算用ワークバッファのクリア */
-    for (i = 0; i < 6 * conv->max_num_coefficients; i++) {
-        conv->work_buffer[i] = 0.0f;
-    }
-
-    /* バッファ参照位置のクリア */
-    conv->output_buffer_pos = 0;
 }
 
 /* レイテンシーの取得 */
@@ -239,6 +392,25 @@ static int32_t RIKaratsuba_GetLatencyNumSamples(void *obj)
     return 0;
 }
 
+/* 統計情報の取得 */
+static uint8_t RIKaratsuba_GetStatistics(void *obj, struct RIConvolveStatistics *statistics)
+{
+#if defined(RICONVOLVE_ENABLE_STATISTICS)
+    const struct RIKaratsuba *conv = (const struct RIKaratsuba *)obj;
+
+    /* 引数チェック */
+    assert((obj != NULL) && (statistics != NULL));
+
+    RIConvolveStatistics_Snapshot(&conv->statistics, statistics);
+
+    return 1;
+#else
+    (void)obj;
+    (void)statistics;
+    return 0;
+#endif
+}
+
 /* 素朴な直線畳込み */
 /* z = a * b zはサイズ2n */
 static void RIKaratsuba_ConvolveNaive(const float *a, const float *b, float *z, uint32_t n)
@@ -250,76 +422,415 @@ static void RIKaratsuba_ConvolveNaive(const float *a, const float *b, float *z,
         z[i] = 0.0f;
     }
 
-    /* 畳み込み */
+    /* 畳み込み: 乗数の1要素を被乗数全体に掛けて足し込む */
     for (j = 0; j < n; j++) {
-        for (i = 0; i < n; i++) {
-            z[j + i] += a[i] * b[j];
+        const float c = b[j];
+        float *zj = &z[j];
+        i = 0;
+#if defined(RIKARATSUBA_USE_AVX512)
+        {
+            const __m512 c16 = _mm512_set1_ps(c);
+            for (; i + 16 <= n; i += 16) {
+                _mm512_storeu_ps(&zj[i], _mm512_fmadd_ps(c16, _mm512_loadu_ps(&a[i]), _mm512_loadu_ps(&zj[i])));
+            }
+        }
+#endif
+#if defined(RIKARATSUBA_USE_AVX512) || defined(RIKARATSUBA_USE_AVX2)
+        {
+            const __m256 c8 = _mm256_set1_ps(c);
+            for (; i + 8 <= n; i += 8) {
+                _mm256_storeu_ps(&zj[i], _mm256_fmadd_ps(c8, _mm256_loadu_ps(&a[i]), _mm256_loadu_ps(&zj[i])));
+            }
+        }
+#endif
+        /* 端数 */
+        for (; i < n; i++) {
+            zj[i] += a[i] * c;
         }
     }
 }
 
+/* 係数側の和の木のサイズ(float要素数)計算 */
+static uint32_t RIKaratsuba_CalculateSumTreeSize(uint32_t n, uint32_t base_case_size, uint32_t num_levels)
+{
+    const uint32_t n0 = n >> 1;
+    const uint32_t n1 = n - n0;
+
+    /* 素朴な畳込みでは和を使わない・保持しない階層では都度計算 */
+    if ((n <= base_case_size) || (num_levels == 0)) {
+        return 0;
+    }
+
+    /* w + (b0, b1, wそれぞれの木) */
+    /* 全階層分保持するとO(n^1.585)で増えるため、上位の階層に限る */
+    return n1 + RIKaratsuba_CalculateSumTreeSize(n0, base_case_size, num_levels - 1)
+        + 2 * RIKaratsuba_CalculateSumTreeSize(n1, base_case_size, num_levels - 1);
+}
+
+/* 係数側の和の木を作成 */
+static void RIKaratsuba_MakeSumTree(const float *b, float *tree, uint32_t n, uint32_t base_case_size, uint32_t num_levels)
+{
+    const uint32_t n0 = n >> 1;
+    const uint32_t n1 = n - n0;
+    float *w, *b0tree, *b1tree, *wtree;
+
+    if ((n <= base_case_size) || (num_levels == 0)) {
+        return;
+    }
+
+    w = &tree[0];
+    b0tree = &tree[n1];
+    b1tree = &b0tree[RIKaratsuba_CalculateSumTreeSize(n0, base_case_size, num_levels - 1)];
+    wtree = &b1tree[RIKaratsuba_CalculateSumTreeSize(n1, base_case_size, num_levels - 1)];
+
+    /* w = b1 + b0 */
+    RIKaratsuba_FoldCoefficients(b, w, n);
+
+    /* 下位の階層も作成 */
+    RIKaratsuba_MakeSumTree(&b[0], b0tree, n0, base_case_size, num_levels - 1);
+    RIKaratsuba_MakeSumTree(&b[n0], b1tree, n1, base_case_size, num_levels - 1);
+    RIKaratsuba_MakeSumTree(w, wtree, n1, base_case_size, num_levels - 1);
+}
+
+/* 係数側の和 w = b1 + b0 を計算 */
+static void RIKaratsuba_FoldCoefficients(const float *b, float *w, uint32_t n)
+{
+    uint32_t i;
+    const uint32_t n0 = n >> 1;
+    const uint32_t n1 = n - n0;
+    const float *b0 = &b[0];
+    const float *b1 = &b[n0];
+
+    /* b0が短い場合の端数はb1のみ */
+    for (i = 0; i < n0; i++) {
+        w[i] = b1[i] + b0[i];
+    }
+    for (; i < n1; i++) {
+        w[i] = b1[i];
+    }
+}
+
+/* カラツバ法の計算用ワークサイズ(float要素数)計算 */
+static uint32_t RIKaratsuba_CalculateKaratsubaWorkSize(uint32_t n, uint32_t base_case_size)
+{
+    const uint32_t n1 = n - (n >> 1);
+
+    /* 素朴な畳込みは結果領域のみで計算できる */
+    if (n <= base_case_size) {
+        return 0;
+    }
+
+    /* x2 + x2のワーク (v + x3のワークはこれ以下) */
+    return 2 * n1 + RIKaratsuba_CalculateKaratsubaWorkSize(n1, base_case_size);
+}
+
 /* カラツバ法による畳込み */
-/* zはサイズ6n 先頭2nに結果が入る */
-static void RIKaratsuba_ConvolveKaratsuba(const float *a, const float *b, float *z, uint32_t n)
+/* a, bを下位floor(n/2)と上位ceil(n/2)に分け、サイズが奇数でも切り上げずに処理する */
+/* x1とx3を結果領域zに置き、x2のみワークに置くことで階層あたりのワークを上位分割2つ分に抑える */
+static void RIKaratsuba_ConvolveKaratsuba(
+        const float *a, const float *b, const float *btree, uint32_t num_levels,
+        float *z, float *work, uint32_t n, uint32_t base_case_size)
 {
     uint32_t i;
-    const uint32_t  n2 = n >> 1;
+    const uint32_t  n0 = n >> 1;        /* 下位の分割サイズ               */
+    const uint32_t  n1 = n - n0;        /* 上位の分割サイズ(n0またはn0 + 1) */
     const float     *a0 = &a[0];        /* 被乗数/右側配列ポインタ        */
-    const float     *a1 = &a[n2];       /* 被乗数/左側配列ポインタ        */
+    const float     *a1 = &a[n0];       /* 被乗数/左側配列ポインタ        */
     const float     *b0 = &b[0];        /* 乗数  /右側配列ポインタ        */
-    const float     *b1 = &b[n2];       /* 乗数  /左側配列ポインタ        */
-    float     *x1 = &z[n * 0];          /* x1 (= a0 * b0) 用配列ポインタ  */
-    float     *x2 = &z[n * 1];          /* x2 (= a1 * b1) 用配列ポインタ  */
-    float     *x3 = &z[n * 2];          /* x3 (= v * w)   用配列ポインタ  */
-    float     *v  = &z[n * 5];          /* v  (= a1 + a0) 用配列ポインタ  */
-    float     *w  = &z[n * 5 + n2];     /* w  (= b1 + b0) 用配列ポインタ  */
-
-    /* サイズが8以下の場合は通常の畳込みを行う */
-    if (n <= 8) {
-        assert(n == 8);
-        RIKaratsuba_ConvolveNaive(a, b, z, 8);
+    const float     *b1 = &b[n0];       /* 乗数  /左側配列ポインタ        */
+    const float     *w;                 /* w  (= b1 + b0) 用配列ポインタ  */
+    const float     *b0tree = NULL;     /* b0の和の木                     */
+    const float     *b1tree = NULL;     /* b1の和の木                     */
+    const float     *wtree  = NULL;     /* w の和の木                     */
+    float     *x1 = &z[0];              /* x1 (= a0 * b0) 用配列ポインタ z[0, 2n0)  */
+    float     *x3 = &z[2 * n0];         /* x3 (= v * w)   用配列ポインタ z[2n0, 2n) */
+    float     *x2 = &work[0];           /* x2 (= a1 * b1) 用配列ポインタ  */
+    float     *v  = &work[0];           /* v  (= a1 + a0) 用配列ポインタ  */
+    float     *x3work;                  /* x3のワーク                     */
+
+    /* 切り替えサイズ以下の場合は通常の畳込みを行う */
+    if (n <= base_case_size) {
+        RIKaratsuba_ConvolveNaive(a, b, z, n);
         return;
     }
 
-    /* v = a1 + a0, w = b1 + b0 */
-    for(i = 0; i < n2; i++) {
+    if (num_levels > 0) {
+        /* 木を保持する階層: w = b1 + b0 は係数設定時に計算済み */
+        w = &btree[0];
+        b0tree = &btree[n1];
+        b1tree = &b0tree[RIKaratsuba_CalculateSumTreeSize(n0, base_case_size, num_levels - 1)];
+        wtree  = &b1tree[RIKaratsuba_CalculateSumTreeSize(n1, base_case_size, num_levels - 1)];
+        x3work = &work[n1];
+        num_levels--;
+    } else {
+        /* 木を保持しない階層: vの後ろ(後でx2が上書きする領域)でwを計算 */
+        RIKaratsuba_FoldCoefficients(b, &work[n1], n);
+        w = &work[n1];
+        x3work = &work[2 * n1];
+    }
+
+    /* v = a1 + a0 */
+    for (i = 0; i < n0; i++) {
         v[i] = a1[i] + a0[i];
-        w[i] = b1[i] + b0[i];
+    }
+    for (; i < n1; i++) {
+        v[i] = a1[i];
     }
 
+    /* x3 = (a1 + a0) * (b1 + b0) : v, wの後ろをワークに使う */
+    RIKaratsuba_ConvolveKaratsuba(v, w, wtree, num_levels, x3, x3work, n1, base_case_size);
+
     /* x1 = a0 * b0 */
-    RIKaratsuba_ConvolveKaratsuba(a0, b0, x1, n2);
+    RIKaratsuba_ConvolveKaratsuba(a0, b0, b0tree, num_levels, x1, work, n0, base_case_size);
 
     /* x2 = a1 * b1 */
-    RIKaratsuba_ConvolveKaratsuba(a1, b1, x2, n2);
-
-    /* x3 = (a1 + a0) * (b1 + b0) */
-    RIKaratsuba_ConvolveKaratsuba(v,  w,  x3, n2);
+    RIKaratsuba_ConvolveKaratsuba(a1, b1, b1tree, num_levels, x2, &work[2 * n1], n1, base_case_size);
 
     /* x3 -= x1 + x2 */
-    for(i = 0; i < n; i++) {
-        x3[i] -= (x1[i] + x2[i]);
+    for (i = 0; i < 2 * n0; i++) {
+        x3[i] -= x1[i] + x2[i];
+    }
+    for (; i < 2 * n1; i++) {
+        x3[i] -= x2[i];
     }
 
-    /* z = x2 * R^2 + (x3 - x1 - x2) * R + x1 */
-    /*      ( x1, x2 は既に所定の位置にセットされているので、x3 のみ加算 ) */
-    for(i = 0; i < n; i++) {
-        z[i + n2] += x3[i];
+    /* z = x2 * R^2 + x3 * R + x1 を前から順に求める */
+    /* x3[i]はz[2n0 + i]にあり、z[n0 + i]で使うため読む前に上書きされることはない */
+    for (i = n0; i < 2 * n0; i++) {
+        z[i] += z[i + n0];
     }
+    for (; i < 2 * n - n0; i++) {
+        z[i] = z[i + n0] + x2[i - 2 * n0];
+    }
+    for (; i < 2 * n; i++) {
+        z[i] = x2[i - 2 * n0];
+    }
+}
 
+/* カラツバ法による畳込み結果を足し込む際の計算用ワークサイズ(float要素数)計算 */
+static uint32_t RIKaratsuba_CalculateKaratsubaAddWorkSize(uint32_t n, uint32_t base_case_size, uint8_t has_tree)
+{
+    const uint32_t n1 = n - (n >> 1);
+
+    /* 素朴な畳込みは結果の2nのみ */
+    if (n <= base_case_size) {
+        return 2 * n;
+    }
+
+    /* v + (木が無ければw) + x3 + x3のワーク (x1, x2とそのワークはこれ以下) */
+    return ((has_tree != 0) ? 3 : 4) * n1 + RIKaratsuba_CalculateKaratsubaWorkSize(n1, base_case_size);
 }
 
-/* 2の冪乗に切り上げ */
-/* ハッカーのたのしみより引用 */
-static uint32_t RIKaratsuba_Roundup2PoweredValue(uint32_t val)
+/* カラツバ法による畳込み結果をzの先頭num_outに足し込む */
+/* 結果を一旦ワークに置かず、x1, x2, x3をそれぞれ該当位置に足し引きする */
+static void RIKaratsuba_ConvolveKaratsubaAdd(
+        const float *a, const float *b, const float *btree, uint32_t num_levels,
+        float *z, uint32_t num_out, float *work, uint32_t n, uint32_t base_case_size)
 {
-    val--;
-    val |= val >> 1;
-    val |= val >> 2;
-    val |= val >> 4;
-    val |= val >> 8;
-    val |= val >> 16;
-    val++;
-
-    return val;
+    uint32_t i;
+    const uint32_t  n0 = n >> 1;
+    const uint32_t  n1 = n - n0;
+    const uint8_t   has_tree = (uint8_t)(num_levels > 0);
+    const float     *a0 = &a[0];
+    const float     *a1 = &a[n0];
+    const float     *b0 = &b[0];
+    const float     *b1 = &b[n0];
+    const float     *w;
+    const float     *b0tree = NULL;
+    const float     *b1tree = NULL;
+    const float     *wtree  = NULL;
+    float     *x = &work[0];            /* x1, x2 用配列ポインタ          */
+    float     *v = &work[0];            /* v  (= a1 + a0) 用配列ポインタ  */
+    float     *x3;                      /* x3 (= v * w)   用配列ポインタ  */
+
+    num_out = MIN(num_out, 2 * n);
+
+    /* 切り替えサイズ以下の場合は通常の畳込みを行い足し込む */
+    if (n <= base_case_size) {
+        RIKaratsuba_ConvolveNaive(a, b, x, n);
+        for (i = 0; i < num_out; i++) {
+            z[i] += x[i];
+        }
+        return;
+    }
+
+    /* 木を保持しない階層ではvとx3の間にwを置く */
+    if (has_tree) {
+        w = &btree[0];
+        b0tree = &btree[n1];
+        b1tree = &b0tree[RIKaratsuba_CalculateSumTreeSize(n0, base_case_size, num_levels - 1)];
+        wtree  = &b1tree[RIKaratsuba_CalculateSumTreeSize(n1, base_case_size, num_levels - 1)];
+        x3 = &work[n1];
+        num_levels--;
+    } else {
+        w = &work[n1];
+        x3 = &work[2 * n1];
+    }
+
+    /* z += x1 - x1 * R */
+    RIKaratsuba_ConvolveKaratsuba(a0, b0, b0tree, num_levels, x, &work[2 * n0], n0, base_case_size);
+    for (i = 0; i < MIN(2 * n0, num_out); i++) {
+        z[i] += x[i];
+    }
+    for (i = 0; (i < 2 * n0) && (i + n0 < num_out); i++) {
+        z[i + n0] -= x[i];
+    }
+
+    /* z += x2 * R^2 - x2 * R */
+    RIKaratsuba_ConvolveKaratsuba(a1, b1, b1tree, num_levels, x, &work[2 * n1], n1, base_case_size);
+    for (i = 0; (i < 2 * n1) && (i + n0 < num_out); i++) {
+        z[i + n0] -= x[i];
+    }
+    for (i = 0; (i < 2 * n1) && (i + 2 * n0 < num_out); i++) {
+        z[i + 2 * n0] += x[i];
+    }
+
+    /* z += x3 * R */
+    for (i = 0; i < n0; i++) {
+        v[i] = a1[i] + a0[i];
+    }
+    for (; i < n1; i++) {
+        v[i] = a1[i];
+    }
+    if (!has_tree) {
+        /* x1, x2の計算で上書きされるためここでwを計算 */
+        RIKaratsuba_FoldCoefficients(b, &work[n1], n);
+    }
+    RIKaratsuba_ConvolveKaratsuba(v, w, wtree, num_levels, x3, &x3[2 * n1], n1, base_case_size);
+    for (i = 0; (i < 2 * n1) && (i + n0 < num_out); i++) {
+        z[i + n0] += x3[i];
+    }
+}
+
+/* 最大処理サンプル単位以下の全てのサイズ・素朴な畳み込みに切り替えるサイズで必要な計算用ワークサイズ(float要素数)計算 */
+static uint32_t RIKaratsuba_CalculateMaxKaratsubaWorkSize(uint32_t max_num_block_samples)
+{
+    uint32_t n = max_num_block_samples, num_levels = RIKARATSUBA_NUM_SUM_TREE_LEVELS;
+    /* 分割しない場合は素朴な畳込み結果の2n */
+    uint32_t work_size = 2 * max_num_block_samples;
+
+    /* 分割する場合は切り替えサイズが最小の時に最大 */
+    /* 係数を分割して畳み込む場合は木を保持しない階層でも足し込むため、分割の各階層で最大を取る */
+    while (n > RIKARATSUBA_MIN_BASE_CASE_SIZE) {
+        work_size = MAX(work_size,
+                RIKaratsuba_CalculateKaratsubaAddWorkSize(n, RIKARATSUBA_MIN_BASE_CASE_SIZE, (uint8_t)(num_levels > 0)));
+        n = n - (n >> 1);
+        num_levels = (num_levels > 0) ? (num_levels - 1) : 0;
+    }
+
+    return work_size;
+}
+
+/* 係数側の和の木を再作成 */
+static void RIKaratsuba_UpdateSumTree(struct RIKaratsuba *conv)
+{
+    conv->tree_size = MAX(conv->num_coefficients, conv->base_case_size);
+    RIKaratsuba_MakeSumTree(conv->coefficients, conv->coefficients_tree,
+            conv->tree_size, conv->base_case_size, RIKARATSUBA_NUM_SUM_TREE_LEVELS);
+}
+
+/* 素朴な畳み込みに切り替えるサイズの設定 */
+void RIKaratsuba_SetBaseCaseSize(void *obj, uint32_t base_case_size)
+{
+    struct RIKaratsuba *conv = (struct RIKaratsuba *)obj;
+
+    assert(obj != NULL);
+
+    /* 範囲内に丸める */
+    base_case_size = MAX(base_case_size, RIKARATSUBA_MIN_BASE_CASE_SIZE);
+    conv->base_case_size = MIN(base_case_size, conv->max_num_coefficients);
+
+    /* 和の木を作り直す */
+    RIKaratsuba_UpdateSumTree(conv);
+
+    /* 内部バッファリセット */
+    RIKaratsuba_Reset(obj);
+}
+
+/* 素朴な畳み込みに切り替えるサイズの取得 */
+uint32_t RIKaratsuba_GetBaseCaseSize(const void *obj)
+{
+    const struct RIKaratsuba *conv = (const struct RIKaratsuba *)obj;
+
+    assert(obj != NULL);
+
+    return conv->base_case_size;
+}
+
+/* 処理時間を計測して素朴な畳み込みに切り替えるサイズを決定 */
+uint32_t RIKaratsuba_CalibrateBaseCaseSize(void *obj)
+{
+    uint32_t size, best_size, num_samples;
+    uint64_t best_ticks = 0;
+    struct RIKaratsuba *conv = (struct RIKaratsuba *)obj;
+
+    assert(obj != NULL);
+
+    /* 最大入力サンプル数のブロックを畳み込む時間で比較 */
+    num_samples = (conv->max_num_input_samples > 0) ? conv->max_num_input_samples : conv->max_num_coefficients;
+    memset(conv->input_buffer, 0, sizeof(float) * num_samples);
+
+    best_size = conv->base_case_size;
+    for (size = RIKARATSUBA_MIN_BASE_CASE_SIZE;
+            size <= MIN(RIKARATSUBA_MAX_CALIBRATION_BASE_CASE_SIZE, conv->max_num_coefficients); size <<= 1) {
+        uint32_t trial;
+        uint64_t min_ticks = 0;
+
+        conv->base_case_size = size;
+        RIKaratsuba_UpdateSumTree(conv);
+
+        /* 初回はキャッシュに載せるため計測しない */
+        (void)RIKaratsuba_ConvolveInputBuffer(conv, num_samples);
+
+        /* 1ブロックの経過時間を数回計測し、割り込み等の影響を除くため最小値を取る */
+        for (trial = 0; trial < RIKARATSUBA_NUM_CALIBRATION_TRIALS; trial++) {
+            const uint64_t start = RIConvolveStatistics_GetTicks();
+            uint64_t ticks;
+            (void)RIKaratsuba_ConvolveInputBuffer(conv, num_samples);
+            ticks = RIConvolveStatistics_GetTicks() - start;
+            if ((trial == 0) || (ticks < min_ticks)) {
+                min_ticks = ticks;
+            }
+        }
+
+        if ((size == RIKARATSUBA_MIN_BASE_CASE_SIZE) || (min_ticks < best_ticks)) {
+            best_ticks = min_ticks;
+            best_size = size;
+        }
+    }
+
+    /* 最速のサイズを設定 */
+    RIKaratsuba_SetBaseCaseSize(obj, best_size);
+
+    return best_size;
+}
+
+/* 要素間隔strideのsrcを連続領域dstにコピー */
+static void RIKaratsuba_CopyFromStrided(float *dst, const float *src, uint32_t stride, uint32_t num_samples)
+{
+    uint32_t smpl;
+
+    if (stride == 1) {
+        memcpy(dst, src, sizeof(float) * num_samples);
+        return;
+    }
+
+    for (smpl = 0; smpl < num_samples; smpl++) {
+        dst[smpl] = src[(size_t)smpl * stride];
+    }
+}
+
+/* 連続領域srcを要素間隔strideのdstにコピー */
+static void RIKaratsuba_CopyToStrided(float *dst, uint32_t stride, const float *src, uint32_t num_samples)
+{
+    uint32_t smpl;
+
+    if (stride == 1) {
+        memcpy(dst, src, sizeof(float) * num_samples);
+        return;
+    }
+
+    for (smpl = 0; smpl < num_samples; smpl++) {
+        dst[(size_t)smpl * stride] = src[smpl];
+    }
 }
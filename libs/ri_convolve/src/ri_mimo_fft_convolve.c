@@ -0,0 +1,348 @@
+#include "ri_mimo_fft_convolve.h"
+
+#include <string.h>
+#include <assert.h>
+
+#include "ri_fft.h"
+#include "ri_fft_convolve.h"
+
+/* デフォルトの係数分割サイズ */
+#define RIMIMOFFTCONVOLVE_DEFAULT_PARTITION_SIZE 1024
+/* 係数分割サイズの最大値（FFT点数がintで表せる範囲） */
+#define RIMIMOFFTCONVOLVE_MAX_PARTITION_SIZE (1UL << 29)
+/* メモリアラインメント */
+#define RIMIMOFFTCONVOLVE_ALIGNMENT 16
+/* 最小値を取得 */
+#define MIN(a,b) (((a) < (b)) ? (a) : (b))
+/* nの倍数切り上げ */
+#define ROUNDUP(val, n) ((((val) + ((n) - 1)) / (n)) * (n))
+
+/* 多入力多出力FFT畳み込み構造体 */
+struct RIMIMOFFTConvolve {
+    uint32_t num_inputs; /* 入力チャンネル数 */
+    uint32_t num_outputs; /* 出力チャンネル数 */
+    uint32_t fft_size; /* FFT点数 */
+    uint32_t partition_size; /* 係数の分割サイズ: fft_size / 2 が成立 */
+    uint32_t max_num_partitions; /* 最大分割数 */
+    uint32_t max_num_coefficients; /* 最大係数長 */
+    uint32_t buffer_count; /* 分割内の入力バッファサンプル数カウント */
+    uint32_t latest_slot; /* 周波数領域遅延線の最新スロット */
+    uint32_t *num_partitions; /* 入出力の組み合わせ毎の分割数 */
+    float *ir_freq; /* 入出力の組み合わせ毎のフーリエ変換済みのインパルス応答 */
+    float *freq_delay_line; /* 入力チャンネル毎の周波数領域遅延線 */
+    float **input_buffer; /* 入力チャンネル毎の入力バッファ 前半に前回の分割, 後半に今回の分割 */
+    float **output_buffer; /* 出力チャンネル毎の出力バッファ */
+    float *work_buffer; /* FFT作業バッファ */
+    float *comp_muladd_buffer; /* 複素数乗算/加算計算結果バッファ */
+};
+
+/* 1分割分の畳み込み処理 */
+static void RIMIMOFFTConvolve_ProcessPartition(struct RIMIMOFFTConvolve *conv);
+/* 係数分割サイズの取得 */
+static uint32_t RIMIMOFFTConvolve_GetPartitionSize(const struct RIMIMOFFTConvolveConfig *config);
+
+/* ワークサイズ計算 */
+int64_t RIMIMOFFTConvolve_CalculateWorkSize(const struct RIMIMOFFTConvolveConfig *config)
+{
+    int64_t work_size, num_pairs, delay_line_size;
+    uint32_t fft_size, partition_size, max_num_partitions;
+
+    /* 引数チェック */
+    if (config == NULL) {
+        return -1;
+    }
+
+    /* コンフィグチェック */
+    if ((config->num_input_channels == 0) || (config->num_output_channels == 0)
+            || (config->max_num_coefficients == 0)
+            || (config->fft_partition_size > RIMIMOFFTCONVOLVE_MAX_PARTITION_SIZE)) {
+        return -1;
+    }
+
+    partition_size = RIMIMOFFTConvolve_GetPartitionSize(config);
+    fft_size = 2 * partition_size;
+    max_num_partitions = (uint32_t)(((uint64_t)config->max_num_coefficients + partition_size - 1) / partition_size);
+    num_pairs = (int64_t)config->num_input_channels * config->num_output_channels;
+    /* 1組み合わせ(1入力)あたりの分割スペクトルのfloat要素数 */
+    delay_line_size = (int64_t)max_num_partitions * fft_size;
+
+    /* ハンドル領域分 */
+    work_size = (int64_t)(sizeof(struct RIMIMOFFTConvolve) + RIMIMOFFTCONVOLVE_ALIGNMENT);
+    /* 組み合わせ毎の分割数 */
+    work_size = RICONVOLVE_ADD_WORK_SIZE(work_size,
+            RICONVOLVE_ARRAY_WORK_SIZE(sizeof(uint32_t), num_pairs, RIMIMOFFTCONVOLVE_ALIGNMENT));
+    /* フーリエ変換済みの係数領域分 */
+    work_size = RICONVOLVE_ADD_WORK_SIZE(work_size,
+            RICONVOLVE_ARRAY_WORK_SIZE(sizeof(float), RICONVOLVE_MUL_WORK_SIZE(delay_line_size, num_pairs), RIMIMOFFTCONVOLVE_ALIGNMENT));
+    /* 周波数領域遅延線 */
+    work_size = RICONVOLVE_ADD_WORK_SIZE(work_size,
+            RICONVOLVE_ARRAY_WORK_SIZE(sizeof(float),
+                RICONVOLVE_MUL_WORK_SIZE(delay_line_size, config->num_input_channels), RIMIMOFFTCONVOLVE_ALIGNMENT));
+    /* 入力バッファ */
+    work_size = RICONVOLVE_ADD_WORK_SIZE(work_size,
+            RICONVOLVE_ARRAY_WORK_SIZE(sizeof(float *), config->num_input_channels, RIMIMOFFTCONVOLVE_ALIGNMENT));
+    work_size = RICONVOLVE_ADD_WORK_SIZE(work_size,
+            RICONVOLVE_MUL_WORK_SIZE(RICONVOLVE_ARRAY_WORK_SIZE(sizeof(float), fft_size, RIMIMOFFTCONVOLVE_ALIGNMENT), config->num_input_channels));
+    /* 出力バッファ */
+    work_size = RICONVOLVE_ADD_WORK_SIZE(work_size,
+            RICONVOLVE_ARRAY_WORK_SIZE(sizeof(float *), config->num_output_channels, RIMIMOFFTCONVOLVE_ALIGNMENT));
+    work_size = RICONVOLVE_ADD_WORK_SIZE(work_size,
+            RICONVOLVE_MUL_WORK_SIZE(RICONVOLVE_ARRAY_WORK_SIZE(sizeof(float), partition_size, RIMIMOFFTCONVOLVE_ALIGNMENT), config->num_output_channels));
+    /* FFT作業領域と複素乗算/加算作業領域 */
+    work_size = RICONVOLVE_ADD_WORK_SIZE(work_size,
+            RICONVOLVE_MUL_WORK_SIZE(RICONVOLVE_ARRAY_WORK_SIZE(sizeof(float), fft_size, RIMIMOFFTCONVOLVE_ALIGNMENT), 2));
+
+    return work_size;
+}
+
+/* インスタンス作成 */
+struct RIMIMOFFTConvolve *RIMIMOFFTConvolve_Create(const struct RIMIMOFFTConvolveConfig *config, void *work, int64_t work_size)
+{
+    uint32_t ch;
+    size_t num_pairs;
+    uint8_t *work_ptr = (uint8_t *)work;
+    struct RIMIMOFFTConvolve *conv;
+    int64_t required_size;
+
+    /* 引数チェック */
+    if ((config == NULL) || (work == NULL)) {
+        return NULL;
+    }
+
+    if (((required_size = RIMIMOFFTConvolve_CalculateWorkSize(config)) < 0)
+            || (work_size < required_size)) {
+        return NULL;
+    }
+
+    /* 構造体を配置 */
+    work_ptr = (uint8_t *)ROUNDUP((uintptr_t)work_ptr, RIMIMOFFTCONVOLVE_ALIGNMENT);
+    conv = (struct RIMIMOFFTConvolve *)work_ptr;
+    conv->num_inputs = config->num_input_channels;
+    conv->num_outputs = config->num_output_channels;
+    conv->partition_size = RIMIMOFFTConvolve_GetPartitionSize(config);
+    conv->fft_size = 2 * conv->partition_size;
+    conv->max_num_partitions = (uint32_t)(((uint64_t)config->max_num_coefficients + conv->partition_size - 1) / conv->partition_size);
+    conv->max_num_coefficients = config->max_num_coefficients;
+    work_ptr += sizeof(struct RIMIMOFFTConvolve);
+
+    num_pairs = (size_t)conv->num_inputs * conv->num_outputs;
+
+    /* 組み合わせ毎の分割数 係数未設定の組み合わせは分割数0 */
+    work_ptr = (uint8_t *)ROUNDUP((uintptr_t)work_ptr, RIMIMOFFTCONVOLVE_ALIGNMENT);
+    conv->num_partitions = (uint32_t *)work_ptr;
+    memset(conv->num_partitions, 0, sizeof(uint32_t) * num_pairs);
+    work_ptr += sizeof(uint32_t) * num_pairs;
+
+    /* 変換済み係数の割り当て */
+    work_ptr = (uint8_t *)ROUNDUP((uintptr_t)work_ptr, RIMIMOFFTCONVOLVE_ALIGNMENT);
+    conv->ir_freq = (float *)work_ptr;
+    work_ptr += sizeof(float) * num_pairs * conv->max_num_partitions * conv->fft_size;
+
+    /* 周波数領域遅延線の割り当て */
+    work_ptr = (uint8_t *)ROUNDUP((uintptr_t)work_ptr, RIMIMOFFTCONVOLVE_ALIGNMENT);
+    conv->freq_delay_line = (float *)work_ptr;
+    work_ptr += sizeof(float) * conv->num_inputs * (size_t)conv->max_num_partitions * conv->fft_size;
+
+    /* 入力バッファの割り当て */
+    work_ptr = (uint8_t *)ROUNDUP((uintptr_t)work_ptr, RIMIMOFFTCONVOLVE_ALIGNMENT);
+    conv->input_buffer = (float **)work_ptr;
+    work_ptr += sizeof(float *) * conv->num_inputs;
+    for (ch = 0; ch < conv->num_inputs; ch++) {
+        work_ptr = (uint8_t *)ROUNDUP((uintptr_t)work_ptr, RIMIMOFFTCONVOLVE_ALIGNMENT);
+        conv->input_buffer[ch] = (float *)work_ptr;
+        work_ptr += sizeof(float) * conv->fft_size;
+    }
+
+    /* 出力バッファの割り当て */
+    work_ptr = (uint8_t *)ROUNDUP((uintptr_t)work_ptr, RIMIMOFFTCONVOLVE_ALIGNMENT);
+    conv->output_buffer = (float **)work_ptr;
+    work_ptr += sizeof(float *) * conv->num_outputs;
+    for (ch = 0; ch < conv->num_outputs; ch++) {
+        work_ptr = (uint8_t *)ROUNDUP((uintptr_t)work_ptr, RIMIMOFFTCONVOLVE_ALIGNMENT);
+        conv->output_buffer[ch] = (float *)work_ptr;
+        work_ptr += sizeof(float) * conv->partition_size;
+    }
+
+    /* 作業領域の割り当て */
+    work_ptr = (uint8_t *)ROUNDUP((uintptr_t)work_ptr, RIMIMOFFTCONVOLVE_ALIGNMENT);
+    conv->work_buffer = (float *)work_ptr;
+    work_ptr += sizeof(float) * conv->fft_size;
+    work_ptr = (uint8_t *)ROUNDUP((uintptr_t)work_ptr, RIMIMOFFTCONVOLVE_ALIGNMENT);
+    conv->comp_muladd_buffer = (float *)work_ptr;
+    work_ptr += sizeof(float) * conv->fft_size;
+
+    /* バッファをリセット */
+    RIMIMOFFTConvolve_Reset(conv);
+
+    return conv;
+}
+
+/* インスタンス破棄 */
+void RIMIMOFFTConvolve_Destroy(struct RIMIMOFFTConvolve *conv)
+{
+    /* 特に何もしない */
+    if (conv != NULL) {
+        return;
+    }
+}
+
+/* 内部状態リセット */
+void RIMIMOFFTConvolve_Reset(struct RIMIMOFFTConvolve *conv)
+{
+    uint32_t ch;
+
+    assert(conv != NULL);
+
+    /* 入出力バッファをクリア */
+    for (ch = 0; ch < conv->num_inputs; ch++) {
+        memset(conv->input_buffer[ch], 0, sizeof(float) * conv->fft_size);
+    }
+    for (ch = 0; ch < conv->num_outputs; ch++) {
+        memset(conv->output_buffer[ch], 0, sizeof(float) * conv->partition_size);
+    }
+
+    /* 周波数領域遅延線をクリア */
+    memset(conv->freq_delay_line, 0,
+            sizeof(float) * conv->num_inputs * (size_t)conv->max_num_partitions * conv->fft_size);
+
+    /* 作業領域をクリア */
+    memset(conv->work_buffer, 0, sizeof(float) * conv->fft_size);
+    memset(conv->comp_muladd_buffer, 0, sizeof(float) * conv->fft_size);
+
+    conv->buffer_count = 0;
+    conv->latest_slot = 0;
+}
+
+/* 畳み込み係数セット */
+void RIMIMOFFTConvolve_SetCoefficients(struct RIMIMOFFTConvolve *conv,
+        uint32_t input_channel, uint32_t output_channel, const float *coefficients, uint32_t num_coefficients)
+{
+    size_t pair;
+
+    /* 引数チェック */
+    assert((conv != NULL) && (coefficients != NULL));
+    assert(input_channel < conv->num_inputs);
+    assert(output_channel < conv->num_outputs);
+
+    /* 係数サイズチェック */
+    assert(num_coefficients <= conv->max_num_coefficients);
+
+    /* 分割して変換 */
+    pair = (size_t)input_channel * conv->num_outputs + output_channel;
+    RIFFTConvolve_MakeSpectrum(conv->partition_size, coefficients, num_coefficients,
+            &conv->ir_freq[pair * conv->max_num_partitions * conv->fft_size], conv->work_buffer);
+    conv->num_partitions[pair] = (uint32_t)(((uint64_t)num_coefficients + conv->partition_size - 1) / conv->partition_size);
+}
+
+/* 畳み込み演算実行 */
+void RIMIMOFFTConvolve_Convolve(struct RIMIMOFFTConvolve *conv,
+        const float *const *input, float *const *output, uint32_t num_samples)
+{
+    uint32_t ch, smpl;
+
+    /* 引数チェック */
+    assert((conv != NULL) && (input != NULL) && (output != NULL));
+
+    smpl = 0;
+    while (smpl < num_samples) {
+        /* 分割サイズに達するまで処理 */
+        const uint32_t num_process = MIN(num_samples - smpl, conv->partition_size - conv->buffer_count);
+
+        /* 入力をバッファ後半に蓄積 */
+        for (ch = 0; ch < conv->num_inputs; ch++) {
+            memcpy(&conv->input_buffer[ch][conv->partition_size + conv->buffer_count],
+                    &input[ch][smpl], sizeof(float) * num_process);
+        }
+
+        /* 前回の分割の畳み込み結果を出力 */
+        for (ch = 0; ch < conv->num_outputs; ch++) {
+            memcpy(&output[ch][smpl],
+                    &conv->output_buffer[ch][conv->buffer_count], sizeof(float) * num_process);
+        }
+
+        conv->buffer_count += num_process;
+        smpl += num_process;
+
+        /* 分割サイズ分溜まったら畳み込み */
+        if (conv->buffer_count == conv->partition_size) {
+            RIMIMOFFTConvolve_ProcessPartition(conv);
+            conv->buffer_count = 0;
+        }
+    }
+}
+
+/* 1分割分の畳み込み処理 */
+static void RIMIMOFFTConvolve_ProcessPartition(struct RIMIMOFFTConvolve *conv)
+{
+    uint32_t in, out, part;
+    const uint32_t fft_size = conv->fft_size;
+    const uint32_t partition_size = conv->partition_size;
+    const size_t delay_line_size = (size_t)conv->max_num_partitions * fft_size;
+
+    /* 周波数領域遅延線を進める */
+    conv->latest_slot = (conv->latest_slot + 1) % conv->max_num_partitions;
+
+    /* 入力チャンネル毎に1回だけFFTし、遅延線の最新スロットに記録 */
+    for (in = 0; in < conv->num_inputs; in++) {
+        float *slot = &conv->freq_delay_line[in * delay_line_size + (size_t)conv->latest_slot * fft_size];
+        memcpy(slot, conv->input_buffer[in], sizeof(float) * fft_size);
+        RIFFT_RealFFT((int)fft_size, -1, slot, conv->work_buffer);
+        /* 今回の分割を前半に移動 */
+        memcpy(conv->input_buffer[in], &conv->input_buffer[in][partition_size], sizeof(float) * partition_size);
+    }
+
+    /* 出力チャンネル毎に全入力の積和をとってから1回だけIFFT */
+    for (out = 0; out < conv->num_outputs; out++) {
+        memset(conv->comp_muladd_buffer, 0, sizeof(float) * fft_size);
+        for (in = 0; in < conv->num_inputs; in++) {
+            const size_t pair = (size_t)in * conv->num_outputs + out;
+            const float *ir_freq = &conv->ir_freq[pair * delay_line_size];
+            const float *delay_line = &conv->freq_delay_line[in * delay_line_size];
+            for (part = 0; part < conv->num_partitions[pair]; part++) {
+                /* part個前の入力と係数のpart番目の分割を乗算 */
+                const uint32_t slot = (conv->latest_slot + conv->max_num_partitions - part) % conv->max_num_partitions;
+                RIFFTConvolve_MulAddSpectrum(conv->comp_muladd_buffer,
+                        &delay_line[(size_t)slot * fft_size], &ir_freq[(size_t)part * fft_size], partition_size);
+            }
+        }
+
+        /* IFFT */
+        RIFFT_RealFFT((int)fft_size, 1, conv->comp_muladd_buffer, conv->work_buffer);
+
+        /* FFT畳み込みで有効なのは結果後半のみ（直線畳み込み） */
+        memcpy(conv->output_buffer[out], &conv->comp_muladd_buffer[partition_size], sizeof(float) * partition_size);
+    }
+}
+
+/* レイテンシーの取得 */
+int32_t RIMIMOFFTConvolve_GetLatencyNumSamples(const struct RIMIMOFFTConvolve *conv)
+{
+    assert(conv != NULL);
+
+    /* 分割サイズ(=FFT点数/2)分遅れる */
+    return (int32_t)conv->partition_size;
+}
+
+/* 係数分割サイズの取得 */
+static uint32_t RIMIMOFFTConvolve_GetPartitionSize(const struct RIMIMOFFTConvolveConfig *config)
+{
+    uint32_t val;
+
+    assert(config != NULL);
+
+    /* 分割サイズの指定がなければ既定値 */
+    if (config->fft_partition_size == 0) {
+        return RIMIMOFFTCONVOLVE_DEFAULT_PARTITION_SIZE;
+    }
+
+    /* 2の冪乗に切り上げ */
+    val = config->fft_partition_size - 1;
+    val |= val >> 1;
+    val |= val >> 2;
+    val |= val >> 4;
+    val |= val >> 8;
+    val |= val >> 16;
+    val++;
+
+    return val;
+}
@@ -0,0 +1,406 @@
+#include "ri_spectrum_cache.h"
+
+#include <string.h>
+#include <assert.h>
+
+#include "ri_fft_convolve.h"
+
+/* メモリアラインメント */
+#define RISPECTRUMCACHE_ALIGNMENT 16
+/* ある整数が2の冪乗か判定. 0:2の冪乗ではない, それ以外:2の冪乗 */
+#define IS_POWER_OF_2(x) (!((x) & ((x) - 1)))
+/* nの倍数切り上げ */
+#define ROUNDUP(val, n) ((((val) + ((n) - 1)) / (n)) * (n))
+/* 64bit FNV-1aハッシュのパラメータ */
+#define RISPECTRUMCACHE_FNV_OFFSET_BASIS (((uint64_t)0xCBF29CE4UL << 32) | 0x84222325UL)
+#define RISPECTRUMCACHE_FNV_PRIME (((uint64_t)0x00000100UL << 32) | 0x000001B3UL)
+
+/* キャッシュエントリ */
+struct RISpectrumCacheEntry {
+    uint8_t used; /* 使用中か？ */
+    uint64_t hash; /* 係数内容のハッシュ値 */
+    uint32_t num_coefficients; /* 係数長 */
+    uint32_t partition_size; /* 分割サイズ */
+    uint32_t reference_count; /* 参照カウント */
+    uint32_t last_access; /* 最後に参照された時刻 */
+    size_t offset; /* スペクトル格納領域の先頭オフセット[byte] */
+    size_t size; /* 格納領域のサイズ[byte] */
+    size_t spectrum_size; /* 格納領域のうちスペクトルのサイズ[byte]. 直後に照合用の係数を置く */
+};
+
+/* スペクトルキャッシュ */
+struct RISpectrumCache {
+    struct RISpectrumCacheEntry *entries; /* エントリ配列 */
+    uint32_t max_num_entries; /* 最大エントリ数 */
+    uint32_t max_partition_size; /* 最大分割サイズ */
+    uint32_t access_count; /* 参照時刻カウンタ */
+    uint8_t *memory; /* スペクトル格納領域 */
+    size_t max_memory_size; /* スペクトル格納領域サイズ */
+    float *fft_work; /* FFT作業領域 */
+};
+
+/* 係数内容のハッシュ値計算 */
+static uint64_t RISpectrumCache_CalculateHash(const float *coefficients, uint32_t num_coefficients);
+/* キーと係数の内容が一致するエントリの探索 見つからない場合はNULL */
+static struct RISpectrumCacheEntry *RISpectrumCache_SearchEntry(struct RISpectrumCache *cache,
+        uint64_t hash, const float *coefficients, uint32_t num_coefficients, uint32_t partition_size);
+/* 格納領域から空き領域を探す. 見つかったら1を返す */
+static uint8_t RISpectrumCache_SearchFreeRegion(
+        const struct RISpectrumCache *cache, size_t size, size_t *poffset);
+/* 参照されていないエントリのうち最も古く使われたものを破棄. 破棄したら1を返す */
+static uint8_t RISpectrumCache_EvictLeastRecentlyUsed(struct RISpectrumCache *cache);
+
+/* スペクトルキャッシュ作成に必要なワークサイズ計算 */
+int64_t RISpectrumCache_CalculateWorkSize(const struct RISpectrumCacheConfig *config)
+{
+    int64_t work_size;
+
+    /* 引数チェック */
+    if (config == NULL) {
+        return -1;
+    }
+
+    /* コンフィグチェック */
+    if ((config->max_num_entries == 0) || (config->max_memory_size == 0)
+            || (config->max_partition_size == 0) || !IS_POWER_OF_2(config->max_partition_size)) {
+        return -1;
+    }
+
+    /* ワークサイズが表現できない */
+    if ((uint64_t)config->max_memory_size > (uint64_t)RICONVOLVE_MAX_WORK_SIZE) {
+        return -1;
+    }
+
+    /* ハンドル領域 */
+    work_size = (int64_t)(sizeof(struct RISpectrumCache) + RISPECTRUMCACHE_ALIGNMENT);
+    /* エントリ領域 */
+    work_size = RICONVOLVE_ADD_WORK_SIZE(work_size,
+            RICONVOLVE_ARRAY_WORK_SIZE(sizeof(struct RISpectrumCacheEntry), config->max_num_entries, RISPECTRUMCACHE_ALIGNMENT));
+    /* スペクトル格納領域 */
+    work_size = RICONVOLVE_ADD_WORK_SIZE(work_size,
+            RICONVOLVE_ARRAY_WORK_SIZE(1, config->max_memory_size, RISPECTRUMCACHE_ALIGNMENT));
+    /* FFT作業領域 */
+    work_size = RICONVOLVE_ADD_WORK_SIZE(work_size,
+            RICONVOLVE_ARRAY_WORK_SIZE(2 * sizeof(float), config->max_partition_size, RISPECTRUMCACHE_ALIGNMENT));
+
+    return work_size;
+}
+
+/* スペクトルキャッシュ作成 */
+struct RISpectrumCache *RISpectrumCache_Create(const struct RISpectrumCacheConfig *config, void *work, int64_t work_size)
+{
+    struct RISpectrumCache *cache;
+    uint8_t *work_ptr;
+    int64_t required_size;
+
+    /* 引数チェック */
+    if ((config == NULL) || (work == NULL) || (work_size < 0)) {
+        return NULL;
+    }
+
+    if (((required_size = RISpectrumCache_CalculateWorkSize(config)) < 0)
+            || (work_size < required_size)) {
+        return NULL;
+    }
+
+    /* ハンドル領域割当 */
+    work_ptr = (uint8_t *)ROUNDUP((uintptr_t)work, RISPECTRUMCACHE_ALIGNMENT);
+    cache = (struct RISpectrumCache *)work_ptr;
+    cache->max_num_entries = config->max_num_entries;
+    cache->max_partition_size = config->max_partition_size;
+    cache->max_memory_size = config->max_memory_size;
+    work_ptr += sizeof(struct RISpectrumCache);
+
+    /* エントリ領域割当 */
+    work_ptr = (uint8_t *)ROUNDUP((uintptr_t)work_ptr, RISPECTRUMCACHE_ALIGNMENT);
+    cache->entries = (struct RISpectrumCacheEntry *)work_ptr;
+    work_ptr += sizeof(struct RISpectrumCacheEntry) * config->max_num_entries;
+
+    /* スペクトル格納領域割当 */
+    work_ptr = (uint8_t *)ROUNDUP((uintptr_t)work_ptr, RISPECTRUMCACHE_ALIGNMENT);
+    cache->memory = work_ptr;
+    work_ptr += config->max_memory_size;
+
+    /* FFT作業領域割当 */
+    work_ptr = (uint8_t *)ROUNDUP((uintptr_t)work_ptr, RISPECTRUMCACHE_ALIGNMENT);
+    cache->fft_work = (float *)work_ptr;
+    work_ptr += sizeof(float) * 2 * config->max_partition_size;
+
+    /* 全エントリを空にする */
+    memset(cache->entries, 0, sizeof(struct RISpectrumCacheEntry) * cache->max_num_entries);
+    cache->access_count = 0;
+
+    return cache;
+}
+
+/* スペクトルキャッシュ破棄 */
+void RISpectrumCache_Destroy(struct RISpectrumCache *cache)
+{
+    /* 特に何もしない */
+    if (cache != NULL) {
+        return;
+    }
+}
+
+/* 参照されていないエントリを全て破棄 */
+void RISpectrumCache_Clear(struct RISpectrumCache *cache)
+{
+    uint32_t i;
+
+    assert(cache != NULL);
+
+    for (i = 0; i < cache->max_num_entries; i++) {
+        if (cache->entries[i].reference_count == 0) {
+            cache->entries[i].used = 0;
+        }
+    }
+}
+
+/* 係数に対応する分割スペクトルを取得 */
+RISpectrumCacheApiResult RISpectrumCache_Acquire(
+        struct RISpectrumCache *cache, const float *coefficients, uint32_t num_coefficients,
+        uint32_t partition_size, const float **pspectrum)
+{
+    uint32_t i;
+    uint64_t hash;
+    size_t size, spectrum_size, offset;
+    struct RISpectrumCacheEntry *entry;
+
+    /* 引数チェック */
+    if ((cache == NULL) || (coefficients == NULL) || (pspectrum == NULL)
+            || (num_coefficients == 0) || (partition_size == 0)
+            || !IS_POWER_OF_2(partition_size) || (partition_size > cache->max_partition_size)) {
+        return RISPECTRUMCACHE_APIRESULT_INVALID_ARGUMENT;
+    }
+
+    /* 参照時刻を進める */
+    cache->access_count++;
+
+    /* キャッシュ済みならばそのまま返す */
+    hash = RISpectrumCache_CalculateHash(coefficients, num_coefficients);
+    if ((entry = RISpectrumCache_SearchEntry(cache, hash, coefficients, num_coefficients, partition_size)) != NULL) {
+        entry->reference_count++;
+        entry->last_access = cache->access_count;
+        (*pspectrum) = (const float *)(cache->memory + entry->offset);
+        return RISPECTRUMCACHE_APIRESULT_OK;
+    }
+
+    /* 格納に必要なサイズ ハッシュ値の衝突に備えて照合用に係数も格納する */
+    spectrum_size = sizeof(float) * RIFFTConvolve_CalculateSpectrumSize(partition_size, num_coefficients);
+    spectrum_size = ROUNDUP(spectrum_size, RISPECTRUMCACHE_ALIGNMENT);
+    size = spectrum_size + ROUNDUP(sizeof(float) * num_coefficients, RISPECTRUMCACHE_ALIGNMENT);
+    if (size > cache->max_memory_size) {
+        return RISPECTRUMCACHE_APIRESULT_EXCEED_MAX_MEMORY;
+    }
+
+    /* 空きエントリを探す 無ければ古いエントリを破棄 */
+    entry = NULL;
+    while (entry == NULL) {
+        for (i = 0; i < cache->max_num_entries; i++) {
+            if (!cache->entries[i].used) {
+                entry = &cache->entries[i];
+                break;
+            }
+        }
+        if ((entry == NULL) && !RISpectrumCache_EvictLeastRecentlyUsed(cache)) {
+            return RISPECTRUMCACHE_APIRESULT_EXCEED_MAX_ENTRIES;
+        }
+    }
+
+    /* 格納領域を探す 無ければ古いエントリを破棄 */
+    while (!RISpectrumCache_SearchFreeRegion(cache, size, &offset)) {
+        if (!RISpectrumCache_EvictLeastRecentlyUsed(cache)) {
+            return RISPECTRUMCACHE_APIRESULT_EXCEED_MAX_MEMORY;
+        }
+    }
+
+    /* 係数を変換して格納 */
+    RIFFTConvolve_MakeSpectrum(partition_size, coefficients, num_coefficients,
+            (float *)(cache->memory + offset), cache->fft_work);
+    memcpy(cache->memory + offset + spectrum_size, coefficients, sizeof(float) * num_coefficients);
+
+    /* エントリ登録 */
+    entry->used = 1;
+    entry->hash = hash;
+    entry->num_coefficients = num_coefficients;
+    entry->partition_size = partition_size;
+    entry->reference_count = 1;
+    entry->last_access = cache->access_count;
+    entry->offset = offset;
+    entry->size = size;
+    entry->spectrum_size = spectrum_size;
+
+    (*pspectrum) = (const float *)(cache->memory + offset);
+
+    return RISPECTRUMCACHE_APIRESULT_OK;
+}
+
+/* 取得したスペクトルの参照を解放 */
+RISpectrumCacheApiResult RISpectrumCache_Release(
+        struct RISpectrumCache *cache, const float *spectrum)
+{
+    uint32_t i;
+
+    /* 引数チェック */
+    if ((cache == NULL) || (spectrum == NULL)) {
+        return RISPECTRUMCACHE_APIRESULT_INVALID_ARGUMENT;
+    }
+
+    for (i = 0; i < cache->max_num_entries; i++) {
+        struct RISpectrumCacheEntry *entry = &cache->entries[i];
+        if (entry->used && ((const uint8_t *)spectrum == (cache->memory + entry->offset))) {
+            /* 参照されていないエントリの解放 */
+            if (entry->reference_count == 0) {
+                return RISPECTRUMCACHE_APIRESULT_NG;
+            }
+            entry->reference_count--;
+            return RISPECTRUMCACHE_APIRESULT_OK;
+        }
+    }
+
+    /* キャッシュ内のスペクトルではない */
+    return RISPECTRUMCACHE_APIRESULT_INVALID_ARGUMENT;
+}
+
+/* 登録済みのエントリ数取得 */
+uint32_t RISpectrumCache_GetNumEntries(const struct RISpectrumCache *cache)
+{
+    uint32_t i, num_entries;
+
+    assert(cache != NULL);
+
+    num_entries = 0;
+    for (i = 0; i < cache->max_num_entries; i++) {
+        if (cache->entries[i].used) {
+            num_entries++;
+        }
+    }
+
+    return num_entries;
+}
+
+/* スペクトル格納に使用中のメモリサイズ取得 */
+size_t RISpectrumCache_GetUsedMemorySize(const struct RISpectrumCache *cache)
+{
+    uint32_t i;
+    size_t used_size;
+
+    assert(cache != NULL);
+
+    used_size = 0;
+    for (i = 0; i < cache->max_num_entries; i++) {
+        if (cache->entries[i].used) {
+            used_size += cache->entries[i].size;
+        }
+    }
+
+    return used_size;
+}
+
+/* 係数内容のハッシュ値計算 */
+/* FNV-1aをバイト列に適用 */
+static uint64_t RISpectrumCache_CalculateHash(const float *coefficients, uint32_t num_coefficients)
+{
+    size_t i;
+    uint64_t hash = RISPECTRUMCACHE_FNV_OFFSET_BASIS;
+    const uint8_t *data = (const uint8_t *)coefficients;
+    const size_t size = sizeof(float) * num_coefficients;
+
+    for (i = 0; i < size; i++) {
+        hash ^= data[i];
+        hash *= RISPECTRUMCACHE_FNV_PRIME;
+    }
+
+    return hash;
+}
+
+/* キーと係数の内容が一致するエントリの探索 */
+static struct RISpectrumCacheEntry *RISpectrumCache_SearchEntry(struct RISpectrumCache *cache,
+        uint64_t hash, const float *coefficients, uint32_t num_coefficients, uint32_t partition_size)
+{
+    uint32_t i;
+
+    for (i = 0; i < cache->max_num_entries; i++) {
+        struct RISpectrumCacheEntry *entry = &cache->entries[i];
+        if (entry->used && (entry->hash == hash)
+                && (entry->num_coefficients == num_coefficients)
+                && (entry->partition_size == partition_size)
+                && (memcmp(cache->memory + entry->offset + entry->spectrum_size,
+                        coefficients, sizeof(float) * num_coefficients) == 0)) {
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
+/* 格納領域から空き領域を探す */
+/* 先頭もしくは使用中領域の直後を候補とし、他の使用中領域と重ならない最初の候補を選ぶ */
+static uint8_t RISpectrumCache_SearchFreeRegion(
+        const struct RISpectrumCache *cache, size_t size, size_t *poffset)
+{
+    uint32_t i, j;
+
+    for (i = 0; i <= cache->max_num_entries; i++) {
+        size_t start;
+        uint8_t overlapped;
+
+        /* 候補位置の決定 */
+        if (i == cache->max_num_entries) {
+            start = 0;
+        } else if (cache->entries[i].used) {
+            start = cache->entries[i].offset + cache->entries[i].size;
+        } else {
+            continue;
+        }
+
+        /* 末尾からはみ出す */
+        if (start + size > cache->max_memory_size) {
+            continue;
+        }
+
+        /* 使用中領域との重なり判定 */
+        overlapped = 0;
+        for (j = 0; j < cache->max_num_entries; j++) {
+            const struct RISpectrumCacheEntry *entry = &cache->entries[j];
+            if (entry->used
+                    && (start < entry->offset + entry->size) && (entry->offset < start + size)) {
+                overlapped = 1;
+                break;
+            }
+        }
+
+        if (!overlapped) {
+            (*poffset) = start;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/* 参照されていないエントリのうち最も古く使われたものを破棄 */
+static uint8_t RISpectrumCache_EvictLeastRecentlyUsed(struct RISpectrumCache *cache)
+{
+    uint32_t i;
+    struct RISpectrumCacheEntry *oldest = NULL;
+
+    for (i = 0; i < cache->max_num_entries; i++) {
+        struct RISpectrumCacheEntry *entry = &cache->entries[i];
+        if (entry->used && (entry->reference_count == 0)) {
+            /* 参照時刻カウンタの巡回を考慮して差分で比較 */
+            if ((oldest == NULL)
+                    || ((uint32_t)(cache->access_count - entry->last_access)
+                        > (uint32_t)(cache->access_count - oldest->last_access))) {
+                oldest = entry;
+            }
+        }
+    }
+
+    if (oldest == NULL) {
+        return 0;
+    }
+
+    oldest->used = 0;
+    return 1;
+}
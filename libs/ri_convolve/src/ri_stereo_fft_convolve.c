@@ -0,0 +1,423 @@
+#include "ri_stereo_fft_convolve.h"
+
+#include <string.h>
+#include <assert.h>
+
+#include "ri_fft.h"
+#include "ri_convolve.h"
+
+/* デフォルトの係数分割サイズ */
+#define RISTEREOFFTCONVOLVE_DEFAULT_PARTITION_SIZE 1024
+/* 係数分割サイズの最大値（FFT点数がintで表せる範囲） */
+#define RISTEREOFFTCONVOLVE_MAX_PARTITION_SIZE (1UL << 29)
+/* メモリアラインメント */
+#define RISTEREOFFTCONVOLVE_ALIGNMENT 16
+/* 最小値を取得 */
+#define MIN(a,b) (((a) < (b)) ? (a) : (b))
+/* nの倍数切り上げ */
+#define ROUNDUP(val, n) ((((val) + ((n) - 1)) / (n)) * (n))
+/* 片側スペクトルのfloat要素数: 直流から最高周波数までの(fft_size / 2 + 1)個の複素数 */
+#define RISTEREOFFTCONVOLVE_SPECTRUM_SIZE(fft_size) ((fft_size) + 2)
+
+/* ステレオFFT畳み込み構造体 */
+struct RIStereoFFTConvolve {
+    uint32_t fft_size; /* FFT点数 */
+    uint32_t partition_size; /* 係数の分割サイズ: fft_size / 2 が成立 */
+    uint32_t spectrum_size; /* 片側スペクトルのfloat要素数 */
+    uint32_t max_num_partitions; /* 最大分割数 */
+    uint32_t max_num_coefficients; /* 最大係数長 */
+    uint32_t buffer_count; /* 分割内の入力バッファサンプル数カウント */
+    uint32_t latest_slot; /* 周波数領域遅延線の最新スロット */
+    uint32_t num_partitions[RISTEREOFFTCONVOLVE_NUM_CHANNELS]; /* チャンネル毎の分割数 */
+    float *ir_freq[RISTEREOFFTCONVOLVE_NUM_CHANNELS]; /* チャンネル毎のフーリエ変換済みのインパルス応答(片側スペクトル) */
+    float *freq_delay_line[RISTEREOFFTCONVOLVE_NUM_CHANNELS]; /* チャンネル毎の周波数領域遅延線(片側スペクトル) */
+    float *input_buffer[RISTEREOFFTCONVOLVE_NUM_CHANNELS]; /* チャンネル毎の入力バッファ 前半に前回の分割, 後半に今回の分割 */
+    float *output_buffer[RISTEREOFFTCONVOLVE_NUM_CHANNELS]; /* チャンネル毎の出力バッファ */
+    float *comp_muladd_buffer[RISTEREOFFTCONVOLVE_NUM_CHANNELS]; /* チャンネル毎の複素数乗算/加算計算結果バッファ */
+    float *complex_buffer; /* 2チャンネルをまとめた複素信号バッファ */
+    float *work_buffer; /* FFT作業バッファ */
+};
+
+/* 1分割分の畳み込み処理 */
+static void RIStereoFFTConvolve_ProcessPartition(struct RIStereoFFTConvolve *conv);
+/* 実部・虚部に2つの実信号をまとめた複素信号のスペクトルから、それぞれの実信号の片側スペクトルを分離 */
+static void RIStereoFFTConvolve_SeparateSpectrum(
+        const float *packed, uint32_t fft_size, float scale, float *spec0, float *spec1);
+/* 2つの実信号の片側スペクトルから、実部・虚部にまとめた複素信号のスペクトルを合成 */
+static void RIStereoFFTConvolve_CombineSpectrum(
+        const float *spec0, const float *spec1, uint32_t fft_size, float *packed);
+/* srcとcoefを複素乗算し、dstに足し込む */
+static void RIStereoFFTConvolve_MulAddSpectrum(
+        float *dst, const float *src, const float *coef, uint32_t num_complex);
+/* 係数分割サイズの取得 */
+static uint32_t RIStereoFFTConvolve_GetPartitionSize(const struct RIStereoFFTConvolveConfig *config);
+
+/* ワークサイズ計算 */
+int64_t RIStereoFFTConvolve_CalculateWorkSize(const struct RIStereoFFTConvolveConfig *config)
+{
+    int64_t work_size, channel_work_size;
+    uint32_t fft_size, partition_size, spectrum_size, max_num_partitions;
+
+    /* 引数チェック */
+    if (config == NULL) {
+        return -1;
+    }
+
+    /* コンフィグチェック */
+    if ((config->max_num_coefficients == 0)
+            || (config->fft_partition_size > RISTEREOFFTCONVOLVE_MAX_PARTITION_SIZE)) {
+        return -1;
+    }
+
+    partition_size = RIStereoFFTConvolve_GetPartitionSize(config);
+    fft_size = 2 * partition_size;
+    spectrum_size = RISTEREOFFTCONVOLVE_SPECTRUM_SIZE(fft_size);
+    max_num_partitions = (uint32_t)(((uint64_t)config->max_num_coefficients + partition_size - 1) / partition_size);
+
+    /* ハンドル領域分 */
+    work_size = (int64_t)(sizeof(struct RIStereoFFTConvolve) + RISTEREOFFTCONVOLVE_ALIGNMENT);
+
+    /* チャンネル毎の領域 */
+    /* フーリエ変換済みの係数領域分・周波数領域遅延線 */
+    channel_work_size = RICONVOLVE_MUL_WORK_SIZE(
+            RICONVOLVE_ARRAY_WORK_SIZE(sizeof(float), (uint64_t)max_num_partitions * spectrum_size, RISTEREOFFTCONVOLVE_ALIGNMENT), 2);
+    /* 入力バッファ */
+    channel_work_size = RICONVOLVE_ADD_WORK_SIZE(channel_work_size,
+            RICONVOLVE_ARRAY_WORK_SIZE(sizeof(float), fft_size, RISTEREOFFTCONVOLVE_ALIGNMENT));
+    /* 出力バッファ */
+    channel_work_size = RICONVOLVE_ADD_WORK_SIZE(channel_work_size,
+            RICONVOLVE_ARRAY_WORK_SIZE(sizeof(float), partition_size, RISTEREOFFTCONVOLVE_ALIGNMENT));
+    /* 複素乗算/加算作業領域 */
+    channel_work_size = RICONVOLVE_ADD_WORK_SIZE(channel_work_size,
+            RICONVOLVE_ARRAY_WORK_SIZE(sizeof(float), spectrum_size, RISTEREOFFTCONVOLVE_ALIGNMENT));
+    work_size = RICONVOLVE_ADD_WORK_SIZE(work_size,
+            RICONVOLVE_MUL_WORK_SIZE(channel_work_size, RISTEREOFFTCONVOLVE_NUM_CHANNELS));
+
+    /* 複素信号バッファとFFT作業領域（複素数でfft_size点） */
+    work_size = RICONVOLVE_ADD_WORK_SIZE(work_size,
+            RICONVOLVE_MUL_WORK_SIZE(RICONVOLVE_ARRAY_WORK_SIZE(sizeof(float), 2 * (uint64_t)fft_size, RISTEREOFFTCONVOLVE_ALIGNMENT), 2));
+
+    return work_size;
+}
+
+/* インスタンス作成 */
+struct RIStereoFFTConvolve *RIStereoFFTConvolve_Create(const struct RIStereoFFTConvolveConfig *config, void *work, int64_t work_size)
+{
+    uint32_t ch;
+    uint8_t *work_ptr = (uint8_t *)work;
+    struct RIStereoFFTConvolve *conv;
+    int64_t required_size;
+
+    /* 引数チェック */
+    if ((config == NULL) || (work == NULL)) {
+        return NULL;
+    }
+
+    if (((required_size = RIStereoFFTConvolve_CalculateWorkSize(config)) < 0)
+            || (work_size < required_size)) {
+        return NULL;
+    }
+
+    /* 構造体を配置 */
+    work_ptr = (uint8_t *)ROUNDUP((uintptr_t)work_ptr, RISTEREOFFTCONVOLVE_ALIGNMENT);
+    conv = (struct RIStereoFFTConvolve *)work_ptr;
+    conv->partition_size = RIStereoFFTConvolve_GetPartitionSize(config);
+    conv->fft_size = 2 * conv->partition_size;
+    conv->spectrum_size = RISTEREOFFTCONVOLVE_SPECTRUM_SIZE(conv->fft_size);
+    conv->max_num_partitions = (uint32_t)(((uint64_t)config->max_num_coefficients + conv->partition_size - 1) / conv->partition_size);
+    conv->max_num_coefficients = config->max_num_coefficients;
+    work_ptr += sizeof(struct RIStereoFFTConvolve);
+
+    for (ch = 0; ch < RISTEREOFFTCONVOLVE_NUM_CHANNELS; ch++) {
+        /* 係数未設定のチャンネルは分割数0（無音） */
+        conv->num_partitions[ch] = 0;
+
+        /* 変換済み係数の割り当て */
+        work_ptr = (uint8_t *)ROUNDUP((uintptr_t)work_ptr, RISTEREOFFTCONVOLVE_ALIGNMENT);
+        conv->ir_freq[ch] = (float *)work_ptr;
+        work_ptr += sizeof(float) * (size_t)conv->max_num_partitions * conv->spectrum_size;
+
+        /* 周波数領域遅延線の割り当て */
+        work_ptr = (uint8_t *)ROUNDUP((uintptr_t)work_ptr, RISTEREOFFTCONVOLVE_ALIGNMENT);
+        conv->freq_delay_line[ch] = (float *)work_ptr;
+        work_ptr += sizeof(float) * (size_t)conv->max_num_partitions * conv->spectrum_size;
+
+        /* 入力バッファの割り当て */
+        work_ptr = (uint8_t *)ROUNDUP((uintptr_t)work_ptr, RISTEREOFFTCONVOLVE_ALIGNMENT);
+        conv->input_buffer[ch] = (float *)work_ptr;
+        work_ptr += sizeof(float) * conv->fft_size;
+
+        /* 出力バッファの割り当て */
+        work_ptr = (uint8_t *)ROUNDUP((uintptr_t)work_ptr, RISTEREOFFTCONVOLVE_ALIGNMENT);
+        conv->output_buffer[ch] = (float *)work_ptr;
+        work_ptr += sizeof(float) * conv->partition_size;
+
+        /* 複素乗算/加算作業領域の割り当て */
+        work_ptr = (uint8_t *)ROUNDUP((uintptr_t)work_ptr, RISTEREOFFTCONVOLVE_ALIGNMENT);
+        conv->comp_muladd_buffer[ch] = (float *)work_ptr;
+        work_ptr += sizeof(float) * conv->spectrum_size;
+    }
+
+    /* 複素信号バッファ・作業領域の割り当て */
+    work_ptr = (uint8_t *)ROUNDUP((uintptr_t)work_ptr, RISTEREOFFTCONVOLVE_ALIGNMENT);
+    conv->complex_buffer = (float *)work_ptr;
+    work_ptr += sizeof(float) * 2 * conv->fft_size;
+    work_ptr = (uint8_t *)ROUNDUP((uintptr_t)work_ptr, RISTEREOFFTCONVOLVE_ALIGNMENT);
+    conv->work_buffer = (float *)work_ptr;
+    work_ptr += sizeof(float) * 2 * conv->fft_size;
+
+    /* バッファをリセット */
+    RIStereoFFTConvolve_Reset(conv);
+
+    return conv;
+}
+
+/* インスタンス破棄 */
+void RIStereoFFTConvolve_Destroy(struct RIStereoFFTConvolve *conv)
+{
+    /* 特に何もしない */
+    if (conv != NULL) {
+        return;
+    }
+}
+
+/* 内部状態リセット */
+void RIStereoFFTConvolve_Reset(struct RIStereoFFTConvolve *conv)
+{
+    uint32_t ch;
+
+    assert(conv != NULL);
+
+    for (ch = 0; ch < RISTEREOFFTCONVOLVE_NUM_CHANNELS; ch++) {
+        /* 入出力バッファをクリア */
+        memset(conv->input_buffer[ch], 0, sizeof(float) * conv->fft_size);
+        memset(conv->output_buffer[ch], 0, sizeof(float) * conv->partition_size);
+        /* 周波数領域遅延線をクリア */
+        memset(conv->freq_delay_line[ch], 0, sizeof(float) * (size_t)conv->max_num_partitions * conv->spectrum_size);
+        memset(conv->comp_muladd_buffer[ch], 0, sizeof(float) * conv->spectrum_size);
+    }
+
+    /* 作業領域をクリア */
+    memset(conv->complex_buffer, 0, sizeof(float) * 2 * conv->fft_size);
+    memset(conv->work_buffer, 0, sizeof(float) * 2 * conv->fft_size);
+
+    conv->buffer_count = 0;
+    conv->latest_slot = 0;
+}
+
+/* 畳み込み係数セット */
+void RIStereoFFTConvolve_SetCoefficients(struct RIStereoFFTConvolve *conv,
+        uint32_t channel, const float *coefficients, uint32_t num_coefficients)
+{
+    uint32_t part, i, num_partitions;
+    const uint32_t fft_size = conv->fft_size;
+    const uint32_t partition_size = conv->partition_size;
+    /* 複素IFFTは正規化しないため、係数側で1/fft_sizeを掛けておく */
+    const float scale = 1.0f / (float)fft_size;
+    float *ir_freq;
+
+    /* 引数チェック */
+    assert((conv != NULL) && (coefficients != NULL));
+    assert(channel < RISTEREOFFTCONVOLVE_NUM_CHANNELS);
+
+    /* 係数サイズチェック */
+    assert(num_coefficients <= conv->max_num_coefficients);
+
+    ir_freq = conv->ir_freq[channel];
+    num_partitions = ROUNDUP(num_coefficients, partition_size) / partition_size;
+
+    /* 隣り合う2分割を実部・虚部にまとめて1回のFFTで変換 */
+    for (part = 0; part < num_partitions; part += 2) {
+        const uint32_t offset0 = part * partition_size;
+        const uint32_t offset1 = offset0 + partition_size;
+        const uint32_t num_copy0 = MIN(partition_size, num_coefficients - offset0);
+        const uint32_t num_copy1 = (offset1 < num_coefficients) ? MIN(partition_size, num_coefficients - offset1) : 0;
+        memset(conv->complex_buffer, 0, sizeof(float) * 2 * fft_size);
+        for (i = 0; i < num_copy0; i++) {
+            RIFFTCOMPLEX_REAL(conv->complex_buffer, i) = coefficients[offset0 + i];
+        }
+        for (i = 0; i < num_copy1; i++) {
+            RIFFTCOMPLEX_IMAG(conv->complex_buffer, i) = coefficients[offset1 + i];
+        }
+        RIFFT_FloatFFT((int)fft_size, -1, conv->complex_buffer, conv->work_buffer);
+        /* 分割数が奇数の場合、最後の虚部側の分割は作業領域に捨てる */
+        RIStereoFFTConvolve_SeparateSpectrum(conv->complex_buffer, fft_size, scale,
+                &ir_freq[part * conv->spectrum_size],
+                (part + 1 < num_partitions) ? &ir_freq[(part + 1) * conv->spectrum_size] : conv->comp_muladd_buffer[channel]);
+    }
+
+    conv->num_partitions[channel] = num_partitions;
+}
+
+/* 畳み込み演算実行 */
+void RIStereoFFTConvolve_Convolve(struct RIStereoFFTConvolve *conv,
+        const float *const *input, float *const *output, uint32_t num_samples)
+{
+    uint32_t ch, smpl;
+
+    /* 引数チェック */
+    assert((conv != NULL) && (input != NULL) && (output != NULL));
+
+    smpl = 0;
+    while (smpl < num_samples) {
+        /* 分割サイズに達するまで処理 */
+        const uint32_t num_process = MIN(num_samples - smpl, conv->partition_size - conv->buffer_count);
+
+        for (ch = 0; ch < RISTEREOFFTCONVOLVE_NUM_CHANNELS; ch++) {
+            /* 入力をバッファ後半に蓄積 */
+            memcpy(&conv->input_buffer[ch][conv->partition_size + conv->buffer_count],
+                    &input[ch][smpl], sizeof(float) * num_process);
+            /* 前回の分割の畳み込み結果を出力 */
+            memcpy(&output[ch][smpl],
+                    &conv->output_buffer[ch][conv->buffer_count], sizeof(float) * num_process);
+        }
+
+        conv->buffer_count += num_process;
+        smpl += num_process;
+
+        /* 分割サイズ分溜まったら畳み込み */
+        if (conv->buffer_count == conv->partition_size) {
+            RIStereoFFTConvolve_ProcessPartition(conv);
+            conv->buffer_count = 0;
+        }
+    }
+}
+
+/* 1分割分の畳み込み処理 */
+static void RIStereoFFTConvolve_ProcessPartition(struct RIStereoFFTConvolve *conv)
+{
+    uint32_t ch, part, i;
+    const uint32_t fft_size = conv->fft_size;
+    const uint32_t partition_size = conv->partition_size;
+    const uint32_t spectrum_size = conv->spectrum_size;
+    const float *in0 = conv->input_buffer[0];
+    const float *in1 = conv->input_buffer[1];
+
+    /* 周波数領域遅延線を進める */
+    conv->latest_slot = (conv->latest_slot + 1) % conv->max_num_partitions;
+
+    /* 2チャンネルを実部・虚部にまとめて1回だけFFT */
+    for (i = 0; i < fft_size; i++) {
+        RIFFTCOMPLEX_REAL(conv->complex_buffer, i) = in0[i];
+        RIFFTCOMPLEX_IMAG(conv->complex_buffer, i) = in1[i];
+    }
+    RIFFT_FloatFFT((int)fft_size, -1, conv->complex_buffer, conv->work_buffer);
+
+    /* 共役対称性を使ってチャンネル毎のスペクトルに分離し、遅延線の最新スロットに記録 */
+    RIStereoFFTConvolve_SeparateSpectrum(conv->complex_buffer, fft_size, 1.0f,
+            &conv->freq_delay_line[0][conv->latest_slot * spectrum_size],
+            &conv->freq_delay_line[1][conv->latest_slot * spectrum_size]);
+
+    /* チャンネル毎に積和 */
+    for (ch = 0; ch < RISTEREOFFTCONVOLVE_NUM_CHANNELS; ch++) {
+        memset(conv->comp_muladd_buffer[ch], 0, sizeof(float) * spectrum_size);
+        for (part = 0; part < conv->num_partitions[ch]; part++) {
+            /* part個前の入力と係数のpart番目の分割を乗算 */
+            const uint32_t slot = (conv->latest_slot + conv->max_num_partitions - part) % conv->max_num_partitions;
+            RIStereoFFTConvolve_MulAddSpectrum(conv->comp_muladd_buffer[ch],
+                    &conv->freq_delay_line[ch][slot * spectrum_size], &conv->ir_freq[ch][part * spectrum_size],
+                    spectrum_size / 2);
+        }
+        /* 今回の分割を前半に移動 */
+        memcpy(conv->input_buffer[ch], &conv->input_buffer[ch][partition_size], sizeof(float) * partition_size);
+    }
+
+    /* 2チャンネルの結果をまとめて1回だけIFFT */
+    RIStereoFFTConvolve_CombineSpectrum(conv->comp_muladd_buffer[0], conv->comp_muladd_buffer[1],
+            fft_size, conv->complex_buffer);
+    RIFFT_FloatFFT((int)fft_size, 1, conv->complex_buffer, conv->work_buffer);
+
+    /* FFT畳み込みで有効なのは結果後半のみ（直線畳み込み） 実部が0チャンネル, 虚部が1チャンネル */
+    for (i = 0; i < partition_size; i++) {
+        conv->output_buffer[0][i] = RIFFTCOMPLEX_REAL(conv->complex_buffer, partition_size + i);
+        conv->output_buffer[1][i] = RIFFTCOMPLEX_IMAG(conv->complex_buffer, partition_size + i);
+    }
+}
+
+/* 実部・虚部に2つの実信号をまとめた複素信号のスペクトルから、それぞれの実信号の片側スペクトルを分離
+* Z[k] = X0[k] + j X1[k] であり、実信号のスペクトルは共役対称なので
+* X0[k] = (Z[k] + conj(Z[N - k])) / 2, X1[k] = (Z[k] - conj(Z[N - k])) / 2j */
+static void RIStereoFFTConvolve_SeparateSpectrum(
+        const float *packed, uint32_t fft_size, float scale, float *spec0, float *spec1)
+{
+    uint32_t k;
+    const float half_scale = 0.5f * scale;
+
+    for (k = 0; k <= fft_size / 2; k++) {
+        const uint32_t m = (fft_size - k) & (fft_size - 1);
+        const float zr = RIFFTCOMPLEX_REAL(packed, k), zi = RIFFTCOMPLEX_IMAG(packed, k);
+        const float mr = RIFFTCOMPLEX_REAL(packed, m), mi = RIFFTCOMPLEX_IMAG(packed, m);
+        RIFFTCOMPLEX_REAL(spec0, k) = half_scale * (zr + mr);
+        RIFFTCOMPLEX_IMAG(spec0, k) = half_scale * (zi - mi);
+        RIFFTCOMPLEX_REAL(spec1, k) = half_scale * (zi + mi);
+        RIFFTCOMPLEX_IMAG(spec1, k) = half_scale * (mr - zr);
+    }
+}
+
+/* 2つの実信号の片側スペクトルから、実部・虚部にまとめた複素信号のスペクトルを合成
+* Z[k] = X0[k] + j X1[k], Z[N - k] = conj(X0[k]) + j conj(X1[k]) */
+static void RIStereoFFTConvolve_CombineSpectrum(
+        const float *spec0, const float *spec1, uint32_t fft_size, float *packed)
+{
+    uint32_t k;
+
+    for (k = 0; k <= fft_size / 2; k++) {
+        const float ar = RIFFTCOMPLEX_REAL(spec0, k), ai = RIFFTCOMPLEX_IMAG(spec0, k);
+        const float br = RIFFTCOMPLEX_REAL(spec1, k), bi = RIFFTCOMPLEX_IMAG(spec1, k);
+        RIFFTCOMPLEX_REAL(packed, k) = ar - bi;
+        RIFFTCOMPLEX_IMAG(packed, k) = ai + br;
+        if ((k > 0) && (k < fft_size / 2)) {
+            RIFFTCOMPLEX_REAL(packed, fft_size - k) = ar + bi;
+            RIFFTCOMPLEX_IMAG(packed, fft_size - k) = br - ai;
+        }
+    }
+}
+
+/* srcとcoefを複素乗算し、dstに足し込む */
+static void RIStereoFFTConvolve_MulAddSpectrum(
+        float *dst, const float *src, const float *coef, uint32_t num_complex)
+{
+    uint32_t cmplx;
+    float src_re, src_im, coef_re, coef_im;
+
+    /* 片側スペクトルは直流・最高周波数成分も複素数として持つため全要素を複素乗算 */
+    for (cmplx = 0; cmplx < num_complex; cmplx++) {
+        src_re = RIFFTCOMPLEX_REAL(src, cmplx); src_im = RIFFTCOMPLEX_IMAG(src, cmplx);
+        coef_re = RIFFTCOMPLEX_REAL(coef, cmplx); coef_im = RIFFTCOMPLEX_IMAG(coef, cmplx);
+        RIFFTCOMPLEX_REAL(dst, cmplx) += src_re * coef_re - src_im * coef_im;
+        RIFFTCOMPLEX_IMAG(dst, cmplx) += src_im * coef_re + src_re * coef_im;
+    }
+}
+
+/* レイテンシーの取得 */
+int32_t RIStereoFFTConvolve_GetLatencyNumSamples(const struct RIStereoFFTConvolve *conv)
+{
+    assert(conv != NULL);
+
+    /* 分割サイズ(=FFT点数/2)分遅れる */
+    return (int32_t)conv->partition_size;
+}
+
+/* 係数分割サイズの取得 */
+static uint32_t RIStereoFFTConvolve_GetPartitionSize(const struct RIStereoFFTConvolveConfig *config)
+{
+    uint32_t val;
+
+    assert(config != NULL);
+
+    /* 分割サイズの指定がなければ既定値 */
+    if (config->fft_partition_size == 0) {
+        return RISTEREOFFTCONVOLVE_DEFAULT_PARTITION_SIZE;
+    }
+
+    /* 2の冪乗に切り上げ */
+    val = config->fft_partition_size - 1;
+    val |= val >> 1;
+    val |= val >> 2;
+    val |= val >> 4;
+    val |= val >> 8;
+    val |= val >> 16;
+    val++;
+
+    return val;
+}
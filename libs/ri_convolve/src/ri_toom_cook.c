@@ -0,0 +1,597 @@
+#include "ri_toom_cook.h"
+#include <assert.h>
+#include <string.h>
+#include "ri_convolve_statistics.h"
+
+/* SIMD命令の選択 */
+#if defined(__AVX512F__)
+#define RITOOMCOOK_USE_AVX512
+#include <immintrin.h>
+#elif defined(__AVX2__) && (defined(__FMA__) || defined(_MSC_VER))
+#define RITOOMCOOK_USE_AVX2
+#include <immintrin.h>
+#endif
+
+/* メモリアラインメント */
+#define RITOOMCOOK_ALIGNMENT 16
+/* 素朴な畳み込みに切り替えるサイズ */
+#define RITOOMCOOK_BASE_CASE_SIZE 64
+/* 係数側の評価値を事前計算する階層数（深い階層まで保持すると係数長の数十倍の領域が必要になる） */
+#define RITOOMCOOK_NUM_EVALUATION_LEVELS 2
+
+/* 2値のうちの最大を取る */
+#define MAX(x,y) (((x) > (y)) ? (x) : (y))
+/* 2値のうちの最小を取る */
+#define MIN(x,y) (((x) < (y)) ? (x) : (y))
+/* nの倍数切り上げ */
+#define ROUNDUP(val, n) ((((val) + ((n) - 1)) / (n)) * (n))
+
+struct RIToomCook {
+    float *coefficients; /* 畳み込み係数（分割処理の端数のため最大処理サンプル単位の2倍） */
+    uint32_t num_coefficients; /* 畳み込み係数サイズ */
+    float *input_buffer; /* 入力バッファ */
+    float *output_buffer; /* 出力バッファ（重畳加算用 最大処理サンプル単位の2倍） */
+    float *product_buffer; /* 畳み込み結果バッファ（最大処理サンプル単位の2倍） */
+    float *work_buffer; /* 計算用ワークバッファ */
+    float *coefficients_evaluation; /* 分割毎の係数の評価値を上位の階層分事前計算した木 */
+    uint32_t evaluation_size; /* 分割1つあたりの評価値の木のサイズ */
+    uint32_t max_num_coefficients; /* 最大処理サンプル単位 */
+    uint32_t max_num_input_samples; /* 最大入力サンプル数（評価値を事前計算する分割サイズ） */
+#if defined(RICONVOLVE_ENABLE_STATISTICS)
+    struct RIConvolveStatisticsCounter statistics; /* 統計情報 */
+#endif
+};
+
+/* ワークサイズ計算 */
+static int64_t RIToomCook_CalculateWorkSize(const struct RIConvolveConfig *config);
+/* インスタンス生成 */
+static void* RIToomCook_Create(const struct RIConvolveConfig *config, void *work, int64_t work_size);
+/* インスタンス破棄 */
+static void RIToomCook_Destroy(void *obj);
+/* 内部状態リセット */
+static void RIToomCook_Reset(void *obj);
+/* 係数セット */
+static void RIToomCook_SetCoefficients(void *obj, const float *coefficients, uint32_t num_coefficients);
+/* 畳み込み計算 */
+static void RIToomCook_Convolve(void *obj, const float *input, float *output, uint32_t num_samples);
+/* 要素間隔を指定した畳み込み計算 */
+static void RIToomCook_ConvolveStrided(void *obj,
+        const float *input, uint32_t input_stride, float *output, uint32_t output_stride, uint32_t num_samples);
+/* レイテンシーの取得 */
+static int32_t RIToomCook_GetLatencyNumSamples(void *obj);
+/* 統計情報の取得 */
+static uint8_t RIToomCook_GetStatistics(void *obj, struct RIConvolveStatistics *statistics);
+/* ナイーブな畳込み */
+/* z = a * b zはサイズ2n */
+static void RIToomCook_ConvolveNaive(const float *a, const float *b, float *z, uint32_t n);
+/* Toom-Cook 3分割法の計算用ワークバッファサイズ(float要素数)計算 */
+static uint32_t RIToomCook_CalculateToom3WorkSize(uint32_t n);
+/* 係数をサイズnで分割したときの分割数(1以上) */
+static uint32_t RIToomCook_CalculateNumSegments(uint32_t num_coefficients, uint32_t n);
+/* 評価値の木のサイズ(float要素数)計算 num_levelsは木を保持する階層数 */
+static uint32_t RIToomCook_CalculateEvaluationTreeSize(uint32_t n, uint32_t num_levels);
+/* 1, -1, -2, ∞ の4点での評価値を計算 各評価値はサイズ(n + 2) / 3 */
+static void RIToomCook_EvaluateToom3(const float *x, float *p1, float *pm1, float *pm2, float *pinf, uint32_t n);
+/* 評価値の木を作成 */
+static void RIToomCook_MakeEvaluationTree(const float *b, float *tree, uint32_t n, uint32_t num_levels);
+/* Toom-Cook 3分割法による畳込み */
+/* btreeはbの評価値の木(num_levelsが0の階層では評価値をワーク上で計算), zはサイズ2n */
+/* workはRIToomCook_CalculateToom3WorkSize(n)の要素数が必要 */
+static void RIToomCook_ConvolveToom3(const float *a, const float *b, const float *btree, uint32_t num_levels,
+        float *z, float *work, uint32_t n);
+
+/* 要素間隔strideのsrcを連続領域dstにコピー */
+static void RIToomCook_CopyFromStrided(float *dst, const float *src, uint32_t stride, uint32_t num_samples);
+/* 連続領域srcを要素間隔strideのdstにコピー */
+static void RIToomCook_CopyToStrided(float *dst, uint32_t stride, const float *src, uint32_t num_samples);
+/* インターフェース */
+static const struct RIConvolveInterface st_toom_cook_convolve_if = {
+    RIToomCook_CalculateWorkSize,
+    RIToomCook_Create,
+    RIToomCook_Destroy,
+    RIToomCook_Reset,
+    RIToomCook_SetCoefficients,
+    RIToomCook_Convolve,
+    RIToomCook_ConvolveStrided,
+    RIToomCook_GetLatencyNumSamples,
+    RIToomCook_GetStatistics,
+};
+
+/* インターフェース取得 */
+const struct RIConvolveInterface* RIToomCook_GetInterface(void)
+{
+    return &st_toom_cook_convolve_if;
+}
+
+/* ワークサイズ計算 */
+static int64_t RIToomCook_CalculateWorkSize(const struct RIConvolveConfig* config)
+{
+    int64_t work_size;
+    uint32_t max_num_block_samples, max_num_input_samples;
+
+    if (config == NULL) {
+        return -1;
+    }
+
+    /* 最大処理サンプル単位 */
+    max_num_block_samples = MAX(config->max_num_coefficients, config->max_num_input_samples);
+    max_num_block_samples = MAX(max_num_block_samples, 1);
+    max_num_input_samples = MAX(config->max_num_input_samples, 1);
+
+    work_size = (int64_t)(sizeof(struct RIToomCook) + RITOOMCOOK_ALIGNMENT);
+
+    /* 係数2 + 入力バッファ1 + 出力バッファ2 + 畳み込み結果2 */
+    work_size = RICONVOLVE_ADD_WORK_SIZE(work_size,
+            RICONVOLVE_MUL_WORK_SIZE(RICONVOLVE_ARRAY_WORK_SIZE(sizeof(float), max_num_block_samples, RITOOMCOOK_ALIGNMENT), 7));
+
+    /* 計算用ワークバッファ */
+    work_size = RICONVOLVE_ADD_WORK_SIZE(work_size,
+            RICONVOLVE_ARRAY_WORK_SIZE(sizeof(float), RIToomCook_CalculateToom3WorkSize(max_num_block_samples), RITOOMCOOK_ALIGNMENT));
+
+    /* 係数の評価値の木（最大入力サンプル数の分割毎） */
+    work_size = RICONVOLVE_ADD_WORK_SIZE(work_size,
+            RICONVOLVE_ARRAY_WORK_SIZE(sizeof(float),
+                RICONVOLVE_MUL_WORK_SIZE(RIToomCook_CalculateEvaluationTreeSize(max_num_input_samples, RITOOMCOOK_NUM_EVALUATION_LEVELS),
+                    RIToomCook_CalculateNumSegments(config->max_num_coefficients, max_num_input_samples)), RITOOMCOOK_ALIGNMENT));
+
+    return work_size;
+}
+
+/* インスタンス生成 */
+static void* RIToomCook_Create(const struct RIConvolveConfig *config, void *work, int64_t work_size)
+{
+    uint8_t *work_ptr = (uint8_t *)work;
+    struct RIToomCook *conv;
+    uint32_t max_num_block_samples;
+    int64_t required_size;
+    uint32_t num_segments;
+
+    /* 引数チェック */
+    if ((work == NULL) || (config == NULL)) {
+        return NULL;
+    }
+
+    if (((required_size = RIToomCook_CalculateWorkSize(config)) < 0)
+            || (work_size < required_size)) {
+        return NULL;
+    }
+
+    /* 最大処理サンプル単位 */
+    max_num_block_samples = MAX(config->max_num_coefficients, config->max_num_input_samples);
+    max_num_block_samples = MAX(max_num_block_samples, 1);
+
+    /* 構造体を配置 */
+    work_ptr = (uint8_t *)ROUNDUP((uintptr_t)work_ptr, RITOOMCOOK_ALIGNMENT);
+    conv = (struct RIToomCook *)work_ptr;
+    conv->num_coefficients = 0;
+    conv->max_num_coefficients = max_num_block_samples;
+    conv->max_num_input_samples = MAX(config->max_num_input_samples, 1);
+    conv->evaluation_size = RIToomCook_CalculateEvaluationTreeSize(conv->max_num_input_samples, RITOOMCOOK_NUM_EVALUATION_LEVELS);
+    work_ptr += sizeof(struct RIToomCook);
+
+    /* 係数領域の割り当て */
+    work_ptr = (uint8_t *)ROUNDUP((uintptr_t)work_ptr, RITOOMCOOK_ALIGNMENT);
+    conv->coefficients = (float *)work_ptr;
+    memset(conv->coefficients, 0, 2 * sizeof(float) * max_num_block_samples);
+    work_ptr += 2 * sizeof(float) * max_num_block_samples;
+
+    /* 入力バッファの割り当て */
+    work_ptr = (uint8_t *)ROUNDUP((uintptr_t)work_ptr, RITOOMCOOK_ALIGNMENT);
+    conv->input_buffer = (float *)work_ptr;
+    work_ptr += sizeof(float) * max_num_block_samples;
+
+    /* 出力バッファの割り当て */
+    work_ptr = (uint8_t *)ROUNDUP((uintptr_t)work_ptr, RITOOMCOOK_ALIGNMENT);
+    conv->output_buffer = (float *)work_ptr;
+    work_ptr += 2 * sizeof(float) * max_num_block_samples;
+
+    /* 畳み込み結果バッファの割り当て */
+    work_ptr = (uint8_t *)ROUNDUP((uintptr_t)work_ptr, RITOOMCOOK_ALIGNMENT);
+    conv->product_buffer = (float *)work_ptr;
+    work_ptr += 2 * sizeof(float) * max_num_block_samples;
+
+    /* 計算用ワークバッファの割り当て */
+    work_ptr = (uint8_t *)ROUNDUP((uintptr_t)work_ptr, RITOOMCOOK_ALIGNMENT);
+    conv->work_buffer = (float *)work_ptr;
+    work_ptr += sizeof(float) * RIToomCook_CalculateToom3WorkSize(max_num_block_samples);
+
+    /* 係数の評価値の木の割り当て */
+    num_segments = RIToomCook_CalculateNumSegments(config->max_num_coefficients, conv->max_num_input_samples);
+    work_ptr = (uint8_t *)ROUNDUP((uintptr_t)work_ptr, RITOOMCOOK_ALIGNMENT);
+    conv->coefficients_evaluation = (float *)work_ptr;
+    memset(conv->coefficients_evaluation, 0, sizeof(float) * conv->evaluation_size * num_segments);
+    work_ptr += sizeof(float) * conv->evaluation_size * num_segments;
+
+    /* バッファをリセット */
+    RIToomCook_Reset(conv);
+
+#if defined(RICONVOLVE_ENABLE_STATISTICS)
+    RIConvolveStatistics_Initialize(&conv->statistics);
+#endif
+
+    return conv;
+}
+
+/* インスタンス破棄 */
+static void RIToomCook_Destroy(void *obj)
+{
+    /* 特に何もしない */
+    if (obj != NULL) {
+        return;
+    }
+}
+
+/* 係数セット */
+static void RIToomCook_SetCoefficients(void *obj, const float *coefficients, uint32_t num_coefficients)
+{
+    uint32_t seg, num_segments;
+    struct RIToomCook* conv = (struct RIToomCook *)obj;
+
+    /* 引数チェック */
+    assert(obj != NULL);
+
+    /* 係数サイズチェック */
+    assert(num_coefficients <= conv->max_num_coefficients);
+
+    /* 係数をコピーし、末尾は0埋め */
+    memcpy(conv->coefficients, coefficients, sizeof(float) * num_coefficients);
+    memset(&conv->coefficients[num_coefficients], 0,
+            sizeof(float) * (2 * conv->max_num_coefficients - num_coefficients));
+    conv->num_coefficients = num_coefficients;
+
+    /* 最大入力サンプル数で処理する場合の分割毎の評価値を事前計算 */
+    num_segments = RIToomCook_CalculateNumSegments(num_coefficients, conv->max_num_input_samples);
+    for (seg = 0; seg < num_segments; seg++) {
+        RIToomCook_MakeEvaluationTree(&conv->coefficients[seg * conv->max_num_input_samples],
+                &conv->coefficients_evaluation[seg * conv->evaluation_size],
+                conv->max_num_input_samples, RITOOMCOOK_NUM_EVALUATION_LEVELS);
+    }
+
+    /* 内部バッファリセット */
+    RIToomCook_Reset(obj);
+}
+
+/* 畳み込み計算 */
+static void RIToomCook_Convolve(void *obj, const float *input, float *output, uint32_t num_samples)
+{
+    RIToomCook_ConvolveStrided(obj, input, 1, output, 1, num_samples);
+}
+
+/* 要素間隔を指定した畳み込み計算 */
+static void RIToomCook_ConvolveStrided(void *obj,
+        const float *input, uint32_t input_stride, float *output, uint32_t output_stride, uint32_t num_samples)
+{
+    uint32_t smpl, seg, num_segments, tail_end;
+    uint8_t has_evaluation;
+    struct RIToomCook* conv = (struct RIToomCook *)obj;
+#if defined(RICONVOLVE_ENABLE_STATISTICS)
+    const uint64_t start_ticks = RIConvolveStatistics_GetTicks();
+#endif
+
+    /* 引数チェック */
+    assert((obj != NULL) && (input != NULL) && (output != NULL));
+    assert((input_stride > 0) && (output_stride > 0));
+    assert(num_samples <= conv->max_num_coefficients);
+
+    if (num_samples == 0) {
+        return;
+    }
+
+    /* 入力バッファにデータを入力 */
+    RIToomCook_CopyFromStrided(conv->input_buffer, input, input_stride, num_samples);
+
+    /* 出力の有効な末尾 */
+    tail_end = conv->num_coefficients + num_samples;
+
+    /* 係数を入力サンプル数で分割し、分割毎に畳み込んで重畳加算 */
+    /* 入力が係数より長い場合は係数を0埋めして1回で畳み込む */
+    /* 2の冪乗への切り上げは行わないため、端数のある長さでも計算量は長さに応じて増える */
+    /* 最大入力サンプル数での呼び出しでは事前計算した係数の評価値を使う */
+    has_evaluation = (uint8_t)(num_samples == conv->max_num_input_samples);
+    num_segments = RIToomCook_CalculateNumSegments(conv->num_coefficients, num_samples);
+    for (seg = 0; seg < num_segments; seg++) {
+        const uint32_t offset = seg * num_samples;
+        const uint32_t num_add = MIN(2 * num_samples, tail_end - offset);
+        RIToomCook_ConvolveToom3(conv->input_buffer, &conv->coefficients[offset],
+                has_evaluation ? &conv->coefficients_evaluation[seg * conv->evaluation_size] : NULL,
+                has_evaluation ? RITOOMCOOK_NUM_EVALUATION_LEVELS : 0,
+                conv->product_buffer, conv->work_buffer, num_samples);
+        for (smpl = 0; smpl < num_add; smpl++) {
+            conv->output_buffer[offset + smpl] += conv->product_buffer[smpl];
+        }
+    }
+
+    /* 先頭のnum_samplesを出力 */
+    RIToomCook_CopyToStrided(output, output_stride, conv->output_buffer, num_samples);
+
+    /* 次回処理のために余り（FIRフィルタの遅延）分出力バッファを前に詰める */
+    memmove(conv->output_buffer, &conv->output_buffer[num_samples], sizeof(float) * (tail_end - num_samples));
+    /* 係数長以降に有効な余りは無いため0埋め */
+    for (smpl = tail_end - num_samples; smpl < tail_end; smpl++) {
+        conv->output_buffer[smpl] = 0.0f;
+    }
+
+#if defined(RICONVOLVE_ENABLE_STATISTICS)
+    /* 統計情報の更新 */
+    RIConvolveStatistics_RecordCall(&conv->statistics, num_samples, RIConvolveStatistics_GetTicks() - start_ticks);
+    RIConvolveStatistics_Publish(&conv->statistics);
+#endif
+}
+
+/* 内部状態リセット */
+static void RIToomCook_Reset(void *obj)
+{
+    struct RIToomCook *conv = (struct RIToomCook *)obj;
+
+    /* 入力バッファのクリア */
+    memset(conv->input_buffer, 0, sizeof(float) * conv->max_num_coefficients);
+
+    /* 出力バッファのクリア */
+    memset(conv->output_buffer, 0, 2 * sizeof(float) * conv->max_num_coefficients);
+}
+
+/* レイテンシーの取得 */
+static int32_t RIToomCook_GetLatencyNumSamples(void *obj)
+{
+    /* レイテンシー0 */
+    (void)obj;
+    return 0;
+}
+
+/* 統計情報の取得 */
+static uint8_t RIToomCook_GetStatistics(void *obj, struct RIConvolveStatistics *statistics)
+{
+#if defined(RICONVOLVE_ENABLE_STATISTICS)
+    const struct RIToomCook *conv = (const struct RIToomCook *)obj;
+
+    /* 引数チェック */
+    assert((obj != NULL) && (statistics != NULL));
+
+    RIConvolveStatistics_Snapshot(&conv->statistics, statistics);
+
+    return 1;
+#else
+    (void)obj;
+    (void)statistics;
+    return 0;
+#endif
+}
+
+/* 素朴な直線畳込み */
+/* z = a * b zはサイズ2n */
+static void RIToomCook_ConvolveNaive(const float *a, const float *b, float *z, uint32_t n)
+{
+    uint32_t i, j;
+
+    /* 初期化 */
+    for (i = 0; i < (n << 1); i++) {
+        z[i] = 0.0f;
+    }
+
+    /* 畳み込み: 乗数の1要素を被乗数全体に掛けて足し込む */
+    for (j = 0; j < n; j++) {
+        const float c = b[j];
+        float *zj = &z[j];
+        i = 0;
+#if defined(RITOOMCOOK_USE_AVX512)
+        {
+            const __m512 c16 = _mm512_set1_ps(c);
+            for (; i + 16 <= n; i += 16) {
+                _mm512_storeu_ps(&zj[i], _mm512_fmadd_ps(c16, _mm512_loadu_ps(&a[i]), _mm512_loadu_ps(&zj[i])));
+            }
+        }
+#endif
+#if defined(RITOOMCOOK_USE_AVX512) || defined(RITOOMCOOK_USE_AVX2)
+        {
+            const __m256 c8 = _mm256_set1_ps(c);
+            for (; i + 8 <= n; i += 8) {
+                _mm256_storeu_ps(&zj[i], _mm256_fmadd_ps(c8, _mm256_loadu_ps(&a[i]), _mm256_loadu_ps(&zj[i])));
+            }
+        }
+#endif
+        /* 端数 */
+        for (; i < n; i++) {
+            zj[i] += a[i] * c;
+        }
+    }
+}
+
+/* Toom-Cook 3分割法の計算用ワークバッファサイズ(float要素数)計算 */
+static uint32_t RIToomCook_CalculateToom3WorkSize(uint32_t n)
+{
+    const uint32_t k = (n + 2) / 3;
+
+    /* 素朴な畳込みではワークバッファを使わない */
+    if (n <= RITOOMCOOK_BASE_CASE_SIZE) {
+        return 0;
+    }
+
+    /* 評価値(a, bそれぞれ4k) + 評価点での積(4 * 2k) + 下位階層 */
+    return 16 * k + RIToomCook_CalculateToom3WorkSize(k);
+}
+
+/* 係数をサイズnで分割したときの分割数(1以上) */
+static uint32_t RIToomCook_CalculateNumSegments(uint32_t num_coefficients, uint32_t n)
+{
+    assert(n > 0);
+    return MAX((uint32_t)(((uint64_t)num_coefficients + n - 1) / n), 1);
+}
+
+/* 評価値の木のサイズ(float要素数)計算 */
+static uint32_t RIToomCook_CalculateEvaluationTreeSize(uint32_t n, uint32_t num_levels)
+{
+    const uint32_t k = (n + 2) / 3;
+
+    /* 素朴な畳込みでは評価値を使わない */
+    if ((n <= RITOOMCOOK_BASE_CASE_SIZE) || (num_levels == 0)) {
+        return 0;
+    }
+
+    /* 評価値(4k) + 各評価点(0, 1, -1, -2, ∞)の下位階層 */
+    return 4 * k + 5 * RIToomCook_CalculateEvaluationTreeSize(k, num_levels - 1);
+}
+
+/* 1, -1, -2, ∞ の4点での評価値を計算 */
+static void RIToomCook_EvaluateToom3(const float *x, float *p1, float *pm1, float *pm2, float *pinf, uint32_t n)
+{
+    uint32_t i;
+    const uint32_t k = (n + 2) / 3;
+    const uint32_t r = n - 2 * k;
+    const float *x0 = &x[0];
+    const float *x1 = &x[k];
+    const float *x2 = &x[2 * k];
+
+    /* 上位の分割を0埋めしてサイズkに揃える */
+    for (i = 0; i < r; i++) {
+        pinf[i] = x2[i];
+    }
+    for (; i < k; i++) {
+        pinf[i] = 0.0f;
+    }
+
+    /* 評価 */
+    for (i = 0; i < k; i++) {
+        const float s = x0[i] + pinf[i];
+        p1[i]  = s + x1[i];
+        pm1[i] = s - x1[i];
+        pm2[i] = 2.0f * (pm1[i] + pinf[i]) - x0[i];
+    }
+}
+
+/* 評価値の木を作成 */
+/* 木の構成: [b(1), b(-1), b(-2), b(∞)] [b0の木] [b(1)の木] [b(-1)の木] [b(-2)の木] [b(∞)の木] */
+static void RIToomCook_MakeEvaluationTree(const float *b, float *tree, uint32_t n, uint32_t num_levels)
+{
+    uint32_t i, sub_size;
+    const uint32_t k = (n + 2) / 3;
+    float *subtree;
+
+    if ((n <= RITOOMCOOK_BASE_CASE_SIZE) || (num_levels == 0)) {
+        return;
+    }
+
+    RIToomCook_EvaluateToom3(b, &tree[0], &tree[k], &tree[2 * k], &tree[3 * k], n);
+
+    sub_size = RIToomCook_CalculateEvaluationTreeSize(k, num_levels - 1);
+    subtree = &tree[4 * k];
+    RIToomCook_MakeEvaluationTree(b, subtree, k, num_levels - 1);
+    for (i = 0; i < 4; i++) {
+        RIToomCook_MakeEvaluationTree(&tree[i * k], &subtree[(i + 1) * sub_size], k, num_levels - 1);
+    }
+}
+
+/* Toom-Cook 3分割法による畳込み */
+/* a = a2 * R^2 + a1 * R + a0 (R = x^k) とみなし、0, 1, -1, -2, ∞ の5点での値の積から補間する */
+static void RIToomCook_ConvolveToom3(const float *a, const float *b, const float *btree, uint32_t num_levels,
+        float *z, float *work, uint32_t n)
+{
+    uint32_t i, sub_size = 0;
+    const uint32_t k = (n + 2) / 3;     /* 分割サイズ                     */
+    const float *a0 = &a[0];            /* 被乗数/下位の分割              */
+    const float *b0 = &b[0];            /* 乗数  /下位の分割              */
+    float *pa1  = &work[k * 0];         /* a(1)                           */
+    float *pam1 = &work[k * 1];         /* a(-1)                          */
+    float *pam2 = &work[k * 2];         /* a(-2)                          */
+    float *pa2  = &work[k * 3];         /* a(∞) (= a2 を0埋めしたもの)    */
+    const float *pb1, *pbm1, *pbm2, *pb2; /* b(1), b(-1), b(-2), b(∞)     */
+    const float *subtree = NULL;        /* 下位階層の評価値の木           */
+    float *r1   = &work[k * 8];         /* r(1)  = a(1) * b(1)            */
+    float *rm1  = &work[k * 10];        /* r(-1) = a(-1) * b(-1)          */
+    float *rm2  = &work[k * 12];        /* r(-2) = a(-2) * b(-2)          */
+    float *rinf = &work[k * 14];        /* r(∞) = a2 * b2                 */
+    float *sub_work = &work[k * 16];    /* 下位階層のワーク               */
+
+    /* 切り替えサイズ以下の場合は通常の畳込みを行う */
+    if (n <= RITOOMCOOK_BASE_CASE_SIZE) {
+        RIToomCook_ConvolveNaive(a, b, z, n);
+        return;
+    }
+
+    /* 評価 係数側は木があればそれを使う */
+    RIToomCook_EvaluateToom3(a, pa1, pam1, pam2, pa2, n);
+    if (num_levels > 0) {
+        pb1  = &btree[k * 0];
+        pbm1 = &btree[k * 1];
+        pbm2 = &btree[k * 2];
+        pb2  = &btree[k * 3];
+        num_levels--;
+        sub_size = RIToomCook_CalculateEvaluationTreeSize(k, num_levels);
+        subtree = (num_levels > 0) ? &btree[k * 4] : NULL;
+    } else {
+        RIToomCook_EvaluateToom3(b, &work[k * 4], &work[k * 5], &work[k * 6], &work[k * 7], n);
+        pb1  = &work[k * 4];
+        pbm1 = &work[k * 5];
+        pbm2 = &work[k * 6];
+        pb2  = &work[k * 7];
+    }
+
+    /* 各評価点での積 r(0)はzの先頭に直接置く */
+    RIToomCook_ConvolveToom3(a0,   b0,   (subtree != NULL) ? &subtree[0 * sub_size] : NULL, num_levels, z,    sub_work, k);
+    RIToomCook_ConvolveToom3(pa1,  pb1,  (subtree != NULL) ? &subtree[1 * sub_size] : NULL, num_levels, r1,   sub_work, k);
+    RIToomCook_ConvolveToom3(pam1, pbm1, (subtree != NULL) ? &subtree[2 * sub_size] : NULL, num_levels, rm1,  sub_work, k);
+    RIToomCook_ConvolveToom3(pam2, pbm2, (subtree != NULL) ? &subtree[3 * sub_size] : NULL, num_levels, rm2,  sub_work, k);
+    RIToomCook_ConvolveToom3(pa2,  pb2,  (subtree != NULL) ? &subtree[4 * sub_size] : NULL, num_levels, rinf, sub_work, k);
+
+    /* 補間（Bodrato の手順） */
+    /* r(-2) <- r3, r(1) <- r1, r(-1) <- r2 に置き換えていく */
+    for (i = 0; i < 2 * k; i++) {
+        float t1, t2, t3;
+        t3 = (rm2[i] - r1[i]) / 3.0f;
+        t1 = 0.5f * (r1[i] - rm1[i]);
+        t2 = rm1[i] - z[i];
+        t3 = 0.5f * (t2 - t3) + 2.0f * rinf[i];
+        t2 = t2 + t1 - rinf[i];
+        t1 = t1 - t3;
+        r1[i] = t1;
+        rm1[i] = t2;
+        rm2[i] = t3;
+    }
+
+    /* z = r0 + r1 * R + r2 * R^2 + r3 * R^3 + r4 * R^4 */
+    /* r(0)より上位は0クリアしてから足し込む. 2nを超える部分は理論上0なので捨てる */
+    for (i = 2 * k; i < 2 * n; i++) {
+        z[i] = 0.0f;
+    }
+    for (i = 0; i < 2 * k; i++) {
+        z[k + i] += r1[i];
+    }
+    for (i = 0; i < MIN(2 * k, 2 * n - 2 * k); i++) {
+        z[2 * k + i] += rm1[i];
+    }
+    for (i = 0; i < MIN(2 * k, 2 * n - 3 * k); i++) {
+        z[3 * k + i] += rm2[i];
+    }
+    for (i = 0; i < 2 * n - 4 * k; i++) {
+        z[4 * k + i] += rinf[i];
+    }
+}
+
+/* 要素間隔strideのsrcを連続領域dstにコピー */
+static void RIToomCook_CopyFromStrided(float *dst, const float *src, uint32_t stride, uint32_t num_samples)
+{
+    uint32_t smpl;
+
+    if (stride == 1) {
+        memcpy(dst, src, sizeof(float) * num_samples);
+        return;
+    }
+
+    for (smpl = 0; smpl < num_samples; smpl++) {
+        dst[smpl] = src[(size_t)smpl * stride];
+    }
+}
+
+/* 連続領域srcを要素間隔strideのdstにコピー */
+static void RIToomCook_CopyToStrided(float *dst, uint32_t stride, const float *src, uint32_t num_samples)
+{
+    uint32_t smpl;
+
+    if (stride == 1) {
+        memcpy(dst, src, sizeof(float) * num_samples);
+        return;
+    }
+
+    for (smpl = 0; smpl < num_samples; smpl++) {
+        dst[(size_t)smpl * stride] = src[smpl];
+    }
+}
@@ -4,16 +4,51 @@
 #include <string.h>
 #include <math.h>
 #include <stdint.h>
+#if defined(_WIN32)
+#include <windows.h>
+#include <intrin.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#if defined(__APPLE__)
+#include <dispatch/dispatch.h>
+#else
+#include <semaphore.h>
+#include <errno.h>
+#endif
+#endif
 
 #include "ri_ring_buffer.h"
 #include "ri_convolve.h"
 #include "ri_karatsuba.h"
+#include "ri_direct_fir.h"
 #include "ri_fft_convolve.h"
+#include "ri_convolve_statistics.h"
 
 /* メモリアラインメント */
 #define RIBARACONVOLVE_ALIGNMENT 16
-/* 時間領域畳み込みの係数長 */
-#define RIBARACONVOLVE_NUM_TIMEDOMAIN_COEFFICIENTS 1024
+/* FFT分割サイズの既定値 */
+#define RIBARACONVOLVE_DEFAULT_PARTITION_SIZE 1024
+/* 計測で選ぶFFT分割サイズの最小値 */
+#define RIBARACONVOLVE_MIN_PARTITION_SIZE 64
+/* 計測で選ぶFFT分割サイズの最大値 */
+#define RIBARACONVOLVE_MAX_PARTITION_SIZE 2048
+/* 段毎の分割サイズの倍率 */
+#define RIBARACONVOLVE_STAGE_PARTITION_RATIO 4
+/* 後段の分割サイズの上限 */
+#define RIBARACONVOLVE_MAX_STAGE_PARTITION_SIZE 8192
+/* ワーカースレッドの処理完了をCPUを譲らずに待つ回数 */
+#define RIBARACONVOLVE_WORKER_SPIN_COUNT 1024
+/* 先読みした出力が足りないときにワーカースレッドの処理完了を待つ間、CPUを譲る最大回数 */
+#define RIBARACONVOLVE_WORKER_MAX_NUM_YIELDS 64
+/* ワーカースレッドの処理完了を終わるまで待つ指定 */
+#define RIBARACONVOLVE_WORKER_WAIT_INFINITE UINT32_MAX
+/* ワーカースレッドへの依頼に積める入力のブロック数（先読みの2ブロックを超えて2ブロック遅れるまで入力を失わない） */
+#define RIBARACONVOLVE_WORKER_INPUT_NUM_BLOCKS 4
+/* FFT畳み込みの最大段数 */
+#define RIBARACONVOLVE_MAX_NUM_STAGES 8
+/* 直接型FIRで畳み込む係数長 */
+#define RIBARACONVOLVE_NUM_DIRECTFIR_COEFFICIENTS 128
 /* 最小値の取得 */
 #define MIN(a, b) (((a) < (b)) ? (a) : (b))
 /* 最大値の取得 */
@@ -21,21 +56,72 @@
 /* nの倍数切り上げ */
 #define ROUNDUP(val, n) ((((val) + ((n) - 1)) / (n)) * (n))
 
+/* FFT畳み込みの段 */
+struct RIZeroLatencyFFTConvolveStage {
+    uint32_t partition_size; /* FFT分割サイズ(=この段のレイテンシ) */
+    uint32_t offset; /* 受け持つ係数の先頭位置 */
+    uint32_t max_num_coefficients; /* 受け持つ最大係数長 */
+    void *conv_obj; /* FFT畳み込みモジュールオブジェクト本体（出力をoffset - partition_size - 先読みサンプル数だけ追加で遅らせる） */
+};
+
 struct RIZeroLatencyFFTConvolve {
     const struct RIConvolveInterface *time_conv_if; /* 時間領域畳み込みモジュールインターフェース	*/
     const struct RIConvolveInterface *freq_conv_if; /* 周波数領域畳み込みモジュールインターフェース */
+    const struct RIConvolveInterface *direct_fir_if; /* 直接型FIRモジュールインターフェース */
+    const struct RIConvolveInterface *head_conv_if; /* 先頭の係数を畳み込むモジュールインターフェース */
     void *time_conv_obj; /* 時間領域畳み込みモジュールオブジェクト本体 */
-    void *freq_conv_obj; /* 時間領域畳み込みモジュールオブジェクト本体 */
-    uint8_t use_freq_conv; /* 周波数畳み込みを行うか？ */
-    struct RIRingBuffer *input_buffer; /* 入力遅延バッファ */			
-    float *output_buffer; /* 出力データバッファ */		
+    void *direct_fir_obj; /* 直接型FIRモジュールオブジェクト本体 */
+    void *head_conv_obj; /* 先頭の係数を畳み込むモジュールオブジェクト本体 */
+    void *time_conv_work; /* 時間領域畳み込みモジュールのワーク領域 */
+    int64_t time_conv_work_size; /* 時間領域畳み込みモジュールのワークサイズ */
+    void *stage_work; /* FFT畳み込み段のワーク領域 */
+    int64_t stage_work_size; /* FFT畳み込み段のワークサイズ */
+    struct RIZeroLatencyFFTConvolveStage stages[RIBARACONVOLVE_MAX_NUM_STAGES]; /* FFT畳み込み段 */
+    uint32_t num_stages; /* FFT畳み込みの段数 */
+    uint32_t num_active_stages; /* セットした係数で使用する段数 */
+    float *output_buffer; /* 出力データバッファ */
+    float *calibration_buffer; /* 分割サイズ計測用の入出力バッファ（分割サイズ未指定時のみ） */
     uint32_t max_num_input_samples; /* 最大入力サンプル数 */
+    uint32_t max_num_coefficients; /* 最大係数長 */
+    uint32_t partition_size; /* 初段のFFT分割サイズ */
+    uint32_t num_head_coefficients; /* 時間領域で畳み込む先頭係数長 */
+    uint32_t config_num_head_coefficients; /* 指定された先頭係数長（0のときは分割サイズに一致させる） */
+    uint32_t min_partition_size; /* 分割サイズの候補の最小値 */
+    uint32_t max_partition_size; /* 分割サイズの候補の最大値 */
+    uint8_t use_worker_thread; /* FFT畳み込み段をワーカースレッドで処理するか？ */
+    uint32_t num_lookahead_samples; /* FFT畳み込み段の先読みサンプル数（ワーカースレッド使用時は最大入力サンプル数の2倍） */
+    float *worker_input; /* ワーカースレッドに渡す入力 */
+    uint32_t worker_num_samples; /* ワーカースレッドに渡す入力サンプル数 */
+    uint32_t worker_num_zero_samples; /* ワーカースレッドが入力に続けて処理する無音のサンプル数 */
+    uint32_t worker_num_discard_samples; /* ワーカースレッドが出力の先頭から捨てるサンプル数 */
+    float *pending_input; /* ワーカースレッドが処理中のため次の依頼に回す入力 */
+    uint32_t pending_num_samples; /* 次の依頼に回す入力サンプル数 */
+    uint32_t pending_num_zero_samples; /* 入力を積みきれず無音で代用するサンプル数 */
+    uint32_t num_missing_tail_samples; /* 間に合わず無音で代用した先読み出力のサンプル数（後から届いた分は読み捨てる） */
+    struct RIRingBuffer *tail_buffer; /* 先読みしたFFT畳み込み段の出力バッファ */
+#if defined(_WIN32)
+    HANDLE worker_thread; /* ワーカースレッド */
+    HANDLE worker_wakeup; /* 処理依頼/終了要求の通知（セマフォ） */
+#else
+    pthread_t worker_thread; /* ワーカースレッド */
+#if defined(__APPLE__)
+    dispatch_semaphore_t worker_wakeup; /* 処理依頼/終了要求の通知 */
+#else
+    sem_t worker_wakeup; /* 処理依頼/終了要求の通知 */
+#endif
+#endif
+    uint8_t worker_running; /* ワーカースレッドが動作中か？ */
+    uint32_t worker_job_pending; /* ワーカースレッドが処理中か？ 両スレッドからアトミックに読み書きする */
+    uint32_t worker_quit; /* ワーカースレッドの終了要求 アトミックに読み書きする */
+#if defined(RICONVOLVE_ENABLE_STATISTICS)
+    struct RIConvolveStatisticsCounter statistics; /* 統計情報（FFT畳み込み段の分は取得時に加える） */
+#endif
 };
 
 /* ワークサイズ取得 */
-static int32_t RIZeroLatencyFFTConvolve_CalculateWorkSize(const struct RIConvolveConfig *config);
+static int64_t RIZeroLatencyFFTConvolve_CalculateWorkSize(const struct RIConvolveConfig *config);
 /* インスタンス生成 */
-static void* RIZeroLatencyFFTConvolve_Create(const struct RIConvolveConfig *config, void *work, int32_t work_size);
+static void* RIZeroLatencyFFTConvolve_Create(const struct RIConvolveConfig *config, void *work, int64_t work_size);
 /* インスタンス破棄 */
 static void	RIZeroLatencyFFTConvolve_Destroy(void *obj);
 /* 内部状態リセット */
@@ -44,9 +130,73 @@ static void	RIZeroLatencyFFTConvolve_Reset(void *obj);
 static void	RIZeroLatencyFFTConvolve_SetCoefficients(void *obj, const float *coefficients, uint32_t num_coefficients);
 /* 畳み込み */
 static void	RIZeroLatencyFFTConvolve_Convolve(void *obj, const float *input, float *output, uint32_t num_samples);
+/* 要素間隔を指定した畳み込み計算 */
+static void RIZeroLatencyFFTConvolve_ConvolveStrided(void *obj,
+        const float *input, uint32_t input_stride, float *output, uint32_t output_stride, uint32_t num_samples);
 /* レイテンシ取得 */
 static int32_t RIZeroLatencyFFTConvolve_GetLatencyNumSamples(void *obj);
+/* 統計情報の取得 */
+static uint8_t RIZeroLatencyFFTConvolve_GetStatistics(void *obj, struct RIConvolveStatistics *statistics);
+
+/* 引数を2の冪乗に切り上げる */
+static uint32_t RIZeroLatencyFFTConvolve_Roundup2PoweredValue(uint32_t val);
+/* FFT畳み込み段の先読みサンプル数を取得 */
+static uint32_t RIZeroLatencyFFTConvolve_GetNumLookaheadSamples(const struct RIConvolveConfig *config);
+/* 分割サイズの候補範囲を取得 */
+static void RIZeroLatencyFFTConvolve_GetPartitionSizeRange(
+        const struct RIConvolveConfig *config, uint32_t *min_partition_size, uint32_t *max_partition_size);
+/* 段構成の計算 段数を返す
+* 各段は前段の末尾から、次段の分割サイズ(=次段のレイテンシ)と先読みサンプル数の和以上の位置まで自段の分割サイズ単位で受け持つ */
+static uint32_t RIZeroLatencyFFTConvolve_CalculateStages(uint32_t partition_size, uint32_t num_head_coefficients,
+        uint32_t max_num_coefficients, uint32_t num_lookahead_samples, struct RIZeroLatencyFFTConvolveStage *stages);
+/* 全段のワークサイズ計算 */
+static int64_t RIZeroLatencyFFTConvolve_CalculateStagesWorkSize(uint32_t partition_size, uint32_t num_head_coefficients,
+        uint32_t max_num_coefficients, uint32_t max_num_input_samples, uint32_t num_lookahead_samples);
+/* 畳み込み計算本体（統計情報は更新しない） FFT畳み込み段の出力が間に合わなかった場合は1を返す */
+static uint8_t RIZeroLatencyFFTConvolve_Process(struct RIZeroLatencyFFTConvolve *conv,
+        const float *input, uint32_t input_stride, float *output, uint32_t output_stride, uint32_t num_samples);
+/* 先読みした出力をoutputに最大num_samples取り出し、取り出したサンプル数を返す outputがNULLなら読み捨てる */
+static uint32_t RIZeroLatencyFFTConvolve_GetTailSamples(struct RIZeroLatencyFFTConvolve *conv, float *output, uint32_t num_samples);
+/* 入力を次のワーカースレッドへの依頼に積む */
+static void RIZeroLatencyFFTConvolve_QueueWorkerInput(struct RIZeroLatencyFFTConvolve *conv,
+        const float *input, uint32_t input_stride, uint32_t num_samples);
+/* 積んだ入力の処理をワーカースレッドに依頼 ワーカースレッドが空いていることを確認してから呼ぶこと */
+static void RIZeroLatencyFFTConvolve_SubmitWorkerJob(struct RIZeroLatencyFFTConvolve *conv);
+/* 全段の畳み込み結果をoutputに足し込む */
+static void RIZeroLatencyFFTConvolve_ConvolveStages(struct RIZeroLatencyFFTConvolve *conv,
+        const float *input, uint32_t input_stride, float *output, uint32_t output_stride, uint32_t num_samples);
+/* 分割サイズに合わせて時間領域畳み込みモジュールとFFT畳み込み段を作り直す */
+static void RIZeroLatencyFFTConvolve_SetupModules(struct RIZeroLatencyFFTConvolve *conv, uint32_t partition_size);
+#if defined(RICONVOLVE_ENABLE_STATISTICS)
+/* FFT畳み込み段のFFT回数と分割毎の複素乗算/加算回数をstatisticsに加える */
+static void RIZeroLatencyFFTConvolve_AddStageStatistics(
+        const struct RIZeroLatencyFFTConvolve *conv, struct RIConvolveStatistics *statistics);
+#endif
+/* 現在の段構成で係数を振り分けてセット */
+static void RIZeroLatencyFFTConvolve_ApplyCoefficients(
+        struct RIZeroLatencyFFTConvolve *conv, const float *coefficients, uint32_t num_coefficients);
+/* 処理時間を計測して最速の分割サイズを選ぶ */
+static uint32_t RIZeroLatencyFFTConvolve_MeasureBestPartitionSize(
+        struct RIZeroLatencyFFTConvolve *conv, const float *coefficients, uint32_t num_coefficients);
+/* ワーカースレッドに依頼する処理: 入力をFFT畳み込み段で処理して出力バッファに追記 */
+static void RIZeroLatencyFFTConvolve_ProcessWorkerJob(struct RIZeroLatencyFFTConvolve *conv);
+/* ワーカースレッドの開始 開始できなければ呼び出し元スレッドで処理する */
+static void RIZeroLatencyFFTConvolve_StartWorker(struct RIZeroLatencyFFTConvolve *conv);
+/* ワーカースレッドの終了 */
+static void RIZeroLatencyFFTConvolve_StopWorker(struct RIZeroLatencyFFTConvolve *conv);
+/* ワーカースレッドへの処理依頼 */
+static void RIZeroLatencyFFTConvolve_KickWorker(struct RIZeroLatencyFFTConvolve *conv);
+/* ワーカースレッドの処理完了待ち */
+static uint8_t RIZeroLatencyFFTConvolve_WaitWorker(struct RIZeroLatencyFFTConvolve *conv, uint32_t max_num_yields);
+/* ワーカースレッドを起こす */
+static void RIZeroLatencyFFTConvolve_WakeupWorker(struct RIZeroLatencyFFTConvolve *conv);
+/* フラグの読み出し(acquire) */
+static uint32_t RIZeroLatencyFFTConvolve_LoadAcquire(const uint32_t *flag);
+/* フラグの書き込み(release) */
+static void RIZeroLatencyFFTConvolve_StoreRelease(uint32_t *flag, uint32_t value);
 
+/* 要素間隔strideのsrcを連続領域dstにコピー */
+static void RIZeroLatencyFFTConvolve_CopyFromStrided(float *dst, const float *src, uint32_t stride, uint32_t num_samples);
 /* インターフェース */
 static const struct RIConvolveInterface st_ribara_convolve_if = {
     RIZeroLatencyFFTConvolve_CalculateWorkSize,
@@ -55,7 +205,9 @@ static const struct RIConvolveInterface st_ribara_convolve_if = {
     RIZeroLatencyFFTConvolve_Reset,
     RIZeroLatencyFFTConvolve_SetCoefficients,
     RIZeroLatencyFFTConvolve_Convolve,
+    RIZeroLatencyFFTConvolve_ConvolveStrided,
     RIZeroLatencyFFTConvolve_GetLatencyNumSamples,
+    RIZeroLatencyFFTConvolve_GetStatistics,
 };
 
 /* インターフェース取得 */
@@ -65,60 +217,118 @@ const struct RIConvolveInterface* RIZeroLatencyFFTConvolve_GetInterface(void)
 }
 
 /* ワークサイズ計算 */
-static int32_t RIZeroLatencyFFTConvolve_CalculateWorkSize(const struct RIConvolveConfig *config)
+static int64_t RIZeroLatencyFFTConvolve_CalculateWorkSize(const struct RIConvolveConfig *config)
 {
-    int32_t	time_conv_size, freq_conv_size, delay_buffer_size, work_size;
-    struct RIRingBufferConfig buffer_config;
+    int64_t	time_conv_size, direct_fir_size, stage_size, work_size;
+    uint32_t partition_size, min_partition_size, max_partition_size, max_num_head_coefficients, num_lookahead_samples;
     struct RIConvolveConfig conv_config;
     const struct RIConvolveInterface *time_conv_if = RIKaratsuba_GetInterface();
-    const struct RIConvolveInterface *freq_conv_if = RIFFTConvolve_GetInterface();
+    const struct RIConvolveInterface *direct_fir_if = RIDirectFIR_GetInterface();
 
     /* 引数チェック */
     if (config == NULL) {
         return -1;
     }
 
+    /* ワーカースレッドへの依頼に積める入力サンプル数が表せない */
+    if (config->use_worker_thread && (config->max_num_input_samples > (UINT32_MAX / RIBARACONVOLVE_WORKER_INPUT_NUM_BLOCKS))) {
+        return -1;
+    }
+
+    /* 先頭係数長はFFT畳み込みのレイテンシ(=分割サイズ)と先読みサンプル数の和以上必要 */
+    num_lookahead_samples = RIZeroLatencyFFTConvolve_GetNumLookaheadSamples(config);
+    if ((config->num_head_coefficients != 0) && (config->num_head_coefficients <= num_lookahead_samples)) {
+        return -1;
+    }
+    if ((config->fft_partition_size != 0) && (config->num_head_coefficients != 0)
+            && (config->num_head_coefficients < (RIZeroLatencyFFTConvolve_Roundup2PoweredValue(config->fft_partition_size) + num_lookahead_samples))) {
+        return -1;
+    }
+
+    /* 分割サイズの候補範囲 */
+    RIZeroLatencyFFTConvolve_GetPartitionSizeRange(config, &min_partition_size, &max_partition_size);
+    max_num_head_coefficients = (config->num_head_coefficients != 0)
+        ? config->num_head_coefficients : (max_partition_size + num_lookahead_samples);
+
     /* 最大入力サンプル数は共通 */
     conv_config.max_num_input_samples = config->max_num_input_samples;
+    conv_config.fft_partition_size = 0;
+    conv_config.num_head_coefficients = 0;
+    conv_config.num_delay_samples = 0;
+    conv_config.use_worker_thread = 0;
 
     /* 時間領域畳み込みモジュール分 */
-    conv_config.max_num_coefficients = RIBARACONVOLVE_NUM_TIMEDOMAIN_COEFFICIENTS;
+    conv_config.max_num_coefficients = MIN(max_num_head_coefficients, config->max_num_coefficients);
     if ((time_conv_size = time_conv_if->CalculateWorkSize(&conv_config)) < 0) {
         return -1;
     }
 
-    /* 周波数領域畳み込みモジュール分 */
-    conv_config.max_num_coefficients = config->max_num_coefficients;
-    if ((freq_conv_size = freq_conv_if->CalculateWorkSize(&conv_config)) < 0) {
+    /* 直接型FIRモジュール分 */
+    conv_config.max_num_coefficients = RIBARACONVOLVE_NUM_DIRECTFIR_COEFFICIENTS;
+    if ((direct_fir_size = direct_fir_if->CalculateWorkSize(&conv_config)) < 0) {
         return -1;
     }
 
-    /* ディレイバッファ分 */
-    buffer_config.max_size = sizeof(float) * (config->max_num_input_samples + RIBARACONVOLVE_NUM_TIMEDOMAIN_COEFFICIENTS);
-    buffer_config.max_required_size = sizeof(float) * config->max_num_input_samples;
-    delay_buffer_size = RIRingBuffer_CalculateWorkSize(&buffer_config);
+    /* FFT畳み込み段分 候補の中で最大のサイズを確保 */
+    stage_size = 0;
+    for (partition_size = min_partition_size; partition_size <= max_partition_size; partition_size <<= 1) {
+        const uint32_t num_head_coefficients = (config->num_head_coefficients != 0)
+            ? config->num_head_coefficients : (partition_size + num_lookahead_samples);
+        const int64_t tmp_work_size = RIZeroLatencyFFTConvolve_CalculateStagesWorkSize(partition_size,
+                num_head_coefficients, config->max_num_coefficients, config->max_num_input_samples, num_lookahead_samples);
+        if (tmp_work_size < 0) {
+            return -1;
+        }
+        stage_size = MAX(stage_size, tmp_work_size);
+    }
 
-    work_size = sizeof(struct RIZeroLatencyFFTConvolve) + RIBARACONVOLVE_ALIGNMENT;
-    work_size += time_conv_size;
-    work_size += freq_conv_size;
-    work_size += delay_buffer_size;
-    work_size += sizeof(float) * config->max_num_input_samples + RIBARACONVOLVE_ALIGNMENT;
+    work_size = (int64_t)(sizeof(struct RIZeroLatencyFFTConvolve) + RIBARACONVOLVE_ALIGNMENT);
+    work_size = RICONVOLVE_ADD_WORK_SIZE(work_size, time_conv_size);
+    work_size = RICONVOLVE_ADD_WORK_SIZE(work_size, direct_fir_size);
+    work_size = RICONVOLVE_ADD_WORK_SIZE(work_size, stage_size);
+    work_size = RICONVOLVE_ADD_WORK_SIZE(work_size,
+            RICONVOLVE_ARRAY_WORK_SIZE(sizeof(float), config->max_num_input_samples, RIBARACONVOLVE_ALIGNMENT));
+    /* 分割サイズを指定しない場合は計測用の入出力バッファ分 */
+    if (min_partition_size < max_partition_size) {
+        work_size = RICONVOLVE_ADD_WORK_SIZE(work_size,
+                RICONVOLVE_ARRAY_WORK_SIZE(2 * sizeof(float), config->max_num_input_samples, RIBARACONVOLVE_ALIGNMENT));
+    }
+    /* ワーカースレッドを使う場合は受け渡し用・次の依頼に回す入力のバッファと先読みした出力のバッファ分 */
+    if (config->use_worker_thread) {
+        struct RIRingBufferConfig buffer_config;
+        int64_t tail_buffer_size;
+        buffer_config.max_size = sizeof(float) * ((size_t)num_lookahead_samples + config->max_num_input_samples);
+        buffer_config.max_required_size = sizeof(float) * config->max_num_input_samples;
+        buffer_config.enable_spsc = 1;
+        buffer_config.use_mirrored_memory = 0;
+        if ((tail_buffer_size = RIRingBuffer_CalculateWorkSize(&buffer_config)) < 0) {
+            return -1;
+        }
+        work_size = RICONVOLVE_ADD_WORK_SIZE(work_size, tail_buffer_size);
+        work_size = RICONVOLVE_ADD_WORK_SIZE(work_size,
+                RICONVOLVE_MUL_WORK_SIZE(RICONVOLVE_ARRAY_WORK_SIZE(sizeof(float),
+                        (uint64_t)RIBARACONVOLVE_WORKER_INPUT_NUM_BLOCKS * config->max_num_input_samples, RIBARACONVOLVE_ALIGNMENT), 2));
+    }
 
     return work_size;
 }
 
 /* インスタンス生成 */
-static void* RIZeroLatencyFFTConvolve_Create(const struct RIConvolveConfig *config, void *work, int32_t work_size)
+static void* RIZeroLatencyFFTConvolve_Create(const struct RIConvolveConfig *config, void *work, int64_t work_size)
 {
     struct RIZeroLatencyFFTConvolve *conv;
     uint8_t *work_ptr = (uint8_t *)work;
     struct RIConvolveConfig conv_config;
-    struct RIRingBufferConfig buffer_config;
-    int32_t tmp_work_size;
+    int64_t tmp_work_size, required_size;
+    uint32_t partition_size, max_num_head_coefficients;
 
     /* 引数チェック */
-    if ((config == NULL) || (work == NULL)
-            || (work_size < RIZeroLatencyFFTConvolve_CalculateWorkSize(config))) {
+    if ((config == NULL) || (work == NULL)) {
+        return NULL;
+    }
+
+    if (((required_size = RIZeroLatencyFFTConvolve_CalculateWorkSize(config)) < 0)
+            || (work_size < required_size)) {
         return NULL;
     }
 
@@ -128,41 +338,111 @@ static void* RIZeroLatencyFFTConvolve_Create(const struct RIConvolveConfig *conf
     work_ptr = (uint8_t *)ROUNDUP((uintptr_t)work_ptr, RIBARACONVOLVE_ALIGNMENT);
     conv = (struct RIZeroLatencyFFTConvolve *)work_ptr;
     conv->time_conv_if = RIKaratsuba_GetInterface();
+    conv->direct_fir_if = RIDirectFIR_GetInterface();
     conv->freq_conv_if = RIFFTConvolve_GetInterface();
+    conv->time_conv_obj = NULL;
+    conv->num_stages = 0;
+    conv->num_active_stages = 0;
     conv->max_num_input_samples = config->max_num_input_samples;
+    conv->max_num_coefficients = config->max_num_coefficients;
+    conv->config_num_head_coefficients = config->num_head_coefficients;
+    conv->use_worker_thread = config->use_worker_thread;
+    conv->num_lookahead_samples = RIZeroLatencyFFTConvolve_GetNumLookaheadSamples(config);
+    conv->worker_num_samples = 0;
+    conv->worker_num_zero_samples = 0;
+    conv->worker_num_discard_samples = 0;
+    conv->pending_num_samples = 0;
+    conv->pending_num_zero_samples = 0;
+    conv->num_missing_tail_samples = 0;
+    conv->worker_running = 0;
+    conv->worker_job_pending = 0;
+    conv->worker_quit = 0;
+    RIZeroLatencyFFTConvolve_GetPartitionSizeRange(config, &conv->min_partition_size, &conv->max_partition_size);
+    max_num_head_coefficients = (config->num_head_coefficients != 0)
+        ? config->num_head_coefficients : (conv->max_partition_size + conv->num_lookahead_samples);
     work_ptr += sizeof(struct RIZeroLatencyFFTConvolve);
 
     /* 共通のパラメータ設定項目 */
     conv_config.max_num_input_samples = config->max_num_input_samples;
+    conv_config.fft_partition_size = 0;
+    conv_config.num_head_coefficients = 0;
+    conv_config.num_delay_samples = 0;
+    conv_config.use_worker_thread = 0;
 
-    /* 時間領域畳み込みモジュール */
-    conv_config.max_num_coefficients = RIBARACONVOLVE_NUM_TIMEDOMAIN_COEFFICIENTS;
+    /* 時間領域畳み込みモジュールの領域 実体は分割サイズ決定時に作成 */
+    conv_config.max_num_coefficients = MIN(max_num_head_coefficients, config->max_num_coefficients);
     if ((tmp_work_size = conv->time_conv_if->CalculateWorkSize(&conv_config)) < 0) {
         return NULL;
     }
-    conv->time_conv_obj = conv->time_conv_if->Create(&conv_config, work_ptr, tmp_work_size);
+    conv->time_conv_work = work_ptr;
+    conv->time_conv_work_size = tmp_work_size;
     work_ptr += tmp_work_size;
 
-    /* 周波数領域畳み込みモジュール */
-    conv_config.max_num_coefficients = config->max_num_coefficients;
-    if ((tmp_work_size = conv->freq_conv_if->CalculateWorkSize(&conv_config)) < 0) {
+    /* 直接型FIRモジュール */
+    conv_config.max_num_coefficients = RIBARACONVOLVE_NUM_DIRECTFIR_COEFFICIENTS;
+    if ((tmp_work_size = conv->direct_fir_if->CalculateWorkSize(&conv_config)) < 0) {
         return NULL;
     }
-    conv->freq_conv_obj = conv->freq_conv_if->Create(&conv_config, work_ptr, tmp_work_size);
+    conv->direct_fir_obj = conv->direct_fir_if->Create(&conv_config, work_ptr, tmp_work_size);
     work_ptr += tmp_work_size;
 
-    /* ディレイバッファ */
-    buffer_config.max_size = sizeof(float) * (config->max_num_input_samples + RIBARACONVOLVE_NUM_TIMEDOMAIN_COEFFICIENTS);
-    buffer_config.max_required_size = sizeof(float) * config->max_num_input_samples;
-    if ((tmp_work_size = RIRingBuffer_CalculateWorkSize(&buffer_config)) < 0) {
-        return NULL;
+    /* FFT畳み込み段の領域 候補の中で最大のサイズを確保 実体は分割サイズ決定時に作成 */
+    conv->stage_work = work_ptr;
+    conv->stage_work_size = 0;
+    for (partition_size = conv->min_partition_size; partition_size <= conv->max_partition_size; partition_size <<= 1) {
+        const uint32_t num_head_coefficients = (config->num_head_coefficients != 0)
+            ? config->num_head_coefficients : (partition_size + conv->num_lookahead_samples);
+        if ((tmp_work_size = RIZeroLatencyFFTConvolve_CalculateStagesWorkSize(partition_size, num_head_coefficients,
+                config->max_num_coefficients, config->max_num_input_samples, conv->num_lookahead_samples)) < 0) {
+            return NULL;
+        }
+        conv->stage_work_size = MAX(conv->stage_work_size, tmp_work_size);
     }
-    conv->input_buffer = RIRingBuffer_Create(&buffer_config, work_ptr, tmp_work_size);
-    work_ptr += tmp_work_size;
+    work_ptr += conv->stage_work_size;
 
     /* 出力データバッファ */
     conv->output_buffer	= (float *)ROUNDUP((uintptr_t)work_ptr, RIBARACONVOLVE_ALIGNMENT);
-    work_ptr += sizeof(float) * config->max_num_input_samples;
+    work_ptr = (uint8_t *)(conv->output_buffer + config->max_num_input_samples);
+
+    /* 計測用の入出力バッファ */
+    conv->calibration_buffer = NULL;
+    if (conv->min_partition_size < conv->max_partition_size) {
+        conv->calibration_buffer = (float *)ROUNDUP((uintptr_t)work_ptr, RIBARACONVOLVE_ALIGNMENT);
+        work_ptr = (uint8_t *)(conv->calibration_buffer + 2 * config->max_num_input_samples);
+    }
+
+    /* ワーカースレッドとの受け渡しバッファ */
+    conv->worker_input = NULL;
+    conv->pending_input = NULL;
+    conv->tail_buffer = NULL;
+    if (conv->use_worker_thread) {
+        struct RIRingBufferConfig buffer_config;
+        conv->worker_input = (float *)ROUNDUP((uintptr_t)work_ptr, RIBARACONVOLVE_ALIGNMENT);
+        work_ptr = (uint8_t *)(conv->worker_input + RIBARACONVOLVE_WORKER_INPUT_NUM_BLOCKS * config->max_num_input_samples);
+        conv->pending_input = (float *)ROUNDUP((uintptr_t)work_ptr, RIBARACONVOLVE_ALIGNMENT);
+        work_ptr = (uint8_t *)(conv->pending_input + RIBARACONVOLVE_WORKER_INPUT_NUM_BLOCKS * config->max_num_input_samples);
+        /* 先読みした出力のバッファ 呼び出し元スレッドが読み出し、ワーカースレッドが書き込む */
+        buffer_config.max_size = sizeof(float) * ((size_t)conv->num_lookahead_samples + config->max_num_input_samples);
+        buffer_config.max_required_size = sizeof(float) * config->max_num_input_samples;
+        buffer_config.enable_spsc = 1;
+        buffer_config.use_mirrored_memory = 0;
+        if ((tmp_work_size = RIRingBuffer_CalculateWorkSize(&buffer_config)) < 0) {
+            return NULL;
+        }
+        conv->tail_buffer = RIRingBuffer_Create(&buffer_config, work_ptr, tmp_work_size);
+        work_ptr += tmp_work_size;
+    }
+
+#if defined(RICONVOLVE_ENABLE_STATISTICS)
+    RIConvolveStatistics_Initialize(&conv->statistics);
+#endif
+
+    /* 指定がなければ既定値を候補範囲に収めて使う 計測で選ぶ場合はRIZeroLatencyFFTConvolve_CalibratePartitionSizeを呼ぶ */
+    partition_size = MIN(MAX(RIBARACONVOLVE_DEFAULT_PARTITION_SIZE, conv->min_partition_size), conv->max_partition_size);
+    RIZeroLatencyFFTConvolve_SetupModules(conv, partition_size);
+
+    /* ワーカースレッド開始 */
+    RIZeroLatencyFFTConvolve_StartWorker(conv);
 
     return conv;
 }
@@ -173,11 +453,19 @@ static void RIZeroLatencyFFTConvolve_Destroy(void *obj)
     struct RIZeroLatencyFFTConvolve *conv = (struct RIZeroLatencyFFTConvolve *)obj;
 
     if (conv != NULL) {
-        /* リングバッファ破棄 */
-        RIRingBuffer_Destroy(conv->input_buffer);
+        uint32_t i;
+        /* ワーカースレッドを止めてから破棄 */
+        RIZeroLatencyFFTConvolve_StopWorker(conv);
+        if (conv->tail_buffer != NULL) {
+            RIRingBuffer_Destroy(conv->tail_buffer);
+        }
+        /* 各段の破棄 */
+        for (i = 0; i < conv->num_stages; i++) {
+            conv->freq_conv_if->Destroy(conv->stages[i].conv_obj);
+        }
         /* 各畳み込みモジュールの破棄 */
         conv->time_conv_if->Destroy(conv->time_conv_obj);
-        conv->freq_conv_if->Destroy(conv->freq_conv_obj);
+        conv->direct_fir_if->Destroy(conv->direct_fir_obj);
     }
 }
 
@@ -186,72 +474,285 @@ static void RIZeroLatencyFFTConvolve_SetCoefficients(void *obj, const float *coe
 {
     struct RIZeroLatencyFFTConvolve *conv = (struct RIZeroLatencyFFTConvolve *)obj;
 
-    if (num_coefficients > RIBARACONVOLVE_NUM_TIMEDOMAIN_COEFFICIENTS) {
-        conv->use_freq_conv = 1;
+    RIZeroLatencyFFTConvolve_ApplyCoefficients(conv, coefficients, num_coefficients);
+}
+
+/* 処理時間を計測して最速の分割サイズを設定 */
+uint32_t RIZeroLatencyFFTConvolve_CalibratePartitionSize(void *obj, const float *coefficients, uint32_t num_coefficients)
+{
+    struct RIZeroLatencyFFTConvolve *conv = (struct RIZeroLatencyFFTConvolve *)obj;
+    uint32_t partition_size;
+#if defined(RICONVOLVE_ENABLE_STATISTICS)
+    struct RIConvolveStatistics statistics;
+#endif
+
+    assert((obj != NULL) && (coefficients != NULL));
+
+    /* 分割サイズが指定されていれば係数をセットするのみ */
+    if (conv->min_partition_size == conv->max_partition_size) {
+        RIZeroLatencyFFTConvolve_ApplyCoefficients(conv, coefficients, num_coefficients);
+        return conv->partition_size;
+    }
+
+#if defined(RICONVOLVE_ENABLE_STATISTICS)
+    /* 計測中の処理は集計しないため、計測前の集計値を退避 */
+    statistics = conv->statistics.local;
+    RIZeroLatencyFFTConvolve_AddStageStatistics(conv, &statistics);
+#endif
+
+    partition_size = RIZeroLatencyFFTConvolve_MeasureBestPartitionSize(conv, coefficients, num_coefficients);
+    RIZeroLatencyFFTConvolve_SetupModules(conv, partition_size);
+    RIZeroLatencyFFTConvolve_ApplyCoefficients(conv, coefficients, num_coefficients);
+
+#if defined(RICONVOLVE_ENABLE_STATISTICS)
+    conv->statistics.local = statistics;
+    RIConvolveStatistics_Publish(&conv->statistics);
+#endif
+
+    return partition_size;
+}
+
+/* 現在の段構成で係数を振り分けてセット */
+static void RIZeroLatencyFFTConvolve_ApplyCoefficients(
+        struct RIZeroLatencyFFTConvolve *conv, const float *coefficients, uint32_t num_coefficients)
+{
+    uint32_t i;
+    const uint32_t num_head_coefficients = MIN(num_coefficients, conv->num_head_coefficients);
+
+    /* ワーカースレッドが各段を処理中なら待つ */
+    RIZeroLatencyFFTConvolve_WaitWorker(conv, RIBARACONVOLVE_WORKER_WAIT_INFINITE);
+
+    if (num_head_coefficients > RIBARACONVOLVE_NUM_DIRECTFIR_COEFFICIENTS) {
         /* 先頭分を時間領域畳み込みモジュールにセット */
-        conv->time_conv_if->SetCoefficients(conv->time_conv_obj, coefficients, RIBARACONVOLVE_NUM_TIMEDOMAIN_COEFFICIENTS);
-        /* 後ろは周波数領域畳み込みモジュールにセット */
-        conv->freq_conv_if->SetCoefficients(conv->freq_conv_obj,
-                &coefficients[RIBARACONVOLVE_NUM_TIMEDOMAIN_COEFFICIENTS],
-                num_coefficients - RIBARACONVOLVE_NUM_TIMEDOMAIN_COEFFICIENTS);
+        conv->time_conv_if->SetCoefficients(conv->time_conv_obj, coefficients, num_head_coefficients);
+        conv->head_conv_if = conv->time_conv_if;
+        conv->head_conv_obj = conv->time_conv_obj;
     } else {
-        conv->use_freq_conv = 0;
-        /* 時間領域畳み込みモジュールで十分 */
-        conv->time_conv_if->SetCoefficients(conv->time_conv_obj, coefficients, num_coefficients);
+        /* 短い係数は直接型FIRの方が速い */
+        conv->direct_fir_if->SetCoefficients(conv->direct_fir_obj, coefficients, num_head_coefficients);
+        conv->head_conv_if = conv->direct_fir_if;
+        conv->head_conv_obj = conv->direct_fir_obj;
     }
 
+    /* 後ろは各段のFFT畳み込みモジュールにセット 係数が届かない段は使わない */
+    for (i = 0; i < conv->num_stages; i++) {
+        struct RIZeroLatencyFFTConvolveStage *stage = &conv->stages[i];
+        if (stage->offset >= num_coefficients) {
+            break;
+        }
+        conv->freq_conv_if->SetCoefficients(stage->conv_obj,
+                &coefficients[stage->offset], MIN(stage->max_num_coefficients, num_coefficients - stage->offset));
+    }
+    conv->num_active_stages = i;
+
     /* 内部状態をリセット（前の係数の影響をクリア） */
     RIZeroLatencyFFTConvolve_Reset(conv);
 }
 
 /* 畳み込み計算 */
 static void RIZeroLatencyFFTConvolve_Convolve(void *obj, const float *input, float *output, uint32_t num_samples)
+{
+    RIZeroLatencyFFTConvolve_ConvolveStrided(obj, input, 1, output, 1, num_samples);
+}
+
+/* 要素間隔を指定した畳み込み計算 */
+static void RIZeroLatencyFFTConvolve_ConvolveStrided(void *obj,
+        const float *input, uint32_t input_stride, float *output, uint32_t output_stride, uint32_t num_samples)
 {
     struct RIZeroLatencyFFTConvolve *conv = (struct RIZeroLatencyFFTConvolve *)obj;
+    uint8_t deadline_missed;
+#if defined(RICONVOLVE_ENABLE_STATISTICS)
+    const uint64_t start_ticks = RIConvolveStatistics_GetTicks();
+#endif
 
-    /* 先頭分を時間領域で畳み込み */
-    conv->time_conv_if->Convolve(conv->time_conv_obj, input, output, num_samples);
+    deadline_missed = RIZeroLatencyFFTConvolve_Process(conv, input, input_stride, output, output_stride, num_samples);
 
-    if (conv->use_freq_conv == 1) {
-        void *buffer_ptr;
-        uint32_t smpl;
-        const uint32_t sample_size = sizeof(float) * num_samples;
+#if defined(RICONVOLVE_ENABLE_STATISTICS)
+    /* 統計情報の更新 */
+    conv->statistics.local.num_deadline_misses += deadline_missed;
+    RIConvolveStatistics_RecordCall(&conv->statistics, num_samples, RIConvolveStatistics_GetTicks() - start_ticks);
+    RIConvolveStatistics_Publish(&conv->statistics);
+#else
+    (void)deadline_missed;
+#endif
+}
 
-        /* ディレイバッファに入力 */
-        RIRingBuffer_Put(conv->input_buffer, input, sample_size);
-        /* ディレイバッファから遅延入力を取得/畳み込み */
-        RIRingBuffer_Get(conv->input_buffer, &buffer_ptr, sample_size);
-        conv->freq_conv_if->Convolve(conv->freq_conv_obj, (const float *)buffer_ptr, conv->output_buffer, num_samples);
+/* 畳み込み計算本体（統計情報は更新しない） */
+static uint8_t RIZeroLatencyFFTConvolve_Process(struct RIZeroLatencyFFTConvolve *conv,
+        const float *input, uint32_t input_stride, float *output, uint32_t output_stride, uint32_t num_samples)
+{
+    uint32_t smpl, num_tail_samples;
+    uint8_t worker_idle, deadline_missed = 0;
+
+    assert((input_stride > 0) && (output_stride > 0));
+    assert(num_samples <= conv->max_num_input_samples);
+
+    if (!conv->use_worker_thread) {
+        /* 入出力が同一領域の場合は先頭分の出力で入力が上書きされるため、各段の入力を退避 */
+        /* ワーカースレッド不使用時は出力データバッファが空いているので使う */
+        if ((input == output) && (conv->num_active_stages > 0)) {
+            RIZeroLatencyFFTConvolve_CopyFromStrided(conv->output_buffer, input, input_stride, num_samples);
+            conv->head_conv_if->ConvolveStrided(conv->head_conv_obj, input, input_stride, output, output_stride, num_samples);
+            RIZeroLatencyFFTConvolve_ConvolveStages(conv, conv->output_buffer, 1, output, output_stride, num_samples);
+            return 0;
+        }
+        /* 先頭分を時間領域で畳み込み */
+        conv->head_conv_if->ConvolveStrided(conv->head_conv_obj, input, input_stride, output, output_stride, num_samples);
+        /* 後ろは各段で畳み込み */
+        RIZeroLatencyFFTConvolve_ConvolveStages(conv, input, input_stride, output, output_stride, num_samples);
+        return 0;
+    }
 
-        /* 時間領域の結果とミックス */
-        for (smpl = 0; smpl < num_samples; smpl++) {
-            output[smpl] += conv->output_buffer[smpl];
+    /* 先読みは2ブロック分あるため、通常はワーカースレッドが処理中でも先読み済みの出力が足りて待たない
+    * 足りない場合のみ、積んである入力の処理を依頼しつつ回数を限って処理完了を待つ */
+    while ((RIRingBuffer_GetRemainSize(conv->tail_buffer) / sizeof(float)) < ((size_t)conv->num_missing_tail_samples + num_samples)) {
+        if (RIZeroLatencyFFTConvolve_LoadAcquire(&conv->worker_job_pending) == 0) {
+            /* これ以上届く出力がない */
+            if ((conv->pending_num_samples + conv->pending_num_zero_samples) == 0) {
+                break;
+            }
+            RIZeroLatencyFFTConvolve_SubmitWorkerJob(conv);
+        }
+        if (!RIZeroLatencyFFTConvolve_WaitWorker(conv, RIBARACONVOLVE_WORKER_MAX_NUM_YIELDS)) {
+            break;
         }
     }
+
+    /* 空いているかは出力を取り出す前に確認する（確認後に書き込まれた出力を、次に依頼する処理の出力と取り違えないため） */
+    worker_idle = (RIZeroLatencyFFTConvolve_LoadAcquire(&conv->worker_job_pending) == 0) ? 1 : 0;
+
+    /* 先読み済みの出力を取り出す 待っても足りなければ締め切りに間に合わなかったとして無音で代用し、後から届いた分は読み捨てる */
+    conv->num_missing_tail_samples -= RIZeroLatencyFFTConvolve_GetTailSamples(conv, NULL, conv->num_missing_tail_samples);
+    num_tail_samples = RIZeroLatencyFFTConvolve_GetTailSamples(conv, conv->output_buffer, num_samples);
+    if (num_tail_samples < num_samples) {
+        memset(&conv->output_buffer[num_tail_samples], 0, sizeof(float) * (num_samples - num_tail_samples));
+        conv->num_missing_tail_samples += num_samples - num_tail_samples;
+        deadline_missed = 1;
+    }
+
+    /* 今回の入力を積み、ワーカースレッドが空いていれば積んだ入力の各段の処理を依頼 */
+    RIZeroLatencyFFTConvolve_QueueWorkerInput(conv, input, input_stride, num_samples);
+    if (worker_idle) {
+        RIZeroLatencyFFTConvolve_SubmitWorkerJob(conv);
+    }
+
+    /* 並行して先頭分を時間領域で畳み込み */
+    conv->head_conv_if->ConvolveStrided(conv->head_conv_obj, input, input_stride, output, output_stride, num_samples);
+
+    /* 先読み済みの各段の結果とミックス */
+    for (smpl = 0; smpl < num_samples; smpl++) {
+        output[(size_t)smpl * output_stride] += conv->output_buffer[smpl];
+    }
+
+    return deadline_missed;
+}
+
+/* 先読みした出力をoutputに最大num_samples取り出し、取り出したサンプル数を返す */
+static uint32_t RIZeroLatencyFFTConvolve_GetTailSamples(struct RIZeroLatencyFFTConvolve *conv, float *output, uint32_t num_samples)
+{
+    uint32_t smpl = 0;
+    void *buffer_ptr;
+    const uint32_t num_remain_samples = (uint32_t)(RIRingBuffer_GetRemainSize(conv->tail_buffer) / sizeof(float));
+
+    num_samples = MIN(num_samples, num_remain_samples);
+
+    /* 一度に取り出せるのは最大入力サンプル数まで */
+    while (smpl < num_samples) {
+        const uint32_t num_get_samples = MIN(conv->max_num_input_samples, num_samples - smpl);
+        RIRingBuffer_Get(conv->tail_buffer, &buffer_ptr, sizeof(float) * num_get_samples);
+        if (output != NULL) {
+            memcpy(&output[smpl], buffer_ptr, sizeof(float) * num_get_samples);
+        }
+        smpl += num_get_samples;
+    }
+
+    return num_samples;
+}
+
+/* 入力を次のワーカースレッドへの依頼に積む */
+static void RIZeroLatencyFFTConvolve_QueueWorkerInput(struct RIZeroLatencyFFTConvolve *conv,
+        const float *input, uint32_t input_stride, uint32_t num_samples)
+{
+    uint32_t num_copy_samples = 0;
+
+    /* 積みきれない分は無音で代用する 順序を保つため、一度代用したら依頼するまで以降も代用する */
+    if (conv->pending_num_zero_samples == 0) {
+        num_copy_samples = MIN(num_samples,
+                RIBARACONVOLVE_WORKER_INPUT_NUM_BLOCKS * conv->max_num_input_samples - conv->pending_num_samples);
+        RIZeroLatencyFFTConvolve_CopyFromStrided(&conv->pending_input[conv->pending_num_samples], input, input_stride, num_copy_samples);
+        conv->pending_num_samples += num_copy_samples;
+    }
+    conv->pending_num_zero_samples += num_samples - num_copy_samples;
+}
+
+/* 積んだ入力の処理をワーカースレッドに依頼 */
+static void RIZeroLatencyFFTConvolve_SubmitWorkerJob(struct RIZeroLatencyFFTConvolve *conv)
+{
+    float *tmp;
+
+    /* 無音で代用した出力のうち届いている分は読み捨てる
+    * ワーカースレッドが空いていれば全て届いているため、残りは依頼する処理の出力の先頭に当たる */
+    conv->num_missing_tail_samples -= RIZeroLatencyFFTConvolve_GetTailSamples(conv, NULL, conv->num_missing_tail_samples);
+    assert((conv->num_missing_tail_samples == 0) || (RIRingBuffer_GetRemainSize(conv->tail_buffer) == 0));
+    conv->worker_num_discard_samples = conv->num_missing_tail_samples;
+    conv->num_missing_tail_samples = 0;
+
+    /* 入力のバッファを入れ替えて渡す */
+    tmp = conv->worker_input;
+    conv->worker_input = conv->pending_input;
+    conv->pending_input = tmp;
+    conv->worker_num_samples = conv->pending_num_samples;
+    conv->worker_num_zero_samples = conv->pending_num_zero_samples;
+    conv->pending_num_samples = conv->pending_num_zero_samples = 0;
+
+    RIZeroLatencyFFTConvolve_KickWorker(conv);
+}
+
+/* 全段の畳み込み結果をoutputに足し込む */
+static void RIZeroLatencyFFTConvolve_ConvolveStages(struct RIZeroLatencyFFTConvolve *conv,
+        const float *input, uint32_t input_stride, float *output, uint32_t output_stride, uint32_t num_samples)
+{
+    uint32_t i;
+
+    /* 各段は受け持つ係数の先頭位置分の遅延を内部の出力バッファで実現している */
+    for (i = 0; i < conv->num_active_stages; i++) {
+        RIFFTConvolve_ConvolveAddStrided(conv->stages[i].conv_obj, input, input_stride, output, output_stride, num_samples);
+    }
 }
 
 /* 内部状態リセット */
 static void RIZeroLatencyFFTConvolve_Reset(void *obj)
 {
     struct RIZeroLatencyFFTConvolve *conv = (struct RIZeroLatencyFFTConvolve *)obj;
-    int32_t smpl, num_input_delay;
+    uint32_t i;
+
+    /* ワーカースレッドが各段を処理中なら待つ */
+    RIZeroLatencyFFTConvolve_WaitWorker(conv, RIBARACONVOLVE_WORKER_WAIT_INFINITE);
 
     /* 各畳み込みモジュールのリセット */
     conv->time_conv_if->Reset(conv->time_conv_obj);
-    conv->freq_conv_if->Reset(conv->freq_conv_obj);
+    conv->direct_fir_if->Reset(conv->direct_fir_obj);
 
-    /* ディレイバッファのリセット */
-    RIRingBuffer_Clear(conv->input_buffer);
-
-    /* 時間領域フィルタ係数分の遅延を実現するため、レイテンシで減じた分だけの無音を挿入 */
-    num_input_delay = (int32_t)RIBARACONVOLVE_NUM_TIMEDOMAIN_COEFFICIENTS - conv->freq_conv_if->GetLatencyNumSamples(conv->freq_conv_obj);
-    assert(num_input_delay >= 0);
     memset(conv->output_buffer, 0, sizeof(float) * conv->max_num_input_samples);
-    smpl = 0;
-    while (smpl < num_input_delay) {
-        const uint32_t num_samples = MIN(conv->max_num_input_samples, (uint32_t)(num_input_delay - smpl));
-        RIRingBuffer_Put(conv->input_buffer, conv->output_buffer, sizeof(float) * num_samples);
-        smpl += num_samples;
+    for (i = 0; i < conv->num_stages; i++) {
+        struct RIZeroLatencyFFTConvolveStage *stage = &conv->stages[i];
+        conv->freq_conv_if->Reset(stage->conv_obj);
+        /* 先読みを含めて受け持つ係数の先頭位置分遅れているはず */
+        assert(((uint32_t)conv->freq_conv_if->GetLatencyNumSamples(stage->conv_obj) + conv->num_lookahead_samples) == stage->offset);
+    }
+
+    /* 先読みした出力のバッファには先読みサンプル数分の無音を入れておく */
+    conv->worker_num_samples = conv->worker_num_zero_samples = conv->worker_num_discard_samples = 0;
+    conv->pending_num_samples = conv->pending_num_zero_samples = 0;
+    conv->num_missing_tail_samples = 0;
+    if (conv->tail_buffer != NULL) {
+        uint32_t smpl = 0;
+        RIRingBuffer_Clear(conv->tail_buffer);
+        while (smpl < conv->num_lookahead_samples) {
+            const uint32_t num_samples = MIN(conv->max_num_input_samples, conv->num_lookahead_samples - smpl);
+            RIRingBuffer_Put(conv->tail_buffer, conv->output_buffer, sizeof(float) * num_samples);
+            smpl += num_samples;
+        }
     }
 }
 
@@ -261,3 +762,586 @@ static int32_t RIZeroLatencyFFTConvolve_GetLatencyNumSamples(void *obj)
     (void)obj;
     return 0;
 }
+
+/* 統計情報の取得 */
+static uint8_t RIZeroLatencyFFTConvolve_GetStatistics(void *obj, struct RIConvolveStatistics *statistics)
+{
+#if defined(RICONVOLVE_ENABLE_STATISTICS)
+    const struct RIZeroLatencyFFTConvolve *conv = (const struct RIZeroLatencyFFTConvolve *)obj;
+
+    /* 引数チェック */
+    assert((obj != NULL) && (statistics != NULL));
+
+    RIConvolveStatistics_Snapshot(&conv->statistics, statistics);
+    /* FFT畳み込み段で実行した分を加える */
+    RIZeroLatencyFFTConvolve_AddStageStatistics(conv, statistics);
+
+    return 1;
+#else
+    (void)obj;
+    (void)statistics;
+    return 0;
+#endif
+}
+
+#if defined(RICONVOLVE_ENABLE_STATISTICS)
+/* FFT畳み込み段のFFT回数と分割毎の複素乗算/加算回数をstatisticsに加える */
+static void RIZeroLatencyFFTConvolve_AddStageStatistics(
+        const struct RIZeroLatencyFFTConvolve *conv, struct RIConvolveStatistics *statistics)
+{
+    uint32_t i;
+    struct RIConvolveStatistics stage_statistics;
+
+    for (i = 0; i < conv->num_stages; i++) {
+        (void)conv->freq_conv_if->GetStatistics(conv->stages[i].conv_obj, &stage_statistics);
+        statistics->num_ffts += stage_statistics.num_ffts;
+        statistics->num_iffts += stage_statistics.num_iffts;
+        statistics->num_partition_macs += stage_statistics.num_partition_macs;
+        statistics->num_skipped_partition_macs += stage_statistics.num_skipped_partition_macs;
+    }
+}
+#endif
+
+/* FFT分割サイズの取得 */
+uint32_t RIZeroLatencyFFTConvolve_GetPartitionSize(const void *obj)
+{
+    const struct RIZeroLatencyFFTConvolve *conv = (const struct RIZeroLatencyFFTConvolve *)obj;
+
+    assert(obj != NULL);
+
+    return conv->partition_size;
+}
+
+/* 時間領域で畳み込む先頭係数長の取得 */
+uint32_t RIZeroLatencyFFTConvolve_GetNumHeadCoefficients(const void *obj)
+{
+    const struct RIZeroLatencyFFTConvolve *conv = (const struct RIZeroLatencyFFTConvolve *)obj;
+
+    assert(obj != NULL);
+
+    return conv->num_head_coefficients;
+}
+
+/* 使用中のFFT畳み込み段数の取得 */
+uint32_t RIZeroLatencyFFTConvolve_GetNumStages(const void *obj)
+{
+    const struct RIZeroLatencyFFTConvolve *conv = (const struct RIZeroLatencyFFTConvolve *)obj;
+
+    assert(obj != NULL);
+
+    return conv->num_active_stages;
+}
+
+/* 引数を2の冪乗に切り上げる */
+static uint32_t RIZeroLatencyFFTConvolve_Roundup2PoweredValue(uint32_t val)
+{
+    val--;
+    val |= val >> 1;
+    val |= val >> 2;
+    val |= val >> 4;
+    val |= val >> 8;
+    val |= val >> 16;
+    val++;
+
+    return val;
+}
+
+/* FFT畳み込み段の先読みサンプル数を取得 */
+static uint32_t RIZeroLatencyFFTConvolve_GetNumLookaheadSamples(const struct RIConvolveConfig *config)
+{
+    assert(config != NULL);
+
+    /* ワーカースレッドは1ブロック前に各段を処理するため最大入力サンプル数だけ先読みが必要
+    * 呼び出し元スレッドはワーカースレッドの処理完了を待たないため、処理が1ブロック遅れても間に合うようにもう1ブロック分先読みする */
+    return config->use_worker_thread ? (2 * config->max_num_input_samples) : 0;
+}
+
+/* 分割サイズの候補範囲を取得 */
+static void RIZeroLatencyFFTConvolve_GetPartitionSizeRange(
+        const struct RIConvolveConfig *config, uint32_t *min_partition_size, uint32_t *max_partition_size)
+{
+    assert((config != NULL) && (min_partition_size != NULL) && (max_partition_size != NULL));
+
+    /* 指定があればそのサイズのみ */
+    if (config->fft_partition_size != 0) {
+        (*min_partition_size) = (*max_partition_size)
+            = RIZeroLatencyFFTConvolve_Roundup2PoweredValue(config->fft_partition_size);
+        return;
+    }
+
+    (*min_partition_size) = RIBARACONVOLVE_MIN_PARTITION_SIZE;
+    (*max_partition_size) = RIBARACONVOLVE_MAX_PARTITION_SIZE;
+
+    /* 係数長を超える分割サイズは全て時間領域処理になり意味がない */
+    (*max_partition_size) = MIN(*max_partition_size,
+            MAX(*min_partition_size, RIZeroLatencyFFTConvolve_Roundup2PoweredValue(config->max_num_coefficients)));
+
+    /* 先頭係数長の指定があれば、レイテンシと先読みサンプル数の和を先頭係数長以下に収めるため
+    * 先頭係数長から先読みサンプル数を引いた値以下の2の冪乗に制限 */
+    if (config->num_head_coefficients != 0) {
+        const uint32_t num_lookahead_samples = RIZeroLatencyFFTConvolve_GetNumLookaheadSamples(config);
+        const uint32_t head_size = RIZeroLatencyFFTConvolve_Roundup2PoweredValue(
+                config->num_head_coefficients - num_lookahead_samples + 1) / 2;
+        assert(config->num_head_coefficients > num_lookahead_samples);
+        (*max_partition_size) = MIN(*max_partition_size, head_size);
+        (*min_partition_size) = MIN(*min_partition_size, *max_partition_size);
+    }
+}
+
+/* 段構成の計算 */
+static uint32_t RIZeroLatencyFFTConvolve_CalculateStages(uint32_t partition_size, uint32_t num_head_coefficients,
+        uint32_t max_num_coefficients, uint32_t num_lookahead_samples, struct RIZeroLatencyFFTConvolveStage *stages)
+{
+    uint32_t num_stages = 0;
+    uint32_t offset = num_head_coefficients;
+
+    assert(stages != NULL);
+    assert(num_head_coefficients >= (partition_size + num_lookahead_samples));
+
+    while (offset < max_num_coefficients) {
+        struct RIZeroLatencyFFTConvolveStage *stage = &stages[num_stages];
+        uint32_t next_partition_size = MIN(partition_size * RIBARACONVOLVE_STAGE_PARTITION_RATIO,
+                MAX(partition_size, RIBARACONVOLVE_MAX_STAGE_PARTITION_SIZE));
+
+        /* 既に次段のレイテンシ(と先読み)を賄える位置に来ていれば、この段は飛ばす */
+        if ((next_partition_size > partition_size) && (offset >= (next_partition_size + num_lookahead_samples))) {
+            partition_size = next_partition_size;
+            continue;
+        }
+
+        stage->partition_size = partition_size;
+        stage->offset = offset;
+        if ((next_partition_size > partition_size) && (num_stages < (RIBARACONVOLVE_MAX_NUM_STAGES - 1))) {
+            /* 次段の分割サイズと先読みサンプル数の和以上の位置まで受け持つ */
+            stage->max_num_coefficients = ROUNDUP(next_partition_size + num_lookahead_samples - offset, partition_size);
+        } else {
+            /* 最終段は末尾まで受け持つ */
+            stage->max_num_coefficients = max_num_coefficients - offset;
+        }
+        stage->max_num_coefficients = MIN(stage->max_num_coefficients, max_num_coefficients - offset);
+
+        offset += stage->max_num_coefficients;
+        partition_size = next_partition_size;
+        num_stages++;
+    }
+
+    return num_stages;
+}
+
+/* 全段のワークサイズ計算 */
+static int64_t RIZeroLatencyFFTConvolve_CalculateStagesWorkSize(uint32_t partition_size, uint32_t num_head_coefficients,
+        uint32_t max_num_coefficients, uint32_t max_num_input_samples, uint32_t num_lookahead_samples)
+{
+    uint32_t i, num_stages;
+    int64_t work_size = 0;
+    struct RIZeroLatencyFFTConvolveStage stages[RIBARACONVOLVE_MAX_NUM_STAGES];
+    const struct RIConvolveInterface *freq_conv_if = RIFFTConvolve_GetInterface();
+
+    num_stages = RIZeroLatencyFFTConvolve_CalculateStages(
+            partition_size, num_head_coefficients, max_num_coefficients, num_lookahead_samples, stages);
+
+    for (i = 0; i < num_stages; i++) {
+        int64_t tmp_work_size;
+        struct RIConvolveConfig conv_config;
+
+        /* FFT畳み込みモジュール分 受け持つ係数の先頭位置までの遅延を含む */
+        conv_config.max_num_coefficients = stages[i].max_num_coefficients;
+        conv_config.max_num_input_samples = max_num_input_samples;
+        conv_config.fft_partition_size = stages[i].partition_size;
+        conv_config.num_head_coefficients = 0;
+        conv_config.num_delay_samples = stages[i].offset - stages[i].partition_size - num_lookahead_samples;
+        conv_config.use_worker_thread = 0;
+        if ((tmp_work_size = freq_conv_if->CalculateWorkSize(&conv_config)) < 0) {
+            return -1;
+        }
+        work_size = RICONVOLVE_ADD_WORK_SIZE(work_size, tmp_work_size);
+    }
+
+    return work_size;
+}
+
+/* 分割サイズに合わせて時間領域畳み込みモジュールとFFT畳み込み段を作り直す */
+static void RIZeroLatencyFFTConvolve_SetupModules(struct RIZeroLatencyFFTConvolve *conv, uint32_t partition_size)
+{
+    uint32_t i;
+    uint8_t *work_ptr;
+    struct RIConvolveConfig conv_config;
+
+    assert(conv != NULL);
+    assert((partition_size >= conv->min_partition_size) && (partition_size <= conv->max_partition_size));
+
+    /* ワーカースレッドが各段を処理中なら待つ */
+    RIZeroLatencyFFTConvolve_WaitWorker(conv, RIBARACONVOLVE_WORKER_WAIT_INFINITE);
+
+    conv->partition_size = partition_size;
+    conv->num_head_coefficients = (conv->config_num_head_coefficients != 0)
+        ? conv->config_num_head_coefficients : (partition_size + conv->num_lookahead_samples);
+
+#if defined(RICONVOLVE_ENABLE_STATISTICS)
+    /* 破棄する段の集計値を引き継ぐ */
+    RIZeroLatencyFFTConvolve_AddStageStatistics(conv, &conv->statistics.local);
+    RIConvolveStatistics_Publish(&conv->statistics);
+#endif
+
+    /* 作成済みのモジュールを破棄 */
+    if (conv->time_conv_obj != NULL) {
+        conv->time_conv_if->Destroy(conv->time_conv_obj);
+    }
+    for (i = 0; i < conv->num_stages; i++) {
+        conv->freq_conv_if->Destroy(conv->stages[i].conv_obj);
+    }
+
+    conv_config.max_num_input_samples = conv->max_num_input_samples;
+    conv_config.num_head_coefficients = 0;
+    conv_config.num_delay_samples = 0;
+    conv_config.use_worker_thread = 0;
+
+    /* 時間領域畳み込みモジュール 先頭係数分のみ */
+    conv_config.max_num_coefficients = MIN(conv->num_head_coefficients, conv->max_num_coefficients);
+    conv_config.fft_partition_size = 0;
+    conv->time_conv_obj = conv->time_conv_if->Create(&conv_config, conv->time_conv_work, conv->time_conv_work_size);
+    assert(conv->time_conv_obj != NULL);
+
+    /* FFT畳み込み段 */
+    conv->num_stages = RIZeroLatencyFFTConvolve_CalculateStages(partition_size,
+            conv->num_head_coefficients, conv->max_num_coefficients, conv->num_lookahead_samples, conv->stages);
+    work_ptr = (uint8_t *)conv->stage_work;
+    for (i = 0; i < conv->num_stages; i++) {
+        int64_t tmp_work_size;
+        struct RIZeroLatencyFFTConvolveStage *stage = &conv->stages[i];
+
+        /* 受け持つ係数の先頭位置分の遅延を実現するため、レイテンシと先読みサンプル数で減じた分だけ出力を遅らせる */
+        conv_config.max_num_coefficients = stage->max_num_coefficients;
+        conv_config.fft_partition_size = stage->partition_size;
+        conv_config.num_delay_samples = stage->offset - stage->partition_size - conv->num_lookahead_samples;
+        tmp_work_size = conv->freq_conv_if->CalculateWorkSize(&conv_config);
+        stage->conv_obj = conv->freq_conv_if->Create(&conv_config, work_ptr, tmp_work_size);
+        assert(stage->conv_obj != NULL);
+        work_ptr += tmp_work_size;
+    }
+    assert(work_ptr <= ((uint8_t *)conv->stage_work + conv->stage_work_size));
+
+    /* 係数設定までは時間領域畳み込みのみ */
+    conv->head_conv_if = conv->time_conv_if;
+    conv->head_conv_obj = conv->time_conv_obj;
+    conv->num_active_stages = 0;
+
+    RIZeroLatencyFFTConvolve_Reset(conv);
+}
+
+/* 処理時間を計測して最速の分割サイズを選ぶ */
+static uint32_t RIZeroLatencyFFTConvolve_MeasureBestPartitionSize(
+        struct RIZeroLatencyFFTConvolve *conv, const float *coefficients, uint32_t num_coefficients)
+{
+    uint32_t partition_size, best_partition_size, num_samples;
+    uint64_t best_time = 0;
+    float *input = conv->calibration_buffer;
+    float *output = conv->calibration_buffer + conv->max_num_input_samples;
+
+    assert(conv->calibration_buffer != NULL);
+
+    /* 入力がなければ計測できない */
+    if (conv->max_num_input_samples == 0) {
+        return conv->min_partition_size;
+    }
+
+    /* 後段の最大分割サイズの2周期分を最大入力サンプル数単位で処理する時間を比較 */
+    num_samples = ROUNDUP(2 * MIN(RIBARACONVOLVE_MAX_STAGE_PARTITION_SIZE,
+                RIZeroLatencyFFTConvolve_Roundup2PoweredValue(num_coefficients)), conv->max_num_input_samples);
+    memset(input, 0, sizeof(float) * conv->max_num_input_samples);
+
+    best_partition_size = conv->min_partition_size;
+    for (partition_size = conv->min_partition_size; partition_size <= conv->max_partition_size; partition_size <<= 1) {
+        uint32_t smpl;
+        uint64_t start, elapsed = 0;
+
+        RIZeroLatencyFFTConvolve_SetupModules(conv, partition_size);
+        RIZeroLatencyFFTConvolve_ApplyCoefficients(conv, coefficients, num_coefficients);
+
+        /* CPU時間ではなく経過時間で比べる */
+        start = RIConvolveStatistics_GetTicks();
+        for (smpl = 0; smpl < num_samples; smpl += conv->max_num_input_samples) {
+            RIZeroLatencyFFTConvolve_Process(conv, input, 1, output, 1, conv->max_num_input_samples);
+            /* ワーカースレッドの処理時間も含める */
+            RIZeroLatencyFFTConvolve_WaitWorker(conv, RIBARACONVOLVE_WORKER_WAIT_INFINITE);
+            /* 最速の候補より遅くなった時点で打ち切り */
+            elapsed = RIConvolveStatistics_GetTicks() - start;
+            if ((partition_size > conv->min_partition_size) && (elapsed > best_time)) {
+                break;
+            }
+        }
+
+        if ((partition_size == conv->min_partition_size) || (elapsed < best_time)) {
+            best_time = elapsed;
+            best_partition_size = partition_size;
+        }
+
+        /* 先頭係数だけで全係数を賄える以上の分割サイズは試さない */
+        if (conv->num_head_coefficients >= num_coefficients) {
+            break;
+        }
+    }
+
+    return best_partition_size;
+}
+
+/* ワーカースレッドに依頼する処理 */
+static void RIZeroLatencyFFTConvolve_ProcessWorkerJob(struct RIZeroLatencyFFTConvolve *conv)
+{
+    uint32_t smpl = 0;
+    const uint32_t num_samples = conv->worker_num_samples + conv->worker_num_zero_samples;
+
+    assert(conv->worker_num_discard_samples <= num_samples);
+
+    /* 各段に渡せるのは最大入力サンプル数まで */
+    while (smpl < num_samples) {
+        void *buffer_ptr;
+        float *input;
+        uint32_t num_block_samples = MIN(conv->max_num_input_samples, num_samples - smpl);
+
+        if (smpl < conv->worker_num_samples) {
+            /* 入力 */
+            num_block_samples = MIN(num_block_samples, conv->worker_num_samples - smpl);
+            input = &conv->worker_input[smpl];
+        } else {
+            /* 入力を処理し終えたら入力のバッファを無音の入力に使う */
+            if (smpl == conv->worker_num_samples) {
+                memset(conv->worker_input, 0, sizeof(float) * conv->max_num_input_samples);
+            }
+            input = conv->worker_input;
+        }
+        if (smpl < conv->worker_num_discard_samples) {
+            num_block_samples = MIN(num_block_samples, conv->worker_num_discard_samples - smpl);
+        }
+
+        /* 先読みした出力のバッファ上に各段の結果を直接足し込んで確定 読み捨てる分は確定しない */
+        RIRingBuffer_Reserve(conv->tail_buffer, &buffer_ptr, sizeof(float) * num_block_samples);
+        memset(buffer_ptr, 0, sizeof(float) * num_block_samples);
+        RIZeroLatencyFFTConvolve_ConvolveStages(conv, input, 1, (float *)buffer_ptr, 1, num_block_samples);
+        if (smpl >= conv->worker_num_discard_samples) {
+            RIRingBuffer_Commit(conv->tail_buffer, sizeof(float) * num_block_samples);
+        }
+        smpl += num_block_samples;
+    }
+}
+
+/* ワーカースレッドのエントリ */
+#if defined(_WIN32)
+static DWORD WINAPI RIZeroLatencyFFTConvolve_WorkerThread(LPVOID arg)
+#else
+static void *RIZeroLatencyFFTConvolve_WorkerThread(void *arg)
+#endif
+{
+    struct RIZeroLatencyFFTConvolve *conv = (struct RIZeroLatencyFFTConvolve *)arg;
+
+    while (1) {
+        /* 処理依頼か終了要求を待つ 待つのはワーカースレッド側のみ */
+#if defined(_WIN32)
+        WaitForSingleObject(conv->worker_wakeup, INFINITE);
+#elif defined(__APPLE__)
+        dispatch_semaphore_wait(conv->worker_wakeup, DISPATCH_TIME_FOREVER);
+#else
+        while ((sem_wait(&conv->worker_wakeup) != 0) && (errno == EINTR)) {
+            ;
+        }
+#endif
+        /* 依頼済みの処理を終えてから終了 */
+        if (RIZeroLatencyFFTConvolve_LoadAcquire(&conv->worker_job_pending)) {
+            RIZeroLatencyFFTConvolve_ProcessWorkerJob(conv);
+            RIZeroLatencyFFTConvolve_StoreRelease(&conv->worker_job_pending, 0);
+            continue;
+        }
+        if (RIZeroLatencyFFTConvolve_LoadAcquire(&conv->worker_quit)) {
+            break;
+        }
+    }
+
+#if defined(_WIN32)
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+/* ワーカースレッドの開始 */
+static void RIZeroLatencyFFTConvolve_StartWorker(struct RIZeroLatencyFFTConvolve *conv)
+{
+    assert(conv != NULL);
+
+    conv->worker_running = 0;
+    conv->worker_job_pending = 0;
+    conv->worker_quit = 0;
+
+    if (!conv->use_worker_thread) {
+        return;
+    }
+
+    /* スレッドと共有するフラグはスレッド作成前にセット */
+    conv->worker_running = 1;
+
+#if defined(_WIN32)
+    if ((conv->worker_wakeup = CreateSemaphore(NULL, 0, LONG_MAX, NULL)) == NULL) {
+        conv->worker_running = 0;
+        return;
+    }
+    conv->worker_thread = CreateThread(NULL, 0, RIZeroLatencyFFTConvolve_WorkerThread, conv, 0, NULL);
+    if (conv->worker_thread == NULL) {
+        CloseHandle(conv->worker_wakeup);
+        conv->worker_running = 0;
+        return;
+    }
+#else
+#if defined(__APPLE__)
+    if ((conv->worker_wakeup = dispatch_semaphore_create(0)) == NULL) {
+        conv->worker_running = 0;
+        return;
+    }
+#else
+    if (sem_init(&conv->worker_wakeup, 0, 0) != 0) {
+        conv->worker_running = 0;
+        return;
+    }
+#endif
+    if (pthread_create(&conv->worker_thread, NULL, RIZeroLatencyFFTConvolve_WorkerThread, conv) != 0) {
+#if defined(__APPLE__)
+        dispatch_release(conv->worker_wakeup);
+#else
+        sem_destroy(&conv->worker_wakeup);
+#endif
+        conv->worker_running = 0;
+        return;
+    }
+#endif
+}
+
+/* ワーカースレッドの終了 */
+static void RIZeroLatencyFFTConvolve_StopWorker(struct RIZeroLatencyFFTConvolve *conv)
+{
+    assert(conv != NULL);
+
+    if (!conv->worker_running) {
+        return;
+    }
+
+    RIZeroLatencyFFTConvolve_StoreRelease(&conv->worker_quit, 1);
+    RIZeroLatencyFFTConvolve_WakeupWorker(conv);
+
+#if defined(_WIN32)
+    WaitForSingleObject(conv->worker_thread, INFINITE);
+    CloseHandle(conv->worker_thread);
+    CloseHandle(conv->worker_wakeup);
+#else
+    pthread_join(conv->worker_thread, NULL);
+#if defined(__APPLE__)
+    dispatch_release(conv->worker_wakeup);
+#else
+    sem_destroy(&conv->worker_wakeup);
+#endif
+#endif
+
+    conv->worker_running = 0;
+}
+
+/* ワーカースレッドへの処理依頼
+* 呼び出し元のスレッドはロックを取らず、フラグを立ててセマフォを加算するのみ */
+static void RIZeroLatencyFFTConvolve_KickWorker(struct RIZeroLatencyFFTConvolve *conv)
+{
+    assert(conv != NULL);
+
+    /* スレッドが無ければその場で処理 */
+    if (!conv->worker_running) {
+        RIZeroLatencyFFTConvolve_ProcessWorkerJob(conv);
+        return;
+    }
+
+    /* 入力の書き込みを済ませてから依頼を公開 */
+    RIZeroLatencyFFTConvolve_StoreRelease(&conv->worker_job_pending, 1);
+    RIZeroLatencyFFTConvolve_WakeupWorker(conv);
+}
+
+/* ワーカースレッドの処理完了待ち 完了していれば1, max_num_yields回CPUを譲っても終わらなければ0を返す
+* 係数セット・リセット・計測時は終わるまで待ち、畳み込み処理中は先読みした出力が足りない場合のみ回数を限って待つ
+* ワーカースレッドはロックを持たないため優先度逆転は起きない. 暫くはCPUを譲らずに待ち、それでも終わらなければ譲りながら待つ */
+static uint8_t RIZeroLatencyFFTConvolve_WaitWorker(struct RIZeroLatencyFFTConvolve *conv, uint32_t max_num_yields)
+{
+    uint32_t spin, num_yields = 0;
+
+    assert(conv != NULL);
+
+    if (!conv->worker_running) {
+        return 1;
+    }
+
+    for (spin = 0; RIZeroLatencyFFTConvolve_LoadAcquire(&conv->worker_job_pending); spin++) {
+        if (spin < RIBARACONVOLVE_WORKER_SPIN_COUNT) {
+#if defined(_MSC_VER)
+            YieldProcessor();
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+            __builtin_ia32_pause();
+#endif
+        } else {
+            if ((max_num_yields != RIBARACONVOLVE_WORKER_WAIT_INFINITE) && (num_yields >= max_num_yields)) {
+                return 0;
+            }
+#if defined(_WIN32)
+            SwitchToThread();
+#else
+            sched_yield();
+#endif
+            num_yields++;
+        }
+    }
+
+    return 1;
+}
+
+/* ワーカースレッドを起こす */
+static void RIZeroLatencyFFTConvolve_WakeupWorker(struct RIZeroLatencyFFTConvolve *conv)
+{
+    assert(conv != NULL);
+
+    /* セマフォの加算は待ち合わせを伴わない */
+#if defined(_WIN32)
+    ReleaseSemaphore(conv->worker_wakeup, 1, NULL);
+#elif defined(__APPLE__)
+    dispatch_semaphore_signal(conv->worker_wakeup);
+#else
+    sem_post(&conv->worker_wakeup);
+#endif
+}
+
+/* フラグの読み出し(acquire) */
+static uint32_t RIZeroLatencyFFTConvolve_LoadAcquire(const uint32_t *flag)
+{
+#if defined(_MSC_VER)
+    /* 値を変えない比較交換で全順序バリア付きの読み出しとする */
+    return (uint32_t)_InterlockedCompareExchange((volatile long *)flag, 0, 0);
+#else
+    return __atomic_load_n(flag, __ATOMIC_ACQUIRE);
+#endif
+}
+
+/* フラグの書き込み(release) */
+static void RIZeroLatencyFFTConvolve_StoreRelease(uint32_t *flag, uint32_t value)
+{
+#if defined(_MSC_VER)
+    _InterlockedExchange((volatile long *)flag, (long)value);
+#else
+    __atomic_store_n(flag, value, __ATOMIC_RELEASE);
+#endif
+}
+
+/* 要素間隔strideのsrcを連続領域dstにコピー */
+static void RIZeroLatencyFFTConvolve_CopyFromStrided(float *dst, const float *src, uint32_t stride, uint32_t num_samples)
+{
+    uint32_t smpl;
+
+    if (stride == 1) {
+        memcpy(dst, src, sizeof(float) * num_samples);
+        return;
+    }
+
+    for (smpl = 0; smpl < num_samples; smpl++) {
+        dst[smpl] = src[(size_t)smpl * stride];
+    }
+}
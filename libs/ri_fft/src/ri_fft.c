@@ -70,16 +70,19 @@ static void RIFFT_ComplexFFT(int n, const int flag, RIFFTComplex *x, RIFFTComple
         const int n1 = (n >> 2);
         const int n2 = (n >> 1);
         const int n3 = n1 + n2;
-        const float theta0 = (float)(2.0f * RI_PI / n);
-        RIFFTComplex j, wdelta, w1p;
-        j.real = 0.0f; j.imag = flag;
-        wdelta.real = cosf(theta0); wdelta.imag = -flag * sinf(theta0);
-        w1p.real = 1.0f; w1p.imag = 0.0f;
+        const double theta0 = 2.0 * RI_PI / n;
+        /* 回転係数の漸化式は誤差が蓄積するため倍精度で計算 */
+        const double wdelta_real = cos(theta0), wdelta_imag = -flag * sin(theta0);
+        double w1p_real = 1.0, w1p_imag = 0.0, wtmp;
+        RIFFTComplex j;
+        j.real = 0.0f; j.imag = (float)flag;
         for (p = 0; p < n1; p++) {
             /* より精密 しかしsin,cosの関数呼び出しがある
             * const RIFFTComplex w1p = { cos(p * theta0), flag * sin(p * theta0) }; */
-            const RIFFTComplex w2p = RIFFTComplex_Mul(w1p, w1p);
-            const RIFFTComplex w3p = RIFFTComplex_Mul(w1p, w2p);
+            RIFFTComplex w1p, w2p, w3p;
+            w1p.real = (float)w1p_real; w1p.imag = (float)w1p_imag;
+            w2p = RIFFTComplex_Mul(w1p, w1p);
+            w3p = RIFFTComplex_Mul(w1p, w2p);
             for (q = 0; q < s; q++) {
                 const RIFFTComplex    a = x[q + s * (p +  0)];
                 const RIFFTComplex    b = x[q + s * (p + n1)];
@@ -95,7 +98,9 @@ static void RIFFT_ComplexFFT(int n, const int flag, RIFFTComplex *x, RIFFTComple
                 y[q + s * ((p << 2) + 3)] = RIFFTComplex_Mul(w3p, RIFFTComplex_Add(amc, jbmd));
             }
             /* 回転係数を進める */
-            w1p = RIFFTComplex_Mul(w1p, wdelta);
+            wtmp = w1p_real;
+            w1p_real = wtmp * wdelta_real - w1p_imag * wdelta_imag;
+            w1p_imag = wtmp * wdelta_imag + w1p_imag * wdelta_real;
         }
         n >>= 2;
         s <<= 2;
@@ -138,11 +143,11 @@ void RIFFT_FloatFFT(int n, const int flag, float *x, float *y)
 void RIFFT_RealFFT(int n, const int flag, float *x, float *y)
 {
     int i;
-    const float theta = (float)(-flag * 2.0f * RI_PI / n);
-    const float wpi = sinf(theta);
-    const float wpr = cosf(theta) - 1.0f;
+    const double theta = -flag * 2.0 * RI_PI / n;
+    const double wpi = sin(theta);
+    const double wpr = cos(theta) - 1.0;
     const float c2 = (float)flag * 0.5f;
-    float wr, wi, wtmp;
+    double wr, wi, wtmp;
 
     /* FFTの場合は先に順変換 */
     if (flag == -1) {
@@ -150,7 +155,7 @@ void RIFFT_RealFFT(int n, const int flag, float *x, float *y)
     }
 
     /* 回転因子初期化 */
-    wr = 1.0f + wpr;
+    wr = 1.0 + wpr;
     wi = wpi;
 
     /* スペクトルの対称性を使用し */
@@ -164,10 +169,11 @@ void RIFFT_RealFFT(int n, const int flag, float *x, float *y)
         const float h1i = 0.5f * (x[i2] - x[i4]);
         const float h2r =  -c2 * (x[i2] + x[i4]);
         const float h2i =   c2 * (x[i1] - x[i3]);
-        x[i1] =  h1r + (wr * h2r) - (wi * h2i);
-        x[i2] =  h1i + (wr * h2i) + (wi * h2r);
-        x[i3] =  h1r - (wr * h2r) + (wi * h2i);
-        x[i4] = -h1i + (wr * h2i) + (wi * h2r);
+        const float fwr = (float)wr, fwi = (float)wi;
+        x[i1] =  h1r + (fwr * h2r) - (fwi * h2i);
+        x[i2] =  h1i + (fwr * h2i) + (fwi * h2r);
+        x[i3] =  h1r - (fwr * h2r) + (fwi * h2i);
+        x[i4] = -h1i + (fwr * h2i) + (fwi * h2r);
         /* 回転因子更新 */
         wtmp = wr;
         wr += wtmp * wpr - wi * wpi;
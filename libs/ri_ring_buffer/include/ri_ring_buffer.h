@@ -13,6 +13,8 @@
 struct RIRingBufferConfig {
     size_t max_size; /* バッファサイズ */
     size_t max_required_size; /* 取り出し最大サイズ */
+    uint8_t enable_spsc; /* 1: 書き込み1スレッド/読み出し1スレッド間で受け渡すSPSCモード. 0で単一スレッド用 */
+    uint8_t use_mirrored_memory; /* 1: 同じ物理ページを仮想メモリ上で2回連続してマップしたデータ領域を使う(Linuxのみ). 0でワーク内に確保 */
 };
 
 typedef enum RIRingBufferApiResult {
@@ -31,14 +33,33 @@ extern "C" {
 #endif /* __cplusplus */
 
 /* リングバッファ作成に必要なワークサイズ計算 */
-int32_t RIRingBuffer_CalculateWorkSize(const struct RIRingBufferConfig *config);
+int64_t RIRingBuffer_CalculateWorkSize(const struct RIRingBufferConfig *config);
 
 /* リングバッファ作成 */
-struct RIRingBuffer *RIRingBuffer_Create(const struct RIRingBufferConfig *config, void *work, int32_t work_size);
+struct RIRingBuffer *RIRingBuffer_Create(const struct RIRingBufferConfig *config, void *work, int64_t work_size);
 
 /* リングバッファ破棄 */
 void RIRingBuffer_Destroy(struct RIRingBuffer *buffer);
 
+/* 鏡像マップ(use_mirrored_memory)について
+* データ領域はワーク外にmemfd/mmapで確保し、RIRingBuffer_Destroyで解放する. ワークサイズはハンドル分のみ
+* バッファサイズはページサイズに切り上げるため、空き領域はmax_sizeより大きくなりうる
+* 末尾を跨ぐ読み書きも連続領域として扱え、剰余領域への重複コピーと取り出し最大サイズの制限がない
+* 対応していない環境ではワークサイズ計算が失敗する
+*/
+
+/* アラインメントについて
+* データ領域の先頭とバッファサイズは16バイトの倍数に揃える
+* 読み書きするサイズが全てn(16の約数)の倍数であれば、Reserve/Peek/Getで得る領域はnバイト境界に揃う
+*/
+
+/* SPSCモードについて
+* Put/GetCapacitySizeは書き込みスレッドのみ、Peek/Get/GetRemainSizeは読み出しスレッドのみが呼ぶこと
+* 書き込み/読み出し位置はacquire/releaseで更新するため、ロックなしで2スレッド間でデータを受け渡せる
+* Peek/Getで得た領域は、読み出しスレッドが次にPeek/Getを呼ぶまで書き込み側に上書きされない
+* Clear/Destroyは両スレッドが操作していないときに呼ぶこと
+*/
+
 /* リングバッファの内容をクリア */
 void RIRingBuffer_Clear(struct RIRingBuffer *buffer);
 
@@ -52,6 +73,20 @@ size_t RIRingBuffer_GetCapacitySize(const struct RIRingBuffer *buffer);
 RIRingBufferApiResult RIRingBuffer_Put(
         struct RIRingBuffer *buffer, const void *data, size_t size);
 
+/* 書き込み領域の確保
+* 書き込み位置から連続したsizeバイトの領域を返す. 書き込んだ後にRIRingBuffer_Commitで確定する
+* sizeは取り出し最大サイズ以下であること. 確定するまでは読み出し側から見えない
+* SPSCモードでは書き込みスレッドのみが呼ぶこと
+*/
+RIRingBufferApiResult RIRingBuffer_Reserve(
+        struct RIRingBuffer *buffer, void **pdata, size_t size);
+
+/* 確保した領域への書き込みを確定
+* sizeはRIRingBuffer_Reserveで確保したサイズ以下であること
+*/
+RIRingBufferApiResult RIRingBuffer_Commit(
+        struct RIRingBuffer *buffer, size_t size);
+
 /* データ見るだけ（バッファの状態は更新されない） 注意）バッファが一周する前に使用しないと上書きされる */
 RIRingBufferApiResult RIRingBuffer_Peek(
         struct RIRingBuffer *buffer, void **pdata, size_t required_size);
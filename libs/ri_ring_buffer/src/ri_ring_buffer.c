@@ -1,29 +1,71 @@
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+/* memfd_createを使うため */
+#define _GNU_SOURCE
+#endif
+
 #include "ri_ring_buffer.h"
 
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+/* 仮想メモリで鏡像マップしたバッファが使えるか */
+#if defined(__linux__)
+#define RIRINGBUFFER_SUPPORT_MIRRORED_MEMORY 1
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
 /* メモリアラインメント */
 #define RIRINGBUFFER_ALIGNMENT 16
+/* キャッシュラインサイズ */
+#define RIRINGBUFFER_CACHE_LINE_SIZE 64
 /* nの倍数への切り上げ */
 #define RIRINGBUFFER_ROUNDUP(val, n) ((((val) + ((n) - 1)) / (n)) * (n))
 /* 最小値の取得 */
 #define RIRINGBUFFER_MIN(a,b) (((a) < (b)) ? (a) : (b))
+/* ワークサイズの上限: int64_tとアドレス空間の小さい方 */
+#define RIRINGBUFFER_MAX_WORK_SIZE ((int64_t)(((uint64_t)SIZE_MAX < (uint64_t)INT64_MAX) ? (uint64_t)SIZE_MAX : (uint64_t)INT64_MAX))
 
 /* リングバッファ */
 struct RIRingBuffer {
     uint8_t *data; /* データ領域の先頭ポインタ データは8ビットデータ列と考える */
     size_t buffer_size; /* バッファデータサイズ */
+    size_t max_size; /* 格納できる最大データサイズ */
     size_t max_required_size; /* 最大要求データサイズ */
-    uint32_t read_pos; /* 読み出し位置 */
-    uint32_t write_pos; /* 書き出し位置 */
+    uint8_t enable_spsc; /* SPSCモードか？ */
+    uint8_t use_mirrored_memory; /* データ領域を仮想メモリ上で2回連続してマップしているか？ */
+    /* 以降は書き込み側と読み出し側で別々に更新するため、偽共有しないようキャッシュラインを分ける */
+    uint8_t padding0[RIRINGBUFFER_CACHE_LINE_SIZE];
+    size_t read_pos; /* 読み出し位置 SPSCモードでは読み出し側が解放済みの位置 */
+    size_t get_pos; /* SPSCモードで読み出し側が取得済みの位置（次の読み出し操作で解放する） */
+    uint8_t padding1[RIRINGBUFFER_CACHE_LINE_SIZE];
+    size_t write_pos; /* 書き出し位置 */
+    uint8_t padding2[RIRINGBUFFER_CACHE_LINE_SIZE];
 };
 
+/* 位置の読み出し(acquire) */
+static size_t RIRingBuffer_LoadAcquire(const size_t *pos);
+/* 位置の書き込み(release) */
+static void RIRingBuffer_StoreRelease(size_t *pos, size_t value);
+/* 読み出し側が取得済みの領域を解放 */
+static void RIRingBuffer_ReleaseGotData(struct RIRingBuffer *buffer);
+/* 書き込み位置の公開 */
+static void RIRingBuffer_PublishWritePosition(struct RIRingBuffer *buffer, size_t write_pos);
+#if defined(RIRINGBUFFER_SUPPORT_MIRRORED_MEMORY)
+/* 鏡像マップしたバッファのサイズ計算 */
+static size_t RIRingBuffer_CalculateMirroredBufferSize(size_t max_size);
+/* 同一の物理ページを2回連続してマップした領域を作成 */
+static uint8_t *RIRingBuffer_MapMirroredMemory(size_t buffer_size);
+#endif
+
 /* リングバッファ作成に必要なワークサイズ計算 */
-int32_t RIRingBuffer_CalculateWorkSize(const struct RIRingBufferConfig *config)
+int64_t RIRingBuffer_CalculateWorkSize(const struct RIRingBufferConfig *config)
 {
-    int32_t work_size;
+    int64_t work_size;
 
     /* 引数チェック */
     if (config == NULL) {
@@ -35,44 +77,88 @@ int32_t RIRingBuffer_CalculateWorkSize(const struct RIRingBufferConfig *config)
         return -1;
     }
 
-    work_size = sizeof(struct RIRingBuffer) + RIRINGBUFFER_ALIGNMENT;
-    work_size += config->max_size + 1 + RIRINGBUFFER_ALIGNMENT;
-    work_size += config->max_required_size;
+    work_size = (int64_t)(sizeof(struct RIRingBuffer) + RIRINGBUFFER_CACHE_LINE_SIZE);
+
+    /* 鏡像マップを使う場合はデータ領域をワーク外に確保する */
+    if (config->use_mirrored_memory) {
+#if defined(RIRINGBUFFER_SUPPORT_MIRRORED_MEMORY)
+        return work_size;
+#else
+        return -1;
+#endif
+    }
+
+    /* データ領域 + 剰余領域 オーバーフローしないよう上限から引いて比較 */
+    if ((uint64_t)config->max_size > (uint64_t)(RIRINGBUFFER_MAX_WORK_SIZE - work_size - 2 * RIRINGBUFFER_ALIGNMENT)) {
+        return -1;
+    }
+    work_size += (int64_t)RIRINGBUFFER_ROUNDUP(config->max_size + 1, RIRINGBUFFER_ALIGNMENT) + RIRINGBUFFER_ALIGNMENT;
+    if ((uint64_t)config->max_required_size > (uint64_t)(RIRINGBUFFER_MAX_WORK_SIZE - work_size)) {
+        return -1;
+    }
+    work_size += (int64_t)config->max_required_size;
 
     return work_size;
 }
 
 /* リングバッファ作成 */
-struct RIRingBuffer *RIRingBuffer_Create(const struct RIRingBufferConfig *config, void *work, int32_t work_size)
+struct RIRingBuffer *RIRingBuffer_Create(const struct RIRingBufferConfig *config, void *work, int64_t work_size)
 {
     struct RIRingBuffer *buffer;
     uint8_t *work_ptr;
+    int64_t required_size;
 
     /* 引数チェック */
     if ((config == NULL) || (work == NULL) || (work_size < 0)) {
         return NULL;
     }
 
-    if (work_size < RIRingBuffer_CalculateWorkSize(config)) {
+    if (((required_size = RIRingBuffer_CalculateWorkSize(config)) < 0)
+            || (work_size < required_size)) {
         return NULL;
     }
 
-    /* ハンドル領域割当 */
-    work_ptr = (uint8_t *)RIRINGBUFFER_ROUNDUP((uintptr_t)work, RIRINGBUFFER_ALIGNMENT);
+    /* ハンドル領域割当 位置がキャッシュラインを跨がないようキャッシュライン境界に置く */
+    work_ptr = (uint8_t *)RIRINGBUFFER_ROUNDUP((uintptr_t)work, RIRINGBUFFER_CACHE_LINE_SIZE);
     buffer = (struct RIRingBuffer *)work_ptr;
     work_ptr += sizeof(struct RIRingBuffer);
 
     /* サイズを記録 */
-    buffer->buffer_size = config->max_size + 1; /* バッファの位置関係を正しく解釈するため1要素分多く確保する（write_pos == read_pos のときデータが一杯なのか空なのか判定できない） */
+    /* バッファの位置関係を正しく解釈するため1要素分多く確保する（write_pos == read_pos のときデータが一杯なのか空なのか判定できない） */
+    /* さらにアラインメントの倍数に切り上げ、読み書きサイズが揃っていれば位置が巡回してもアラインメントが崩れないようにする */
+    buffer->buffer_size = RIRINGBUFFER_ROUNDUP(config->max_size + 1, RIRINGBUFFER_ALIGNMENT);
+    buffer->max_size = config->max_size;
     buffer->max_required_size = config->max_required_size;
+    buffer->enable_spsc = config->enable_spsc;
+    buffer->use_mirrored_memory = config->use_mirrored_memory;
+
+    if (buffer->use_mirrored_memory) {
+#if defined(RIRINGBUFFER_SUPPORT_MIRRORED_MEMORY)
+        /* バッファ末尾の直後に先頭が見えるため、バッファサイズまで連続して読み書きできる */
+        buffer->buffer_size = RIRingBuffer_CalculateMirroredBufferSize(config->max_size);
+        buffer->max_size = buffer->buffer_size - 1;
+        buffer->max_required_size = buffer->buffer_size;
+        if ((buffer->data = RIRingBuffer_MapMirroredMemory(buffer->buffer_size)) == NULL) {
+            return NULL;
+        }
+#else
+        return NULL;
+#endif
+    } else {
+        /* バッファ領域割当 */
+        work_ptr = (uint8_t *)RIRINGBUFFER_ROUNDUP((uintptr_t)work_ptr, RIRINGBUFFER_ALIGNMENT);
+        buffer->data = work_ptr;
+        work_ptr += (buffer->buffer_size + config->max_required_size);
+    }
 
-    /* バッファ領域割当 */
-    work_ptr = (uint8_t *)RIRINGBUFFER_ROUNDUP((uintptr_t)work_ptr, RIRINGBUFFER_ALIGNMENT);
-    buffer->data = work_ptr;
-    work_ptr += (buffer->buffer_size + config->max_required_size);
-
-    /* バッファの内容をクリア */
-    RIRingBuffer_Clear(buffer);
+    /* バッファの内容をクリア 鏡像マップは作成直後に0埋めされているため位置のみ初期化 */
+    if (buffer->use_mirrored_memory) {
+        buffer->read_pos = 0;
+        buffer->get_pos = 0;
+        buffer->write_pos = 0;
+    } else {
+        RIRingBuffer_Clear(buffer);
+    }
 
     return buffer;
 }
@@ -80,6 +166,15 @@ struct RIRingBuffer *RIRingBuffer_Create(const struct RIRingBufferConfig *config
 /* リングバッファ破棄 */
 void RIRingBuffer_Destroy(struct RIRingBuffer *buffer)
 {
+#if defined(RIRINGBUFFER_SUPPORT_MIRRORED_MEMORY)
+    /* 鏡像マップした領域は解放するのみ */
+    if (buffer->use_mirrored_memory) {
+        munmap(buffer->data, 2 * buffer->buffer_size);
+        buffer->data = NULL;
+        return;
+    }
+#endif
+
     /* 不定領域アクセス防止のため内容はクリア */
     RIRingBuffer_Clear(buffer);
 }
@@ -89,40 +184,68 @@ void RIRingBuffer_Clear(struct RIRingBuffer *buffer)
 {
     assert(buffer != NULL);
 
-    /* データ領域を0埋め */
-    memset(buffer->data, 0, buffer->buffer_size + buffer->max_required_size);
+    /* データ領域を0埋め 鏡像マップでは後半は前半と同じ領域 */
+    if (buffer->use_mirrored_memory) {
+        memset(buffer->data, 0, buffer->buffer_size);
+    } else {
+        memset(buffer->data, 0, buffer->buffer_size + buffer->max_required_size);
+    }
 
     /* バッファ参照位置を初期化 */
     buffer->read_pos = 0;
+    buffer->get_pos = 0;
     buffer->write_pos = 0;
 }
 
 /* リングバッファ内に残ったデータサイズ取得 */
 size_t RIRingBuffer_GetRemainSize(const struct RIRingBuffer *buffer)
 {
+    size_t read_pos, write_pos;
+
     assert(buffer != NULL);
 
-    if (buffer->read_pos > buffer->write_pos) {
-        return buffer->buffer_size + buffer->write_pos - buffer->read_pos;
+    if (buffer->enable_spsc) {
+        /* 読み出し側から見た残りサイズ: 取得済みの位置から書き込み側が公開した位置まで */
+        read_pos = buffer->get_pos;
+        write_pos = RIRingBuffer_LoadAcquire(&buffer->write_pos);
+    } else {
+        read_pos = buffer->read_pos;
+        write_pos = buffer->write_pos;
     }
 
-    return buffer->write_pos - buffer->read_pos;
+    if (read_pos > write_pos) {
+        return buffer->buffer_size + write_pos - read_pos;
+    }
+
+    return write_pos - read_pos;
 }
 
 /* リングバッファ内の空き領域サイズ取得 */
 size_t RIRingBuffer_GetCapacitySize(const struct RIRingBuffer *buffer)
 {
+    size_t used_size, read_pos;
+
     assert(buffer != NULL);
-    assert(buffer->buffer_size >= RIRingBuffer_GetRemainSize(buffer));
 
-    /* 実際に入るサイズはバッファサイズより1バイト少ない */
-    return buffer->buffer_size - RIRingBuffer_GetRemainSize(buffer) - 1;
+    /* 書き込み側から見た使用中のサイズ: 読み出し側が解放した位置から書き込み位置まで */
+    read_pos = buffer->enable_spsc ? RIRingBuffer_LoadAcquire(&buffer->read_pos) : buffer->read_pos;
+    if (read_pos > buffer->write_pos) {
+        used_size = buffer->buffer_size + buffer->write_pos - read_pos;
+    } else {
+        used_size = buffer->write_pos - read_pos;
+    }
+    assert(buffer->max_size >= used_size);
+
+    /* バッファサイズは切り上げているため、実際に入るサイズは最大データサイズまで */
+    return buffer->max_size - used_size;
 }
 
 /* データ挿入 */
 RIRingBufferApiResult RIRingBuffer_Put(
         struct RIRingBuffer *buffer, const void *data, size_t size)
 {
+    size_t write_pos;
+
     /* 引数チェック */
     if ((buffer == NULL) || (data == NULL) || (size == 0)) {
         return RIRINGBUFFER_APIRESULT_INVALID_ARGUMENT;
@@ -133,26 +256,113 @@ RIRingBufferApiResult RIRingBuffer_Put(
         return RIRINGBUFFER_APIRESULT_EXCEED_MAX_CAPACITY;
     }
 
+    /* 書き込み位置は全て書き終えてから公開する */
+    write_pos = buffer->write_pos;
+
+    /* 鏡像マップでは末尾を跨いでもそのまま書き込めばよい */
+    if (buffer->use_mirrored_memory) {
+        memcpy(buffer->data + write_pos, data, size);
+        RIRingBuffer_PublishWritePosition(buffer, (write_pos + size) % buffer->buffer_size);
+        return RIRINGBUFFER_APIRESULT_OK;
+    }
+
     /* リングバッファを巡回するケース: バッファ末尾までまず書き込み */
-    if (buffer->write_pos + size >= buffer->buffer_size) {
-        uint8_t *wp = buffer->data + buffer->write_pos;
-        const size_t data_head_size = buffer->buffer_size - buffer->write_pos;
+    if (write_pos + size >= buffer->buffer_size) {
+        uint8_t *wp = buffer->data + write_pos;
+        const size_t data_head_size = buffer->buffer_size - write_pos;
         memcpy(wp, data, data_head_size);
         data = (const void *)((uint8_t *)data + data_head_size);
         size -= data_head_size;
-        buffer->write_pos = 0;
+        write_pos = 0;
     }
 
     /* 剰余領域への書き込み */
-    if (buffer->write_pos < buffer->max_required_size) {
-        uint8_t *wp = buffer->data + buffer->buffer_size + buffer->write_pos;
-        const size_t copy_size = RIRINGBUFFER_MIN(size, buffer->max_required_size - buffer->write_pos);
+    if (write_pos < buffer->max_required_size) {
+        uint8_t *wp = buffer->data + buffer->buffer_size + write_pos;
+        const size_t copy_size = RIRINGBUFFER_MIN(size, buffer->max_required_size - write_pos);
         memcpy(wp, data, copy_size);
     }
 
     /* リングバッファへの書き込み */
-    memcpy(buffer->data + buffer->write_pos, data, size);
-    buffer->write_pos += size; /* 巡回するケースでインデックスの剰余処理済 */
+    memcpy(buffer->data + write_pos, data, size);
+    write_pos += size; /* 巡回するケースでインデックスの剰余処理済 */
+
+    /* 書き込み位置の更新 */
+    RIRingBuffer_PublishWritePosition(buffer, write_pos);
+
+    return RIRINGBUFFER_APIRESULT_OK;
+}
+
+/* 書き込み領域の確保 */
+RIRingBufferApiResult RIRingBuffer_Reserve(
+        struct RIRingBuffer *buffer, void **pdata, size_t size)
+{
+    /* 引数チェック */
+    if ((buffer == NULL) || (pdata == NULL) || (size == 0)) {
+        return RIRINGBUFFER_APIRESULT_INVALID_ARGUMENT;
+    }
+
+    /* 末尾を跨ぐ場合は剰余領域に書かせるため、最大要求サイズまで */
+    if (size > buffer->max_required_size) {
+        return RIRINGBUFFER_APIRESULT_EXCEED_MAX_REQUIRED;
+    }
+
+    /* バッファに空き領域がない */
+    if (size > RIRingBuffer_GetCapacitySize(buffer)) {
+        return RIRINGBUFFER_APIRESULT_EXCEED_MAX_CAPACITY;
+    }
+
+    /* データ領域先頭とバッファサイズはアラインメントの倍数 書き込み位置のアラインメントがそのまま返す領域のアラインメントになる */
+    assert(((uintptr_t)buffer->data % RIRINGBUFFER_ALIGNMENT) == 0);
+    assert((buffer->buffer_size % RIRINGBUFFER_ALIGNMENT) == 0);
+
+    /* 書き込み位置から連続した領域を返す（末尾を超えた分は剰余領域に入る） */
+    (*pdata) = (void *)(buffer->data + buffer->write_pos);
+
+    return RIRINGBUFFER_APIRESULT_OK;
+}
+
+/* 確保した領域への書き込みを確定 */
+RIRingBufferApiResult RIRingBuffer_Commit(
+        struct RIRingBuffer *buffer, size_t size)
+{
+    size_t write_pos, end_pos;
+
+    /* 引数チェック */
+    if ((buffer == NULL) || (size == 0)) {
+        return RIRINGBUFFER_APIRESULT_INVALID_ARGUMENT;
+    }
+
+    /* Reserveで確保できないサイズ */
+    if (size > buffer->max_required_size) {
+        return RIRINGBUFFER_APIRESULT_EXCEED_MAX_REQUIRED;
+    }
+    if (size > RIRingBuffer_GetCapacitySize(buffer)) {
+        return RIRINGBUFFER_APIRESULT_EXCEED_MAX_CAPACITY;
+    }
+
+    write_pos = buffer->write_pos;
+    end_pos = write_pos + size;
+
+    /* 鏡像マップでは書き込んだ内容が既に両方から見えている */
+    if (buffer->use_mirrored_memory) {
+        RIRingBuffer_PublishWritePosition(buffer, end_pos % buffer->buffer_size);
+        return RIRINGBUFFER_APIRESULT_OK;
+    }
+
+    /* 末尾を超えて剰余領域に書かれた分をバッファ先頭に反映 */
+    if (end_pos > buffer->buffer_size) {
+        memcpy(buffer->data, buffer->data + buffer->buffer_size, end_pos - buffer->buffer_size);
+    }
+
+    /* バッファ先頭の剰余領域に対応する範囲に書かれた分を剰余領域に反映 */
+    if (write_pos < buffer->max_required_size) {
+        const size_t copy_size = RIRINGBUFFER_MIN(end_pos, buffer->max_required_size) - write_pos;
+        memcpy(buffer->data + buffer->buffer_size + write_pos, buffer->data + write_pos, copy_size);
+    }
+
+    /* 書き込み位置の更新 */
+    RIRingBuffer_PublishWritePosition(buffer, end_pos % buffer->buffer_size);
 
     return RIRINGBUFFER_APIRESULT_OK;
 }
@@ -171,13 +381,18 @@ RIRingBufferApiResult RIRingBuffer_Peek(
         return RIRINGBUFFER_APIRESULT_EXCEED_MAX_REQUIRED;
     }
 
+    /* SPSCモードでは前回取得した領域をここで解放 */
+    if (buffer->enable_spsc) {
+        RIRingBuffer_ReleaseGotData(buffer);
+    }
+
     /* 残りデータサイズを超えている */
     if (required_size > RIRingBuffer_GetRemainSize(buffer)) {
         return RIRINGBUFFER_APIRESULT_EXCEED_MAX_REMAIN;
     }
 
     /* データの参照取得 */
-    (*pdata) = (void *)(buffer->data + buffer->read_pos);
+    (*pdata) = (void *)(buffer->data + (buffer->enable_spsc ? buffer->get_pos : buffer->read_pos));
 
     return RIRINGBUFFER_APIRESULT_OK;
 }
@@ -194,8 +409,114 @@ RIRingBufferApiResult RIRingBuffer_Get(
     }
 
     /* バッファ参照位置更新 */
-    buffer->read_pos = (buffer->read_pos + (uint32_t)required_size) % buffer->buffer_size;
+    if (buffer->enable_spsc) {
+        /* 取得した領域は読み出し側が使い終わるまで上書きされないよう、次の読み出し操作まで解放しない */
+        buffer->get_pos = (buffer->get_pos + required_size) % buffer->buffer_size;
+    } else {
+        buffer->read_pos = (buffer->read_pos + required_size) % buffer->buffer_size;
+    }
 
     return RIRINGBUFFER_APIRESULT_OK;
 }
 
+/* 読み出し側が取得済みの領域を解放 */
+static void RIRingBuffer_ReleaseGotData(struct RIRingBuffer *buffer)
+{
+    assert(buffer != NULL);
+    assert(buffer->enable_spsc);
+
+    if (buffer->read_pos != buffer->get_pos) {
+        RIRingBuffer_StoreRelease(&buffer->read_pos, buffer->get_pos);
+    }
+}
+
+/* 書き込み位置の公開 */
+static void RIRingBuffer_PublishWritePosition(struct RIRingBuffer *buffer, size_t write_pos)
+{
+    assert(buffer != NULL);
+
+    if (buffer->enable_spsc) {
+        RIRingBuffer_StoreRelease(&buffer->write_pos, write_pos);
+    } else {
+        buffer->write_pos = write_pos;
+    }
+}
+
+#if defined(RIRINGBUFFER_SUPPORT_MIRRORED_MEMORY)
+/* 鏡像マップしたバッファのサイズ計算 */
+static size_t RIRingBuffer_CalculateMirroredBufferSize(size_t max_size)
+{
+    const long page_size = sysconf(_SC_PAGESIZE);
+    assert(page_size > 0);
+    /* マップはページ単位のため、1要素分多い領域をページサイズに切り上げる */
+    return RIRINGBUFFER_ROUNDUP(max_size + 1, (size_t)page_size);
+}
+
+/* 同一の物理ページを2回連続してマップした領域を作成 */
+static uint8_t *RIRingBuffer_MapMirroredMemory(size_t buffer_size)
+{
+    int fd;
+    uint8_t *base;
+
+    /* 物理ページの実体となる無名ファイル */
+    if ((fd = memfd_create("ri_ring_buffer", MFD_CLOEXEC)) < 0) {
+        return NULL;
+    }
+    if (ftruncate(fd, (off_t)buffer_size) != 0) {
+        close(fd);
+        return NULL;
+    }
+
+    /* 2倍のアドレス範囲を予約し、前半と後半に同じファイルを固定アドレスで重ねる */
+    base = (uint8_t *)mmap(NULL, 2 * buffer_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == (uint8_t *)MAP_FAILED) {
+        close(fd);
+        return NULL;
+    }
+    if ((mmap(base, buffer_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED)
+            || (mmap(base + buffer_size, buffer_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED)) {
+        munmap(base, 2 * buffer_size);
+        close(fd);
+        return NULL;
+    }
+
+    /* マップが残っていればファイル記述子は不要 */
+    close(fd);
+
+    return base;
+}
+#endif
+
+/* 位置の読み出し(acquire) */
+static size_t RIRingBuffer_LoadAcquire(const size_t *pos)
+{
+#if defined(_MSC_VER)
+    /* 値を変えない比較交換で全順序バリア付きの読み出しとする */
+#if defined(_WIN64)
+    return (size_t)_InterlockedCompareExchange64((volatile __int64 *)pos, 0, 0);
+#else
+    return (size_t)_InterlockedCompareExchange((volatile long *)pos, 0, 0);
+#endif
+#elif defined(__GNUC__) || defined(__clang__)
+    return __atomic_load_n(pos, __ATOMIC_ACQUIRE);
+#else
+#error "RIRingBuffer requires atomic load/store support for SPSC mode"
+#endif
+}
+
+/* 位置の書き込み(release) */
+static void RIRingBuffer_StoreRelease(size_t *pos, size_t value)
+{
+#if defined(_MSC_VER)
+#if defined(_WIN64)
+    _InterlockedExchange64((volatile __int64 *)pos, (__int64)value);
+#else
+    _InterlockedExchange((volatile long *)pos, (long)value);
+#endif
+#elif defined(__GNUC__) || defined(__clang__)
+    __atomic_store_n(pos, value, __ATOMIC_RELEASE);
+#else
+#error "RIRingBuffer requires atomic load/store support for SPSC mode"
+#endif
+}
+
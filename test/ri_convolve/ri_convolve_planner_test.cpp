@@ -0,0 +1,265 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include <gtest/gtest.h>
+
+/* テスト対象のモジュール */
+extern "C" {
+#include "../../libs/ri_convolve/src/ri_convolve_planner.c"
+}
+
+/* テストで使うwisdomファイル */
+#define RICONVOLVEPLANNERTEST_WISDOM_PATH "ri_convolve_planner_test_wisdom.txt"
+
+/* テスト用のコンフィグ設定 */
+static void RIConvolvePlannerTest_SetConfig(struct RIConvolveConfig *config,
+        uint32_t max_num_coefficients, uint32_t max_num_input_samples)
+{
+    memset(config, 0, sizeof(struct RIConvolveConfig));
+    config->max_num_coefficients = max_num_coefficients;
+    config->max_num_input_samples = max_num_input_samples;
+}
+
+/* 計画結果のモジュールで畳み込み、直接畳み込みと一致するか確認 */
+static void RIConvolvePlannerTest_CheckPlan(const struct RIConvolvePlan *plan, uint32_t max_latency_num_samples)
+{
+#define NUM_SAMPLES 8192
+    int64_t work_size;
+    void *work, *conv;
+    float *coef, *input, *output, *answer;
+    uint32_t i, j, smpl, latency;
+
+    coef = (float *)malloc(sizeof(float) * plan->config.max_num_coefficients);
+    input = (float *)malloc(sizeof(float) * NUM_SAMPLES);
+    output = (float *)malloc(sizeof(float) * NUM_SAMPLES);
+    answer = (float *)malloc(sizeof(float) * NUM_SAMPLES);
+
+    srand(0);
+    for (i = 0; i < plan->config.max_num_coefficients; i++) {
+        coef[i] = (2.0f * rand() / (float)RAND_MAX - 1.0f) / plan->config.max_num_coefficients;
+    }
+    for (smpl = 0; smpl < NUM_SAMPLES; smpl++) {
+        input[smpl] = 2.0f * rand() / (float)RAND_MAX - 1.0f;
+    }
+    memset(answer, 0, sizeof(float) * NUM_SAMPLES);
+    for (i = 0; i < NUM_SAMPLES; i++) {
+        for (j = 0; j < plan->config.max_num_coefficients; j++) {
+            if (i + j < NUM_SAMPLES) {
+                answer[i + j] += coef[j] * input[i];
+            }
+        }
+    }
+
+    ASSERT_TRUE(plan->convolve_if != NULL);
+    work_size = plan->convolve_if->CalculateWorkSize(&plan->config);
+    ASSERT_TRUE(work_size > 0);
+    work = malloc((size_t)work_size);
+    conv = plan->convolve_if->Create(&plan->config, work, work_size);
+    ASSERT_TRUE(conv != NULL);
+    plan->convolve_if->SetCoefficients(conv, coef, plan->config.max_num_coefficients);
+
+    latency = (uint32_t)plan->convolve_if->GetLatencyNumSamples(conv);
+    EXPECT_TRUE(latency <= max_latency_num_samples);
+
+    for (smpl = 0; smpl < NUM_SAMPLES; smpl += plan->config.max_num_input_samples) {
+        plan->convolve_if->Convolve(conv, &input[smpl], &output[smpl], plan->config.max_num_input_samples);
+    }
+    for (smpl = 0; smpl < NUM_SAMPLES - latency; smpl++) {
+        EXPECT_NEAR(answer[smpl], output[smpl + latency], 1e-4f);
+    }
+
+    plan->convolve_if->Destroy(conv);
+    free(work);
+    free(coef);
+    free(input);
+    free(output);
+    free(answer);
+#undef NUM_SAMPLES
+}
+
+/* ワークサイズ計算テスト */
+TEST(RIConvolvePlannerTest, CalculateWorkSizeTest)
+{
+    struct RIConvolveConfig config;
+
+    RIConvolvePlannerTest_SetConfig(&config, 1000, 256);
+    EXPECT_TRUE(RIConvolvePlanner_CalculateWorkSize(&config) > 0);
+
+    /* 全候補のインスタンスが入る */
+    EXPECT_TRUE(RIConvolvePlanner_CalculateWorkSize(&config)
+            >= RIKaratsuba_GetInterface()->CalculateWorkSize(&config));
+    config.fft_partition_size = 1024;
+    EXPECT_TRUE(RIConvolvePlanner_CalculateWorkSize(&config)
+            >= RIFFTConvolve_GetInterface()->CalculateWorkSize(&config));
+
+    /* 不正な引数 */
+    EXPECT_TRUE(RIConvolvePlanner_CalculateWorkSize(NULL) < 0);
+}
+
+/* 計画テスト */
+TEST(RIConvolvePlannerTest, PlanTest)
+{
+    /* 不正な引数 */
+    {
+        struct RIConvolveConfig config;
+        struct RIConvolvePlan plan;
+        int64_t work_size;
+        void *work;
+
+        RIConvolvePlannerTest_SetConfig(&config, 1000, 256);
+        work_size = RIConvolvePlanner_CalculateWorkSize(&config);
+        work = malloc((size_t)work_size);
+
+        EXPECT_EQ(RICONVOLVEPLANNER_APIRESULT_INVALID_ARGUMENT, RIConvolvePlanner_Plan(NULL, 0, &plan, work, work_size));
+        EXPECT_EQ(RICONVOLVEPLANNER_APIRESULT_INVALID_ARGUMENT, RIConvolvePlanner_Plan(&config, 0, NULL, work, work_size));
+        EXPECT_EQ(RICONVOLVEPLANNER_APIRESULT_INVALID_ARGUMENT, RIConvolvePlanner_Plan(&config, 0, &plan, NULL, work_size));
+        EXPECT_EQ(RICONVOLVEPLANNER_APIRESULT_INSUFFICIENT_BUFFER, RIConvolvePlanner_Plan(&config, 0, &plan, work, work_size - 1));
+        config.max_num_input_samples = 0;
+        EXPECT_EQ(RICONVOLVEPLANNER_APIRESULT_INVALID_ARGUMENT, RIConvolvePlanner_Plan(&config, 0, &plan, work, work_size));
+
+        free(work);
+    }
+
+    /* 様々な条件で計画し、結果の動作とレイテンシーを確認 */
+    {
+        static const struct {
+            uint32_t max_num_coefficients;
+            uint32_t max_num_input_samples;
+            uint32_t max_latency_num_samples;
+            uint8_t use_worker_thread;
+        } test_cases[] = {
+            {    100,  64,     0, 0 },
+            {   1000, 128,     0, 0 },
+            {   1000, 128,  4096, 0 },
+            {   4000, 256,   512, 0 },
+            {   4000, 256,     0, 1 },
+        };
+        uint32_t i;
+
+        for (i = 0; i < sizeof(test_cases) / sizeof(test_cases[0]); i++) {
+            struct RIConvolveConfig config;
+            struct RIConvolvePlan plan;
+            int64_t work_size;
+            void *work;
+
+            RIConvolvePlannerTest_SetConfig(&config,
+                    test_cases[i].max_num_coefficients, test_cases[i].max_num_input_samples);
+            config.use_worker_thread = test_cases[i].use_worker_thread;
+            work_size = RIConvolvePlanner_CalculateWorkSize(&config);
+            ASSERT_TRUE(work_size > 0);
+            work = malloc((size_t)work_size);
+
+            ASSERT_EQ(RICONVOLVEPLANNER_APIRESULT_OK,
+                    RIConvolvePlanner_Plan(&config, test_cases[i].max_latency_num_samples, &plan, work, work_size));
+            EXPECT_TRUE(plan.engine < RICONVOLVEPLANNER_ENGINE_NUM);
+            EXPECT_EQ(RIConvolvePlanner_GetInterface(plan.engine), plan.convolve_if);
+            EXPECT_EQ(config.max_num_coefficients, plan.config.max_num_coefficients);
+            EXPECT_EQ(config.max_num_input_samples, plan.config.max_num_input_samples);
+            EXPECT_EQ(config.use_worker_thread, plan.config.use_worker_thread);
+            /* ゼロレイテンシーが必要な場合はFFT畳み込みを選ばない */
+            if (test_cases[i].max_latency_num_samples == 0) {
+                EXPECT_NE(RICONVOLVEPLANNER_ENGINE_FFT, plan.engine);
+            }
+            RIConvolvePlannerTest_CheckPlan(&plan, test_cases[i].max_latency_num_samples);
+
+            free(work);
+        }
+    }
+}
+
+/* wisdomファイル読み書きテスト */
+TEST(RIConvolvePlannerTest, WisdomTest)
+{
+    struct RIConvolveConfig config, other_config;
+    struct RIConvolvePlan plan, loaded;
+
+    remove(RICONVOLVEPLANNERTEST_WISDOM_PATH);
+
+    RIConvolvePlannerTest_SetConfig(&config, 1000, 256);
+    RIConvolvePlannerTest_SetConfig(&other_config, 2000, 256);
+    RIConvolvePlanner_SetupCandidate(RICONVOLVEPLANNER_ENGINE_FFT, 512, &config, &plan);
+
+    /* 不正な引数 */
+    EXPECT_EQ(RICONVOLVEPLANNER_APIRESULT_INVALID_ARGUMENT, RIConvolvePlanner_LoadWisdom(NULL, &config, 0, &loaded));
+    EXPECT_EQ(RICONVOLVEPLANNER_APIRESULT_INVALID_ARGUMENT, RIConvolvePlanner_LoadWisdom(RICONVOLVEPLANNERTEST_WISDOM_PATH, NULL, 0, &loaded));
+    EXPECT_EQ(RICONVOLVEPLANNER_APIRESULT_INVALID_ARGUMENT, RIConvolvePlanner_LoadWisdom(RICONVOLVEPLANNERTEST_WISDOM_PATH, &config, 0, NULL));
+    EXPECT_EQ(RICONVOLVEPLANNER_APIRESULT_INVALID_ARGUMENT, RIConvolvePlanner_SaveWisdom(NULL, &config, 0, &plan));
+    EXPECT_EQ(RICONVOLVEPLANNER_APIRESULT_INVALID_ARGUMENT, RIConvolvePlanner_SaveWisdom(RICONVOLVEPLANNERTEST_WISDOM_PATH, NULL, 0, &plan));
+    EXPECT_EQ(RICONVOLVEPLANNER_APIRESULT_INVALID_ARGUMENT, RIConvolvePlanner_SaveWisdom(RICONVOLVEPLANNERTEST_WISDOM_PATH, &config, 0, NULL));
+
+    /* ファイルがない */
+    EXPECT_EQ(RICONVOLVEPLANNER_APIRESULT_NOT_FOUND,
+            RIConvolvePlanner_LoadWisdom(RICONVOLVEPLANNERTEST_WISDOM_PATH, &config, 1024, &loaded));
+
+    /* 保存した計画を読み出せる */
+    ASSERT_EQ(RICONVOLVEPLANNER_APIRESULT_OK,
+            RIConvolvePlanner_SaveWisdom(RICONVOLVEPLANNERTEST_WISDOM_PATH, &config, 1024, &plan));
+    ASSERT_EQ(RICONVOLVEPLANNER_APIRESULT_OK,
+            RIConvolvePlanner_LoadWisdom(RICONVOLVEPLANNERTEST_WISDOM_PATH, &config, 1024, &loaded));
+    EXPECT_EQ(RICONVOLVEPLANNER_ENGINE_FFT, loaded.engine);
+    EXPECT_EQ(RIFFTConvolve_GetInterface(), loaded.convolve_if);
+    EXPECT_EQ(0, memcmp(&plan.config, &loaded.config, sizeof(struct RIConvolveConfig)));
+
+    /* 条件が違えば見つからない */
+    EXPECT_EQ(RICONVOLVEPLANNER_APIRESULT_NOT_FOUND,
+            RIConvolvePlanner_LoadWisdom(RICONVOLVEPLANNERTEST_WISDOM_PATH, &config, 0, &loaded));
+    EXPECT_EQ(RICONVOLVEPLANNER_APIRESULT_NOT_FOUND,
+            RIConvolvePlanner_LoadWisdom(RICONVOLVEPLANNERTEST_WISDOM_PATH, &other_config, 1024, &loaded));
+
+    /* 解釈できない行は読み飛ばし、同じ条件は後から追記したものを優先 */
+    {
+        FILE *fp = fopen(RICONVOLVEPLANNERTEST_WISDOM_PATH, "a");
+        ASSERT_TRUE(fp != NULL);
+        fprintf(fp, "broken line\n");
+        fprintf(fp, RICONVOLVEPLANNER_WISDOM_TAG " 1 2 3\n");
+        fclose(fp);
+    }
+    RIConvolvePlanner_SetupCandidate(RICONVOLVEPLANNER_ENGINE_ZEROLATENCY_FFT, 256, &config, &plan);
+    ASSERT_EQ(RICONVOLVEPLANNER_APIRESULT_OK,
+            RIConvolvePlanner_SaveWisdom(RICONVOLVEPLANNERTEST_WISDOM_PATH, &config, 1024, &plan));
+    ASSERT_EQ(RICONVOLVEPLANNER_APIRESULT_OK,
+            RIConvolvePlanner_LoadWisdom(RICONVOLVEPLANNERTEST_WISDOM_PATH, &config, 1024, &loaded));
+    EXPECT_EQ(RICONVOLVEPLANNER_ENGINE_ZEROLATENCY_FFT, loaded.engine);
+    EXPECT_EQ(RIZeroLatencyFFTConvolve_GetInterface(), loaded.convolve_if);
+    EXPECT_EQ(256, loaded.config.fft_partition_size);
+
+    /* 別のマシンで保存した計画は後から追記されていても使わない */
+    {
+        FILE *fp = fopen(RICONVOLVEPLANNERTEST_WISDOM_PATH, "a");
+        ASSERT_TRUE(fp != NULL);
+        fprintf(fp, RICONVOLVEPLANNER_WISDOM_TAG " other-machine %lu %lu 0 0 0 1024 %d 64 0\n",
+                (unsigned long)config.max_num_coefficients, (unsigned long)config.max_num_input_samples,
+                RICONVOLVEPLANNER_ENGINE_FFT);
+        fclose(fp);
+    }
+    ASSERT_EQ(RICONVOLVEPLANNER_APIRESULT_OK,
+            RIConvolvePlanner_LoadWisdom(RICONVOLVEPLANNERTEST_WISDOM_PATH, &config, 1024, &loaded));
+    EXPECT_EQ(RICONVOLVEPLANNER_ENGINE_ZEROLATENCY_FFT, loaded.engine);
+    EXPECT_EQ(256, loaded.config.fft_partition_size);
+
+    remove(RICONVOLVEPLANNERTEST_WISDOM_PATH);
+}
+
+/* マシンキー取得テスト */
+TEST(RIConvolvePlannerTest, GetMachineKeyTest)
+{
+    char key[RICONVOLVEPLANNER_MACHINE_KEY_LENGTH + 1];
+    char again[RICONVOLVEPLANNER_MACHINE_KEY_LENGTH + 1];
+    size_t i;
+
+    RIConvolvePlanner_GetMachineKey(key);
+    RIConvolvePlanner_GetMachineKey(again);
+
+    /* wisdomファイルの1語として読めること */
+    ASSERT_TRUE(strlen(key) > 0);
+    ASSERT_TRUE(strlen(key) <= RICONVOLVEPLANNER_MACHINE_KEY_LENGTH);
+    for (i = 0; i < strlen(key); i++) {
+        EXPECT_TRUE(isgraph((unsigned char)key[i]));
+    }
+    EXPECT_EQ(0, strncmp(key, RICONVOLVEPLANNER_ARCH_NAME "-" RICONVOLVEPLANNER_ISA_NAME "-",
+                strlen(RICONVOLVEPLANNER_ARCH_NAME "-" RICONVOLVEPLANNER_ISA_NAME "-")));
+    /* 同じマシンなら同じキー */
+    EXPECT_STREQ(key, again);
+}
@@ -0,0 +1,316 @@
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+/* テスト対象のモジュール */
+extern "C" {
+#include "../../libs/ri_convolve/src/ri_convolve_statistics.c"
+}
+#include "../../libs/ri_convolve/include/ri_karatsuba.h"
+#include "../../libs/ri_convolve/include/ri_toom_cook.h"
+#include "../../libs/ri_convolve/include/ri_direct_fir.h"
+#include "../../libs/ri_convolve/include/ri_fft_convolve.h"
+#include "../../libs/ri_convolve/include/ri_zerolatency_fft_convolve.h"
+
+/* ヒストグラムの度数の合計 */
+static uint64_t RIConvolveStatisticsTest_SumHistogram(const struct RIConvolveStatistics *statistics)
+{
+    uint32_t i;
+    uint64_t sum = 0;
+
+    for (i = 0; i < RICONVOLVE_STATISTICS_NUM_HISTOGRAM_BINS; i++) {
+        sum += statistics->histogram[i];
+    }
+
+    return sum;
+}
+
+/* 集計と公開のテスト */
+TEST(RIConvolveStatisticsTest, RecordCallTest)
+{
+    struct RIConvolveStatisticsCounter counter;
+    struct RIConvolveStatistics statistics;
+
+    RIConvolveStatistics_Initialize(&counter);
+    RIConvolveStatistics_Snapshot(&counter, &statistics);
+    EXPECT_EQ(0U, statistics.num_calls);
+    EXPECT_EQ(0U, statistics.num_samples);
+    EXPECT_EQ(0U, RIConvolveStatisticsTest_SumHistogram(&statistics));
+
+    /* サンプル数0の呼び出しは数えない */
+    RIConvolveStatistics_RecordCall(&counter, 0, 12345);
+    RIConvolveStatistics_RecordCall(&counter, 64, 10);
+    RIConvolveStatistics_RecordCall(&counter, 32, 3);
+    RIConvolveStatistics_RecordCall(&counter, 64, 1000);
+
+    /* 公開するまで読み出し側には見えない */
+    RIConvolveStatistics_Snapshot(&counter, &statistics);
+    EXPECT_EQ(0U, statistics.num_calls);
+
+    RIConvolveStatistics_Publish(&counter);
+    RIConvolveStatistics_Snapshot(&counter, &statistics);
+    EXPECT_EQ(3U, statistics.num_calls);
+    EXPECT_EQ(160U, statistics.num_samples);
+    EXPECT_EQ(3U, statistics.min_ticks);
+    EXPECT_EQ(1000U, statistics.max_ticks);
+    EXPECT_EQ(1013U, statistics.total_ticks);
+    EXPECT_EQ(3U, RIConvolveStatisticsTest_SumHistogram(&statistics));
+    EXPECT_EQ(1U, statistics.histogram[1]); /* 3 */
+    EXPECT_EQ(1U, statistics.histogram[3]); /* 10 */
+    EXPECT_EQ(1U, statistics.histogram[9]); /* 1000 */
+
+    /* 0と1は先頭のビン, 範囲外は末尾のビン */
+    RIConvolveStatistics_Initialize(&counter);
+    RIConvolveStatistics_RecordCall(&counter, 1, 0);
+    RIConvolveStatistics_RecordCall(&counter, 1, 1);
+    RIConvolveStatistics_RecordCall(&counter, 1, UINT64_MAX);
+    RIConvolveStatistics_Publish(&counter);
+    RIConvolveStatistics_Snapshot(&counter, &statistics);
+    EXPECT_EQ(0U, statistics.min_ticks);
+    EXPECT_EQ(2U, statistics.histogram[0]);
+    EXPECT_EQ(1U, statistics.histogram[RICONVOLVE_STATISTICS_NUM_HISTOGRAM_BINS - 1]);
+}
+
+/* パーセンタイル取得のテスト */
+TEST(RIConvolveStatisticsTest, GetPercentileTicksTest)
+{
+    uint32_t i;
+    struct RIConvolveStatisticsCounter counter;
+    struct RIConvolveStatistics statistics;
+
+    /* 呼び出しがなければ0 */
+    RIConvolveStatistics_Initialize(&counter);
+    RIConvolveStatistics_Snapshot(&counter, &statistics);
+    EXPECT_EQ(0U, RIConvolveStatistics_GetPercentileTicks(&statistics, 99));
+
+    /* 99回は100ティック, 1回だけ5000ティック */
+    for (i = 0; i < 99; i++) {
+        RIConvolveStatistics_RecordCall(&counter, 256, 100);
+    }
+    RIConvolveStatistics_RecordCall(&counter, 256, 5000);
+    RIConvolveStatistics_Publish(&counter);
+    RIConvolveStatistics_Snapshot(&counter, &statistics);
+
+    /* 100は[64, 128)のビンに入るのでその上端 */
+    EXPECT_EQ(127U, RIConvolveStatistics_GetPercentileTicks(&statistics, 0));
+    EXPECT_EQ(127U, RIConvolveStatistics_GetPercentileTicks(&statistics, 50));
+    EXPECT_EQ(127U, RIConvolveStatistics_GetPercentileTicks(&statistics, 99));
+    /* 最大値を超えない */
+    EXPECT_EQ(5000U, RIConvolveStatistics_GetPercentileTicks(&statistics, 100));
+
+    /* 最悪値が1%を超えればp99に現れる */
+    RIConvolveStatistics_RecordCall(&counter, 256, 5000);
+    RIConvolveStatistics_Publish(&counter);
+    RIConvolveStatistics_Snapshot(&counter, &statistics);
+    EXPECT_EQ(5000U, RIConvolveStatistics_GetPercentileTicks(&statistics, 99));
+}
+
+/* 書き込みと並行したスナップショットの一貫性テスト */
+TEST(RIConvolveStatisticsTest, ConcurrentSnapshotTest)
+{
+#define NUM_CALLS 200000
+    struct RIConvolveStatisticsCounter counter;
+    uint32_t num_errors = 0;
+
+    RIConvolveStatistics_Initialize(&counter);
+
+    /* 書き込みスレッド: 1呼び出し毎に公開 */
+    std::thread writer([&counter]() {
+        uint32_t i;
+        for (i = 0; i < NUM_CALLS; i++) {
+            RIConvolveStatistics_RecordCall(&counter, 2, i);
+            RIConvolveStatistics_Publish(&counter);
+        }
+    });
+
+    /* 読み出しスレッド: 各値が同じ時点のものか確認 */
+    std::thread reader([&counter, &num_errors]() {
+        uint64_t prev_num_calls = 0;
+        struct RIConvolveStatistics statistics;
+        do {
+            RIConvolveStatistics_Snapshot(&counter, &statistics);
+            if ((statistics.num_samples != 2 * statistics.num_calls)
+                    || (RIConvolveStatisticsTest_SumHistogram(&statistics) != statistics.num_calls)
+                    || (statistics.num_calls < prev_num_calls)) {
+                num_errors++;
+            }
+            if ((statistics.num_calls > 0)
+                    && ((statistics.max_ticks != statistics.num_calls - 1)
+                        || (2 * statistics.total_ticks != statistics.num_calls * (statistics.num_calls - 1)))) {
+                num_errors++;
+            }
+            prev_num_calls = statistics.num_calls;
+        } while (prev_num_calls < NUM_CALLS);
+    });
+
+    writer.join();
+    reader.join();
+    EXPECT_EQ(0U, num_errors);
+#undef NUM_CALLS
+}
+
+/* 各畳み込みモジュールの統計情報取得テスト */
+TEST(RIConvolveStatisticsTest, GetStatisticsTest)
+{
+#define NUM_COEFFICIENTS 4096
+#define NUM_BLOCK_SAMPLES 64
+#define NUM_CALLS 64
+    static float coef[NUM_COEFFICIENTS];
+    static float data[NUM_BLOCK_SAMPLES];
+    struct RIConvolveConfig config;
+    struct RIConvolveStatistics statistics;
+    uint32_t i;
+
+    srand(0);
+    for (i = 0; i < NUM_COEFFICIENTS; i++) {
+        coef[i] = 2.0f * ((float)rand() / RAND_MAX - 0.5f);
+    }
+    for (i = 0; i < NUM_BLOCK_SAMPLES; i++) {
+        data[i] = 2.0f * ((float)rand() / RAND_MAX - 0.5f);
+    }
+
+    config.max_num_coefficients = NUM_COEFFICIENTS;
+    config.max_num_input_samples = NUM_BLOCK_SAMPLES;
+    config.fft_partition_size = 0;
+    config.num_head_coefficients = 0;
+    config.num_delay_samples = 0;
+    config.use_worker_thread = 0;
+
+    /* 全モジュールで呼び出し回数・サンプル数・処理時間が数えられる */
+    {
+        const struct RIConvolveInterface *ifs[] = {
+            RIKaratsuba_GetInterface(),
+            RIToomCook_GetInterface(),
+            RIDirectFIR_GetInterface(),
+            RIFFTConvolve_GetInterface(),
+            RIZeroLatencyFFTConvolve_GetInterface(),
+        };
+        const uint8_t uses_fft[] = { 0, 0, 0, 1, 1 };
+
+        for (i = 0; i < sizeof(ifs) / sizeof(ifs[0]); i++) {
+            uint32_t call;
+            void *work, *conv;
+            const int64_t work_size = ifs[i]->CalculateWorkSize(&config);
+            ASSERT_TRUE(work_size > 0);
+            work = malloc((size_t)work_size);
+            conv = ifs[i]->Create(&config, work, work_size);
+            ASSERT_TRUE(conv != NULL);
+            if (ifs[i] == RIZeroLatencyFFTConvolve_GetInterface()) {
+                RIZeroLatencyFFTConvolve_CalibratePartitionSize(conv, coef, NUM_COEFFICIENTS);
+            } else {
+                ifs[i]->SetCoefficients(conv, coef, NUM_COEFFICIENTS);
+            }
+
+            /* 係数設定時の分割サイズの計測は数えない */
+            ASSERT_EQ(1, ifs[i]->GetStatistics(conv, &statistics));
+            EXPECT_EQ(0U, statistics.num_calls);
+            EXPECT_EQ(0U, statistics.num_ffts);
+
+            for (call = 0; call < NUM_CALLS; call++) {
+                ifs[i]->Convolve(conv, data, data, NUM_BLOCK_SAMPLES);
+            }
+            /* サンプル数0の呼び出しは数えない */
+            ifs[i]->Convolve(conv, data, data, 0);
+
+            ASSERT_EQ(1, ifs[i]->GetStatistics(conv, &statistics));
+            EXPECT_EQ((uint64_t)NUM_CALLS, statistics.num_calls);
+            EXPECT_EQ((uint64_t)NUM_CALLS * NUM_BLOCK_SAMPLES, statistics.num_samples);
+            EXPECT_EQ((uint64_t)NUM_CALLS, RIConvolveStatisticsTest_SumHistogram(&statistics));
+            EXPECT_TRUE(statistics.min_ticks <= statistics.max_ticks);
+            EXPECT_TRUE(statistics.max_ticks <= statistics.total_ticks);
+            if (uses_fft[i]) {
+                EXPECT_TRUE(statistics.num_ffts > 0);
+                EXPECT_EQ(statistics.num_ffts, statistics.num_iffts);
+                EXPECT_TRUE(statistics.num_partition_macs >= statistics.num_ffts);
+            } else {
+                EXPECT_EQ(0U, statistics.num_ffts);
+                EXPECT_EQ(0U, statistics.num_iffts);
+                EXPECT_EQ(0U, statistics.num_partition_macs);
+            }
+
+            ifs[i]->Destroy(conv);
+            free(work);
+        }
+    }
+
+    /* FFT畳み込みの変換回数と分割毎の積和回数 */
+    {
+        const struct RIConvolveInterface *conv_if = RIFFTConvolve_GetInterface();
+        struct RIConvolveConfig fft_config = config;
+        int64_t work_size;
+        uint32_t call, num_blocks;
+        void *work, *conv;
+
+        /* 分割サイズ256で最大3分割, 係数は2分割（2の冪乗に切り上げた4分割ではなく3分割に対して省略を数える） */
+        fft_config.fft_partition_size = 256;
+        fft_config.max_num_coefficients = 768;
+        work_size = conv_if->CalculateWorkSize(&fft_config);
+        ASSERT_TRUE(work_size > 0);
+        work = malloc((size_t)work_size);
+        conv = conv_if->Create(&fft_config, work, work_size);
+        ASSERT_TRUE(conv != NULL);
+        conv_if->SetCoefficients(conv, coef, 512);
+
+        for (call = 0; call < NUM_CALLS; call++) {
+            conv_if->Convolve(conv, data, data, NUM_BLOCK_SAMPLES);
+        }
+
+        /* 分割サイズ分の入力毎に1回ずつ変換 */
+        num_blocks = (NUM_CALLS * NUM_BLOCK_SAMPLES) / 256;
+        ASSERT_EQ(1, conv_if->GetStatistics(conv, &statistics));
+        EXPECT_EQ((uint64_t)num_blocks, statistics.num_ffts);
+        EXPECT_EQ((uint64_t)num_blocks, statistics.num_iffts);
+        EXPECT_EQ((uint64_t)num_blocks * 2, statistics.num_partition_macs);
+        EXPECT_EQ((uint64_t)num_blocks, statistics.num_skipped_partition_macs);
+
+        conv_if->Destroy(conv);
+        free(work);
+    }
+
+    /* ゼロレイテンシー畳み込みの複数インスタンスとワーカースレッド使用時 */
+    {
+        const struct RIConvolveInterface *conv_if = RIZeroLatencyFFTConvolve_GetInterface();
+        struct RIConvolveConfig zl_config = config;
+        static float data2[NUM_BLOCK_SAMPLES];
+        void *works[2], *convs[2];
+        float *datas[2];
+        int64_t work_size;
+        uint32_t ch, call;
+
+        zl_config.use_worker_thread = 1;
+        work_size = conv_if->CalculateWorkSize(&zl_config);
+        ASSERT_TRUE(work_size > 0);
+        for (ch = 0; ch < 2; ch++) {
+            works[ch] = malloc((size_t)work_size);
+            convs[ch] = conv_if->Create(&zl_config, works[ch], work_size);
+            ASSERT_TRUE(convs[ch] != NULL);
+            conv_if->SetCoefficients(convs[ch], coef, NUM_COEFFICIENTS);
+        }
+
+        memcpy(data2, data, sizeof(data));
+        datas[0] = data;
+        datas[1] = data2;
+        for (call = 0; call < NUM_CALLS; call++) {
+            for (ch = 0; ch < 2; ch++) {
+                conv_if->Convolve(convs[ch], datas[ch], datas[ch], NUM_BLOCK_SAMPLES);
+            }
+        }
+
+        for (ch = 0; ch < 2; ch++) {
+            /* ワーカースレッドの処理完了を待つためにリセット */
+            conv_if->Reset(convs[ch]);
+            ASSERT_EQ(1, conv_if->GetStatistics(convs[ch], &statistics));
+            EXPECT_EQ((uint64_t)NUM_CALLS, statistics.num_calls);
+            EXPECT_EQ((uint64_t)NUM_CALLS * NUM_BLOCK_SAMPLES, statistics.num_samples);
+            EXPECT_TRUE(statistics.num_ffts > 0);
+            EXPECT_EQ(statistics.num_ffts, statistics.num_iffts);
+            conv_if->Destroy(convs[ch]);
+            free(works[ch]);
+        }
+    }
+#undef NUM_COEFFICIENTS
+#undef NUM_BLOCK_SAMPLES
+#undef NUM_CALLS
+}
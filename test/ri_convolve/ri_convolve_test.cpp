@@ -12,6 +12,8 @@
 
 /* テスト対象のモジュール */
 #include "../../libs/ri_convolve/include/ri_karatsuba.h"
+#include "../../libs/ri_convolve/include/ri_toom_cook.h"
+#include "../../libs/ri_convolve/include/ri_direct_fir.h"
 #include "../../libs/ri_convolve/include/ri_fft_convolve.h"
 #include "../../libs/ri_convolve/include/ri_zerolatency_fft_convolve.h"
 
@@ -38,7 +40,7 @@ static void ConvolveCheckSub(
         const float *input, uint32_t num_samples,
         const float *coef, uint32_t num_coefs)
 {
-    int32_t work_size;
+    int64_t work_size;
     void *work, *conv;
     float *answer, *test;
     uint32_t smpl;
@@ -248,16 +250,294 @@ TEST(RIConvolveTest, ConvolveTest)
 {
     struct RIConvolveConfig config;
 
+    config.max_num_coefficients = 100;
+    config.max_num_input_samples = 64;
+    config.fft_partition_size = 0;
+    config.num_head_coefficients = 0;
+    config.num_delay_samples = 0;
+    config.use_worker_thread = 0;
+    ConvolveCheck(RIKaratsuba_GetInterface(), &config);
+    ConvolveCheck(RIToomCook_GetInterface(), &config);
+    ConvolveCheck(RIDirectFIR_GetInterface(), &config);
+    ConvolveCheck(RIZeroLatencyFFTConvolve_GetInterface(), &config);
+
     config.max_num_coefficients = 200;
     config.max_num_input_samples = 256;
+    config.fft_partition_size = 0;
+    config.num_head_coefficients = 0;
     ConvolveCheck(RIKaratsuba_GetInterface(), &config);
+    ConvolveCheck(RIToomCook_GetInterface(), &config);
+    ConvolveCheck(RIDirectFIR_GetInterface(), &config);
     ConvolveCheck(RIFFTConvolve_GetInterface(), &config);
     ConvolveCheck(RIZeroLatencyFFTConvolve_GetInterface(), &config);
 
     config.max_num_coefficients = 10000;
     config.max_num_input_samples = 512;
+    config.fft_partition_size = 0;
+    config.num_head_coefficients = 0;
+    ConvolveCheck(RIFFTConvolve_GetInterface(), &config);
+    ConvolveCheck(RIZeroLatencyFFTConvolve_GetInterface(), &config);
+
+    config.max_num_coefficients = 3000;
+    config.max_num_input_samples = 32;
+    config.fft_partition_size = 64;
+    config.num_head_coefficients = 64;
     ConvolveCheck(RIFFTConvolve_GetInterface(), &config);
     ConvolveCheck(RIZeroLatencyFFTConvolve_GetInterface(), &config);
+    config.fft_partition_size = 0;
+    config.num_head_coefficients = 300;
+    ConvolveCheck(RIZeroLatencyFFTConvolve_GetInterface(), &config);
+
+    /* FFT畳み込み段をワーカースレッドで処理 */
+    config.max_num_coefficients = 10000;
+    config.max_num_input_samples = 512;
+    config.fft_partition_size = 0;
+    config.num_head_coefficients = 0;
+    config.use_worker_thread = 1;
+    ConvolveCheck(RIZeroLatencyFFTConvolve_GetInterface(), &config);
+    config.max_num_coefficients = 3000;
+    config.max_num_input_samples = 32;
+    config.fft_partition_size = 64;
+    ConvolveCheck(RIZeroLatencyFFTConvolve_GetInterface(), &config);
 }
 
+/* 要素間隔を指定した畳み込みの一致確認 */
+static void ConvolveStridedCheck(
+        const struct RIConvolveInterface *convif,
+        const struct RIConvolveConfig *config, uint32_t input_stride, uint32_t output_stride)
+{
+    const uint32_t num_samples = 8192;
+    const float sentinel = 12345.0f;
+    int64_t work_size;
+    void *work, *conv;
+    float *input, *coef, *answer, *strided_input, *strided_output;
+    uint32_t smpl, latency;
+
+    work_size = convif->CalculateWorkSize(config);
+    assert(work_size >= 0);
+    work = malloc((size_t)work_size);
+    conv = convif->Create(config, work, work_size);
+    assert(conv != NULL);
+
+    input = (float *)malloc(sizeof(float) * num_samples);
+    coef = (float *)malloc(sizeof(float) * config->max_num_coefficients);
+    answer = (float *)malloc(sizeof(float) * num_samples);
+    strided_input = (float *)malloc(sizeof(float) * num_samples * input_stride);
+    strided_output = (float *)malloc(sizeof(float) * num_samples * output_stride);
+
+    srand(0);
+    for (smpl = 0; smpl < num_samples; smpl++) {
+        input[smpl] = 2.0f * rand() / (float)RAND_MAX - 1.0f;
+    }
+    for (smpl = 0; smpl < config->max_num_coefficients; smpl++) {
+        coef[smpl] = (2.0f * rand() / (float)RAND_MAX - 1.0f) / config->max_num_coefficients;
+    }
+    DirectConvolve(coef, config->max_num_coefficients, input, answer, num_samples);
+    convif->SetCoefficients(conv, coef, config->max_num_coefficients);
+
+    /* 他チャンネルの位置は番兵で埋めておく */
+    for (smpl = 0; smpl < num_samples * input_stride; smpl++) {
+        strided_input[smpl] = sentinel;
+    }
+    for (smpl = 0; smpl < num_samples; smpl++) {
+        strided_input[smpl * input_stride] = input[smpl];
+    }
+    for (smpl = 0; smpl < num_samples * output_stride; smpl++) {
+        strided_output[smpl] = sentinel;
+    }
 
+    /* ブロックサイズを変えながら実行 */
+    smpl = 0;
+    while (smpl < num_samples) {
+        const uint32_t rand_input = (uint32_t)rand() % (config->max_num_input_samples + 1);
+        const uint32_t num_block_samples = MIN(rand_input, num_samples - smpl);
+        convif->ConvolveStrided(conv, &strided_input[smpl * input_stride], input_stride,
+                &strided_output[smpl * output_stride], output_stride, num_block_samples);
+        smpl += num_block_samples;
+    }
+
+    /* 一致確認 */
+    latency = (uint32_t)convif->GetLatencyNumSamples(conv);
+    assert(latency < num_samples);
+    for (smpl = 0; smpl < num_samples - latency; smpl++) {
+        if (fabs(answer[smpl] - strided_output[(smpl + latency) * output_stride]) > FLOAT_EPSILON) {
+            printf("test failed. stride:%d/%d %d answer:%f actual:%f \n", input_stride, output_stride,
+                    smpl, answer[smpl], strided_output[(smpl + latency) * output_stride]);
+            FAIL();
+        }
+    }
+    /* 他チャンネルの位置は書き換えない */
+    for (smpl = 0; smpl < num_samples * output_stride; smpl++) {
+        if ((smpl % output_stride) != 0) {
+            ASSERT_EQ(sentinel, strided_output[smpl]);
+        }
+    }
+
+    convif->Destroy(conv);
+    free(work);
+    free(input);
+    free(coef);
+    free(answer);
+    free(strided_input);
+    free(strided_output);
+}
+
+/* 要素間隔を指定した畳み込みテスト */
+TEST(RIConvolveTest, ConvolveStridedTest)
+{
+    static const uint32_t strides[][2] = { { 1, 1 }, { 2, 2 }, { 3, 1 }, { 1, 4 } };
+    struct RIConvolveConfig config;
+    uint32_t i;
+
+    for (i = 0; i < sizeof(strides) / sizeof(strides[0]); i++) {
+        const uint32_t input_stride = strides[i][0], output_stride = strides[i][1];
+
+        config.max_num_coefficients = 200;
+        config.max_num_input_samples = 256;
+        config.fft_partition_size = 0;
+        config.num_head_coefficients = 0;
+        config.num_delay_samples = 0;
+        config.use_worker_thread = 0;
+        ConvolveStridedCheck(RIKaratsuba_GetInterface(), &config, input_stride, output_stride);
+        ConvolveStridedCheck(RIToomCook_GetInterface(), &config, input_stride, output_stride);
+        ConvolveStridedCheck(RIDirectFIR_GetInterface(), &config, input_stride, output_stride);
+        ConvolveStridedCheck(RIFFTConvolve_GetInterface(), &config, input_stride, output_stride);
+        ConvolveStridedCheck(RIZeroLatencyFFTConvolve_GetInterface(), &config, input_stride, output_stride);
+
+        config.max_num_coefficients = 10000;
+        config.max_num_input_samples = 512;
+        ConvolveStridedCheck(RIFFTConvolve_GetInterface(), &config, input_stride, output_stride);
+        ConvolveStridedCheck(RIZeroLatencyFFTConvolve_GetInterface(), &config, input_stride, output_stride);
+        config.use_worker_thread = 1;
+        ConvolveStridedCheck(RIZeroLatencyFFTConvolve_GetInterface(), &config, input_stride, output_stride);
+    }
+}
+
+/* 入出力が同一領域の畳み込みの一致確認
+* 2チャンネルをインターリーブしたバッファ上で、チャンネル毎に間隔指定・1チャンネル毎の通常呼び出し・一括呼び出しを試す */
+static void ConvolveInPlaceCheck(
+        const struct RIConvolveInterface *convif, const struct RIConvolveConfig *config)
+{
+#define NUM_CHANNELS 2
+    const uint32_t num_samples = 8192;
+    int64_t work_size;
+    void *work[NUM_CHANNELS], *conv[NUM_CHANNELS];
+    float *input[NUM_CHANNELS], *coef[NUM_CHANNELS], *answer[NUM_CHANNELS], *data[NUM_CHANNELS];
+    float *interleaved;
+    uint32_t ch, smpl, mode, latency;
+
+    work_size = convif->CalculateWorkSize(config);
+    assert(work_size >= 0);
+
+    srand(0);
+    for (ch = 0; ch < NUM_CHANNELS; ch++) {
+        work[ch] = malloc((size_t)work_size);
+        input[ch] = (float *)malloc(sizeof(float) * num_samples);
+        coef[ch] = (float *)malloc(sizeof(float) * config->max_num_coefficients);
+        answer[ch] = (float *)malloc(sizeof(float) * num_samples);
+        data[ch] = (float *)malloc(sizeof(float) * num_samples);
+        for (smpl = 0; smpl < num_samples; smpl++) {
+            input[ch][smpl] = 2.0f * rand() / (float)RAND_MAX - 1.0f;
+        }
+        for (smpl = 0; smpl < config->max_num_coefficients; smpl++) {
+            coef[ch][smpl] = (2.0f * rand() / (float)RAND_MAX - 1.0f) / config->max_num_coefficients;
+        }
+        DirectConvolve(coef[ch], config->max_num_coefficients, input[ch], answer[ch], num_samples);
+    }
+    interleaved = (float *)malloc(sizeof(float) * num_samples * NUM_CHANNELS);
+
+    /* 0:Convolve, 1:ConvolveStrided(インターリーブ) */
+    for (mode = 0; mode < 2; mode++) {
+        for (ch = 0; ch < NUM_CHANNELS; ch++) {
+            conv[ch] = convif->Create(config, work[ch], work_size);
+            assert(conv[ch] != NULL);
+            convif->SetCoefficients(conv[ch], coef[ch], config->max_num_coefficients);
+            memcpy(data[ch], input[ch], sizeof(float) * num_samples);
+            for (smpl = 0; smpl < num_samples; smpl++) {
+                interleaved[NUM_CHANNELS * smpl + ch] = input[ch][smpl];
+            }
+        }
+
+        smpl = 0;
+        while (smpl < num_samples) {
+            const uint32_t rand_input = (uint32_t)rand() % (config->max_num_input_samples + 1);
+            const uint32_t num_block_samples = MIN(rand_input, num_samples - smpl);
+            switch (mode) {
+            case 0:
+                for (ch = 0; ch < NUM_CHANNELS; ch++) {
+                    convif->Convolve(conv[ch], &data[ch][smpl], &data[ch][smpl], num_block_samples);
+                }
+                break;
+            default:
+                for (ch = 0; ch < NUM_CHANNELS; ch++) {
+                    float *ptr = &interleaved[NUM_CHANNELS * smpl + ch];
+                    convif->ConvolveStrided(conv[ch], ptr, NUM_CHANNELS, ptr, NUM_CHANNELS, num_block_samples);
+                }
+                break;
+            }
+            smpl += num_block_samples;
+        }
+
+        /* 一致確認 */
+        for (ch = 0; ch < NUM_CHANNELS; ch++) {
+            latency = (uint32_t)convif->GetLatencyNumSamples(conv[ch]);
+            assert(latency < num_samples);
+            for (smpl = 0; smpl < num_samples - latency; smpl++) {
+                const float actual = (mode == 1)
+                    ? interleaved[NUM_CHANNELS * (smpl + latency) + ch] : data[ch][smpl + latency];
+                if (fabs(answer[ch][smpl] - actual) > FLOAT_EPSILON) {
+                    printf("test failed. mode:%d ch:%d %d answer:%f actual:%f \n", mode, ch, smpl, answer[ch][smpl], actual);
+                    FAIL();
+                }
+            }
+            convif->Destroy(conv[ch]);
+        }
+    }
+
+    for (ch = 0; ch < NUM_CHANNELS; ch++) {
+        free(work[ch]);
+        free(input[ch]);
+        free(coef[ch]);
+        free(answer[ch]);
+        free(data[ch]);
+    }
+    free(interleaved);
+#undef NUM_CHANNELS
+}
+
+/* 入出力が同一領域の畳み込みテスト */
+TEST(RIConvolveTest, ConvolveInPlaceTest)
+{
+    struct RIConvolveConfig config;
+
+    config.max_num_coefficients = 200;
+    config.max_num_input_samples = 256;
+    config.fft_partition_size = 0;
+    config.num_head_coefficients = 0;
+    config.num_delay_samples = 0;
+    config.use_worker_thread = 0;
+    ConvolveInPlaceCheck(RIKaratsuba_GetInterface(), &config);
+    ConvolveInPlaceCheck(RIToomCook_GetInterface(), &config);
+    ConvolveInPlaceCheck(RIDirectFIR_GetInterface(), &config);
+    ConvolveInPlaceCheck(RIFFTConvolve_GetInterface(), &config);
+    ConvolveInPlaceCheck(RIZeroLatencyFFTConvolve_GetInterface(), &config);
+
+    config.max_num_coefficients = 10000;
+    config.max_num_input_samples = 512;
+    ConvolveInPlaceCheck(RIFFTConvolve_GetInterface(), &config);
+    ConvolveInPlaceCheck(RIZeroLatencyFFTConvolve_GetInterface(), &config);
+
+    config.max_num_coefficients = 3000;
+    config.max_num_input_samples = 32;
+    config.fft_partition_size = 64;
+    config.num_head_coefficients = 64;
+    ConvolveInPlaceCheck(RIZeroLatencyFFTConvolve_GetInterface(), &config);
+
+    /* FFT畳み込み段をワーカースレッドで処理 */
+    config.max_num_coefficients = 10000;
+    config.max_num_input_samples = 512;
+    config.fft_partition_size = 0;
+    config.num_head_coefficients = 0;
+    config.use_worker_thread = 1;
+    ConvolveInPlaceCheck(RIZeroLatencyFFTConvolve_GetInterface(), &config);
+}
@@ -0,0 +1,80 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <gtest/gtest.h>
+
+/* テスト対象のモジュール */
+extern "C" {
+#include "../../libs/ri_convolve/src/ri_direct_fir.c"
+}
+
+/* 最大長より短い係数での畳み込み一致確認テスト */
+TEST(RIDirectFIRTest, ConvolveShortCoefficientsTest)
+{
+#define NUM_SAMPLES 4096
+#define MAX_NUM_COEFFICIENTS 128
+#define MAX_NUM_INPUT_SAMPLES 100
+    const struct RIConvolveInterface *conv_if = RIDirectFIR_GetInterface();
+    struct RIConvolveConfig config;
+    void *conv, *work;
+    int64_t work_size;
+    uint32_t smpl, j, pattern;
+    const uint32_t num_coefficients[] = { 0, 1, 7, 33, 127, 128 };
+    static float coef[MAX_NUM_COEFFICIENTS];
+    static float input[NUM_SAMPLES];
+    static float output[NUM_SAMPLES];
+    static float answer[NUM_SAMPLES];
+
+    config.max_num_coefficients = MAX_NUM_COEFFICIENTS;
+    config.max_num_input_samples = MAX_NUM_INPUT_SAMPLES;
+    config.fft_partition_size = 0;
+    config.num_head_coefficients = 0;
+    config.num_delay_samples = 0;
+    config.use_worker_thread = 0;
+    work_size = conv_if->CalculateWorkSize(&config);
+    ASSERT_TRUE(work_size > 0);
+    work = malloc((size_t)work_size);
+    conv = conv_if->Create(&config, work, work_size);
+    ASSERT_TRUE(conv != NULL);
+    EXPECT_EQ(0, conv_if->GetLatencyNumSamples(conv));
+
+    srand(0);
+    for (smpl = 0; smpl < NUM_SAMPLES; smpl++) {
+        input[smpl] = 2.0f * ((float)rand() / RAND_MAX - 0.5f);
+    }
+
+    for (pattern = 0; pattern < sizeof(num_coefficients) / sizeof(num_coefficients[0]); pattern++) {
+        for (j = 0; j < num_coefficients[pattern]; j++) {
+            coef[j] = 2.0f * ((float)rand() / RAND_MAX - 0.5f);
+        }
+        conv_if->SetCoefficients(conv, coef, num_coefficients[pattern]);
+
+        /* 正解作成 */
+        memset(answer, 0, sizeof(answer));
+        for (smpl = 0; smpl < NUM_SAMPLES; smpl++) {
+            for (j = 0; (j < num_coefficients[pattern]) && (smpl + j < NUM_SAMPLES); j++) {
+                answer[smpl + j] += coef[j] * input[smpl];
+            }
+        }
+
+        /* ランダムなブロックサイズで畳み込み */
+        smpl = 0;
+        while (smpl < NUM_SAMPLES) {
+            const uint32_t rand_input = (uint32_t)rand() % (MAX_NUM_INPUT_SAMPLES + 1);
+            const uint32_t num_block_samples = (rand_input < NUM_SAMPLES - smpl) ? rand_input : (NUM_SAMPLES - smpl);
+            conv_if->Convolve(conv, &input[smpl], &output[smpl], num_block_samples);
+            smpl += num_block_samples;
+        }
+
+        /* 一致確認 */
+        for (smpl = 0; smpl < NUM_SAMPLES; smpl++) {
+            EXPECT_NEAR(answer[smpl], output[smpl], 1e-4);
+        }
+    }
+
+    conv_if->Destroy(conv);
+    free(work);
+#undef NUM_SAMPLES
+#undef MAX_NUM_COEFFICIENTS
+#undef MAX_NUM_INPUT_SAMPLES
+}
@@ -7,3 +7,188 @@
 extern "C" {
 #include "../../libs/ri_convolve/src/ri_fft_convolve.c"
 }
+
+/* 周波数領域入力の一致確認テスト */
+TEST(RIFFTConvolveTest, ConvolveSpectrumTest)
+{
+#define NUM_SAMPLES 8192
+#define NUM_COEFFICIENTS 3000
+    const struct RIConvolveInterface *conv_if = RIFFTConvolve_GetInterface();
+    struct RIConvolveConfig config;
+    void *time_conv, *freq_conv;
+    void *time_work, *freq_work;
+    int64_t work_size;
+    uint32_t smpl, i, partition_size;
+    static float coef[NUM_COEFFICIENTS];
+    static float input[NUM_SAMPLES];
+    static float output[NUM_SAMPLES];
+    static float answer[NUM_SAMPLES];
+    float *window, *spectrum, *work;
+
+    config.max_num_coefficients = NUM_COEFFICIENTS;
+    config.max_num_input_samples = 1024;
+    config.fft_partition_size = 0;
+    config.num_head_coefficients = 0;
+    config.num_delay_samples = 0;
+    config.use_worker_thread = 0;
+    work_size = conv_if->CalculateWorkSize(&config);
+    ASSERT_TRUE(work_size > 0);
+    time_work = malloc((size_t)work_size);
+    freq_work = malloc((size_t)work_size);
+    time_conv = conv_if->Create(&config, time_work, work_size);
+    freq_conv = conv_if->Create(&config, freq_work, work_size);
+    ASSERT_TRUE((time_conv != NULL) && (freq_conv != NULL));
+
+    srand(0);
+    for (i = 0; i < NUM_COEFFICIENTS; i++) {
+        coef[i] = 2.0f * ((float)rand() / RAND_MAX - 0.5f) / (float)(i + 1);
+    }
+    for (smpl = 0; smpl < NUM_SAMPLES; smpl++) {
+        input[smpl] = 2.0f * ((float)rand() / RAND_MAX - 0.5f);
+    }
+    conv_if->SetCoefficients(time_conv, coef, NUM_COEFFICIENTS);
+    conv_if->SetCoefficients(freq_conv, coef, NUM_COEFFICIENTS);
+
+    partition_size = RIFFTConvolve_GetPartitionSize(freq_conv);
+    window = (float *)calloc(2 * partition_size, sizeof(float));
+    spectrum = (float *)malloc(sizeof(float) * 2 * partition_size);
+    work = (float *)malloc(sizeof(float) * 2 * partition_size);
+
+    /* 時間領域で畳み込み（正解）: 分割サイズ分遅れる */
+    for (smpl = 0; smpl < NUM_SAMPLES; smpl += config.max_num_input_samples) {
+        conv_if->Convolve(time_conv, &input[smpl], &answer[smpl], config.max_num_input_samples);
+    }
+
+    /* 周波数領域で畳み込み */
+    for (smpl = 0; smpl < NUM_SAMPLES; smpl += partition_size) {
+        /* 前回と今回の分割を並べて変換 */
+        memcpy(&window[partition_size], &input[smpl], sizeof(float) * partition_size);
+        memcpy(spectrum, window, sizeof(float) * 2 * partition_size);
+        RIFFT_RealFFT((int)(2 * partition_size), -1, spectrum, work);
+        RIFFTConvolve_ConvolveSpectrum(freq_conv, spectrum, &output[smpl]);
+        memcpy(window, &window[partition_size], sizeof(float) * partition_size);
+    }
+
+    /* 一致確認 */
+    for (smpl = 0; smpl < NUM_SAMPLES - partition_size; smpl++) {
+        EXPECT_NEAR(answer[smpl + partition_size], output[smpl], 1e-3);
+    }
+
+    free(work);
+    free(spectrum);
+    free(window);
+    conv_if->Destroy(freq_conv);
+    conv_if->Destroy(time_conv);
+    free(freq_work);
+    free(time_work);
+#undef NUM_SAMPLES
+#undef NUM_COEFFICIENTS
+}
+
+/* 32bitに収まらないワークサイズの計算テスト */
+TEST(RIFFTConvolveTest, LargeWorkSizeTest)
+{
+    const struct RIConvolveInterface *conv_if = RIFFTConvolve_GetInterface();
+    struct RIConvolveConfig config;
+    int64_t work_size;
+
+    config.max_num_coefficients = 1UL << 28;
+    config.max_num_input_samples = 1024;
+    config.fft_partition_size = 0;
+    config.num_head_coefficients = 0;
+    config.num_delay_samples = 0;
+    config.use_worker_thread = 0;
+
+    /* 変換済み係数とリングバッファで係数長の数倍のfloat数 */
+    work_size = conv_if->CalculateWorkSize(&config);
+    if (SIZE_MAX > UINT32_MAX) {
+        EXPECT_GT(work_size, (int64_t)INT32_MAX);
+        EXPECT_GT(work_size, (int64_t)(2 * sizeof(float) * config.max_num_coefficients));
+    } else {
+        /* アドレス空間に収まらない */
+        EXPECT_EQ(-1, work_size);
+    }
+
+    /* FFT点数が32bitに収まらない係数長はエラー */
+    config.max_num_coefficients = UINT32_MAX;
+    EXPECT_EQ(-1, conv_if->CalculateWorkSize(&config));
+
+    /* ワークサイズ計算に失敗する設定では作成できない */
+    EXPECT_TRUE(conv_if->Create(&config, &config, INT64_MAX) == NULL);
+}
+
+/* 出力遅延と足し込み出力のテスト */
+TEST(RIFFTConvolveTest, DelayAndConvolveAddTest)
+{
+#define NUM_SAMPLES 8192
+#define NUM_COEFFICIENTS 1000
+#define NUM_DELAY_SAMPLES 777
+#define NUM_BLOCK_SAMPLES 100
+    const struct RIConvolveInterface *conv_if = RIFFTConvolve_GetInterface();
+    struct RIConvolveConfig config;
+    void *conv, *delay_conv;
+    void *work, *delay_work;
+    int64_t work_size, delay_work_size;
+    uint32_t smpl, i;
+    static float coef[NUM_COEFFICIENTS];
+    static float input[NUM_SAMPLES];
+    static float answer[NUM_SAMPLES];
+    static float output[NUM_SAMPLES];
+
+    config.max_num_coefficients = NUM_COEFFICIENTS;
+    config.max_num_input_samples = NUM_BLOCK_SAMPLES;
+    config.fft_partition_size = 128;
+    config.num_head_coefficients = 0;
+    config.num_delay_samples = 0;
+    config.use_worker_thread = 0;
+    work_size = conv_if->CalculateWorkSize(&config);
+    ASSERT_TRUE(work_size > 0);
+    work = malloc((size_t)work_size);
+    conv = conv_if->Create(&config, work, work_size);
+    ASSERT_TRUE(conv != NULL);
+
+    config.num_delay_samples = NUM_DELAY_SAMPLES;
+    delay_work_size = conv_if->CalculateWorkSize(&config);
+    ASSERT_TRUE(delay_work_size > work_size);
+    delay_work = malloc((size_t)delay_work_size);
+    delay_conv = conv_if->Create(&config, delay_work, delay_work_size);
+    ASSERT_TRUE(delay_conv != NULL);
+
+    srand(0);
+    for (i = 0; i < NUM_COEFFICIENTS; i++) {
+        coef[i] = 2.0f * ((float)rand() / RAND_MAX - 0.5f) / (float)(i + 1);
+    }
+    for (smpl = 0; smpl < NUM_SAMPLES; smpl++) {
+        input[smpl] = 2.0f * ((float)rand() / RAND_MAX - 0.5f);
+        output[smpl] = 1.0f;
+    }
+    conv_if->SetCoefficients(conv, coef, NUM_COEFFICIENTS);
+    conv_if->SetCoefficients(delay_conv, coef, NUM_COEFFICIENTS);
+
+    /* レイテンシは遅延分増える */
+    EXPECT_EQ(conv_if->GetLatencyNumSamples(conv) + NUM_DELAY_SAMPLES, conv_if->GetLatencyNumSamples(delay_conv));
+
+    /* 遅延なしで畳み込んだ結果を正解とし、遅延ありの結果は既存の出力に足し込む */
+    for (smpl = 0; smpl < NUM_SAMPLES; smpl += NUM_BLOCK_SAMPLES) {
+        const uint32_t num_samples = MIN(NUM_BLOCK_SAMPLES, NUM_SAMPLES - smpl);
+        conv_if->Convolve(conv, &input[smpl], &answer[smpl], num_samples);
+        RIFFTConvolve_ConvolveAdd(delay_conv, &input[smpl], &output[smpl], num_samples);
+    }
+
+    /* 一致確認 */
+    for (smpl = 0; smpl < NUM_DELAY_SAMPLES; smpl++) {
+        EXPECT_FLOAT_EQ(1.0f, output[smpl]);
+    }
+    for (smpl = NUM_DELAY_SAMPLES; smpl < NUM_SAMPLES; smpl++) {
+        EXPECT_NEAR(answer[smpl - NUM_DELAY_SAMPLES] + 1.0f, output[smpl], 1e-4);
+    }
+
+    conv_if->Destroy(delay_conv);
+    conv_if->Destroy(conv);
+    free(delay_work);
+    free(work);
+#undef NUM_SAMPLES
+#undef NUM_COEFFICIENTS
+#undef NUM_DELAY_SAMPLES
+#undef NUM_BLOCK_SAMPLES
+}
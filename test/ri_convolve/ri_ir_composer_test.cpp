@@ -0,0 +1,156 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <gtest/gtest.h>
+
+/* テスト対象のモジュール */
+extern "C" {
+#include "../../libs/ri_convolve/src/ri_ir_composer.c"
+}
+
+/* 葉ノードの設定 */
+static void RIIRComposerTest_SetImpulse(struct RIIRNode *node, const float *coefficients, uint32_t num_coefficients, float gain)
+{
+    memset(node, 0, sizeof(struct RIIRNode));
+    node->type = RIIRNODE_TYPE_IMPULSE;
+    node->gain = gain;
+    node->coefficients = coefficients;
+    node->num_coefficients = num_coefficients;
+}
+
+/* 接続ノードの設定 */
+static void RIIRComposerTest_SetConnection(struct RIIRNode *node, RIIRNodeType type,
+        const struct RIIRNode *const *children, uint32_t num_children, float gain)
+{
+    memset(node, 0, sizeof(struct RIIRNode));
+    node->type = type;
+    node->gain = gain;
+    node->children = children;
+    node->num_children = num_children;
+}
+
+/* 係数長取得テスト */
+TEST(RIIRComposerTest, GetNumCoefficientsTest)
+{
+    static const float coef[100] = { 0.0f, };
+    struct RIIRNode a, b, c, series, parallel;
+    const struct RIIRNode *series_children[2];
+    const struct RIIRNode *parallel_children[2];
+
+    RIIRComposerTest_SetImpulse(&a, coef, 10, 1.0f);
+    RIIRComposerTest_SetImpulse(&b, coef, 20, 1.0f);
+    RIIRComposerTest_SetImpulse(&c, coef, 100, 1.0f);
+    series_children[0] = &a; series_children[1] = &b;
+    RIIRComposerTest_SetConnection(&series, RIIRNODE_TYPE_SERIES, series_children, 2, 1.0f);
+    parallel_children[0] = &series; parallel_children[1] = &c;
+    RIIRComposerTest_SetConnection(&parallel, RIIRNODE_TYPE_PARALLEL, parallel_children, 2, 1.0f);
+
+    EXPECT_EQ(10, RIIRComposer_GetNumCoefficients(&a));
+    EXPECT_EQ(29, RIIRComposer_GetNumCoefficients(&series));
+    EXPECT_EQ(100, RIIRComposer_GetNumCoefficients(&parallel));
+
+    /* 32bitを超えるワークサイズも計算できる（係数は参照しない） */
+    if (sizeof(size_t) > sizeof(int32_t)) {
+        RIIRComposerTest_SetImpulse(&c, coef, 1UL << 29, 1.0f);
+        EXPECT_TRUE(RIIRComposer_CalculateWorkSize(&c, 0) > (int64_t)INT32_MAX);
+        RIIRComposerTest_SetImpulse(&c, coef, 100, 1.0f);
+    }
+
+    /* 不正なグラフ */
+    EXPECT_EQ(0, RIIRComposer_GetNumCoefficients(NULL));
+    RIIRComposerTest_SetConnection(&series, RIIRNODE_TYPE_SERIES, series_children, 0, 1.0f);
+    EXPECT_EQ(0, RIIRComposer_GetNumCoefficients(&series));
+    EXPECT_EQ(0, RIIRComposer_GetNumCoefficients(&parallel));
+    EXPECT_TRUE(RIIRComposer_CalculateWorkSize(&parallel, 0) < 0);
+    RIIRComposerTest_SetImpulse(&a, NULL, 10, 1.0f);
+    EXPECT_EQ(0, RIIRComposer_GetNumCoefficients(&a));
+    EXPECT_TRUE(RIIRComposer_CalculateWorkSize(&c, 3) < 0);
+}
+
+/* 合成結果の一致確認テスト */
+TEST(RIIRComposerTest, ComposeTest)
+{
+#define NUM_A 300
+#define NUM_B 1500
+#define NUM_C 2000
+#define PARTITION_SIZE 1024
+    static float coef_a[NUM_A], coef_b[NUM_B], coef_c[NUM_C];
+    static float answer[NUM_C + 10], composed[NUM_C + 10];
+    struct RIIRNode a, b, c, series, parallel;
+    const struct RIIRNode *series_children[2];
+    const struct RIIRNode *parallel_children[2];
+    uint32_t i, j, spectrum_size;
+    int64_t work_size;
+    void *work;
+    float *spectrum, *answer_spectrum, *fft_work;
+
+    srand(0);
+    for (i = 0; i < NUM_A; i++) {
+        coef_a[i] = 2.0f * ((float)rand() / RAND_MAX - 0.5f) / (float)(i + 1);
+    }
+    for (i = 0; i < NUM_B; i++) {
+        coef_b[i] = 2.0f * ((float)rand() / RAND_MAX - 0.5f) / (float)(i + 1);
+    }
+    for (i = 0; i < NUM_C; i++) {
+        coef_c[i] = 2.0f * ((float)rand() / RAND_MAX - 0.5f) / (float)(i + 1);
+    }
+
+    /* (0.5 * a * b + 0.25 * c) * 2.0 */
+    RIIRComposerTest_SetImpulse(&a, coef_a, NUM_A, 0.5f);
+    RIIRComposerTest_SetImpulse(&b, coef_b, NUM_B, 1.0f);
+    RIIRComposerTest_SetImpulse(&c, coef_c, NUM_C, 0.25f);
+    series_children[0] = &a; series_children[1] = &b;
+    RIIRComposerTest_SetConnection(&series, RIIRNODE_TYPE_SERIES, series_children, 2, 1.0f);
+    parallel_children[0] = &series; parallel_children[1] = &c;
+    RIIRComposerTest_SetConnection(&parallel, RIIRNODE_TYPE_PARALLEL, parallel_children, 2, 2.0f);
+    ASSERT_EQ(NUM_C, RIIRComposer_GetNumCoefficients(&parallel));
+
+    /* 正解作成 */
+    memset(answer, 0, sizeof(answer));
+    for (i = 0; i < NUM_A; i++) {
+        for (j = 0; j < NUM_B; j++) {
+            answer[i + j] += 2.0f * 0.5f * coef_a[i] * coef_b[j];
+        }
+    }
+    for (i = 0; i < NUM_C; i++) {
+        answer[i] += 2.0f * 0.25f * coef_c[i];
+    }
+
+    work_size = RIIRComposer_CalculateWorkSize(&parallel, PARTITION_SIZE);
+    ASSERT_TRUE(work_size > 0);
+    work = malloc((size_t)work_size);
+
+    /* 不正な引数 */
+    EXPECT_EQ(RIIRCOMPOSER_APIRESULT_INVALID_ARGUMENT, RIIRComposer_Compose(NULL, composed, NUM_C, work, work_size));
+    EXPECT_EQ(RIIRCOMPOSER_APIRESULT_INVALID_ARGUMENT, RIIRComposer_Compose(&parallel, NULL, NUM_C, work, work_size));
+    EXPECT_EQ(RIIRCOMPOSER_APIRESULT_INVALID_ARGUMENT, RIIRComposer_Compose(&parallel, composed, NUM_C, NULL, work_size));
+    EXPECT_EQ(RIIRCOMPOSER_APIRESULT_INSUFFICIENT_BUFFER, RIIRComposer_Compose(&parallel, composed, NUM_C - 1, work, work_size));
+    EXPECT_EQ(RIIRCOMPOSER_APIRESULT_INSUFFICIENT_BUFFER, RIIRComposer_Compose(&parallel, composed, NUM_C, work, work_size - 1 - 16));
+
+    /* 時間領域で合成 */
+    ASSERT_EQ(RIIRCOMPOSER_APIRESULT_OK, RIIRComposer_Compose(&parallel, composed, NUM_C + 10, work, work_size));
+    for (i = 0; i < NUM_C + 10; i++) {
+        EXPECT_NEAR(answer[i], composed[i], 1e-4);
+    }
+
+    /* 分割スペクトルを合成 */
+    spectrum_size = RIFFTConvolve_CalculateSpectrumSize(PARTITION_SIZE, NUM_C);
+    spectrum = (float *)malloc(sizeof(float) * spectrum_size);
+    answer_spectrum = (float *)malloc(sizeof(float) * spectrum_size);
+    fft_work = (float *)malloc(sizeof(float) * 2 * PARTITION_SIZE);
+    ASSERT_EQ(RIIRCOMPOSER_APIRESULT_OK, RIIRComposer_ComposeSpectrum(&parallel, PARTITION_SIZE, spectrum, work, work_size));
+    RIFFTConvolve_MakeSpectrum(PARTITION_SIZE, answer, NUM_C, answer_spectrum, fft_work);
+    for (i = 0; i < spectrum_size; i++) {
+        EXPECT_NEAR(answer_spectrum[i], spectrum[i], 1e-4);
+    }
+
+    free(fft_work);
+    free(answer_spectrum);
+    free(spectrum);
+    free(work);
+#undef NUM_A
+#undef NUM_B
+#undef NUM_C
+#undef PARTITION_SIZE
+}
@@ -7,3 +7,349 @@
 extern "C" {
 #include "../../libs/ri_convolve/src/ri_karatsuba.c"
 }
+
+/* 係数長より長いブロックでの畳み込み一致確認テスト */
+TEST(RIKaratsubaTest, ConvolveLongBlockTest)
+{
+#define NUM_SAMPLES 4096
+#define MAX_NUM_INPUT_SAMPLES 512
+    const struct RIConvolveInterface *conv_if = RIKaratsuba_GetInterface();
+    struct RIConvolveConfig config;
+    void *conv, *work;
+    int64_t work_size;
+    uint32_t smpl, i, j, pattern;
+    const uint32_t num_coefficients[] = { 1, 8, 20, 64, 300 };
+    static float coef[300];
+    static float input[NUM_SAMPLES];
+    static float output[NUM_SAMPLES];
+    static float answer[NUM_SAMPLES];
+
+    config.max_num_coefficients = 300;
+    config.max_num_input_samples = MAX_NUM_INPUT_SAMPLES;
+    config.fft_partition_size = 0;
+    config.num_head_coefficients = 0;
+    config.num_delay_samples = 0;
+    config.use_worker_thread = 0;
+    work_size = conv_if->CalculateWorkSize(&config);
+    ASSERT_TRUE(work_size > 0);
+    work = malloc((size_t)work_size);
+    conv = conv_if->Create(&config, work, work_size);
+    ASSERT_TRUE(conv != NULL);
+
+    srand(0);
+    for (smpl = 0; smpl < NUM_SAMPLES; smpl++) {
+        input[smpl] = 2.0f * ((float)rand() / RAND_MAX - 0.5f);
+    }
+
+    for (pattern = 0; pattern < sizeof(num_coefficients) / sizeof(num_coefficients[0]); pattern++) {
+        for (i = 0; i < num_coefficients[pattern]; i++) {
+            coef[i] = 2.0f * ((float)rand() / RAND_MAX - 0.5f);
+        }
+        conv_if->SetCoefficients(conv, coef, num_coefficients[pattern]);
+
+        /* 正解作成 */
+        memset(answer, 0, sizeof(answer));
+        for (smpl = 0; smpl < NUM_SAMPLES; smpl++) {
+            for (j = 0; (j < num_coefficients[pattern]) && (smpl + j < NUM_SAMPLES); j++) {
+                answer[smpl + j] += coef[j] * input[smpl];
+            }
+        }
+
+        /* 係数長を超えるブロックを含むランダムなブロックサイズで畳み込み */
+        smpl = 0;
+        while (smpl < NUM_SAMPLES) {
+            const uint32_t rand_input = (uint32_t)rand() % (MAX_NUM_INPUT_SAMPLES + 1);
+            const uint32_t num_block_samples = (rand_input < NUM_SAMPLES - smpl) ? rand_input : (NUM_SAMPLES - smpl);
+            conv_if->Convolve(conv, &input[smpl], &output[smpl], num_block_samples);
+            smpl += num_block_samples;
+        }
+
+        /* 一致確認 */
+        for (smpl = 0; smpl < NUM_SAMPLES; smpl++) {
+            EXPECT_NEAR(answer[smpl], output[smpl], 1e-4);
+        }
+    }
+
+    conv_if->Destroy(conv);
+    free(work);
+#undef NUM_SAMPLES
+#undef MAX_NUM_INPUT_SAMPLES
+}
+
+/* 係数長より短いブロックでの畳み込み一致確認テスト */
+TEST(RIKaratsubaTest, ConvolveShortBlockTest)
+{
+#define NUM_SAMPLES 4096
+#define NUM_COEFFICIENTS 1024
+    const struct RIConvolveInterface *conv_if = RIKaratsuba_GetInterface();
+    struct RIConvolveConfig config;
+    void *conv, *work;
+    int64_t work_size;
+    uint32_t smpl, j, pattern;
+    const uint32_t max_num_input_samples[] = { 1, 16, 64, 100 };
+    static float coef[NUM_COEFFICIENTS];
+    static float input[NUM_SAMPLES];
+    static float output[NUM_SAMPLES];
+    static float answer[NUM_SAMPLES];
+
+    srand(0);
+    for (j = 0; j < NUM_COEFFICIENTS; j++) {
+        coef[j] = 2.0f * ((float)rand() / RAND_MAX - 0.5f) / (float)(j + 1);
+    }
+    for (smpl = 0; smpl < NUM_SAMPLES; smpl++) {
+        input[smpl] = 2.0f * ((float)rand() / RAND_MAX - 0.5f);
+    }
+
+    /* 正解作成 */
+    memset(answer, 0, sizeof(answer));
+    for (smpl = 0; smpl < NUM_SAMPLES; smpl++) {
+        for (j = 0; (j < NUM_COEFFICIENTS) && (smpl + j < NUM_SAMPLES); j++) {
+            answer[smpl + j] += coef[j] * input[smpl];
+        }
+    }
+
+    for (pattern = 0; pattern < sizeof(max_num_input_samples) / sizeof(max_num_input_samples[0]); pattern++) {
+        config.max_num_coefficients = NUM_COEFFICIENTS;
+        config.max_num_input_samples = max_num_input_samples[pattern];
+        config.fft_partition_size = 0;
+        config.num_head_coefficients = 0;
+        config.num_delay_samples = 0;
+        config.use_worker_thread = 0;
+        work_size = conv_if->CalculateWorkSize(&config);
+        ASSERT_TRUE(work_size > 0);
+        work = malloc((size_t)work_size);
+        conv = conv_if->Create(&config, work, work_size);
+        ASSERT_TRUE(conv != NULL);
+        conv_if->SetCoefficients(conv, coef, NUM_COEFFICIENTS);
+
+        /* 係数を分割して処理されるランダムなブロックサイズで畳み込み */
+        smpl = 0;
+        while (smpl < NUM_SAMPLES) {
+            const uint32_t rand_input = (uint32_t)rand() % (config.max_num_input_samples + 1);
+            const uint32_t num_block_samples = (rand_input < NUM_SAMPLES - smpl) ? rand_input : (NUM_SAMPLES - smpl);
+            conv_if->Convolve(conv, &input[smpl], &output[smpl], num_block_samples);
+            smpl += num_block_samples;
+        }
+
+        /* 一致確認 */
+        for (smpl = 0; smpl < NUM_SAMPLES; smpl++) {
+            EXPECT_NEAR(answer[smpl], output[smpl], 1e-4);
+        }
+
+        conv_if->Destroy(conv);
+        free(work);
+    }
+#undef NUM_SAMPLES
+#undef NUM_COEFFICIENTS
+}
+
+/* 素朴な畳み込みに切り替えるサイズを変えた畳み込み一致確認テスト */
+TEST(RIKaratsubaTest, BaseCaseSizeTest)
+{
+#define NUM_SAMPLES 2048
+#define NUM_COEFFICIENTS 512
+#define MAX_NUM_INPUT_SAMPLES 128
+    const struct RIConvolveInterface *conv_if = RIKaratsuba_GetInterface();
+    struct RIConvolveConfig config;
+    void *conv, *work;
+    int64_t work_size;
+    uint32_t smpl, j, pattern;
+    /* 0は較正で決定 */
+    const uint32_t base_case_size[] = { 1, 8, 16, 24, 100, 128, 1024, 0 };
+    static float coef[NUM_COEFFICIENTS];
+    static float input[NUM_SAMPLES];
+    static float output[NUM_SAMPLES];
+    static float answer[NUM_SAMPLES];
+
+    srand(0);
+    for (j = 0; j < NUM_COEFFICIENTS; j++) {
+        coef[j] = 2.0f * ((float)rand() / RAND_MAX - 0.5f) / (float)(j + 1);
+    }
+    for (smpl = 0; smpl < NUM_SAMPLES; smpl++) {
+        input[smpl] = 2.0f * ((float)rand() / RAND_MAX - 0.5f);
+    }
+
+    /* 正解作成 */
+    memset(answer, 0, sizeof(answer));
+    for (smpl = 0; smpl < NUM_SAMPLES; smpl++) {
+        for (j = 0; (j < NUM_COEFFICIENTS) && (smpl + j < NUM_SAMPLES); j++) {
+            answer[smpl + j] += coef[j] * input[smpl];
+        }
+    }
+
+    config.max_num_coefficients = NUM_COEFFICIENTS;
+    config.max_num_input_samples = MAX_NUM_INPUT_SAMPLES;
+    config.fft_partition_size = 0;
+    config.num_head_coefficients = 0;
+    config.num_delay_samples = 0;
+    config.use_worker_thread = 0;
+    work_size = conv_if->CalculateWorkSize(&config);
+    ASSERT_TRUE(work_size > 0);
+    work = malloc((size_t)work_size);
+    conv = conv_if->Create(&config, work, work_size);
+    ASSERT_TRUE(conv != NULL);
+    conv_if->SetCoefficients(conv, coef, NUM_COEFFICIENTS);
+
+    for (pattern = 0; pattern < sizeof(base_case_size) / sizeof(base_case_size[0]); pattern++) {
+        uint32_t size;
+
+        if (base_case_size[pattern] == 0) {
+            size = RIKaratsuba_CalibrateBaseCaseSize(conv);
+        } else {
+            RIKaratsuba_SetBaseCaseSize(conv, base_case_size[pattern]);
+            size = RIKaratsuba_GetBaseCaseSize(conv);
+        }
+
+        /* 8以上かつ最大処理サンプル単位以下になっているか */
+        EXPECT_EQ(size, RIKaratsuba_GetBaseCaseSize(conv));
+        EXPECT_TRUE(size >= 8);
+        EXPECT_TRUE(size <= NUM_COEFFICIENTS);
+
+        /* ランダムなブロックサイズで畳み込み */
+        smpl = 0;
+        while (smpl < NUM_SAMPLES) {
+            const uint32_t rand_input = (uint32_t)rand() % (MAX_NUM_INPUT_SAMPLES + 1);
+            const uint32_t num_block_samples = (rand_input < NUM_SAMPLES - smpl) ? rand_input : (NUM_SAMPLES - smpl);
+            conv_if->Convolve(conv, &input[smpl], &output[smpl], num_block_samples);
+            smpl += num_block_samples;
+        }
+
+        /* 一致確認 */
+        for (smpl = 0; smpl < NUM_SAMPLES; smpl++) {
+            EXPECT_NEAR(answer[smpl], output[smpl], 1e-4);
+        }
+    }
+
+    conv_if->Destroy(conv);
+    free(work);
+#undef NUM_SAMPLES
+#undef NUM_COEFFICIENTS
+#undef MAX_NUM_INPUT_SAMPLES
+}
+
+/* 2の冪乗でない係数長・ブロックサイズでの畳み込み一致確認テスト */
+TEST(RIKaratsubaTest, ConvolveOddLengthTest)
+{
+#define NUM_SAMPLES 8192
+    const struct RIConvolveInterface *conv_if = RIKaratsuba_GetInterface();
+    struct RIConvolveConfig config;
+    void *conv, *work;
+    int64_t work_size;
+    uint32_t smpl, j, pattern;
+    const uint32_t num_coefficients[] = { 1025, 1025, 777, 3001 };
+    const uint32_t max_num_input_samples[] = { 1, 333, 2000, 100 };
+    static float coef[4000];
+    static float input[NUM_SAMPLES];
+    static float output[NUM_SAMPLES];
+    static float answer[NUM_SAMPLES];
+
+    /* 2の冪乗に切り上げないため、1025点は2048点よりワークサイズが小さい */
+    {
+        int64_t work_size_1025, work_size_2048;
+        config.max_num_input_samples = 1;
+        config.fft_partition_size = 0;
+        config.num_head_coefficients = 0;
+        config.num_delay_samples = 0;
+        config.use_worker_thread = 0;
+        config.max_num_coefficients = 1025;
+        work_size_1025 = conv_if->CalculateWorkSize(&config);
+        config.max_num_coefficients = 2048;
+        work_size_2048 = conv_if->CalculateWorkSize(&config);
+        EXPECT_TRUE(work_size_1025 < work_size_2048 * 2 / 3);
+    }
+
+    srand(0);
+    for (smpl = 0; smpl < NUM_SAMPLES; smpl++) {
+        input[smpl] = 2.0f * ((float)rand() / RAND_MAX - 0.5f);
+    }
+
+    for (pattern = 0; pattern < sizeof(num_coefficients) / sizeof(num_coefficients[0]); pattern++) {
+        for (j = 0; j < num_coefficients[pattern]; j++) {
+            coef[j] = 2.0f * ((float)rand() / RAND_MAX - 0.5f) / (float)(j + 1);
+        }
+
+        /* 正解作成 */
+        memset(answer, 0, sizeof(answer));
+        for (smpl = 0; smpl < NUM_SAMPLES; smpl++) {
+            for (j = 0; (j < num_coefficients[pattern]) && (smpl + j < NUM_SAMPLES); j++) {
+                answer[smpl + j] += coef[j] * input[smpl];
+            }
+        }
+
+        config.max_num_coefficients = num_coefficients[pattern];
+        config.max_num_input_samples = max_num_input_samples[pattern];
+        config.fft_partition_size = 0;
+        config.num_head_coefficients = 0;
+        config.num_delay_samples = 0;
+        config.use_worker_thread = 0;
+        work_size = conv_if->CalculateWorkSize(&config);
+        ASSERT_TRUE(work_size > 0);
+        work = malloc((size_t)work_size);
+        conv = conv_if->Create(&config, work, work_size);
+        ASSERT_TRUE(conv != NULL);
+        conv_if->SetCoefficients(conv, coef, num_coefficients[pattern]);
+
+        /* ランダムなブロックサイズで畳み込み */
+        smpl = 0;
+        while (smpl < NUM_SAMPLES) {
+            const uint32_t rand_input = (uint32_t)rand() % (config.max_num_input_samples + 1);
+            const uint32_t num_block_samples = (rand_input < NUM_SAMPLES - smpl) ? rand_input : (NUM_SAMPLES - smpl);
+            conv_if->Convolve(conv, &input[smpl], &output[smpl], num_block_samples);
+            smpl += num_block_samples;
+        }
+
+        /* 一致確認 */
+        for (smpl = 0; smpl < NUM_SAMPLES; smpl++) {
+            EXPECT_NEAR(answer[smpl], output[smpl], 1e-4);
+        }
+
+        conv_if->Destroy(conv);
+        free(work);
+    }
+#undef NUM_SAMPLES
+}
+
+/* 計算用ワークサイズの確認テスト */
+TEST(RIKaratsubaTest, KaratsubaWorkSizeTest)
+{
+    uint32_t n, base_case_size;
+
+    /* 結果領域を除いたワークは約2n, 足し込み時のワークは約2.5nに収まるか */
+    /* 奇数分割の切り上げで階層あたり最大2要素増えるため, 階層数分の余裕を持たせる */
+    for (base_case_size = RIKARATSUBA_MIN_BASE_CASE_SIZE; base_case_size <= 256; base_case_size <<= 1) {
+        for (n = 1; n <= 5000; n += 7) {
+            EXPECT_TRUE(RIKaratsuba_CalculateKaratsubaWorkSize(n, base_case_size) <= 2 * n + 64);
+            EXPECT_TRUE(RIKaratsuba_CalculateKaratsubaAddWorkSize(n, base_case_size, 1) <= (5 * n) / 2 + 64);
+            EXPECT_TRUE(RIKaratsuba_CalculateKaratsubaAddWorkSize(n, base_case_size, 1) <= RIKaratsuba_CalculateMaxKaratsubaWorkSize(n));
+        }
+    }
+
+    /* インスタンス全体のワークサイズが従来(2の冪乗に切り上げたサイズの9倍)以下に収まるか */
+    {
+        const uint32_t max_num_input_samples[] = { 1, 64, 257, 1024 };
+        uint32_t i, max_num_coefficients;
+
+        for (i = 0; i < sizeof(max_num_input_samples) / sizeof(max_num_input_samples[0]); i++) {
+            for (max_num_coefficients = 1; max_num_coefficients <= 20000; max_num_coefficients += 97) {
+                struct RIConvolveConfig config;
+                uint32_t num_block_samples = 1;
+                int64_t baseline_size;
+
+                config.max_num_coefficients = max_num_coefficients;
+                config.max_num_input_samples = max_num_input_samples[i];
+                config.fft_partition_size = 0;
+                config.num_head_coefficients = 0;
+                config.num_delay_samples = 0;
+                config.use_worker_thread = 0;
+
+                while (num_block_samples < MAX(MAX(max_num_coefficients, max_num_input_samples[i]), RIKARATSUBA_MIN_BASE_CASE_SIZE)) {
+                    num_block_samples <<= 1;
+                }
+                baseline_size = (int64_t)(sizeof(struct RIKaratsuba) + RIKARATSUBA_ALIGNMENT)
+                    + 9 * (int64_t)(sizeof(float) * num_block_samples + RIKARATSUBA_ALIGNMENT);
+
+                EXPECT_TRUE(RIKaratsuba_GetInterface()->CalculateWorkSize(&config) <= baseline_size);
+            }
+        }
+    }
+}
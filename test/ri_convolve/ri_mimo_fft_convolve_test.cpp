@@ -0,0 +1,152 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <gtest/gtest.h>
+
+/* テスト対象のモジュール */
+extern "C" {
+#include "../../libs/ri_convolve/src/ri_mimo_fft_convolve.c"
+}
+
+/* 生成破棄テスト */
+TEST(RIMIMOFFTConvolveTest, CreateDestroyTest)
+{
+    struct RIMIMOFFTConvolveConfig config;
+    struct RIMIMOFFTConvolve *conv;
+    int64_t work_size;
+    void *work;
+
+    config.num_input_channels = 2;
+    config.num_output_channels = 4;
+    config.max_num_coefficients = 4096;
+    config.fft_partition_size = 0;
+    work_size = RIMIMOFFTConvolve_CalculateWorkSize(&config);
+    ASSERT_TRUE(work_size > 0);
+    work = malloc((size_t)work_size);
+
+    /* 不正な引数 */
+    EXPECT_TRUE(RIMIMOFFTConvolve_CalculateWorkSize(NULL) < 0);
+    EXPECT_TRUE(RIMIMOFFTConvolve_Create(NULL, work, work_size) == NULL);
+    EXPECT_TRUE(RIMIMOFFTConvolve_Create(&config, NULL, work_size) == NULL);
+    EXPECT_TRUE(RIMIMOFFTConvolve_Create(&config, work, work_size - 1) == NULL);
+    config.num_input_channels = 0;
+    EXPECT_TRUE(RIMIMOFFTConvolve_CalculateWorkSize(&config) < 0);
+    config.num_input_channels = 2;
+    config.fft_partition_size = RIMIMOFFTCONVOLVE_MAX_PARTITION_SIZE + 1;
+    EXPECT_TRUE(RIMIMOFFTConvolve_CalculateWorkSize(&config) < 0);
+    config.fft_partition_size = 0;
+
+    /* 既定の分割サイズ */
+    conv = RIMIMOFFTConvolve_Create(&config, work, work_size);
+    ASSERT_TRUE(conv != NULL);
+    EXPECT_EQ(RIMIMOFFTCONVOLVE_DEFAULT_PARTITION_SIZE, RIMIMOFFTConvolve_GetLatencyNumSamples(conv));
+    RIMIMOFFTConvolve_Destroy(conv);
+
+    /* 分割サイズは2の冪乗に切り上げ */
+    config.fft_partition_size = 200;
+    ASSERT_TRUE(RIMIMOFFTConvolve_CalculateWorkSize(&config) <= work_size);
+    conv = RIMIMOFFTConvolve_Create(&config, work, work_size);
+    ASSERT_TRUE(conv != NULL);
+    EXPECT_EQ(256, RIMIMOFFTConvolve_GetLatencyNumSamples(conv));
+    RIMIMOFFTConvolve_Destroy(conv);
+
+    free(work);
+}
+
+/* 畳み込み一致確認テスト */
+TEST(RIMIMOFFTConvolveTest, ConvolveTest)
+{
+#define NUM_INPUTS 2
+#define NUM_OUTPUTS 3
+#define NUM_SAMPLES 8192
+#define MAX_NUM_COEFFICIENTS 3000
+    struct RIMIMOFFTConvolveConfig config;
+    struct RIMIMOFFTConvolve *conv;
+    int64_t work_size;
+    int32_t latency;
+    void *work;
+    uint32_t in, out, smpl, i, part;
+    /* 分割サイズ: 既定値, 係数より短い, 係数より長い */
+    const uint32_t partition_sizes[] = { 0, 128, 4096 };
+    const uint32_t num_coefficients[NUM_INPUTS][NUM_OUTPUTS] = { { 3000, 10, 1025 }, { 0, 2048, 1 } };
+    static float coef[NUM_INPUTS][NUM_OUTPUTS][MAX_NUM_COEFFICIENTS];
+    static float input[NUM_INPUTS][NUM_SAMPLES];
+    static float output[NUM_OUTPUTS][NUM_SAMPLES];
+    static float answer[NUM_OUTPUTS][NUM_SAMPLES];
+    const float *pinput[NUM_INPUTS];
+    float *poutput[NUM_OUTPUTS];
+
+    srand(0);
+    for (part = 0; part < sizeof(partition_sizes) / sizeof(partition_sizes[0]); part++) {
+        config.num_input_channels = NUM_INPUTS;
+        config.num_output_channels = NUM_OUTPUTS;
+        config.max_num_coefficients = MAX_NUM_COEFFICIENTS;
+        config.fft_partition_size = partition_sizes[part];
+        work_size = RIMIMOFFTConvolve_CalculateWorkSize(&config);
+        ASSERT_TRUE(work_size > 0);
+        work = malloc((size_t)work_size);
+        conv = RIMIMOFFTConvolve_Create(&config, work, work_size);
+        ASSERT_TRUE(conv != NULL);
+
+        /* 係数と入力を作成 */
+        for (in = 0; in < NUM_INPUTS; in++) {
+            for (out = 0; out < NUM_OUTPUTS; out++) {
+                for (i = 0; i < num_coefficients[in][out]; i++) {
+                    coef[in][out][i] = 2.0f * ((float)rand() / RAND_MAX - 0.5f) / (float)(i + 1);
+                }
+                if (num_coefficients[in][out] > 0) {
+                    RIMIMOFFTConvolve_SetCoefficients(conv, in, out, coef[in][out], num_coefficients[in][out]);
+                }
+            }
+            for (smpl = 0; smpl < NUM_SAMPLES; smpl++) {
+                input[in][smpl] = 2.0f * ((float)rand() / RAND_MAX - 0.5f);
+            }
+        }
+
+        /* 正解作成 */
+        memset(answer, 0, sizeof(answer));
+        for (out = 0; out < NUM_OUTPUTS; out++) {
+            for (in = 0; in < NUM_INPUTS; in++) {
+                for (smpl = 0; smpl < NUM_SAMPLES; smpl++) {
+                    for (i = 0; (i < num_coefficients[in][out]) && (smpl + i < NUM_SAMPLES); i++) {
+                        answer[out][smpl + i] += coef[in][out][i] * input[in][smpl];
+                    }
+                }
+            }
+        }
+
+        /* ランダムなブロックサイズで畳み込み */
+        smpl = 0;
+        while (smpl < NUM_SAMPLES) {
+            const uint32_t rand_input = (uint32_t)rand() % 1500;
+            const uint32_t num_block_samples = MIN(rand_input, NUM_SAMPLES - smpl);
+            for (in = 0; in < NUM_INPUTS; in++) {
+                pinput[in] = &input[in][smpl];
+            }
+            for (out = 0; out < NUM_OUTPUTS; out++) {
+                poutput[out] = &output[out][smpl];
+            }
+            RIMIMOFFTConvolve_Convolve(conv, pinput, poutput, num_block_samples);
+            smpl += num_block_samples;
+        }
+
+        /* 一致確認 */
+        latency = RIMIMOFFTConvolve_GetLatencyNumSamples(conv);
+        for (out = 0; out < NUM_OUTPUTS; out++) {
+            for (smpl = 0; smpl < (uint32_t)latency; smpl++) {
+                EXPECT_EQ(0.0f, output[out][smpl]);
+            }
+            for (smpl = 0; smpl < NUM_SAMPLES - (uint32_t)latency; smpl++) {
+                EXPECT_NEAR(answer[out][smpl], output[out][smpl + (uint32_t)latency], 1e-3);
+            }
+        }
+
+        RIMIMOFFTConvolve_Destroy(conv);
+        free(work);
+    }
+#undef NUM_INPUTS
+#undef NUM_OUTPUTS
+#undef NUM_SAMPLES
+#undef MAX_NUM_COEFFICIENTS
+}
@@ -0,0 +1,283 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <gtest/gtest.h>
+
+/* テスト対象のモジュール */
+extern "C" {
+#include "../../libs/ri_convolve/src/ri_spectrum_cache.c"
+}
+
+/* 生成破棄テスト */
+TEST(RISpectrumCacheTest, CreateDestroyTest)
+{
+    /* ワークサイズ計算 */
+    {
+        struct RISpectrumCacheConfig config;
+
+        config.max_num_entries = 16;
+        config.max_partition_size = 1024;
+        config.max_memory_size = 1024 * 1024;
+        EXPECT_TRUE(RISpectrumCache_CalculateWorkSize(&config) > 0);
+
+        /* 不正な引数 */
+        EXPECT_TRUE(RISpectrumCache_CalculateWorkSize(NULL) < 0);
+        config.max_num_entries = 0;
+        EXPECT_TRUE(RISpectrumCache_CalculateWorkSize(&config) < 0);
+        config.max_num_entries = 16;
+        config.max_partition_size = 1000;
+        EXPECT_TRUE(RISpectrumCache_CalculateWorkSize(&config) < 0);
+
+        /* 32bitを超えるワークサイズも計算できる */
+        if (sizeof(size_t) > sizeof(int32_t)) {
+            config.max_partition_size = 1024;
+            config.max_memory_size = (size_t)INT32_MAX + 1;
+            EXPECT_TRUE(RISpectrumCache_CalculateWorkSize(&config) > (int64_t)INT32_MAX);
+            /* 上限を超える場合は失敗 */
+            config.max_memory_size = (size_t)RICONVOLVE_MAX_WORK_SIZE;
+            EXPECT_TRUE(RISpectrumCache_CalculateWorkSize(&config) < 0);
+        }
+    }
+
+    /* 生成 */
+    {
+        struct RISpectrumCacheConfig config;
+        struct RISpectrumCache *cache;
+        int64_t work_size;
+        void *work;
+
+        config.max_num_entries = 16;
+        config.max_partition_size = 1024;
+        config.max_memory_size = 1024 * 1024;
+        work_size = RISpectrumCache_CalculateWorkSize(&config);
+        work = malloc((size_t)work_size);
+
+        /* ワークサイズ不足 */
+        EXPECT_TRUE(RISpectrumCache_Create(&config, work, work_size - 1) == NULL);
+
+        cache = RISpectrumCache_Create(&config, work, work_size);
+        ASSERT_TRUE(cache != NULL);
+        EXPECT_EQ(0U, RISpectrumCache_GetNumEntries(cache));
+        EXPECT_EQ(0U, RISpectrumCache_GetUsedMemorySize(cache));
+
+        RISpectrumCache_Destroy(cache);
+        free(work);
+    }
+}
+
+/* 取得/解放テスト */
+TEST(RISpectrumCacheTest, AcquireReleaseTest)
+{
+    struct RISpectrumCacheConfig config;
+    struct RISpectrumCache *cache;
+    int64_t work_size;
+    void *work;
+    float coef[3000];
+    const float *spec1, *spec2, *spec3;
+    uint32_t i;
+
+    config.max_num_entries = 16;
+    config.max_partition_size = 1024;
+    config.max_memory_size = 1024 * 1024;
+    work_size = RISpectrumCache_CalculateWorkSize(&config);
+    work = malloc((size_t)work_size);
+    cache = RISpectrumCache_Create(&config, work, work_size);
+    ASSERT_TRUE(cache != NULL);
+
+    srand(0);
+    for (i = 0; i < 3000; i++) {
+        coef[i] = 2.0f * ((float)rand() / RAND_MAX - 0.5f);
+    }
+
+    /* 同一係数は同じスペクトルを返す */
+    EXPECT_EQ(RISPECTRUMCACHE_APIRESULT_OK, RISpectrumCache_Acquire(cache, coef, 3000, 1024, &spec1));
+    EXPECT_EQ(RISPECTRUMCACHE_APIRESULT_OK, RISpectrumCache_Acquire(cache, coef, 3000, 1024, &spec2));
+    EXPECT_EQ(spec1, spec2);
+    EXPECT_EQ(1U, RISpectrumCache_GetNumEntries(cache));
+
+    /* 分割サイズが異なれば別エントリ */
+    EXPECT_EQ(RISPECTRUMCACHE_APIRESULT_OK, RISpectrumCache_Acquire(cache, coef, 3000, 512, &spec3));
+    EXPECT_NE(spec1, spec3);
+    EXPECT_EQ(2U, RISpectrumCache_GetNumEntries(cache));
+
+    /* 内容が異なれば別エントリ */
+    coef[1234] += 1.0f;
+    EXPECT_EQ(RISPECTRUMCACHE_APIRESULT_OK, RISpectrumCache_Acquire(cache, coef, 3000, 1024, &spec2));
+    EXPECT_NE(spec1, spec2);
+    EXPECT_EQ(3U, RISpectrumCache_GetNumEntries(cache));
+
+    /* ハッシュ値が衝突しても内容が異なるエントリは返さない */
+    {
+        const float *spec4;
+        struct RISpectrumCacheEntry *entry;
+        uint64_t hash;
+        /* 変更前の係数のエントリのハッシュ値を変更後の係数のものに書き換える */
+        coef[1234] -= 1.0f;
+        hash = RISpectrumCache_CalculateHash(coef, 3000);
+        entry = RISpectrumCache_SearchEntry(cache, hash, coef, 3000, 1024);
+        ASSERT_TRUE(entry != NULL);
+        coef[1234] += 1.0f;
+        entry->hash = RISpectrumCache_CalculateHash(coef, 3000);
+        EXPECT_EQ(RISPECTRUMCACHE_APIRESULT_OK, RISpectrumCache_Acquire(cache, coef, 3000, 1024, &spec4));
+        EXPECT_EQ(spec2, spec4);
+        EXPECT_EQ(3U, RISpectrumCache_GetNumEntries(cache));
+        EXPECT_EQ(RISPECTRUMCACHE_APIRESULT_OK, RISpectrumCache_Release(cache, spec4));
+        entry->hash = hash;
+    }
+
+    /* 解放 */
+    EXPECT_EQ(RISPECTRUMCACHE_APIRESULT_OK, RISpectrumCache_Release(cache, spec1));
+    EXPECT_EQ(RISPECTRUMCACHE_APIRESULT_OK, RISpectrumCache_Release(cache, spec1));
+    EXPECT_EQ(RISPECTRUMCACHE_APIRESULT_NG, RISpectrumCache_Release(cache, spec1));
+    EXPECT_EQ(RISPECTRUMCACHE_APIRESULT_OK, RISpectrumCache_Release(cache, spec2));
+    EXPECT_EQ(RISPECTRUMCACHE_APIRESULT_OK, RISpectrumCache_Release(cache, spec3));
+    EXPECT_EQ(RISPECTRUMCACHE_APIRESULT_INVALID_ARGUMENT, RISpectrumCache_Release(cache, coef));
+
+    /* 不正な引数 */
+    EXPECT_EQ(RISPECTRUMCACHE_APIRESULT_INVALID_ARGUMENT, RISpectrumCache_Acquire(NULL, coef, 3000, 1024, &spec1));
+    EXPECT_EQ(RISPECTRUMCACHE_APIRESULT_INVALID_ARGUMENT, RISpectrumCache_Acquire(cache, NULL, 3000, 1024, &spec1));
+    EXPECT_EQ(RISPECTRUMCACHE_APIRESULT_INVALID_ARGUMENT, RISpectrumCache_Acquire(cache, coef, 3000, 2048, &spec1));
+    EXPECT_EQ(RISPECTRUMCACHE_APIRESULT_INVALID_ARGUMENT, RISpectrumCache_Acquire(cache, coef, 3000, 1000, &spec1));
+
+    /* クリア */
+    RISpectrumCache_Clear(cache);
+    EXPECT_EQ(0U, RISpectrumCache_GetNumEntries(cache));
+
+    RISpectrumCache_Destroy(cache);
+    free(work);
+}
+
+/* 追い出しテスト */
+TEST(RISpectrumCacheTest, EvictionTest)
+{
+    struct RISpectrumCacheConfig config;
+    struct RISpectrumCache *cache;
+    int64_t work_size;
+    void *work;
+    float coef[3][1024];
+    const float *spec[3], *tmp;
+    uint32_t i, j;
+
+    /* 2エントリ分のメモリしか無い */
+    config.max_num_entries = 16;
+    config.max_partition_size = 512;
+    config.max_memory_size = 2 * sizeof(float) * (2048 + 1024);
+    work_size = RISpectrumCache_CalculateWorkSize(&config);
+    work = malloc((size_t)work_size);
+    cache = RISpectrumCache_Create(&config, work, work_size);
+    ASSERT_TRUE(cache != NULL);
+
+    for (i = 0; i < 3; i++) {
+        for (j = 0; j < 1024; j++) {
+            coef[i][j] = (float)(i + 1) / (float)(j + 1);
+        }
+    }
+
+    /* 2つ登録して参照を解放 */
+    EXPECT_EQ(RISPECTRUMCACHE_APIRESULT_OK, RISpectrumCache_Acquire(cache, coef[0], 1024, 512, &spec[0]));
+    EXPECT_EQ(RISPECTRUMCACHE_APIRESULT_OK, RISpectrumCache_Acquire(cache, coef[1], 1024, 512, &spec[1]));
+    EXPECT_EQ(2 * sizeof(float) * (2048 + 1024), RISpectrumCache_GetUsedMemorySize(cache));
+    EXPECT_EQ(RISPECTRUMCACHE_APIRESULT_OK, RISpectrumCache_Release(cache, spec[0]));
+    EXPECT_EQ(RISPECTRUMCACHE_APIRESULT_OK, RISpectrumCache_Release(cache, spec[1]));
+
+    /* 0番目を使用して最近使ったことにする */
+    EXPECT_EQ(RISPECTRUMCACHE_APIRESULT_OK, RISpectrumCache_Acquire(cache, coef[0], 1024, 512, &tmp));
+    EXPECT_EQ(spec[0], tmp);
+    EXPECT_EQ(RISPECTRUMCACHE_APIRESULT_OK, RISpectrumCache_Release(cache, tmp));
+
+    /* 新規登録で最も古い1番目が追い出され、その領域が使われる */
+    EXPECT_EQ(RISPECTRUMCACHE_APIRESULT_OK, RISpectrumCache_Acquire(cache, coef[2], 1024, 512, &spec[2]));
+    EXPECT_EQ(spec[1], spec[2]);
+    EXPECT_EQ(2U, RISpectrumCache_GetNumEntries(cache));
+
+    /* 0番目は残っている */
+    EXPECT_EQ(RISPECTRUMCACHE_APIRESULT_OK, RISpectrumCache_Acquire(cache, coef[0], 1024, 512, &tmp));
+    EXPECT_EQ(spec[0], tmp);
+
+    /* 全て参照中なので追い出せない */
+    EXPECT_EQ(RISPECTRUMCACHE_APIRESULT_EXCEED_MAX_MEMORY, RISpectrumCache_Acquire(cache, coef[1], 1024, 512, &tmp));
+
+    /* 予算を超えるサイズは登録できない */
+    {
+        float large_coef[4096];
+        memset(large_coef, 0, sizeof(large_coef));
+        EXPECT_EQ(RISPECTRUMCACHE_APIRESULT_EXCEED_MAX_MEMORY, RISpectrumCache_Acquire(cache, large_coef, 4096, 512, &tmp));
+    }
+
+    RISpectrumCache_Destroy(cache);
+    free(work);
+}
+
+/* キャッシュしたスペクトルをFFT畳み込みにセットするテスト */
+TEST(RISpectrumCacheTest, BindSpectrumTest)
+{
+    const uint32_t num_coefficients = 5000;
+    const uint32_t num_samples = 8192;
+    const struct RIConvolveInterface *convif = RIFFTConvolve_GetInterface();
+    struct RIConvolveConfig conv_config;
+    struct RISpectrumCacheConfig config;
+    struct RISpectrumCache *cache;
+    int64_t cache_work_size;
+    int64_t conv_work_size;
+    void *cache_work, *conv_work[2], *conv[2];
+    float *coef, *input, *output[2];
+    const float *spec;
+    uint32_t i, smpl;
+
+    config.max_num_entries = 4;
+    config.max_partition_size = 1024;
+    config.max_memory_size = 1024 * 1024;
+    cache_work_size = RISpectrumCache_CalculateWorkSize(&config);
+    cache_work = malloc((size_t)cache_work_size);
+    cache = RISpectrumCache_Create(&config, cache_work, cache_work_size);
+    ASSERT_TRUE(cache != NULL);
+
+    conv_config.max_num_coefficients = num_coefficients;
+    conv_config.max_num_input_samples = 256;
+    conv_config.fft_partition_size = 0;
+    conv_config.num_head_coefficients = 0;
+    conv_config.num_delay_samples = 0;
+    conv_config.use_worker_thread = 0;
+    conv_work_size = convif->CalculateWorkSize(&conv_config);
+    for (i = 0; i < 2; i++) {
+        conv_work[i] = malloc((size_t)conv_work_size);
+        conv[i] = convif->Create(&conv_config, conv_work[i], conv_work_size);
+        ASSERT_TRUE(conv[i] != NULL);
+        output[i] = (float *)malloc(sizeof(float) * num_samples);
+    }
+
+    coef = (float *)malloc(sizeof(float) * num_coefficients);
+    input = (float *)malloc(sizeof(float) * num_samples);
+    srand(0);
+    for (i = 0; i < num_coefficients; i++) {
+        coef[i] = 2.0f * ((float)rand() / RAND_MAX - 0.5f);
+    }
+    for (smpl = 0; smpl < num_samples; smpl++) {
+        input[smpl] = 2.0f * ((float)rand() / RAND_MAX - 0.5f);
+    }
+
+    /* 一方は通常の係数セット、もう一方はキャッシュからセット */
+    convif->SetCoefficients(conv[0], coef, num_coefficients);
+    ASSERT_EQ(RISPECTRUMCACHE_APIRESULT_OK,
+            RISpectrumCache_Acquire(cache, coef, num_coefficients, RIFFTConvolve_GetPartitionSize(conv[1]), &spec));
+    RIFFTConvolve_BindSpectrum(conv[1], spec, num_coefficients);
+
+    /* 結果は一致する */
+    for (smpl = 0; smpl < num_samples; smpl += 256) {
+        convif->Convolve(conv[0], &input[smpl], &output[0][smpl], 256);
+        convif->Convolve(conv[1], &input[smpl], &output[1][smpl], 256);
+    }
+    EXPECT_EQ(0, memcmp(output[0], output[1], sizeof(float) * num_samples));
+
+    EXPECT_EQ(RISPECTRUMCACHE_APIRESULT_OK, RISpectrumCache_Release(cache, spec));
+
+    for (i = 0; i < 2; i++) {
+        convif->Destroy(conv[i]);
+        free(conv_work[i]);
+        free(output[i]);
+    }
+    free(coef);
+    free(input);
+    RISpectrumCache_Destroy(cache);
+    free(cache_work);
+}
@@ -0,0 +1,145 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <gtest/gtest.h>
+
+/* テスト対象のモジュール */
+extern "C" {
+#include "../../libs/ri_convolve/src/ri_stereo_fft_convolve.c"
+}
+
+/* 生成破棄テスト */
+TEST(RIStereoFFTConvolveTest, CreateDestroyTest)
+{
+    struct RIStereoFFTConvolveConfig config;
+    struct RIStereoFFTConvolve *conv;
+    int64_t work_size;
+    void *work;
+
+    config.max_num_coefficients = 4096;
+    config.fft_partition_size = 0;
+    work_size = RIStereoFFTConvolve_CalculateWorkSize(&config);
+    ASSERT_TRUE(work_size > 0);
+    work = malloc((size_t)work_size);
+
+    /* 不正な引数 */
+    EXPECT_TRUE(RIStereoFFTConvolve_CalculateWorkSize(NULL) < 0);
+    EXPECT_TRUE(RIStereoFFTConvolve_Create(NULL, work, work_size) == NULL);
+    EXPECT_TRUE(RIStereoFFTConvolve_Create(&config, NULL, work_size) == NULL);
+    EXPECT_TRUE(RIStereoFFTConvolve_Create(&config, work, work_size - 1) == NULL);
+    config.max_num_coefficients = 0;
+    EXPECT_TRUE(RIStereoFFTConvolve_CalculateWorkSize(&config) < 0);
+    config.max_num_coefficients = 4096;
+    config.fft_partition_size = RISTEREOFFTCONVOLVE_MAX_PARTITION_SIZE + 1;
+    EXPECT_TRUE(RIStereoFFTConvolve_CalculateWorkSize(&config) < 0);
+    config.fft_partition_size = 0;
+
+    /* 既定の分割サイズ */
+    conv = RIStereoFFTConvolve_Create(&config, work, work_size);
+    ASSERT_TRUE(conv != NULL);
+    EXPECT_EQ(RISTEREOFFTCONVOLVE_DEFAULT_PARTITION_SIZE, RIStereoFFTConvolve_GetLatencyNumSamples(conv));
+    RIStereoFFTConvolve_Destroy(conv);
+
+    /* 分割サイズは2の冪乗に切り上げ */
+    config.fft_partition_size = 200;
+    ASSERT_TRUE(RIStereoFFTConvolve_CalculateWorkSize(&config) <= work_size);
+    conv = RIStereoFFTConvolve_Create(&config, work, work_size);
+    ASSERT_TRUE(conv != NULL);
+    EXPECT_EQ(256, RIStereoFFTConvolve_GetLatencyNumSamples(conv));
+    RIStereoFFTConvolve_Destroy(conv);
+
+    free(work);
+}
+
+/* 畳み込み一致確認テスト */
+TEST(RIStereoFFTConvolveTest, ConvolveTest)
+{
+#define NUM_CHANNELS RISTEREOFFTCONVOLVE_NUM_CHANNELS
+#define NUM_SAMPLES 8192
+#define MAX_NUM_COEFFICIENTS 3000
+    struct RIStereoFFTConvolveConfig config;
+    struct RIStereoFFTConvolve *conv;
+    int64_t work_size;
+    int32_t latency;
+    void *work;
+    uint32_t ch, smpl, i, pattern, part;
+    /* 分割サイズ: 既定値, 係数より短い, 係数より長い */
+    const uint32_t partition_sizes[] = { 0, 128, 4096 };
+    /* 長さの異なる係数, 分割数が奇数/偶数の係数, 片チャンネルのみ係数を設定した場合を確認 */
+    const uint32_t num_coefficients[][NUM_CHANNELS] = { { 3000, 1025 }, { 2048, 1 }, { 0, 1500 } };
+    static float coef[NUM_CHANNELS][MAX_NUM_COEFFICIENTS];
+    static float input[NUM_CHANNELS][NUM_SAMPLES];
+    static float output[NUM_CHANNELS][NUM_SAMPLES];
+    static float answer[NUM_CHANNELS][NUM_SAMPLES];
+    const float *pinput[NUM_CHANNELS];
+    float *poutput[NUM_CHANNELS];
+
+    srand(0);
+    for (part = 0; part < sizeof(partition_sizes) / sizeof(partition_sizes[0]); part++) {
+        config.max_num_coefficients = MAX_NUM_COEFFICIENTS;
+        config.fft_partition_size = partition_sizes[part];
+        work_size = RIStereoFFTConvolve_CalculateWorkSize(&config);
+        ASSERT_TRUE(work_size > 0);
+        work = malloc((size_t)work_size);
+
+        for (pattern = 0; pattern < sizeof(num_coefficients) / sizeof(num_coefficients[0]); pattern++) {
+            conv = RIStereoFFTConvolve_Create(&config, work, work_size);
+            ASSERT_TRUE(conv != NULL);
+
+            /* 係数と入力を作成 */
+            for (ch = 0; ch < NUM_CHANNELS; ch++) {
+                for (i = 0; i < num_coefficients[pattern][ch]; i++) {
+                    coef[ch][i] = 2.0f * ((float)rand() / RAND_MAX - 0.5f) / (float)(i + 1);
+                }
+                if (num_coefficients[pattern][ch] > 0) {
+                    RIStereoFFTConvolve_SetCoefficients(conv, ch, coef[ch], num_coefficients[pattern][ch]);
+                }
+                for (smpl = 0; smpl < NUM_SAMPLES; smpl++) {
+                    input[ch][smpl] = 2.0f * ((float)rand() / RAND_MAX - 0.5f);
+                }
+            }
+
+            /* 正解作成 */
+            memset(answer, 0, sizeof(answer));
+            for (ch = 0; ch < NUM_CHANNELS; ch++) {
+                for (smpl = 0; smpl < NUM_SAMPLES; smpl++) {
+                    for (i = 0; (i < num_coefficients[pattern][ch]) && (smpl + i < NUM_SAMPLES); i++) {
+                        answer[ch][smpl + i] += coef[ch][i] * input[ch][smpl];
+                    }
+                }
+            }
+
+            /* ランダムなブロックサイズで畳み込み */
+            smpl = 0;
+            while (smpl < NUM_SAMPLES) {
+                const uint32_t rand_input = (uint32_t)rand() % 1500;
+                const uint32_t num_block_samples = MIN(rand_input, NUM_SAMPLES - smpl);
+                for (ch = 0; ch < NUM_CHANNELS; ch++) {
+                    pinput[ch] = &input[ch][smpl];
+                    poutput[ch] = &output[ch][smpl];
+                }
+                RIStereoFFTConvolve_Convolve(conv, pinput, poutput, num_block_samples);
+                smpl += num_block_samples;
+            }
+
+            /* 一致確認 */
+            latency = RIStereoFFTConvolve_GetLatencyNumSamples(conv);
+            for (ch = 0; ch < NUM_CHANNELS; ch++) {
+                for (smpl = 0; smpl < (uint32_t)latency; smpl++) {
+                    EXPECT_EQ(0.0f, output[ch][smpl]);
+                }
+                for (smpl = 0; smpl < NUM_SAMPLES - (uint32_t)latency; smpl++) {
+                    EXPECT_NEAR(answer[ch][smpl], output[ch][smpl + (uint32_t)latency], 1e-3);
+                }
+            }
+
+            RIStereoFFTConvolve_Destroy(conv);
+        }
+
+        free(work);
+    }
+#undef NUM_CHANNELS
+#undef NUM_SAMPLES
+#undef MAX_NUM_COEFFICIENTS
+}
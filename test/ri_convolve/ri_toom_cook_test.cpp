@@ -0,0 +1,129 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <gtest/gtest.h>
+
+/* テスト対象のモジュール */
+extern "C" {
+#include "../../libs/ri_convolve/src/ri_toom_cook.c"
+}
+
+/* Toom-Cook 3分割法の単体での畳み込み一致確認テスト */
+TEST(RIToomCookTest, ConvolveToom3Test)
+{
+#define MAX_NUM_SAMPLES 3000
+    uint32_t i, j, pattern, num_levels;
+    /* 分割の端数が全て現れる長さを含める */
+    const uint32_t num_samples[] = { 1, 7, 64, 65, 66, 67, 200, 1024, 1025, 2049, 3000 };
+    static float a[MAX_NUM_SAMPLES];
+    static float b[MAX_NUM_SAMPLES];
+    static float z[2 * MAX_NUM_SAMPLES];
+    static float answer[2 * MAX_NUM_SAMPLES];
+    float *work, *tree;
+
+    work = (float *)malloc(sizeof(float) * MAX(RIToomCook_CalculateToom3WorkSize(MAX_NUM_SAMPLES), 1));
+    tree = (float *)malloc(sizeof(float) * MAX(RIToomCook_CalculateEvaluationTreeSize(MAX_NUM_SAMPLES, 3), 1));
+
+    srand(0);
+    for (pattern = 0; pattern < sizeof(num_samples) / sizeof(num_samples[0]); pattern++) {
+        const uint32_t n = num_samples[pattern];
+
+        for (i = 0; i < n; i++) {
+            a[i] = 2.0f * ((float)rand() / RAND_MAX - 0.5f);
+            b[i] = 2.0f * ((float)rand() / RAND_MAX - 0.5f) / (float)(i + 1);
+        }
+
+        /* 正解作成 */
+        memset(answer, 0, sizeof(answer));
+        for (i = 0; i < n; i++) {
+            for (j = 0; j < n; j++) {
+                answer[i + j] += a[i] * b[j];
+            }
+        }
+
+        /* 係数側の評価値の木を持つ階層数を変えても一致 */
+        for (num_levels = 0; num_levels <= 3; num_levels++) {
+            RIToomCook_MakeEvaluationTree(b, tree, n, num_levels);
+            RIToomCook_ConvolveToom3(a, b, tree, num_levels, z, work, n);
+
+            /* 一致確認 */
+            for (i = 0; i < 2 * n; i++) {
+                EXPECT_NEAR(answer[i], z[i], 1e-4);
+            }
+        }
+    }
+
+    free(work);
+    free(tree);
+#undef MAX_NUM_SAMPLES
+}
+
+/* 2の冪乗でない係数長・ブロックサイズでの畳み込み一致確認テスト */
+TEST(RIToomCookTest, ConvolveTest)
+{
+#define NUM_SAMPLES 8192
+    const struct RIConvolveInterface *conv_if = RIToomCook_GetInterface();
+    struct RIConvolveConfig config;
+    void *conv, *work;
+    int64_t work_size;
+    uint32_t smpl, j, pattern, fixed_block;
+    const uint32_t num_coefficients[] = { 1, 100, 1025, 3000, 3000 };
+    const uint32_t max_num_input_samples[] = { 512, 1, 1500, 100, 4000 };
+    static float coef[4000];
+    static float input[NUM_SAMPLES];
+    static float output[NUM_SAMPLES];
+    static float answer[NUM_SAMPLES];
+
+    srand(0);
+    for (smpl = 0; smpl < NUM_SAMPLES; smpl++) {
+        input[smpl] = 2.0f * ((float)rand() / RAND_MAX - 0.5f);
+    }
+
+    for (pattern = 0; pattern < sizeof(num_coefficients) / sizeof(num_coefficients[0]); pattern++) {
+        for (j = 0; j < num_coefficients[pattern]; j++) {
+            coef[j] = 2.0f * ((float)rand() / RAND_MAX - 0.5f) / (float)(j + 1);
+        }
+
+        /* 正解作成 */
+        memset(answer, 0, sizeof(answer));
+        for (smpl = 0; smpl < NUM_SAMPLES; smpl++) {
+            for (j = 0; (j < num_coefficients[pattern]) && (smpl + j < NUM_SAMPLES); j++) {
+                answer[smpl + j] += coef[j] * input[smpl];
+            }
+        }
+
+        config.max_num_coefficients = num_coefficients[pattern];
+        config.max_num_input_samples = max_num_input_samples[pattern];
+        config.fft_partition_size = 0;
+        config.num_head_coefficients = 0;
+        config.num_delay_samples = 0;
+        config.use_worker_thread = 0;
+        work_size = conv_if->CalculateWorkSize(&config);
+        ASSERT_TRUE(work_size > 0);
+        work = malloc((size_t)work_size);
+        conv = conv_if->Create(&config, work, work_size);
+        ASSERT_TRUE(conv != NULL);
+
+        /* ランダムなブロックサイズ・最大入力サンプル数（事前計算した評価値を使う）で畳み込み */
+        for (fixed_block = 0; fixed_block <= 1; fixed_block++) {
+            conv_if->SetCoefficients(conv, coef, num_coefficients[pattern]);
+            smpl = 0;
+            while (smpl < NUM_SAMPLES) {
+                const uint32_t rand_input = fixed_block ? config.max_num_input_samples
+                    : (uint32_t)rand() % (config.max_num_input_samples + 1);
+                const uint32_t num_block_samples = (rand_input < NUM_SAMPLES - smpl) ? rand_input : (NUM_SAMPLES - smpl);
+                conv_if->Convolve(conv, &input[smpl], &output[smpl], num_block_samples);
+                smpl += num_block_samples;
+            }
+
+            /* 一致確認 */
+            for (smpl = 0; smpl < NUM_SAMPLES; smpl++) {
+                EXPECT_NEAR(answer[smpl], output[smpl], 1e-4);
+            }
+        }
+
+        conv_if->Destroy(conv);
+        free(work);
+    }
+#undef NUM_SAMPLES
+}
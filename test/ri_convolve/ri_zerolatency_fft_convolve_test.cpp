@@ -1,5 +1,6 @@
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 
 #include <gtest/gtest.h>
 
@@ -7,3 +8,421 @@
 extern "C" {
 #include "../../libs/ri_convolve/src/ri_zerolatency_fft_convolve.c"
 }
+
+/* 分割サイズと先頭係数長の設定を確認しつつ直接畳み込みと比較 calibrateが真なら分割サイズを計測して係数をセット */
+static void ZeroLatencyConvolveCheckCommon(
+        const struct RIConvolveConfig *config, uint32_t num_coefficients, uint32_t num_block_samples, uint8_t calibrate,
+        uint32_t *partition_size, uint32_t *num_head_coefficients, uint32_t *num_stages)
+{
+#define NUM_SAMPLES 16384
+    const struct RIConvolveInterface *conv_if = RIZeroLatencyFFTConvolve_GetInterface();
+    void *conv, *work;
+    int64_t work_size;
+    uint32_t i, j, smpl;
+    float *coef, *input, *output, *answer;
+
+    coef = (float *)malloc(sizeof(float) * num_coefficients);
+    input = (float *)malloc(sizeof(float) * NUM_SAMPLES);
+    output = (float *)malloc(sizeof(float) * NUM_SAMPLES);
+    answer = (float *)malloc(sizeof(float) * NUM_SAMPLES);
+
+    srand(0);
+    for (i = 0; i < num_coefficients; i++) {
+        coef[i] = 2.0f * ((float)rand() / RAND_MAX - 0.5f) / sqrtf((float)num_coefficients);
+    }
+    for (smpl = 0; smpl < NUM_SAMPLES; smpl++) {
+        input[smpl] = 2.0f * ((float)rand() / RAND_MAX - 0.5f);
+    }
+    memset(answer, 0, sizeof(float) * NUM_SAMPLES);
+    for (smpl = 0; smpl < NUM_SAMPLES; smpl++) {
+        for (j = 0; (j < num_coefficients) && (smpl + j < NUM_SAMPLES); j++) {
+            answer[smpl + j] += coef[j] * input[smpl];
+        }
+    }
+
+    work_size = conv_if->CalculateWorkSize(config);
+    ASSERT_TRUE(work_size > 0);
+    work = malloc((size_t)work_size);
+    conv = conv_if->Create(config, work, work_size);
+    ASSERT_TRUE(conv != NULL);
+
+    if (calibrate) {
+        const uint32_t calibrated_size = RIZeroLatencyFFTConvolve_CalibratePartitionSize(conv, coef, num_coefficients);
+        EXPECT_EQ(calibrated_size, RIZeroLatencyFFTConvolve_GetPartitionSize(conv));
+    } else {
+        conv_if->SetCoefficients(conv, coef, num_coefficients);
+    }
+    (*partition_size) = RIZeroLatencyFFTConvolve_GetPartitionSize(conv);
+    (*num_head_coefficients) = RIZeroLatencyFFTConvolve_GetNumHeadCoefficients(conv);
+    (*num_stages) = RIZeroLatencyFFTConvolve_GetNumStages(conv);
+    EXPECT_GE(*num_head_coefficients, *partition_size);
+
+    for (smpl = 0; smpl < NUM_SAMPLES; smpl += num_block_samples) {
+        conv_if->Convolve(conv, &input[smpl], &output[smpl], num_block_samples);
+    }
+    for (smpl = 0; smpl < NUM_SAMPLES; smpl++) {
+        EXPECT_NEAR(answer[smpl], output[smpl], 1e-4f);
+    }
+
+    conv_if->Destroy(conv);
+    free(work);
+    free(answer);
+    free(output);
+    free(input);
+    free(coef);
+#undef NUM_SAMPLES
+}
+
+/* 係数をセットして確認 */
+static void ZeroLatencyConvolveCheck(
+        const struct RIConvolveConfig *config, uint32_t num_coefficients, uint32_t num_block_samples,
+        uint32_t *partition_size, uint32_t *num_head_coefficients, uint32_t *num_stages)
+{
+    ZeroLatencyConvolveCheckCommon(config, num_coefficients, num_block_samples, 0,
+            partition_size, num_head_coefficients, num_stages);
+}
+
+/* 分割サイズと先頭係数長の設定テスト */
+TEST(RIZeroLatencyFFTConvolveTest, PartitionSizeTest)
+{
+    struct RIConvolveConfig config;
+    uint32_t partition_size, num_head_coefficients, num_stages;
+
+    /* 先頭係数長が分割サイズ未満なら失敗 */
+    config.max_num_coefficients = 2000;
+    config.max_num_input_samples = 32;
+    config.fft_partition_size = 256;
+    config.num_head_coefficients = 128;
+    config.num_delay_samples = 0;
+    config.use_worker_thread = 0;
+    EXPECT_TRUE(RIZeroLatencyFFTConvolve_GetInterface()->CalculateWorkSize(&config) < 0);
+
+    /* 短いブロック向けに分割サイズ/先頭係数長を小さく指定 */
+    config.fft_partition_size = 64;
+    config.num_head_coefficients = 64;
+    ZeroLatencyConvolveCheck(&config, 2000, 32, &partition_size, &num_head_coefficients, &num_stages);
+    EXPECT_EQ(64, partition_size);
+    EXPECT_EQ(64, num_head_coefficients);
+
+    /* 分割サイズは2の冪乗に切り上げ、先頭係数長は分割サイズより長くてもよい */
+    config.fft_partition_size = 100;
+    config.num_head_coefficients = 300;
+    ZeroLatencyConvolveCheck(&config, 2000, 32, &partition_size, &num_head_coefficients, &num_stages);
+    EXPECT_EQ(128, partition_size);
+    EXPECT_EQ(300, num_head_coefficients);
+
+    /* 大きいブロック向けに大きい分割サイズを指定 */
+    config.max_num_input_samples = 1024;
+    config.fft_partition_size = 2048;
+    config.num_head_coefficients = 0;
+    ZeroLatencyConvolveCheck(&config, 2000, 1024, &partition_size, &num_head_coefficients, &num_stages);
+    EXPECT_EQ(2048, partition_size);
+    EXPECT_EQ(2048, num_head_coefficients);
+
+    /* 先頭係数長のみ指定: 分割サイズは既定値を先頭係数長以下に制限 */
+    config.max_num_input_samples = 32;
+    config.fft_partition_size = 0;
+    config.num_head_coefficients = 200;
+    ZeroLatencyConvolveCheck(&config, 2000, 32, &partition_size, &num_head_coefficients, &num_stages);
+    EXPECT_EQ(128, partition_size);
+    EXPECT_EQ(200, num_head_coefficients);
+
+    /* 指定なし: 既定値 */
+    config.fft_partition_size = 0;
+    config.num_head_coefficients = 0;
+    ZeroLatencyConvolveCheck(&config, 2000, 32, &partition_size, &num_head_coefficients, &num_stages);
+    EXPECT_EQ(RIBARACONVOLVE_DEFAULT_PARTITION_SIZE, partition_size);
+    EXPECT_EQ(partition_size, num_head_coefficients);
+
+    /* 最大係数長が既定値より短ければ係数長まで */
+    config.max_num_coefficients = 300;
+    ZeroLatencyConvolveCheck(&config, 300, 32, &partition_size, &num_head_coefficients, &num_stages);
+    EXPECT_EQ(512, partition_size);
+
+    /* 係数長が短ければ時間領域のみ */
+    config.max_num_coefficients = 2000;
+    ZeroLatencyConvolveCheck(&config, 50, 32, &partition_size, &num_head_coefficients, &num_stages);
+    EXPECT_EQ(RIBARACONVOLVE_DEFAULT_PARTITION_SIZE, partition_size);
+    EXPECT_EQ(0, num_stages);
+}
+
+/* 分割サイズの計測テスト */
+TEST(RIZeroLatencyFFTConvolveTest, CalibratePartitionSizeTest)
+{
+    struct RIConvolveConfig config;
+    uint32_t partition_size, num_head_coefficients, num_stages;
+
+    config.max_num_coefficients = 2000;
+    config.max_num_input_samples = 32;
+    config.fft_partition_size = 0;
+    config.num_head_coefficients = 0;
+    config.num_delay_samples = 0;
+    config.use_worker_thread = 0;
+
+    /* 候補の中から選ぶ */
+    ZeroLatencyConvolveCheckCommon(&config, 2000, 32, 1, &partition_size, &num_head_coefficients, &num_stages);
+    EXPECT_TRUE((partition_size >= RIBARACONVOLVE_MIN_PARTITION_SIZE) && (partition_size <= RIBARACONVOLVE_MAX_PARTITION_SIZE));
+    EXPECT_EQ(partition_size, num_head_coefficients);
+
+    /* 先頭係数長の指定があれば先頭係数長以下から選ぶ */
+    config.num_head_coefficients = 200;
+    ZeroLatencyConvolveCheckCommon(&config, 2000, 32, 1, &partition_size, &num_head_coefficients, &num_stages);
+    EXPECT_TRUE((partition_size == 64) || (partition_size == 128));
+    EXPECT_EQ(200, num_head_coefficients);
+
+    /* 分割サイズを指定していれば変わらない */
+    config.fft_partition_size = 256;
+    config.num_head_coefficients = 0;
+    ZeroLatencyConvolveCheckCommon(&config, 2000, 32, 1, &partition_size, &num_head_coefficients, &num_stages);
+    EXPECT_EQ(256, partition_size);
+
+    /* ワーカースレッド使用時 */
+    config.fft_partition_size = 0;
+    config.use_worker_thread = 1;
+    ZeroLatencyConvolveCheckCommon(&config, 2000, 32, 1, &partition_size, &num_head_coefficients, &num_stages);
+    EXPECT_EQ(partition_size + 2 * 32, num_head_coefficients);
+}
+
+/* 多段構成のテスト */
+TEST(RIZeroLatencyFFTConvolveTest, MultiStageTest)
+{
+    struct RIConvolveConfig config;
+    struct RIZeroLatencyFFTConvolveStage stages[RIBARACONVOLVE_MAX_NUM_STAGES];
+    uint32_t i, num_stages, partition_size, num_head_coefficients;
+
+    /* 段構成: 各段は前段の末尾から始まり、遅延(先頭位置 - 分割サイズ)は非負 */
+    {
+        const uint32_t test_partition_size[] = { 64, 128, 1024, 2048, 8192, 16384 };
+        const uint32_t test_num_coefficients[] = { 1, 100, 1000, 10000, 100000, 1000000 };
+        uint32_t p, c;
+
+        for (p = 0; p < sizeof(test_partition_size) / sizeof(test_partition_size[0]); p++) {
+            for (c = 0; c < sizeof(test_num_coefficients) / sizeof(test_num_coefficients[0]); c++) {
+                uint32_t offset = test_partition_size[p];
+                num_stages = RIZeroLatencyFFTConvolve_CalculateStages(
+                        test_partition_size[p], test_partition_size[p], test_num_coefficients[c], 0, stages);
+                ASSERT_TRUE(num_stages <= RIBARACONVOLVE_MAX_NUM_STAGES);
+                for (i = 0; i < num_stages; i++) {
+                    EXPECT_EQ(offset, stages[i].offset);
+                    EXPECT_GE(stages[i].offset, stages[i].partition_size);
+                    EXPECT_GT(stages[i].max_num_coefficients, 0);
+                    EXPECT_LE(stages[i].partition_size, MAX(test_partition_size[p], RIBARACONVOLVE_MAX_STAGE_PARTITION_SIZE));
+                    if (i > 0) {
+                        EXPECT_GT(stages[i].partition_size, stages[i - 1].partition_size);
+                    }
+                    offset += stages[i].max_num_coefficients;
+                }
+                EXPECT_EQ(MAX(test_partition_size[p], test_num_coefficients[c]), offset);
+            }
+        }
+
+        /* 64から始めると64, 256, 1024, 4096, 8192の5段 */
+        num_stages = RIZeroLatencyFFTConvolve_CalculateStages(64, 64, 100000, 0, stages);
+        ASSERT_EQ(5, num_stages);
+        EXPECT_EQ(64, stages[0].partition_size);
+        EXPECT_EQ(256, stages[1].partition_size);
+        EXPECT_EQ(1024, stages[2].partition_size);
+        EXPECT_EQ(4096, stages[3].partition_size);
+        EXPECT_EQ(8192, stages[4].partition_size);
+        EXPECT_EQ(8192, stages[4].offset);
+    }
+
+    /* 全段を通した畳み込み結果の確認 */
+    config.max_num_coefficients = 12000;
+    config.max_num_input_samples = 32;
+    config.fft_partition_size = 64;
+    config.num_head_coefficients = 64;
+    config.num_delay_samples = 0;
+    config.use_worker_thread = 0;
+    ZeroLatencyConvolveCheck(&config, 12000, 32, &partition_size, &num_head_coefficients, &num_stages);
+    EXPECT_EQ(5, num_stages);
+
+    /* 先頭係数長が分割サイズより長い場合 */
+    config.fft_partition_size = 128;
+    config.num_head_coefficients = 300;
+    ZeroLatencyConvolveCheck(&config, 12000, 32, &partition_size, &num_head_coefficients, &num_stages);
+    EXPECT_EQ(4, num_stages);
+
+    /* 係数が短ければ後段は使わない */
+    config.fft_partition_size = 64;
+    config.num_head_coefficients = 64;
+    ZeroLatencyConvolveCheck(&config, 1000, 32, &partition_size, &num_head_coefficients, &num_stages);
+    EXPECT_EQ(2, num_stages);
+
+    /* 入力ブロックが分割サイズより大きい場合 */
+    config.max_num_input_samples = 1024;
+    ZeroLatencyConvolveCheck(&config, 12000, 1024, &partition_size, &num_head_coefficients, &num_stages);
+    EXPECT_EQ(5, num_stages);
+}
+
+/* ワーカースレッド使用時のテスト */
+TEST(RIZeroLatencyFFTConvolveTest, WorkerThreadTest)
+{
+    struct RIConvolveConfig config;
+    struct RIZeroLatencyFFTConvolveStage stages[RIBARACONVOLVE_MAX_NUM_STAGES];
+    uint32_t i, num_stages, partition_size, num_head_coefficients;
+
+    /* 段構成: 先読みサンプル数を含めても遅延(先頭位置 - 分割サイズ - 先読みサンプル数)は非負 */
+    {
+        const uint32_t test_lookahead_samples[] = { 1, 32, 256, 1024 };
+        uint32_t l;
+
+        for (l = 0; l < sizeof(test_lookahead_samples) / sizeof(test_lookahead_samples[0]); l++) {
+            const uint32_t num_lookahead_samples = test_lookahead_samples[l];
+            uint32_t offset = 64 + num_lookahead_samples;
+            num_stages = RIZeroLatencyFFTConvolve_CalculateStages(64, offset, 100000, num_lookahead_samples, stages);
+            ASSERT_TRUE(num_stages <= RIBARACONVOLVE_MAX_NUM_STAGES);
+            for (i = 0; i < num_stages; i++) {
+                EXPECT_EQ(offset, stages[i].offset);
+                EXPECT_GE(stages[i].offset, stages[i].partition_size + num_lookahead_samples);
+                offset += stages[i].max_num_coefficients;
+            }
+            EXPECT_EQ(100000, offset);
+        }
+    }
+
+    /* 先頭係数長が先読みサンプル数（最大入力サンプル数の2倍）以下なら失敗 */
+    config.max_num_coefficients = 12000;
+    config.max_num_input_samples = 32;
+    config.fft_partition_size = 0;
+    config.num_head_coefficients = 2 * 32;
+    config.num_delay_samples = 0;
+    config.use_worker_thread = 1;
+    EXPECT_TRUE(RIZeroLatencyFFTConvolve_GetInterface()->CalculateWorkSize(&config) < 0);
+
+    /* 先頭係数長が分割サイズと先読みサンプル数の和未満なら失敗 */
+    config.fft_partition_size = 64;
+    config.num_head_coefficients = 64;
+    EXPECT_TRUE(RIZeroLatencyFFTConvolve_GetInterface()->CalculateWorkSize(&config) < 0);
+
+    /* 分割サイズ指定: 先頭係数長は分割サイズと先読みサンプル数の和 */
+    config.num_head_coefficients = 0;
+    ZeroLatencyConvolveCheck(&config, 12000, 32, &partition_size, &num_head_coefficients, &num_stages);
+    EXPECT_EQ(64, partition_size);
+    EXPECT_EQ(64 + 2 * 32, num_head_coefficients);
+
+    /* 先頭係数長も指定 */
+    config.fft_partition_size = 128;
+    config.num_head_coefficients = 300;
+    ZeroLatencyConvolveCheck(&config, 12000, 32, &partition_size, &num_head_coefficients, &num_stages);
+    EXPECT_EQ(128, partition_size);
+    EXPECT_EQ(300, num_head_coefficients);
+
+    /* 指定なし: 既定値 */
+    config.fft_partition_size = 0;
+    config.num_head_coefficients = 0;
+    ZeroLatencyConvolveCheck(&config, 12000, 32, &partition_size, &num_head_coefficients, &num_stages);
+    EXPECT_EQ(partition_size + 2 * 32, num_head_coefficients);
+
+    /* 大きい入力ブロック */
+    config.max_num_input_samples = 256;
+    ZeroLatencyConvolveCheck(&config, 12000, 256, &partition_size, &num_head_coefficients, &num_stages);
+    EXPECT_EQ(partition_size + 2 * 256, num_head_coefficients);
+
+    /* 係数が短ければ時間領域のみ */
+    ZeroLatencyConvolveCheck(&config, 50, 256, &partition_size, &num_head_coefficients, &num_stages);
+    EXPECT_EQ(0, num_stages);
+}
+
+/* ワーカースレッドの処理が間に合わない場合のテスト
+* スレッドを止めてから処理中のフラグを立て、ワーカースレッドが指定ブロック数だけ止まった状況を再現する */
+TEST(RIZeroLatencyFFTConvolveTest, DeadlineMissTest)
+{
+#define NUM_SAMPLES 16384
+#define NUM_COEFFICIENTS 3000
+#define NUM_BLOCK_SAMPLES 32
+#define STALL_START_BLOCK 20
+    const struct RIConvolveInterface *conv_if = RIZeroLatencyFFTConvolve_GetInterface();
+    struct RIConvolveConfig config;
+    struct RIZeroLatencyFFTConvolve *conv;
+    struct RIConvolveStatistics statistics;
+    void *work;
+    int64_t work_size;
+    uint32_t i, j, smpl, pattern, num_head_coefficients;
+    /* 先読みの範囲内・入力を失わない範囲・入力を失う長さ */
+    const uint32_t num_stall_blocks[] = { 2, 4, 10 };
+    static float coef[NUM_COEFFICIENTS];
+    static float input[NUM_SAMPLES];
+    static float output[NUM_SAMPLES];
+    static float answer[NUM_SAMPLES];
+    static float head_answer[NUM_SAMPLES];
+
+    srand(0);
+    for (i = 0; i < NUM_COEFFICIENTS; i++) {
+        coef[i] = 2.0f * ((float)rand() / RAND_MAX - 0.5f) / sqrtf((float)NUM_COEFFICIENTS);
+    }
+    for (smpl = 0; smpl < NUM_SAMPLES; smpl++) {
+        input[smpl] = 2.0f * ((float)rand() / RAND_MAX - 0.5f);
+    }
+
+    config.max_num_coefficients = NUM_COEFFICIENTS;
+    config.max_num_input_samples = NUM_BLOCK_SAMPLES;
+    config.fft_partition_size = 64;
+    config.num_head_coefficients = 0;
+    config.num_delay_samples = 0;
+    config.use_worker_thread = 1;
+    work_size = conv_if->CalculateWorkSize(&config);
+    ASSERT_TRUE(work_size > 0);
+    work = malloc((size_t)work_size);
+
+    for (pattern = 0; pattern < sizeof(num_stall_blocks) / sizeof(num_stall_blocks[0]); pattern++) {
+        const uint32_t stall_end_block = STALL_START_BLOCK + num_stall_blocks[pattern];
+        /* 先読みの2ブロックを超えた分は間に合わない */
+        const uint32_t num_missed_blocks = (num_stall_blocks[pattern] > 2) ? (num_stall_blocks[pattern] - 2) : 0;
+
+        conv = (struct RIZeroLatencyFFTConvolve *)conv_if->Create(&config, work, work_size);
+        ASSERT_TRUE(conv != NULL);
+        conv_if->SetCoefficients(conv, coef, NUM_COEFFICIENTS);
+        num_head_coefficients = RIZeroLatencyFFTConvolve_GetNumHeadCoefficients(conv);
+        EXPECT_EQ(64 + 2 * NUM_BLOCK_SAMPLES, num_head_coefficients);
+
+        /* 正解と先頭係数のみの結果 */
+        memset(answer, 0, sizeof(answer));
+        memset(head_answer, 0, sizeof(head_answer));
+        for (smpl = 0; smpl < NUM_SAMPLES; smpl++) {
+            for (j = 0; (j < NUM_COEFFICIENTS) && (smpl + j < NUM_SAMPLES); j++) {
+                answer[smpl + j] += coef[j] * input[smpl];
+                if (j < num_head_coefficients) {
+                    head_answer[smpl + j] += coef[j] * input[smpl];
+                }
+            }
+        }
+
+        /* 呼び出し元スレッドで処理させ、止まっている間だけ処理中に見せる */
+        RIZeroLatencyFFTConvolve_StopWorker(conv);
+        for (i = 0; i < NUM_SAMPLES / NUM_BLOCK_SAMPLES; i++) {
+            const uint8_t stall = ((i >= STALL_START_BLOCK) && (i < stall_end_block)) ? 1 : 0;
+            conv->worker_running = stall;
+            conv->worker_job_pending = stall;
+            conv_if->Convolve(conv, &input[i * NUM_BLOCK_SAMPLES], &output[i * NUM_BLOCK_SAMPLES], NUM_BLOCK_SAMPLES);
+        }
+        conv->worker_running = 0;
+        conv->worker_job_pending = 0;
+
+        /* 間に合わなかったブロックは先頭係数分のみ */
+        for (smpl = (STALL_START_BLOCK + 2) * NUM_BLOCK_SAMPLES; smpl < stall_end_block * NUM_BLOCK_SAMPLES; smpl++) {
+            EXPECT_NEAR(head_answer[smpl], output[smpl], 1e-4f);
+        }
+        /* 間に合ったブロックは一致 入力を失った場合はその影響が消えてから一致 */
+        for (smpl = 0; smpl < NUM_SAMPLES; smpl++) {
+            const uint32_t block = smpl / NUM_BLOCK_SAMPLES;
+            if ((block < STALL_START_BLOCK + 2)
+                    || ((num_stall_blocks[pattern] <= RIBARACONVOLVE_WORKER_INPUT_NUM_BLOCKS) && (block >= stall_end_block))
+                    || (smpl >= stall_end_block * NUM_BLOCK_SAMPLES + NUM_COEFFICIENTS)) {
+                EXPECT_NEAR(answer[smpl], output[smpl], 1e-4f);
+            }
+        }
+
+        if (conv_if->GetStatistics(conv, &statistics)) {
+            EXPECT_EQ((uint64_t)num_missed_blocks, statistics.num_deadline_misses);
+        }
+
+        conv_if->Destroy(conv);
+    }
+
+    free(work);
+#undef NUM_SAMPLES
+#undef NUM_COEFFICIENTS
+#undef NUM_BLOCK_SAMPLES
+#undef STALL_START_BLOCK
+}
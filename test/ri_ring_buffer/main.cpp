@@ -1,5 +1,7 @@
 #include <stdlib.h>
 #include <string.h>
+#include <algorithm>
+#include <thread>
 
 #include <gtest/gtest.h>
 
@@ -12,7 +14,7 @@ extern "C" {
 TEST(RIRingBufferTest, PutGetTest)
 {
     {
-        int32_t work_size;
+        int64_t work_size;
         void *work;
         struct RIRingBuffer *buf;
         struct RIRingBufferConfig config;
@@ -21,6 +23,8 @@ TEST(RIRingBufferTest, PutGetTest)
 
         config.max_size = 6;
         config.max_required_size = 3;
+        config.enable_spsc = 0;
+        config.use_mirrored_memory = 0;
 
         work_size = RIRingBuffer_CalculateWorkSize(&config);
         ASSERT_TRUE(work_size >= 0);
@@ -94,10 +98,435 @@ TEST(RIRingBufferTest, PutGetTest)
         EXPECT_EQ(6, RIRingBuffer_GetCapacitySize(buf));
 
         RIRingBuffer_Destroy(buf);
-        free(buf);
+        free(work);
     }
 }
 
+/* Reserve / Commitテスト */
+TEST(RIRingBufferTest, ReserveCommitTest)
+{
+    int64_t work_size;
+    void *work;
+    struct RIRingBuffer *buf;
+    struct RIRingBufferConfig config;
+    const char data[] = "0123456789";
+    char *tmp, *wp;
+
+    config.max_size = 6;
+    config.max_required_size = 3;
+    config.enable_spsc = 0;
+    config.use_mirrored_memory = 0;
+
+    work_size = RIRingBuffer_CalculateWorkSize(&config);
+    ASSERT_TRUE(work_size >= 0);
+    work = malloc(work_size);
+    buf = RIRingBuffer_Create(&config, work, work_size);
+    ASSERT_TRUE(buf != NULL);
+
+    /* 異常系 */
+    EXPECT_EQ(RIRINGBUFFER_APIRESULT_INVALID_ARGUMENT, RIRingBuffer_Reserve(NULL, (void **)&wp, 1));
+    EXPECT_EQ(RIRINGBUFFER_APIRESULT_INVALID_ARGUMENT, RIRingBuffer_Reserve(buf, NULL, 1));
+    EXPECT_EQ(RIRINGBUFFER_APIRESULT_INVALID_ARGUMENT, RIRingBuffer_Reserve(buf, (void **)&wp, 0));
+    EXPECT_EQ(RIRINGBUFFER_APIRESULT_EXCEED_MAX_REQUIRED, RIRingBuffer_Reserve(buf, (void **)&wp, 4));
+    EXPECT_EQ(RIRINGBUFFER_APIRESULT_INVALID_ARGUMENT, RIRingBuffer_Commit(buf, 0));
+
+    /* 確定するまでは見えない */
+    EXPECT_EQ(RIRINGBUFFER_APIRESULT_OK, RIRingBuffer_Reserve(buf, (void **)&wp, 3));
+    memcpy(wp, &data[0], 3);
+    EXPECT_EQ(0, RIRingBuffer_GetRemainSize(buf));
+    EXPECT_EQ(RIRINGBUFFER_APIRESULT_OK, RIRingBuffer_Commit(buf, 2));
+    EXPECT_EQ(2, RIRingBuffer_GetRemainSize(buf));
+    EXPECT_EQ(4, RIRingBuffer_GetCapacitySize(buf));
+
+    /* Putと混在させても順序通り */
+    EXPECT_EQ(RIRINGBUFFER_APIRESULT_OK, RIRingBuffer_Put(buf, &data[2], 2));
+    EXPECT_EQ(RIRINGBUFFER_APIRESULT_OK, RIRingBuffer_Get(buf, (void **)&tmp, 3));
+    EXPECT_EQ(0, memcmp(tmp, &data[0], 3));
+
+    /* 末尾を跨いで確保/確定し、連続領域として読めること */
+    EXPECT_EQ(RIRINGBUFFER_APIRESULT_OK, RIRingBuffer_Reserve(buf, (void **)&wp, 3));
+    memcpy(wp, &data[4], 3);
+    EXPECT_EQ(RIRINGBUFFER_APIRESULT_OK, RIRingBuffer_Commit(buf, 3));
+    EXPECT_EQ(4, RIRingBuffer_GetRemainSize(buf));
+    EXPECT_EQ(RIRINGBUFFER_APIRESULT_OK, RIRingBuffer_Get(buf, (void **)&tmp, 1));
+    EXPECT_EQ(tmp[0], data[3]);
+    EXPECT_EQ(RIRINGBUFFER_APIRESULT_OK, RIRingBuffer_Get(buf, (void **)&tmp, 3));
+    EXPECT_EQ(0, memcmp(tmp, &data[4], 3));
+
+    /* 先頭付近に書いた内容が剰余領域にも反映されていること */
+    EXPECT_EQ(RIRINGBUFFER_APIRESULT_OK, RIRingBuffer_Reserve(buf, (void **)&wp, 3));
+    memcpy(wp, &data[7], 3);
+    EXPECT_EQ(RIRINGBUFFER_APIRESULT_OK, RIRingBuffer_Commit(buf, 3));
+    EXPECT_EQ(RIRINGBUFFER_APIRESULT_OK, RIRingBuffer_Put(buf, &data[0], 3));
+    EXPECT_EQ(RIRINGBUFFER_APIRESULT_OK, RIRingBuffer_Get(buf, (void **)&tmp, 3));
+    EXPECT_EQ(0, memcmp(tmp, &data[7], 3));
+    EXPECT_EQ(RIRINGBUFFER_APIRESULT_OK, RIRingBuffer_Get(buf, (void **)&tmp, 3));
+    EXPECT_EQ(0, memcmp(tmp, &data[0], 3));
+    EXPECT_EQ(0, RIRingBuffer_GetRemainSize(buf));
+
+    /* 空きがなければ確保できない */
+    EXPECT_EQ(RIRINGBUFFER_APIRESULT_OK, RIRingBuffer_Put(buf, &data[0], 5));
+    EXPECT_EQ(RIRINGBUFFER_APIRESULT_EXCEED_MAX_CAPACITY, RIRingBuffer_Reserve(buf, (void **)&wp, 2));
+
+    RIRingBuffer_Destroy(buf);
+    free(work);
+}
+
+/* 巡回しても取得/確保する領域のアラインメントが崩れないかのテスト */
+TEST(RIRingBufferTest, AlignmentTest)
+{
+    int64_t work_size;
+    void *work;
+    struct RIRingBuffer *buf;
+    struct RIRingBufferConfig config;
+    uint8_t data[16 * 7];
+    size_t unit, i;
+    void *ptr;
+
+    memset(data, 0, sizeof(data));
+
+    /* 単位サイズの倍数で読み書きすれば、単位サイズ境界に揃う */
+    for (unit = 1; unit <= 16; unit *= 2) {
+        uint32_t seed = 1;
+
+        /* バッファサイズは半端な値にする */
+        config.max_size = unit * 29 + 3;
+        config.max_required_size = unit * 7;
+        config.enable_spsc = 0;
+        config.use_mirrored_memory = 0;
+
+        work_size = RIRingBuffer_CalculateWorkSize(&config);
+        ASSERT_TRUE(work_size >= 0);
+        work = malloc(work_size);
+        buf = RIRingBuffer_Create(&config, work, work_size);
+        ASSERT_TRUE(buf != NULL);
+
+        /* 格納できるサイズは指定通り */
+        EXPECT_EQ(config.max_size, RIRingBuffer_GetCapacitySize(buf));
+
+        for (i = 0; i < 1000; i++) {
+            size_t size;
+            seed = seed * 1103515245 + 12345;
+            size = unit * ((seed >> 16) % 7 + 1);
+            /* Put/Reserveを交互に使って書き込み */
+            if (RIRingBuffer_GetCapacitySize(buf) >= size) {
+                if (seed & 0x80000000U) {
+                    EXPECT_EQ(RIRINGBUFFER_APIRESULT_OK, RIRingBuffer_Put(buf, data, size));
+                } else {
+                    EXPECT_EQ(RIRINGBUFFER_APIRESULT_OK, RIRingBuffer_Reserve(buf, &ptr, size));
+                    EXPECT_EQ(0, (uintptr_t)ptr % unit);
+                    EXPECT_EQ(RIRINGBUFFER_APIRESULT_OK, RIRingBuffer_Commit(buf, size));
+                }
+            }
+            /* 書き込みとは別のサイズで読み出し */
+            seed = seed * 1103515245 + 12345;
+            size = unit * ((seed >> 16) % 7 + 1);
+            if (RIRingBuffer_GetRemainSize(buf) >= size) {
+                EXPECT_EQ(RIRINGBUFFER_APIRESULT_OK, RIRingBuffer_Get(buf, &ptr, size));
+                EXPECT_EQ(0, (uintptr_t)ptr % unit);
+            }
+        }
+
+        RIRingBuffer_Destroy(buf);
+        free(work);
+    }
+}
+
+#if defined(RIRINGBUFFER_SUPPORT_MIRRORED_MEMORY)
+/* 鏡像マップしたバッファのテスト */
+TEST(RIRingBufferTest, MirroredMemoryTest)
+{
+    int64_t work_size;
+    void *work;
+    struct RIRingBuffer *buf;
+    struct RIRingBufferConfig config;
+    uint8_t data[256], *tmp, *wp;
+    size_t i, capacity, half;
+
+    for (i = 0; i < sizeof(data); i++) {
+        data[i] = (uint8_t)i;
+    }
+
+    config.max_size = 100;
+    config.max_required_size = 1;
+    config.enable_spsc = 0;
+    config.use_mirrored_memory = 1;
+
+    /* データ領域はワーク外 */
+    work_size = RIRingBuffer_CalculateWorkSize(&config);
+    ASSERT_TRUE(work_size >= 0);
+    EXPECT_TRUE(work_size < (int64_t)(sizeof(struct RIRingBuffer) + config.max_size));
+    work = malloc(work_size);
+    buf = RIRingBuffer_Create(&config, work, work_size);
+    ASSERT_TRUE(buf != NULL);
+
+    /* バッファサイズはページサイズの倍数に切り上がる */
+    EXPECT_EQ(0, buf->buffer_size % (size_t)sysconf(_SC_PAGESIZE));
+    capacity = RIRingBuffer_GetCapacitySize(buf);
+    EXPECT_EQ(buf->buffer_size - 1, capacity);
+    EXPECT_TRUE(capacity >= config.max_size);
+
+    /* 後半は前半と同じ物理ページ */
+    buf->data[0] = 0xAB;
+    EXPECT_EQ(0xAB, buf->data[buf->buffer_size]);
+    buf->data[0] = 0;
+
+    /* 末尾近くまで進める */
+    half = buf->buffer_size - 10;
+    for (i = 0; i < half; i += sizeof(data)) {
+        const size_t size = std::min(sizeof(data), half - i);
+        EXPECT_EQ(RIRINGBUFFER_APIRESULT_OK, RIRingBuffer_Put(buf, data, size));
+        EXPECT_EQ(RIRINGBUFFER_APIRESULT_OK, RIRingBuffer_Get(buf, (void **)&tmp, size));
+    }
+    EXPECT_EQ(0, RIRingBuffer_GetRemainSize(buf));
+
+    /* 末尾を跨ぐ書き込み/読み出しが取り出し最大サイズを超えて連続領域で行える */
+    EXPECT_EQ(RIRINGBUFFER_APIRESULT_OK, RIRingBuffer_Put(buf, data, sizeof(data)));
+    EXPECT_EQ(RIRINGBUFFER_APIRESULT_OK, RIRingBuffer_Peek(buf, (void **)&tmp, sizeof(data)));
+    EXPECT_EQ(0, memcmp(tmp, data, sizeof(data)));
+    EXPECT_EQ(data[10], buf->data[0]);
+    EXPECT_EQ(RIRINGBUFFER_APIRESULT_OK, RIRingBuffer_Get(buf, (void **)&tmp, sizeof(data)));
+
+    /* 確保/確定も同様 */
+    EXPECT_EQ(RIRINGBUFFER_APIRESULT_OK, RIRingBuffer_Reserve(buf, (void **)&wp, capacity));
+    memset(wp, 0x5A, capacity);
+    EXPECT_EQ(RIRINGBUFFER_APIRESULT_OK, RIRingBuffer_Commit(buf, capacity));
+    EXPECT_EQ(0, RIRingBuffer_GetCapacitySize(buf));
+    EXPECT_EQ(RIRINGBUFFER_APIRESULT_EXCEED_MAX_CAPACITY, RIRingBuffer_Reserve(buf, (void **)&wp, 1));
+    EXPECT_EQ(RIRINGBUFFER_APIRESULT_OK, RIRingBuffer_Get(buf, (void **)&tmp, capacity));
+    for (i = 0; i < capacity; i++) {
+        EXPECT_EQ(0x5A, tmp[i]);
+    }
+
+    RIRingBuffer_Destroy(buf);
+    free(work);
+}
+#endif
+
+/* ワークサイズのオーバーフローテスト */
+TEST(RIRingBufferTest, WorkSizeOverflowTest)
+{
+    struct RIRingBufferConfig config;
+    uint8_t work[1];
+
+    config.max_size = SIZE_MAX;
+    config.max_required_size = 0;
+    config.enable_spsc = 0;
+    config.use_mirrored_memory = 0;
+    EXPECT_EQ(-1, RIRingBuffer_CalculateWorkSize(&config));
+    EXPECT_TRUE(RIRingBuffer_Create(&config, work, INT64_MAX) == NULL);
+
+    config.max_size = SIZE_MAX / 2;
+    config.max_required_size = SIZE_MAX / 2;
+    EXPECT_EQ(-1, RIRingBuffer_CalculateWorkSize(&config));
+    EXPECT_TRUE(RIRingBuffer_Create(&config, work, INT64_MAX) == NULL);
+}
+
+#if defined(RIRINGBUFFER_SUPPORT_MIRRORED_MEMORY)
+/* 32bitを超える位置での読み書きテスト */
+TEST(RIRingBufferTest, LargePositionTest)
+{
+    int64_t work_size;
+    void *work;
+    struct RIRingBuffer *buf;
+    struct RIRingBufferConfig config;
+    uint8_t data[256], *tmp;
+    size_t i, pos;
+
+    /* 64bit環境のみ */
+    if (SIZE_MAX <= UINT32_MAX) {
+        return;
+    }
+
+    for (i = 0; i < sizeof(data); i++) {
+        data[i] = (uint8_t)i;
+    }
+
+    /* 鏡像マップは触れたページのみ実メモリを使うため、大きなバッファを確保できる */
+    config.max_size = ((size_t)1 << 32) + 1000;
+    config.max_required_size = 1;
+    config.enable_spsc = 1;
+    config.use_mirrored_memory = 1;
+
+    work_size = RIRingBuffer_CalculateWorkSize(&config);
+    ASSERT_TRUE(work_size >= 0);
+    work = malloc((size_t)work_size);
+    buf = RIRingBuffer_Create(&config, work, work_size);
+    ASSERT_TRUE(buf != NULL);
+    EXPECT_GT(RIRingBuffer_GetCapacitySize(buf), (size_t)UINT32_MAX);
+
+    /* 32bitを超えた位置から開始し、末尾を跨いで読み書き */
+    pos = buf->buffer_size - 100;
+    ASSERT_GT(pos, (size_t)UINT32_MAX);
+    buf->read_pos = buf->get_pos = buf->write_pos = pos;
+    EXPECT_EQ(0, RIRingBuffer_GetRemainSize(buf));
+    EXPECT_EQ(RIRINGBUFFER_APIRESULT_OK, RIRingBuffer_Put(buf, data, sizeof(data)));
+    EXPECT_EQ(sizeof(data), RIRingBuffer_GetRemainSize(buf));
+    EXPECT_EQ(RIRINGBUFFER_APIRESULT_OK, RIRingBuffer_Get(buf, (void **)&tmp, sizeof(data)));
+    EXPECT_EQ(0, memcmp(tmp, data, sizeof(data)));
+    EXPECT_EQ(sizeof(data) - 100, buf->get_pos);
+
+    /* 剰余が32bitで切り詰められないこと */
+    buf->read_pos = buf->get_pos = buf->write_pos = (size_t)UINT32_MAX - 10;
+    EXPECT_EQ(RIRINGBUFFER_APIRESULT_OK, RIRingBuffer_Put(buf, data, sizeof(data)));
+    EXPECT_EQ((size_t)UINT32_MAX - 10 + sizeof(data), buf->write_pos);
+    EXPECT_EQ(RIRINGBUFFER_APIRESULT_OK, RIRingBuffer_Get(buf, (void **)&tmp, sizeof(data)));
+    EXPECT_EQ(0, memcmp(tmp, data, sizeof(data)));
+
+    RIRingBuffer_Destroy(buf);
+    free(work);
+}
+#endif
+
+/* SPSCモードの単一スレッドでの動作テスト */
+TEST(RIRingBufferTest, SPSCPutGetTest)
+{
+    int64_t work_size;
+    void *work;
+    struct RIRingBuffer *buf;
+    struct RIRingBufferConfig config;
+    const char data[] = "0123456789";
+    char *tmp;
+
+    config.max_size = 6;
+    config.max_required_size = 3;
+    config.enable_spsc = 1;
+    config.use_mirrored_memory = 0;
+
+    work_size = RIRingBuffer_CalculateWorkSize(&config);
+    ASSERT_TRUE(work_size >= 0);
+    work = malloc(work_size);
+
+    buf = RIRingBuffer_Create(&config, work, work_size);
+    ASSERT_TRUE(buf != NULL);
+
+    /* 読み出し/書き込み位置は別のキャッシュラインにある */
+    EXPECT_GE((uintptr_t)&buf->write_pos - (uintptr_t)&buf->read_pos, (uintptr_t)RIRINGBUFFER_CACHE_LINE_SIZE);
+    EXPECT_GE((uintptr_t)&buf->read_pos - (uintptr_t)&buf->enable_spsc, (uintptr_t)RIRINGBUFFER_CACHE_LINE_SIZE);
+
+    EXPECT_EQ(RIRINGBUFFER_APIRESULT_OK, RIRingBuffer_Put(buf, &data[0], 6));
+    EXPECT_EQ(6, RIRingBuffer_GetRemainSize(buf));
+    EXPECT_EQ(0, RIRingBuffer_GetCapacitySize(buf));
+
+    /* 取得した領域は次の読み出し操作まで解放されない */
+    EXPECT_EQ(RIRINGBUFFER_APIRESULT_OK, RIRingBuffer_Get(buf, (void **)&tmp, 3));
+    EXPECT_EQ(0, memcmp(tmp, &data[0], 3));
+    EXPECT_EQ(3, RIRingBuffer_GetRemainSize(buf));
+    EXPECT_EQ(0, RIRingBuffer_GetCapacitySize(buf));
+    EXPECT_EQ(RIRINGBUFFER_APIRESULT_EXCEED_MAX_CAPACITY, RIRingBuffer_Put(buf, &data[6], 1));
+
+    /* 次の取得で前回分が解放される */
+    EXPECT_EQ(RIRINGBUFFER_APIRESULT_OK, RIRingBuffer_Peek(buf, (void **)&tmp, 3));
+    EXPECT_EQ(0, memcmp(tmp, &data[3], 3));
+    EXPECT_EQ(3, RIRingBuffer_GetCapacitySize(buf));
+    EXPECT_EQ(RIRINGBUFFER_APIRESULT_OK, RIRingBuffer_Get(buf, (void **)&tmp, 3));
+    EXPECT_EQ(0, memcmp(tmp, &data[3], 3));
+    EXPECT_EQ(0, RIRingBuffer_GetRemainSize(buf));
+    EXPECT_EQ(3, RIRingBuffer_GetCapacitySize(buf));
+
+    /* 巡回しても連続領域として読める */
+    EXPECT_EQ(RIRINGBUFFER_APIRESULT_OK, RIRingBuffer_Put(buf, &data[4], 3));
+    EXPECT_EQ(RIRINGBUFFER_APIRESULT_OK, RIRingBuffer_Get(buf, (void **)&tmp, 3));
+    EXPECT_EQ(0, memcmp(tmp, &data[4], 3));
+    EXPECT_EQ(RIRINGBUFFER_APIRESULT_EXCEED_MAX_REMAIN, RIRingBuffer_Get(buf, (void **)&tmp, 1));
+    EXPECT_EQ(6, RIRingBuffer_GetCapacitySize(buf));
+
+    RIRingBuffer_Destroy(buf);
+    free(work);
+}
+
+/* SPSCモードの2スレッド間受け渡しテスト */
+TEST(RIRingBufferTest, SPSCStressTest)
+{
+#define NUM_TOTAL_WORDS (1 << 20)
+#define MAX_NUM_WORDS 37
+    int64_t work_size;
+    void *work;
+    struct RIRingBuffer *buf;
+    struct RIRingBufferConfig config;
+    uint32_t num_errors = 0;
+
+    /* 巡回位置が毎回ずれるよう、半端なサイズにする */
+    config.max_size = sizeof(uint32_t) * 101 + 3;
+    config.max_required_size = sizeof(uint32_t) * MAX_NUM_WORDS;
+    config.enable_spsc = 1;
+    config.use_mirrored_memory = 0;
+
+    work_size = RIRingBuffer_CalculateWorkSize(&config);
+    ASSERT_TRUE(work_size >= 0);
+    work = malloc(work_size);
+    buf = RIRingBuffer_Create(&config, work, work_size);
+    ASSERT_TRUE(buf != NULL);
+
+    /* 書き込みスレッド: 連番を乱数長に区切って書き込む */
+    std::thread producer([buf]() {
+        uint32_t count = 0, seed = 1;
+        uint32_t words[MAX_NUM_WORDS];
+        while (count < NUM_TOTAL_WORDS) {
+            uint32_t i, num_words;
+            seed = seed * 1103515245 + 12345;
+            num_words = std::min<uint32_t>((seed >> 16) % MAX_NUM_WORDS + 1, NUM_TOTAL_WORDS - count);
+            if (seed & 0x80000000U) {
+                for (i = 0; i < num_words; i++) {
+                    words[i] = count + i;
+                }
+                while (RIRingBuffer_Put(buf, words, sizeof(uint32_t) * num_words) != RIRINGBUFFER_APIRESULT_OK) {
+                    std::this_thread::yield();
+                }
+            } else {
+                /* 確保した領域に直接書き込む */
+                void *ptr;
+                uint8_t *wp;
+                while (RIRingBuffer_Reserve(buf, &ptr, sizeof(uint32_t) * num_words) != RIRINGBUFFER_APIRESULT_OK) {
+                    std::this_thread::yield();
+                }
+                wp = (uint8_t *)ptr;
+                for (i = 0; i < num_words; i++) {
+                    const uint32_t word = count + i;
+                    memcpy(&wp[sizeof(uint32_t) * i], &word, sizeof(uint32_t));
+                }
+                EXPECT_EQ(RIRINGBUFFER_APIRESULT_OK, RIRingBuffer_Commit(buf, sizeof(uint32_t) * num_words));
+            }
+            count += num_words;
+        }
+    });
+
+    /* 読み出しスレッド: 書き込みとは別の区切りで読み出して連番を確認 */
+    std::thread consumer([buf, &num_errors]() {
+        uint32_t count = 0, seed = 2;
+        while (count < NUM_TOTAL_WORDS) {
+            uint32_t i, num_words;
+            void *ptr;
+            const uint8_t *words;
+            seed = seed * 1103515245 + 12345;
+            num_words = std::min<uint32_t>((seed >> 16) % MAX_NUM_WORDS + 1, NUM_TOTAL_WORDS - count);
+            while (RIRingBuffer_Get(buf, &ptr, sizeof(uint32_t) * num_words) != RIRINGBUFFER_APIRESULT_OK) {
+                std::this_thread::yield();
+            }
+            /* 取得した領域は次のGetまで書き換わらないはず */
+            words = (const uint8_t *)ptr;
+            std::this_thread::yield();
+            for (i = 0; i < num_words; i++) {
+                uint32_t word;
+                memcpy(&word, &words[sizeof(uint32_t) * i], sizeof(uint32_t));
+                if (word != count + i) {
+                    num_errors++;
+                }
+            }
+            count += num_words;
+        }
+    });
+
+    producer.join();
+    consumer.join();
+    EXPECT_EQ(0, num_errors);
+
+    RIRingBuffer_Destroy(buf);
+    free(work);
+#undef NUM_TOTAL_WORDS
+#undef MAX_NUM_WORDS
+}
+
 int main(int argc, char **argv)
 {
     ::testing::InitGoogleTest(&argc, argv);